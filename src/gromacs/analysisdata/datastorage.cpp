@@ -55,6 +55,7 @@
 #include "gromacs/analysisdata/paralleloptions.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/mutex.h"
 
 namespace gmx
 {
@@ -245,7 +246,7 @@ class AnalysisDataStorageImpl
          * There is always one unused frame in the buffer, which is initialized
          * such that when \a firstFrameLocation_ is incremented, it becomes
          * valid.  This makes it easier to rotate the buffer in concurrent
-         * access scenarions (which are not yet otherwise implemented).
+         * access scenarions.
          */
         FrameList               frames_;
         //! Location of oldest frame in \a frames_.
@@ -270,6 +271,14 @@ class AnalysisDataStorageImpl
          * frame (see \a frames_).
          */
         int                     nextIndex_;
+        /*! \brief
+         * Protects the storage state when several frames are constructed
+         * concurrently from different threads.
+         *
+         * Only the operations that access state shared between frames are
+         * protected; each frame is only accessed from a single thread.
+         */
+        Mutex                   mutex_;
 };
 
 /********************************************************************
@@ -497,7 +506,8 @@ AnalysisDataStorageImpl::getFrameBuilder()
 void
 AnalysisDataStorageImpl::finishFrame(int index)
 {
-    const int storageIndex = computeStorageLocation(index);
+    lock_guard<Mutex> lock(mutex_);
+    const int         storageIndex = computeStorageLocation(index);
     GMX_RELEASE_ASSERT(storageIndex >= 0, "Out of bounds frame index");
 
     AnalysisDataStorageFrameData &storedFrame = *frames_[storageIndex];
@@ -617,6 +627,7 @@ AnalysisDataStorageFrameData::addPointSet(int dataSetIndex, int firstColumn,
                                           dataSetIndex, firstColumn);
     AnalysisDataPointSetRef  pointSet(header(), pointSetInfo,
                                       constArrayRefFromVector<AnalysisDataValue>(begin, end));
+    lock_guard<Mutex>        lock(storageImpl().mutex_);
     storageImpl().modules_->notifyParallelPointsAdd(pointSet);
     if (storageImpl().shouldNotifyImmediately())
     {
@@ -865,6 +876,7 @@ AnalysisDataStorageFrame &
 AnalysisDataStorage::startFrame(const AnalysisDataFrameHeader &header)
 {
     GMX_ASSERT(header.isValid(), "Invalid header");
+    lock_guard<Mutex>                       lock(impl_->mutex_);
     internal::AnalysisDataStorageFrameData *storedFrame;
     if (impl_->storeAll())
     {
@@ -908,7 +920,8 @@ AnalysisDataStorage::startFrame(int index, real x, real dx)
 AnalysisDataStorageFrame &
 AnalysisDataStorage::currentFrame(int index)
 {
-    const int storageIndex = impl_->computeStorageLocation(index);
+    lock_guard<Mutex> lock(impl_->mutex_);
+    const int         storageIndex = impl_->computeStorageLocation(index);
     GMX_RELEASE_ASSERT(storageIndex >= 0, "Out of bounds frame index");
 
     internal::AnalysisDataStorageFrameData &storedFrame = *impl_->frames_[storageIndex];
@@ -933,6 +946,7 @@ AnalysisDataStorage::finishFrameSerial(int index)
 {
     if (impl_->pendingLimit_ > 1)
     {
+        lock_guard<Mutex> lock(impl_->mutex_);
         impl_->finishFrameSerial(index);
     }
 }
@@ -104,6 +104,8 @@ int many_auto_correl(std::vector<std::vector<real> > *c)
                     in[2*j+0] = (*c)[i][j];
                     in[2*j+1] = 0;
                 }
+                /* Clear the padding, which holds the spectrum of the previous function */
+                std::fill(in.begin() + 2*ndata, in.end(), 0);
                 gmx_fft_1d(fft1, GMX_FFT_BACKWARD, (void *)in.data(), (void *)out.data());
                 for (size_t j = 0; j < nfft; j++)
                 {
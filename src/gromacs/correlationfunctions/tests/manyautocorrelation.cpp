@@ -81,6 +81,37 @@ TEST_F (ManyAutocorrelationTest, DifferentLength)
 }
 #endif
 
+TEST_F (ManyAutocorrelationTest, ManyFunctionsMatchDirectSum)
+{
+    const int                       nfunc = 5, ndata = 37;
+    std::vector<std::vector<real> > c(nfunc), ref(nfunc);
+    for (int i = 0; i < nfunc; i++)
+    {
+        c[i].resize(ndata);
+        for (int j = 0; j < ndata; j++)
+        {
+            c[i][j] = std::sin(0.3*(i + 1)*j) + 0.1*i;
+        }
+        ref[i].resize(ndata, 0);
+        for (int m = 0; m < ndata; m++)
+        {
+            for (int j = 0; j + m < ndata; j++)
+            {
+                ref[i][m] += c[i][j]*c[i][j + m];
+            }
+        }
+    }
+    EXPECT_EQ(0, many_auto_correl(&c));
+    // Only the lags up to half the length are free of periodic images
+    for (int i = 0; i < nfunc; i++)
+    {
+        for (int m = 0; m <= ndata/2; m++)
+        {
+            EXPECT_REAL_EQ_TOL(ref[i][m], c[i][m], test::relativeToleranceAsFloatingPoint(ndata, 1e-4));
+        }
+    }
+}
+
 }
 
 }
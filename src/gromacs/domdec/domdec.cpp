@@ -47,12 +47,14 @@
 #include <string.h>
 
 #include <algorithm>
+#include <vector>
 
 #include "gromacs/domdec/domdec_network.h"
 #include "gromacs/domdec/ga2la.h"
 #include "gromacs/ewald/pme.h"
 #include "gromacs/fileio/gmxfio.h"
 #include "gromacs/fileio/pdbio.h"
+#include "gromacs/fileio/xtcio.h"
 #include "gromacs/gmxlib/chargegroup.h"
 #include "gromacs/gmxlib/network.h"
 #include "gromacs/gmxlib/nrnb.h"
@@ -390,10 +392,116 @@ void dd_get_constraint_range(const gmx_domdec_t *dd, int *at_start, int *at_end)
     *at_end   = dd->comm->nat[ddnatCON];
 }
 
-void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[])
+/*! \brief Packs the coordinates to send for pulse \p ind into \p buf
+ *
+ * Without charge groups the atom and buffer indices are identical,
+ * which allows for simple OpenMP parallelization of the packing.
+ */
+static void dd_pack_x(const gmx_domdec_t *dd, const gmx_domdec_ind_t *ind,
+                      int nzone, gmx_bool bPBC, gmx_bool bScrew,
+                      const rvec shift, matrix box, const rvec x[], rvec *buf)
 {
-    int                    nzone, nat_tot, n, d, p, i, j, at0, at1, zone;
-    int                   *index, *cgindex;
+    const int *index   = ind->index;
+    const int *cgindex = dd->cgindex;
+    const int  nsend   = ind->nsend[nzone];
+    int        n       = 0;
+
+    if (!dd->comm->bCGs)
+    {
+        /* Only use multiple threads when there is sufficient work */
+        const int nthread = (nsend >= 1000 ? dd->comm->nth : 1);
+
+        if (!bPBC)
+        {
+#pragma omp parallel for num_threads(nthread) schedule(static)
+            for (int i = 0; i < nsend; i++)
+            {
+                copy_rvec(x[index[i]], buf[i]);
+            }
+        }
+        else if (!bScrew)
+        {
+#pragma omp parallel for num_threads(nthread) schedule(static)
+            for (int i = 0; i < nsend; i++)
+            {
+                /* We need to shift the coordinates */
+                rvec_add(x[index[i]], shift, buf[i]);
+            }
+        }
+        else
+        {
+#pragma omp parallel for num_threads(nthread) schedule(static)
+            for (int i = 0; i < nsend; i++)
+            {
+                const int j = index[i];
+                /* Shift x, rotate y and z, see below */
+                buf[i][XX] = x[j][XX] + shift[XX];
+                buf[i][YY] = box[YY][YY] - x[j][YY];
+                buf[i][ZZ] = box[ZZ][ZZ] - x[j][ZZ];
+            }
+        }
+
+        return;
+    }
+
+    if (!bPBC)
+    {
+        for (int i = 0; i < nsend; i++)
+        {
+            int at0 = cgindex[index[i]];
+            int at1 = cgindex[index[i]+1];
+            for (int j = at0; j < at1; j++)
+            {
+                copy_rvec(x[j], buf[n]);
+                n++;
+            }
+        }
+    }
+    else if (!bScrew)
+    {
+        for (int i = 0; i < nsend; i++)
+        {
+            int at0 = cgindex[index[i]];
+            int at1 = cgindex[index[i]+1];
+            for (int j = at0; j < at1; j++)
+            {
+                /* We need to shift the coordinates */
+                rvec_add(x[j], shift, buf[n]);
+                n++;
+            }
+        }
+    }
+    else
+    {
+        for (int i = 0; i < nsend; i++)
+        {
+            int at0 = cgindex[index[i]];
+            int at1 = cgindex[index[i]+1];
+            for (int j = at0; j < at1; j++)
+            {
+                /* Shift x */
+                buf[n][XX] = x[j][XX] + shift[XX];
+                /* Rotate y and z.
+                 * This operation requires a special shift force
+                 * treatment, which is performed in calc_vir.
+                 */
+                buf[n][YY] = box[YY][YY] - x[j][YY];
+                buf[n][ZZ] = box[ZZ][ZZ] - x[j][ZZ];
+                n++;
+            }
+        }
+    }
+}
+
+/*! \brief Communicates the halo coordinates for all dimensions and pulses
+ *
+ * When \p bFirstPulseStarted is TRUE, the first pulse has been packed
+ * and started by dd_move_x_start and only needs to be completed.
+ */
+static void dd_move_x_pulses(gmx_domdec_t *dd, matrix box, rvec x[],
+                             gmx_bool bFirstPulseStarted)
+{
+    int                    nzone, nat_tot, d, p, i, j, zone;
     gmx_domdec_comm_t     *comm;
     gmx_domdec_comm_dim_t *cd;
     gmx_domdec_ind_t      *ind;
@@ -402,8 +510,6 @@ void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[])
 
     comm = dd->comm;
 
-    cgindex = dd->cgindex;
-
     buf = comm->vbuf.v;
 
     nzone   = 1;
@@ -420,68 +526,28 @@ void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[])
         for (p = 0; p < cd->np; p++)
         {
             ind   = &cd->ind[p];
-            index = ind->index;
-            n     = 0;
-            if (!bPBC)
-            {
-                for (i = 0; i < ind->nsend[nzone]; i++)
-                {
-                    at0 = cgindex[index[i]];
-                    at1 = cgindex[index[i]+1];
-                    for (j = at0; j < at1; j++)
-                    {
-                        copy_rvec(x[j], buf[n]);
-                        n++;
-                    }
-                }
-            }
-            else if (!bScrew)
+
+            if (cd->bInPlace)
             {
-                for (i = 0; i < ind->nsend[nzone]; i++)
-                {
-                    at0 = cgindex[index[i]];
-                    at1 = cgindex[index[i]+1];
-                    for (j = at0; j < at1; j++)
-                    {
-                        /* We need to shift the coordinates */
-                        rvec_add(x[j], shift, buf[n]);
-                        n++;
-                    }
-                }
+                rbuf = x + nat_tot;
             }
             else
             {
-                for (i = 0; i < ind->nsend[nzone]; i++)
-                {
-                    at0 = cgindex[index[i]];
-                    at1 = cgindex[index[i]+1];
-                    for (j = at0; j < at1; j++)
-                    {
-                        /* Shift x */
-                        buf[n][XX] = x[j][XX] + shift[XX];
-                        /* Rotate y and z.
-                         * This operation requires a special shift force
-                         * treatment, which is performed in calc_vir.
-                         */
-                        buf[n][YY] = box[YY][YY] - x[j][YY];
-                        buf[n][ZZ] = box[ZZ][ZZ] - x[j][ZZ];
-                        n++;
-                    }
-                }
+                rbuf = comm->vbuf2.v;
             }
-
-            if (cd->bInPlace)
+            if (d == 0 && p == 0 && bFirstPulseStarted)
             {
-                rbuf = x + nat_tot;
+                dd_sendrecv_wait(dd);
             }
             else
             {
-                rbuf = comm->vbuf2.v;
+                dd_pack_x(dd, ind, nzone, bPBC, bScrew, shift, box, x, buf);
+
+                /* Send and receive the coordinates */
+                dd_sendrecv_rvec(dd, d, dddirBackward,
+                                 buf,  ind->nsend[nzone+1],
+                                 rbuf, ind->nrecv[nzone+1]);
             }
-            /* Send and receive the coordinates */
-            dd_sendrecv_rvec(dd, d, dddirBackward,
-                             buf,  ind->nsend[nzone+1],
-                             rbuf, ind->nrecv[nzone+1]);
             if (!cd->bInPlace)
             {
                 j = 0;
@@ -500,6 +566,54 @@ void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[])
     }
 }
 
+void dd_move_x(gmx_domdec_t *dd, matrix box, rvec x[])
+{
+    dd_move_x_pulses(dd, box, x, FALSE);
+}
+
+void dd_move_x_start(gmx_domdec_t *dd, matrix box, rvec x[])
+{
+    gmx_domdec_comm_t     *comm = dd->comm;
+    gmx_domdec_comm_dim_t *cd   = &comm->cd[0];
+    gmx_domdec_ind_t      *ind;
+    rvec                   shift = {0, 0, 0};
+    gmx_bool               bPBC, bScrew;
+
+    GMX_ASSERT(!dd->bMoveXStarted, "dd_move_x_start should be followed by dd_move_x_finish");
+
+    if (dd->ndim == 0 || cd->np == 0)
+    {
+        return;
+    }
+
+    /* The first pulse of the first dimension only sends home atoms,
+     * so it can be started before any other communication completes.
+     */
+    bPBC   = (dd->ci[dd->dim[0]] == 0);
+    bScrew = (bPBC && dd->bScrewPBC && dd->dim[0] == XX);
+    if (bPBC)
+    {
+        copy_rvec(box[dd->dim[0]], shift);
+    }
+    ind = &cd->ind[0];
+
+    dd_pack_x(dd, ind, 1, bPBC, bScrew, shift, box, x, comm->vbuf.v);
+
+    dd_isendrecv_rvec(dd, 0, dddirBackward,
+                      comm->vbuf.v, ind->nsend[2],
+                      cd->bInPlace ? x + dd->nat_home : comm->vbuf2.v,
+                      ind->nrecv[2]);
+
+    dd->bMoveXStarted = TRUE;
+}
+
+void dd_move_x_finish(gmx_domdec_t *dd, matrix box, rvec x[])
+{
+    dd_move_x_pulses(dd, box, x, dd->bMoveXStarted);
+
+    dd->bMoveXStarted = FALSE;
+}
+
 void dd_move_f(gmx_domdec_t *dd, rvec f[], rvec *fshift)
 {
     int                    nzone, nat_tot, n, d, p, i, j, at0, at1, zone;
@@ -1296,6 +1410,106 @@ void dd_collect_vec(gmx_domdec_t           *dd,
     dd_collect_vec(dd, state_local, localVector, as_rvec_array(vector->data()));
 }
 
+void dd_collect_compressed_x(gmx_domdec_t       *dd,
+                             t_state            *state_local,
+                             const gmx_groups_t *groups,
+                             real                precision,
+                             rvec               *x)
+{
+    gmx_domdec_master_t *ma;
+    const t_block       *cgs_gl = &dd->comm->cgs_gl;
+    int                  ncg_home;
+    const int           *cg;
+
+    dd_collect_cg(dd, state_local);
+
+    /* Select the home atoms in the compressed output group, in the same
+     * order as the charge group indices that the master has received.
+     */
+    if (state_local->ddp_count == dd->ddp_count)
+    {
+        ncg_home = dd->ncg_home;
+        cg       = dd->index_gl;
+    }
+    else
+    {
+        ncg_home = state_local->cg_gl.size();
+        cg       = state_local->cg_gl.data();
+    }
+    std::vector<gmx::RVec> xSelected;
+    int                    a = 0;
+    for (int i = 0; i < ncg_home; i++)
+    {
+        for (int ag = cgs_gl->index[cg[i]]; ag < cgs_gl->index[cg[i]+1]; ag++, a++)
+        {
+            if (ggrpnr(groups, egcCompressedX, ag) == 0)
+            {
+                xSelected.push_back(state_local->x[a]);
+            }
+        }
+    }
+
+    /* Compress the home atoms here, so the master only receives
+     * the compressed data and the compression work is distributed.
+     */
+    int               buf2[2];
+    std::vector<char> compressed(xtc_compressed_size_max(xSelected.size()));
+    buf2[0] = xSelected.size();
+    buf2[1] = xtc_compress_coords(buf2[0], as_rvec_array(xSelected.data()), precision,
+                                  compressed.data(), compressed.size());
+    if (buf2[1] == 0)
+    {
+        gmx_incons("Compression of the local coordinates failed");
+    }
+
+    std::vector<int>  natSelected, rcounts, disps;
+    std::vector<char> received;
+    ma = dd->ma;
+    dd_gather(dd, 2*sizeof(int), buf2, DDMASTER(dd) ? ma->ibuf : nullptr);
+    if (DDMASTER(dd))
+    {
+        natSelected.resize(dd->nnodes);
+        rcounts.resize(dd->nnodes);
+        disps.resize(dd->nnodes + 1);
+        disps[0] = 0;
+        for (int n = 0; n < dd->nnodes; n++)
+        {
+            natSelected[n] = ma->ibuf[2*n];
+            rcounts[n]     = ma->ibuf[2*n+1];
+            disps[n+1]     = disps[n] + rcounts[n];
+        }
+        received.resize(disps[dd->nnodes]);
+    }
+    dd_gatherv(dd, buf2[1], compressed.data(),
+               DDMASTER(dd) ? rcounts.data() : nullptr,
+               DDMASTER(dd) ? disps.data() : nullptr,
+               DDMASTER(dd) ? received.data() : nullptr);
+
+    if (DDMASTER(dd))
+    {
+        for (int n = 0; n < dd->nnodes; n++)
+        {
+            xSelected.resize(natSelected[n]);
+            if (!xtc_decompress_coords(received.data() + disps[n], rcounts[n],
+                                       natSelected[n], as_rvec_array(xSelected.data())))
+            {
+                gmx_incons("Decompression of collected coordinates failed");
+            }
+            int j = 0;
+            for (int i = ma->index[n]; i < ma->index[n+1]; i++)
+            {
+                for (int ag = cgs_gl->index[ma->cg[i]]; ag < cgs_gl->index[ma->cg[i]+1]; ag++)
+                {
+                    if (ggrpnr(groups, egcCompressedX, ag) == 0)
+                    {
+                        copy_rvec(xSelected[j++], x[ag]);
+                    }
+                }
+            }
+        }
+    }
+}
+
 
 void dd_collect_state(gmx_domdec_t *dd,
                       t_state *state_local, t_state *state)
@@ -2184,10 +2398,10 @@ static void dd_set_cginfo(int *index_gl, int cg0, int cg1,
     }
 }
 
-static void make_dd_indices(gmx_domdec_t *dd,
-                            const int *gcgs_index, int cg_start)
+void make_dd_indices(gmx_domdec_t *dd,
+                     const int *gcgs_index, int cg_start)
 {
-    int          nzone, zone, zone1, cg0, cg1, cg1_p1, cg, cg_gl, a, a_gl;
+    int          nzone, zone, cg0, cg1, cg1_p1;
     int         *zone2cg, *zone_ncg1, *index_gl, *gatindex;
     gmx_bool     bCGs;
 
@@ -2209,8 +2423,13 @@ static void make_dd_indices(gmx_domdec_t *dd,
         gmx_incons("dd->ncg_zone is not up to date");
     }
 
-    /* Make the local to global and global to local atom index */
-    a = dd->cgindex[cg_start];
+    /* Make the local to global and global to local atom index.
+     * With a direct ga2la list each global atom has its own entry,
+     * so threads can set entries concurrently. The hash table is not
+     * thread safe, so then we only fill the gatindex in parallel.
+     */
+    const int      nthread      = gmx_omp_nthreads_get(emntDomdec);
+    const gmx_bool bSetInThread = ga2la_is_thread_safe(dd->ga2la);
     for (zone = 0; zone < nzone; zone++)
     {
         if (zone == 0)
@@ -2224,29 +2443,48 @@ static void make_dd_indices(gmx_domdec_t *dd,
         cg1    = zone2cg[zone+1];
         cg1_p1 = cg0 + zone_ncg1[zone];
 
-        for (cg = cg0; cg < cg1; cg++)
+#pragma omp parallel for num_threads(nthread) schedule(static)
+        for (int cg = cg0; cg < cg1; cg++)
         {
-            zone1 = zone;
+            int zone1 = zone;
             if (cg >= cg1_p1)
             {
                 /* Signal that this cg is from more than one pulse away */
                 zone1 += nzone;
             }
-            cg_gl = index_gl[cg];
+            int cg_gl = index_gl[cg];
+            int a     = dd->cgindex[cg];
             if (bCGs)
             {
-                for (a_gl = gcgs_index[cg_gl]; a_gl < gcgs_index[cg_gl+1]; a_gl++)
+                for (int a_gl = gcgs_index[cg_gl]; a_gl < gcgs_index[cg_gl+1]; a_gl++)
                 {
                     gatindex[a] = a_gl;
-                    ga2la_set(dd->ga2la, a_gl, a, zone1);
+                    if (bSetInThread)
+                    {
+                        ga2la_set(dd->ga2la, a_gl, a, zone1);
+                    }
                     a++;
                 }
             }
             else
             {
                 gatindex[a] = cg_gl;
-                ga2la_set(dd->ga2la, cg_gl, a, zone1);
-                a++;
+                if (bSetInThread)
+                {
+                    ga2la_set(dd->ga2la, cg_gl, a, zone1);
+                }
+            }
+        }
+
+        if (!bSetInThread)
+        {
+            for (int cg = cg0; cg < cg1; cg++)
+            {
+                int zone1 = (cg < cg1_p1 ? zone : zone + nzone);
+                for (int a = dd->cgindex[cg]; a < dd->cgindex[cg+1]; a++)
+                {
+                    ga2la_set(dd->ga2la, gatindex[a], a, zone1);
+                }
             }
         }
     }
@@ -2372,7 +2610,7 @@ static void clear_dd_indices(gmx_domdec_t *dd, int cg_start, int a_start)
     if (a_start == 0)
     {
         /* Clear the whole list without searching */
-        ga2la_clear(dd->ga2la);
+        ga2la_clear(dd->ga2la, gmx_omp_nthreads_get(emntDomdec));
     }
     else
     {
@@ -8716,17 +8954,19 @@ static int comp_cgsort(const void *a, const void *b)
 }
 
 static void order_int_cg(int n, const gmx_cgsort_t *sort,
-                         int *a, int *buf)
+                         int *a, int *buf, int nthread)
 {
     int i;
 
     /* Order the data */
+#pragma omp parallel for num_threads(nthread) schedule(static)
     for (i = 0; i < n; i++)
     {
         buf[i] = a[sort[i].ind];
     }
 
     /* Copy back to the original array */
+#pragma omp parallel for num_threads(nthread) schedule(static)
     for (i = 0; i < n; i++)
     {
         a[i] = buf[i];
@@ -8734,32 +8974,34 @@ static void order_int_cg(int n, const gmx_cgsort_t *sort,
 }
 
 static void order_vec_cg(int n, const gmx_cgsort_t *sort,
-                         rvec *v, rvec *buf)
+                         rvec *v, rvec *buf, int nthread)
 {
     int i;
 
     /* Order the data */
+#pragma omp parallel for num_threads(nthread) schedule(static)
     for (i = 0; i < n; i++)
     {
         copy_rvec(v[sort[i].ind], buf[i]);
     }
 
     /* Copy back to the original array */
+#pragma omp parallel for num_threads(nthread) schedule(static)
     for (i = 0; i < n; i++)
     {
         copy_rvec(buf[i], v[i]);
     }
 }
 
-static void order_vec_atom(int ncg, const int *cgindex, const gmx_cgsort_t *sort,
-                           rvec *v, rvec *buf)
+void order_vec_atom(int ncg, const int *cgindex, const gmx_cgsort_t *sort,
+                    rvec *v, rvec *buf, int nthread)
 {
     int a, atot, cg, cg0, cg1, i;
 
     if (cgindex == nullptr)
     {
         /* Avoid the useless loop of the atoms within a cg */
-        order_vec_cg(ncg, sort, v, buf);
+        order_vec_cg(ncg, sort, v, buf, nthread);
 
         return;
     }
@@ -8779,6 +9021,7 @@ static void order_vec_atom(int ncg, const int *cgindex, const gmx_cgsort_t *sort
     atot = a;
 
     /* Copy back to the original array */
+#pragma omp parallel for num_threads(nthread) schedule(static)
     for (a = 0; a < atot; a++)
     {
         copy_rvec(buf[a], v[a]);
@@ -8910,27 +9153,57 @@ static int dd_sort_order(gmx_domdec_t *dd, t_forcerec *fr, int ncg_home_old)
     return ncg_new;
 }
 
-static int dd_sort_order_nbnxn(gmx_domdec_t *dd, t_forcerec *fr)
+int dd_compact_atom_order(const int *a, int na, gmx_cgsort_t *sort, int nthread)
 {
-    gmx_cgsort_t *sort;
-    int           ncg_new, i, na;
-    const int    *a;
-
-    sort = dd->comm->sort->sort;
+    /* Compact out the filler particles, marked by -1, in parallel.
+     * Each thread counts its valid entries, the offsets of the threads
+     * in the output follow from a prefix sum over the counts.
+     */
+    std::vector<int> threadOffset(nthread + 1, 0);
 
-    nbnxn_get_atomorder(fr->nbv->nbs, &a, &na);
+#pragma omp parallel for num_threads(nthread) schedule(static)
+    for (int thread = 0; thread < nthread; thread++)
+    {
+        int count = 0;
+        for (int i = (thread*na)/nthread; i < ((thread + 1)*na)/nthread; i++)
+        {
+            if (a[i] >= 0)
+            {
+                count++;
+            }
+        }
+        threadOffset[thread + 1] = count;
+    }
+    for (int thread = 0; thread < nthread; thread++)
+    {
+        threadOffset[thread + 1] += threadOffset[thread];
+    }
 
-    ncg_new = 0;
-    for (i = 0; i < na; i++)
+#pragma omp parallel for num_threads(nthread) schedule(static)
+    for (int thread = 0; thread < nthread; thread++)
     {
-        if (a[i] >= 0)
+        int ind = threadOffset[thread];
+        for (int i = (thread*na)/nthread; i < ((thread + 1)*na)/nthread; i++)
         {
-            sort[ncg_new].ind = a[i];
-            ncg_new++;
+            if (a[i] >= 0)
+            {
+                sort[ind++].ind = a[i];
+            }
         }
     }
 
-    return ncg_new;
+    return threadOffset[nthread];
+}
+
+static int dd_sort_order_nbnxn(gmx_domdec_t *dd, t_forcerec *fr)
+{
+    const int    *a;
+    int           na;
+
+    nbnxn_get_atomorder(fr->nbv->nbs, &a, &na);
+
+    return dd_compact_atom_order(a, na, dd->comm->sort->sort,
+                                 gmx_omp_nthreads_get(emntDomdec));
 }
 
 static void dd_sort_state(gmx_domdec_t *dd, rvec *cgcm, t_forcerec *fr, t_state *state,
@@ -8944,6 +9217,8 @@ static void dd_sort_state(gmx_domdec_t *dd, rvec *cgcm, t_forcerec *fr, t_state
 
     sort = dd->comm->sort;
 
+    const int nthread = gmx_omp_nthreads_get(emntDomdec);
+
     if (dd->ncg_home > sort->sort_nalloc)
     {
         sort->sort_nalloc = over_alloc_dd(dd->ncg_home);
@@ -8989,21 +9264,21 @@ static void dd_sort_state(gmx_domdec_t *dd, rvec *cgcm, t_forcerec *fr, t_state
     /* Reorder the state */
     if (state->flags & (1 << estX))
     {
-        order_vec_atom(dd->ncg_home, cgindex, cgsort, as_rvec_array(state->x.data()), vbuf);
+        order_vec_atom(dd->ncg_home, cgindex, cgsort, as_rvec_array(state->x.data()), vbuf, nthread);
     }
     if (state->flags & (1 << estV))
     {
-        order_vec_atom(dd->ncg_home, cgindex, cgsort, as_rvec_array(state->v.data()), vbuf);
+        order_vec_atom(dd->ncg_home, cgindex, cgsort, as_rvec_array(state->v.data()), vbuf, nthread);
     }
     if (state->flags & (1 << estCGP))
     {
-        order_vec_atom(dd->ncg_home, cgindex, cgsort, as_rvec_array(state->cg_p.data()), vbuf);
+        order_vec_atom(dd->ncg_home, cgindex, cgsort, as_rvec_array(state->cg_p.data()), vbuf, nthread);
     }
 
     if (fr->cutoff_scheme == ecutsGROUP)
     {
         /* Reorder cgcm */
-        order_vec_cg(dd->ncg_home, cgsort, cgcm, vbuf);
+        order_vec_cg(dd->ncg_home, cgsort, cgcm, vbuf, nthread);
     }
 
     if (dd->ncg_home+1 > sort->ibuf_nalloc)
@@ -9013,9 +9288,9 @@ static void dd_sort_state(gmx_domdec_t *dd, rvec *cgcm, t_forcerec *fr, t_state
     }
     ibuf = sort->ibuf;
     /* Reorder the global cg index */
-    order_int_cg(dd->ncg_home, cgsort, dd->index_gl, ibuf);
+    order_int_cg(dd->ncg_home, cgsort, dd->index_gl, ibuf, nthread);
     /* Reorder the cginfo */
-    order_int_cg(dd->ncg_home, cgsort, fr->cginfo, ibuf);
+    order_int_cg(dd->ncg_home, cgsort, fr->cginfo, ibuf, nthread);
     /* Rebuild the local cg index */
     if (dd->comm->bCGs)
     {
@@ -9032,6 +9307,7 @@ static void dd_sort_state(gmx_domdec_t *dd, rvec *cgcm, t_forcerec *fr, t_state
     }
     else
     {
+#pragma omp parallel for num_threads(nthread) schedule(static)
         for (i = 0; i < dd->ncg_home+1; i++)
         {
             dd->cgindex[i] = i;
@@ -9592,7 +9868,7 @@ void dd_partition_system(FILE                *fplog,
         dd_resize_state(state_local, f, dd->nat_home);
 
         /* Rebuild all the indices */
-        ga2la_clear(dd->ga2la);
+        ga2la_clear(dd->ga2la, gmx_omp_nthreads_get(emntDomdec));
         ncgindex_set = 0;
 
         wallcycle_sub_stop(wcycle, ewcsDD_GRID);
@@ -212,6 +212,19 @@ void dd_collect_vec(struct gmx_domdec_t *dd,
 void dd_collect_vec(struct gmx_domdec_t *dd,
                     t_state *state_local, const PaddedRVecVector *lv, PaddedRVecVector *v);
 
+/*! \brief Collects the coordinates of the compressed output group to \p x on the master rank
+ *
+ * Each rank compresses the coordinates of its home atoms in the
+ * compressed output group with XTC compression with \p precision and
+ * only the compressed data is sent to the master, where it is
+ * decompressed into \p x. Other atoms in \p x are not changed.
+ * Compressing the collected coordinates again with the same precision
+ * gives the same result as compressing the original coordinates.
+ */
+void dd_collect_compressed_x(struct gmx_domdec_t *dd,
+                             t_state *state_local, const gmx_groups_t *groups,
+                             real precision, rvec *x);
+
 /*! \brief Collects the local state \p state_local to \p state on the master rank */
 void dd_collect_state(struct gmx_domdec_t *dd,
                       t_state *state_local, t_state *state);
@@ -239,6 +252,19 @@ float dd_pme_f_ratio(struct gmx_domdec_t *dd);
 /*! \brief Communicate the coordinates to the neighboring cells and do pbc. */
 void dd_move_x(struct gmx_domdec_t *dd, matrix box, rvec x[]);
 
+/*! \brief Start communicating the coordinates to the neighboring cells.
+ *
+ * Packs the home coordinates for the first communication pulse and posts
+ * non-blocking send and receive calls for them. Only home atom coordinates
+ * in \p x may be used until dd_move_x_finish() has been called with
+ * the same arguments, which completes the communication.
+ * This allows overlapping the first pulse with local computation.
+ */
+void dd_move_x_start(struct gmx_domdec_t *dd, matrix box, rvec x[]);
+
+/*! \brief Complete the coordinate communication started by dd_move_x_start(). */
+void dd_move_x_finish(struct gmx_domdec_t *dd, matrix box, rvec x[]);
+
 /*! \brief Sum the forces over the neighboring cells.
  *
  * When fshift!=NULL the shift forces are updated to obtain
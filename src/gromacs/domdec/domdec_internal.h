@@ -418,6 +418,31 @@ static const int zone_reorder_cartesian[DD_MAXZONE] = { 0, 1, 3, 2, 5, 4, 6, 7 }
  * components see only j zones with that component 0.
  */
 
+/*! \brief Makes the local to global and global to local atom indices
+ *
+ * Sets dd->gatindex and dd->ga2la for the charge groups from \p cg_start
+ * in the home zone and all charge groups in the other zones, using the
+ * DD OpenMP threads.
+ */
+void make_dd_indices(gmx_domdec_t *dd,
+                     const int *gcgs_index, int cg_start);
+
+/*! \brief Compacts the nbnxn atom order into the sort order
+ *
+ * Stores the \p na entries of \p a that are not filler particles,
+ * marked by -1, in sort[].ind, using \p nthread threads.
+ * Returns the number of home atoms.
+ */
+int dd_compact_atom_order(const int *a, int na, gmx_cgsort_t *sort, int nthread);
+
+/*! \brief Reorders the rvecs \p v of \p ncg charge groups to the order of \p sort
+ *
+ * \p cgindex is the charge group index, or nullptr without charge groups,
+ * \p buf is a buffer of at least the number of atoms.
+ */
+void order_vec_atom(int ncg, const int *cgindex, const gmx_cgsort_t *sort,
+                    rvec *v, rvec *buf, int nthread);
+
 /*! \brief Returns the DD cut-off distance for multi-body interactions */
 real dd_cutoff_multibody(const gmx_domdec_t *dd);
 
@@ -154,6 +154,42 @@ void dd_sendrecv_rvec(const struct gmx_domdec_t gmx_unused *dd,
 #endif
 }
 
+void dd_isendrecv_rvec(struct gmx_domdec_t gmx_unused *dd,
+                       int gmx_unused ddimind, int gmx_unused direction,
+                       rvec gmx_unused *buf_s, int gmx_unused n_s,
+                       rvec gmx_unused *buf_r, int gmx_unused n_r)
+{
+#if GMX_MPI
+    int rank_s, rank_r;
+
+    rank_s = dd->neighbor[ddimind][direction == dddirForward ? 0 : 1];
+    rank_r = dd->neighbor[ddimind][direction == dddirForward ? 1 : 0];
+
+    dd->nreq_halo = 0;
+    if (n_r)
+    {
+        MPI_Irecv(buf_r[0], n_r*sizeof(rvec), MPI_BYTE, rank_r, 0,
+                  dd->mpi_comm_all, &dd->req_halo[dd->nreq_halo++]);
+    }
+    if (n_s)
+    {
+        MPI_Isend(buf_s[0], n_s*sizeof(rvec), MPI_BYTE, rank_s, 0,
+                  dd->mpi_comm_all, &dd->req_halo[dd->nreq_halo++]);
+    }
+#endif
+}
+
+void dd_sendrecv_wait(struct gmx_domdec_t gmx_unused *dd)
+{
+#if GMX_MPI
+    if (dd->nreq_halo > 0)
+    {
+        MPI_Waitall(dd->nreq_halo, dd->req_halo, MPI_STATUSES_IGNORE);
+        dd->nreq_halo = 0;
+    }
+#endif
+}
+
 void dd_sendrecv2_rvec(const struct gmx_domdec_t gmx_unused *dd,
                        int gmx_unused ddimind,
                        rvec gmx_unused *buf_s_fw, int gmx_unused n_s_fw,
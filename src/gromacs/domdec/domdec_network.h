@@ -91,6 +91,22 @@ dd_sendrecv_rvec(const struct gmx_domdec_t *dd,
                  rvec *buf_s, int n_s,
                  rvec *buf_r, int n_r);
 
+/*! \brief Start moving rvec's in the comm. region one cell along the domain decomposition
+ *
+ * Moves in dimension indexed by ddimind, either forward
+ * (direction=dddirFoward) or backward (direction=dddirBackward),
+ * using non-blocking communication. The buffers should not be accessed
+ * until the communication has been completed with dd_sendrecv_wait().
+ */
+void
+dd_isendrecv_rvec(struct gmx_domdec_t *dd,
+                  int ddimind, int direction,
+                  rvec *buf_s, int n_s,
+                  rvec *buf_r, int n_r);
+
+/*! \brief Wait for the communication started with dd_isendrecv_rvec() to complete */
+void
+dd_sendrecv_wait(struct gmx_domdec_t *dd);
 
 /*! \brief Move revc's in the comm. region one cell along the domain decomposition
  *
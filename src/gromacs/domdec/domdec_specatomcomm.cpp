@@ -465,16 +465,25 @@ int setup_specat_communication(gmx_domdec_t               *dd,
             start       = nlast - nr;
             spas->nsend = 0;
             nsend[0]    = 0;
+            if (nr > spac->lbuf_nalloc)
+            {
+                spac->lbuf_nalloc = over_alloc_large(nr);
+                srenew(spac->lbuf, spac->lbuf_nalloc);
+            }
+            /* Look up all requested atoms first, the lookups are independent */
+            ga2la_get_home_batch(dd->ga2la, nr, ireq->ind + start, spac->lbuf);
             for (i = 0; i < nr; i++)
             {
-                indr = ireq->ind[start+i];
-                ind  = -1;
-                /* Check if this is a home atom and if so ind will be set */
-                if (!ga2la_get_home(dd->ga2la, indr, &ind))
+                if (spac->lbuf[i] < 0)
                 {
                     /* Search in the communicated atoms */
-                    ind = gmx_hash_get_minone(ga2la_specat, indr);
+                    spac->lbuf[i] = gmx_hash_get_minone(ga2la_specat, ireq->ind[start+i]);
                 }
+            }
+            for (i = 0; i < nr; i++)
+            {
+                indr = ireq->ind[start+i];
+                ind  = spac->lbuf[i];
                 if (ind >= 0)
                 {
                     if (i < n0 || !spac->bSendAtom[ind])
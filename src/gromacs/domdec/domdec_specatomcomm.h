@@ -71,6 +71,8 @@ struct gmx_domdec_specat_comm_t {
     gmx_specatsend_t spas[DIM][2];     /**< The communication setup per DIM, direction */
     gmx_bool        *bSendAtom;        /**< Work buffer that tells if spec.atoms should be sent */
     int              bSendAtom_nalloc; /**< Allocation size of \p bSendAtom */
+    int             *lbuf;             /**< Work buffer with local indices of requested atoms */
+    int              lbuf_nalloc;      /**< Allocation size of \p lbuf */
     /* Send buffers */
     int             *ibuf;             /**< Integer send buffer */
     int              ibuf_nalloc;      /**< Allocation size of \p ibuf */
@@ -136,6 +136,10 @@ struct gmx_domdec_t {
     gmx_pme_comm_n_box_t  *cnb;
     int                    nreq_pme;
     MPI_Request            req_pme[8];
+    /* Non-blocking halo communication started by dd_move_x_start */
+    gmx_bool               bMoveXStarted;
+    int                    nreq_halo;
+    MPI_Request            req_halo[2];
 
 
     /* The communication setup, identical for each cell, cartesian index */
@@ -53,6 +53,7 @@
 
 #include <algorithm>
 #include <string>
+#include <vector>
 
 #include "gromacs/domdec/domdec.h"
 #include "gromacs/domdec/domdec_network.h"
@@ -108,6 +109,24 @@ typedef struct {
     int        excl_count;       /**< The total exclusion count for \p excl */
 } thread_work_t;
 
+/*! \brief Struct with the local bonded interactions of the previous partitioning
+ *
+ * Used for updating the local topology incrementally.
+ */
+typedef struct {
+    gmx_bool  bValid;          /**< Can this data be used for an incremental update? */
+    int       nat;             /**< The number of atoms in the zones */
+    int      *gatindex;        /**< The global atom index for each local atom */
+    int      *cell;            /**< The DD cell, as stored in ga2la, for each local atom */
+    int      *newIndex;        /**< Work array with the current local index for each atom, -1 when not present */
+    int       nalloc;          /**< Allocation size of \p gatindex, \p cell and \p newIndex */
+    t_ilist   il[F_NRE];       /**< The bonded interactions, with local atom indices of the previous partitioning */
+    t_ilist   ilCheck[F_NRE];  /**< Copy of an incremental update, for checking against a full assignment */
+    gmx_bool *bUnchanged;      /**< Work array, tells if an atom is in the same cell as before */
+    gmx_bool *bAffected;       /**< Work array, tells if the interactions of an atom need to be reassigned */
+    int       flags_nalloc;    /**< Allocation size of \p bUnchanged and \p bAffected */
+} prev_local_top_t;
+
 /*! \brief Struct for the reverse topology: links bonded interactions to atomsx */
 struct gmx_reverse_top_t
 {
@@ -127,6 +146,12 @@ struct gmx_reverse_top_t
     gmx_bool         bIntermolecularInteractions; /**< Do we have intermolecular interactions? */
     reverse_ilist_t  ril_intermol;                /**< Intermolecular reverse ilist */
 
+    /* Data for incremental updates of the local topology */
+    gmx_bool         bIncrementalTop;             /**< Can we update the local topology incrementally? */
+    gmx_bool         bCheckIncrementalTop;        /**< Check incremental updates against a full assignment? */
+    reverse_ilist_t *ril_mt_all;                  /**< Reverse ilist for all moltypes, linking interactions to all their atoms */
+    prev_local_top_t prev;                        /**< The local bonded interactions of the previous partitioning */
+
     /* Work data structures for multi-threading */
     int            nthread;           /**< The number of threads to be used */
     thread_work_t *th_work;           /**< Thread work array for local topology generation */
@@ -860,6 +885,49 @@ void dd_make_reverse_top(FILE *fplog,
     {
         init_domdec_constraints(dd, mtop);
     }
+
+    /* The assignment of bonded interactions only depends on the cells
+     * the atoms are in, unless distances need to be checked, which we
+     * check during partitioning. Virtual sites, position restraints and
+     * intermolecular interactions require extra bookkeeping and
+     * are not supported with incremental updates.
+     * Incremental updates are only used on request for now.
+     */
+    rt->bIncrementalTop = (getenv("GMX_DD_INCREMENTAL_TOP") != nullptr &&
+                           vsite == nullptr &&
+                           !rt->bIntermolecularInteractions);
+    for (int mt = 0; mt < mtop->nmoltype; mt++)
+    {
+        const t_ilist *il = mtop->moltype[mt].ilist;
+
+        if (il[F_POSRES].nr > 0 || il[F_FBPOSRES].nr > 0)
+        {
+            rt->bIncrementalTop = FALSE;
+        }
+    }
+    if (rt->bIncrementalTop)
+    {
+        snew(rt->ril_mt_all, mtop->nmoltype);
+        for (int mt = 0; mt < mtop->nmoltype; mt++)
+        {
+            gmx_moltype_t *molt = &mtop->moltype[mt];
+
+            make_reverse_ilist(molt->ilist, &molt->atoms, nullptr,
+                               rt->bConstr, rt->bSettle, rt->bBCheck, TRUE,
+                               &rt->ril_mt_all[mt]);
+        }
+        rt->bCheckIncrementalTop = (getenv("GMX_DD_CHECK_INCREMENTAL_TOP") != nullptr);
+
+        if (fplog)
+        {
+            fprintf(fplog, "Will update the local topology incrementally when possible\n");
+            if (rt->bCheckIncrementalTop)
+            {
+                fprintf(fplog, "Will check the incremental updates against a full assignment\n");
+            }
+        }
+    }
+
     if (fplog)
     {
         fprintf(fplog, "\n");
@@ -1547,6 +1615,8 @@ check_assign_interactions_atom(int i, int i_gl,
  *
  * With thread parallelizing each thread acts on a different atom range:
  * at_start to at_end.
+ * When \p bAtomAffected != NULL, only atoms with \p bAtomAffected set
+ * are considered.
  */
 static int make_bondeds_zone(gmx_domdec_t *dd,
                              const gmx_domdec_zones_t *zones,
@@ -1559,7 +1629,8 @@ static int make_bondeds_zone(gmx_domdec_t *dd,
                              int **vsite_pbc,
                              int *vsite_pbc_nalloc,
                              int izone,
-                             int at_start, int at_end)
+                             int at_start, int at_end,
+                             const gmx_bool *bAtomAffected)
 {
     int                i, i_gl, mb, mt, mol, i_mol;
     int               *index, *rtil;
@@ -1575,6 +1646,11 @@ static int make_bondeds_zone(gmx_domdec_t *dd,
 
     for (i = at_start; i < at_end; i++)
     {
+        if (bAtomAffected != nullptr && !bAtomAffected[i])
+        {
+            continue;
+        }
+
         /* Get the global atom number */
         i_gl = dd->gatindex[i];
         global_atomnr_to_moltype_ind(rt, i_gl, &mb, &mt, &mol, &i_mol);
@@ -1926,11 +2002,16 @@ static void clear_idef(t_idef *idef)
     }
 }
 
-/*! \brief Generate and store all required local bonded interactions in \p idef and local exclusions in \p lexcls */
+/*! \brief Generate and store all required local bonded interactions in \p idef and local exclusions in \p lexcls
+ *
+ * When \p bMakeBondeds = FALSE, only the exclusions are generated
+ * and \p idef is left unchanged.
+ */
 static int make_local_bondeds_excls(gmx_domdec_t *dd,
                                     gmx_domdec_zones_t *zones,
                                     const gmx_mtop_t *mtop,
                                     const int *cginfo,
+                                    gmx_bool bMakeBondeds,
                                     gmx_bool bRCheckMB, ivec rcheck, gmx_bool bRCheck2B,
                                     real rc,
                                     int *la2lc, t_pbc *pbc_null, rvec *cg_cm,
@@ -1974,7 +2055,10 @@ static int make_local_bondeds_excls(gmx_domdec_t *dd,
     rc2 = rc*rc;
 
     /* Clear the counts */
-    clear_idef(idef);
+    if (bMakeBondeds)
+    {
+        clear_idef(idef);
+    }
     nbonded_local = 0;
 
     lexcls->nr    = 0;
@@ -2009,6 +2093,7 @@ static int make_local_bondeds_excls(gmx_domdec_t *dd,
                     idef_t = &rt->th_work[thread].idef;
                     clear_idef(idef_t);
                 }
+                rt->th_work[thread].nbonded = 0;
 
                 if (vsite && vsite->bHaveChargeGroups && vsite->n_intercg_vsite > 0)
                 {
@@ -2029,15 +2114,19 @@ static int make_local_bondeds_excls(gmx_domdec_t *dd,
                     vsite_pbc_nalloc = nullptr;
                 }
 
-                rt->th_work[thread].nbonded =
-                    make_bondeds_zone(dd, zones,
-                                      mtop->molblock,
-                                      bRCheckMB, rcheck, bRCheck2B, rc2,
-                                      la2lc, pbc_null, cg_cm, idef->iparams,
-                                      idef_t,
-                                      vsite_pbc, vsite_pbc_nalloc,
-                                      izone,
-                                      dd->cgindex[cg0t], dd->cgindex[cg1t]);
+                if (bMakeBondeds)
+                {
+                    rt->th_work[thread].nbonded =
+                        make_bondeds_zone(dd, zones,
+                                          mtop->molblock,
+                                          bRCheckMB, rcheck, bRCheck2B, rc2,
+                                          la2lc, pbc_null, cg_cm, idef->iparams,
+                                          idef_t,
+                                          vsite_pbc, vsite_pbc_nalloc,
+                                          izone,
+                                          dd->cgindex[cg0t], dd->cgindex[cg1t],
+                                          nullptr);
+                }
 
                 if (izone < nzone_excl)
                 {
@@ -2077,7 +2166,7 @@ static int make_local_bondeds_excls(gmx_domdec_t *dd,
             GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
         }
 
-        if (rt->nthread > 1)
+        if (bMakeBondeds && rt->nthread > 1)
         {
             combine_idef(idef, rt->th_work, rt->nthread, vsite);
         }
@@ -2119,6 +2208,270 @@ static int make_local_bondeds_excls(gmx_domdec_t *dd,
     return nbonded_local;
 }
 
+/*! \brief Marks the local atoms that own interactions involving global atom \p a_gl as affected */
+static void mark_owners_affected(gmx_domdec_t *dd, int a_gl,
+                                 gmx_bool *bAffected, int *naffected)
+{
+    gmx_reverse_top_t *rt = dd->reverse_top;
+    int                mb, mt, mol, a_mol;
+    const int         *index, *rtil;
+    int                j;
+
+    global_atomnr_to_moltype_ind(rt, a_gl, &mb, &mt, &mol, &a_mol);
+    index = rt->ril_mt_all[mt].index;
+    rtil  = rt->ril_mt_all[mt].il;
+    for (j = index[a_mol]; j < index[a_mol + 1]; j += 2 + nral_rt(rtil[j]))
+    {
+        /* Interactions are assigned through their first atom */
+        int owner_gl = a_gl + rtil[j + 2] - a_mol;
+        int owner, cell;
+
+        if (ga2la_get(dd->ga2la, owner_gl, &owner, &cell) && !bAffected[owner])
+        {
+            bAffected[owner] = TRUE;
+            (*naffected)++;
+        }
+    }
+}
+
+/*! \brief Update the local bonded interactions in \p idef from those of the previous partitioning
+ *
+ * Without distance checks, whether a bonded interaction is assigned
+ * to this rank only depends on the cells its atoms are in. So we can
+ * keep all interactions of which no atom changed cell and only need
+ * to reassign the interactions of atoms that own an interaction
+ * involving an atom that changed cell.
+ *
+ * \returns FALSE, with \p idef unchanged, when so many atoms are affected
+ * that a full, thread parallel, assignment is faster.
+ */
+static gmx_bool make_local_bondeds_incremental(gmx_domdec_t *dd,
+                                               const gmx_domdec_zones_t *zones,
+                                               const gmx_mtop_t *mtop,
+                                               t_idef *idef,
+                                               int *nbonded_local)
+{
+    gmx_reverse_top_t *rt   = dd->reverse_top;
+    prev_local_top_t  *prev = &rt->prev;
+    int                nat, a, naffected, nbonded, ftype, izone;
+    ivec               rcheck;
+
+    nat = dd->cgindex[zones->cg_range[zones->n]];
+    if (nat > prev->flags_nalloc)
+    {
+        prev->flags_nalloc = over_alloc_dd(nat);
+        srenew(prev->bUnchanged, prev->flags_nalloc);
+        srenew(prev->bAffected, prev->flags_nalloc);
+    }
+    for (a = 0; a < nat; a++)
+    {
+        prev->bUnchanged[a] = FALSE;
+        prev->bAffected[a]  = FALSE;
+    }
+
+    /* Determine where the atoms of the previous partitioning are now */
+    naffected = 0;
+    for (a = 0; a < prev->nat; a++)
+    {
+        int a_loc, cell;
+
+        if (ga2la_get(dd->ga2la, prev->gatindex[a], &a_loc, &cell))
+        {
+            prev->newIndex[a] = a_loc;
+            if (cell == prev->cell[a])
+            {
+                prev->bUnchanged[a_loc] = TRUE;
+            }
+        }
+        else
+        {
+            prev->newIndex[a] = -1;
+            mark_owners_affected(dd, prev->gatindex[a],
+                                 prev->bAffected, &naffected);
+        }
+    }
+    for (a = 0; a < nat; a++)
+    {
+        if (!prev->bUnchanged[a])
+        {
+            mark_owners_affected(dd, dd->gatindex[a],
+                                 prev->bAffected, &naffected);
+        }
+    }
+
+    if (debug)
+    {
+        fprintf(debug, "Incremental local topology: %d out of %d atoms affected\n",
+                naffected, nat);
+    }
+
+    /* The reassignment below is not thread parallel */
+    if (2*naffected*rt->nthread > nat)
+    {
+        return FALSE;
+    }
+
+    clear_idef(idef);
+    nbonded = 0;
+
+    /* Keep the interactions with owners that are not affected,
+     * all atoms of these interactions are present in the same cell.
+     */
+    for (ftype = 0; ftype < F_NRE; ftype++)
+    {
+        const t_ilist *il_prev = &prev->il[ftype];
+        int            nral, i, k;
+        gmx_bool       bCount;
+        t_iatom        tiatoms[1 + MAXATOMLIST];
+
+        if (il_prev->nr == 0)
+        {
+            continue;
+        }
+
+        nral   = NRAL(ftype);
+        bCount = (ftype == F_SETTLE || rt->bBCheck ||
+                  !(interaction_function[ftype].flags & IF_LIMZERO));
+        for (i = 0; i < il_prev->nr; i += 1 + nral)
+        {
+            const t_iatom *ia    = il_prev->iatoms + i;
+            int            owner = prev->newIndex[ia[1]];
+
+            if (owner >= 0 && !prev->bAffected[owner])
+            {
+                tiatoms[0] = ia[0];
+                for (k = 1; k <= nral; k++)
+                {
+                    tiatoms[k] = prev->newIndex[ia[k]];
+                }
+                add_ifunc(nral, tiatoms, &idef->il[ftype]);
+                if (bCount)
+                {
+                    nbonded++;
+                }
+            }
+        }
+    }
+
+    /* Reassign the interactions of the affected atoms */
+    clear_ivec(rcheck);
+    for (izone = 0; izone < (rt->bInterCGInteractions ? zones->n : 1); izone++)
+    {
+        nbonded += make_bondeds_zone(dd, zones, mtop->molblock,
+                                     FALSE, rcheck, FALSE, 0,
+                                     nullptr, nullptr, nullptr,
+                                     idef->iparams, idef,
+                                     nullptr, nullptr,
+                                     izone,
+                                     dd->cgindex[zones->cg_range[izone]],
+                                     dd->cgindex[zones->cg_range[izone + 1]],
+                                     prev->bAffected);
+    }
+
+    *nbonded_local = nbonded;
+
+    return TRUE;
+}
+
+/*! \brief Copies the interactions in \p src to \p dest */
+static void copy_ilist(const t_ilist *src, t_ilist *dest)
+{
+    int i;
+
+    if (src->nr > dest->nalloc)
+    {
+        dest->nalloc = over_alloc_large(src->nr);
+        srenew(dest->iatoms, dest->nalloc);
+    }
+    for (i = 0; i < src->nr; i++)
+    {
+        dest->iatoms[i] = src->iatoms[i];
+    }
+    dest->nr = src->nr;
+}
+
+/*! \brief Returns the interactions in \p il as a sorted list of entries */
+static std::vector<std::vector<t_iatom> > sorted_ilist_entries(const t_ilist *il, int ftype)
+{
+    const int                         nral = NRAL(ftype);
+    std::vector<std::vector<t_iatom> > entries;
+
+    for (int i = 0; i < il->nr; i += 1 + nral)
+    {
+        entries.emplace_back(il->iatoms + i, il->iatoms + i + 1 + nral);
+    }
+    std::sort(entries.begin(), entries.end());
+
+    return entries;
+}
+
+/*! \brief Checks that an incremental update gave the same interactions as a full assignment
+ *
+ * The order of the interactions differs between the two,
+ * so we compare sorted lists of interactions.
+ *
+ * \param[in] dd                  The domain decomposition struct
+ * \param[in] il_incremental      The interactions from the incremental update
+ * \param[in] nbonded_incremental The bonded count from the incremental update
+ * \param[in] idef                The interactions from the full assignment
+ * \param[in] nbonded             The bonded count from the full assignment
+ */
+static void check_incremental_local_top(const gmx_domdec_t *dd,
+                                        const t_ilist      *il_incremental,
+                                        int                 nbonded_incremental,
+                                        const t_idef       *idef,
+                                        int                 nbonded)
+{
+    for (int ftype = 0; ftype < F_NRE; ftype++)
+    {
+        if (il_incremental[ftype].nr != idef->il[ftype].nr ||
+            sorted_ilist_entries(&il_incremental[ftype], ftype) !=
+            sorted_ilist_entries(&idef->il[ftype], ftype))
+        {
+            gmx_fatal(FARGS, "DD rank %d: the incremental update of the local topology gave different %s interactions than a full assignment (%d versus %d entries)",
+                      dd->rank, interaction_function[ftype].longname,
+                      il_incremental[ftype].nr, idef->il[ftype].nr);
+        }
+    }
+    if (nbonded_incremental != nbonded)
+    {
+        gmx_fatal(FARGS, "DD rank %d: the incremental update of the local topology counted %d bonded interactions, a full assignment %d",
+                  dd->rank, nbonded_incremental, nbonded);
+    }
+}
+
+/*! \brief Store the local bonded interactions in \p idef for incremental updates at the next partitioning */
+static void store_prev_local_top(gmx_domdec_t *dd,
+                                 const gmx_domdec_zones_t *zones,
+                                 const t_idef *idef)
+{
+    prev_local_top_t *prev = &dd->reverse_top->prev;
+    int               a, ftype;
+
+    prev->nat = dd->cgindex[zones->cg_range[zones->n]];
+    if (prev->nat > prev->nalloc)
+    {
+        prev->nalloc = over_alloc_dd(prev->nat);
+        srenew(prev->gatindex, prev->nalloc);
+        srenew(prev->cell, prev->nalloc);
+        srenew(prev->newIndex, prev->nalloc);
+    }
+    for (a = 0; a < prev->nat; a++)
+    {
+        int a_loc;
+
+        prev->gatindex[a] = dd->gatindex[a];
+        ga2la_get(dd->ga2la, prev->gatindex[a], &a_loc, &prev->cell[a]);
+    }
+
+    for (ftype = 0; ftype < F_NRE; ftype++)
+    {
+        copy_ilist(&idef->il[ftype], &prev->il[ftype]);
+    }
+
+    prev->bValid = TRUE;
+}
+
 void dd_make_local_cgs(gmx_domdec_t *dd, t_block *lcgs)
 {
     lcgs->nr    = dd->ncg_tot;
@@ -2200,13 +2553,58 @@ void dd_make_local_top(gmx_domdec_t *dd, gmx_domdec_zones_t *zones,
         }
     }
 
+    gmx_reverse_top_t *rt                  = dd->reverse_top;
+    gmx_bool           bIncremental        = FALSE;
+    gmx_bool           bCheck              = FALSE;
+    int                nbonded_incremental = 0;
+
+    if (rt->bIncrementalTop && rt->prev.bValid && !bRCheckMB && !bRCheck2B)
+    {
+        bIncremental =
+            make_local_bondeds_incremental(dd, zones, mtop,
+                                           &ltop->idef, &nbonded_incremental);
+    }
+    if (bIncremental && rt->bCheckIncrementalTop)
+    {
+        /* Store the incremental result and assign from scratch below */
+        for (int ftype = 0; ftype < F_NRE; ftype++)
+        {
+            copy_ilist(&ltop->idef.il[ftype], &rt->prev.ilCheck[ftype]);
+        }
+        bIncremental = FALSE;
+        bCheck       = TRUE;
+    }
+
     dd->nbonded_local =
         make_local_bondeds_excls(dd, zones, mtop, fr->cginfo,
+                                 !bIncremental,
                                  bRCheckMB, rcheck, bRCheck2B, rc,
                                  dd->la2lc,
                                  pbc_null, cgcm_or_x,
                                  &ltop->idef, vsite,
                                  &ltop->excls, &nexcl);
+    if (bIncremental)
+    {
+        dd->nbonded_local += nbonded_incremental;
+    }
+    if (bCheck)
+    {
+        check_incremental_local_top(dd, rt->prev.ilCheck, nbonded_incremental,
+                                    &ltop->idef, dd->nbonded_local);
+    }
+
+    if (rt->bIncrementalTop)
+    {
+        /* With distance checks the assignment depends on the coordinates */
+        if (!bRCheckMB && !bRCheck2B)
+        {
+            store_prev_local_top(dd, zones, &ltop->idef);
+        }
+        else
+        {
+            rt->prev.bValid = FALSE;
+        }
+    }
 
     /* The ilist is not sorted yet,
      * we can only do this when we have the charge arrays.
@@ -60,32 +60,66 @@ typedef struct {
 
 /*! \libinternal \brief Structure for the local atom info for a hash table */
 typedef struct {
-    int  ga;   /**< The global atom index */
+    int  ga;   /**< The global atom index, -1 for an empty entry */
     int  la;   /**< The local atom index */
     int  cell; /**< The DD zone index for neighboring domains, zone+zone otherwise */
-    int  next; /**< Index in the list of the next element with the same hash, -1 if none */
 } gmx_lal_t;
 
-/*! \libinternal \brief Structure for all global to local mapping information */
+/*! \libinternal \brief Structure for all global to local mapping information
+ *
+ * The hash table uses open addressing with linear probing, see
+ * domdec/hash.h for details.
+ */
 struct gmx_ga2la_t {
     gmx_bool   bDirectList;        /**< Use a direct list */
-    int        mod;                /**< The hash size */
-    int        nalloc;             /**< The alloction size of laa or la1 */
+    int        mod;                /**< The hash table size, a power of 2 */
+    int        mask;               /**< mod - 1 */
+    int        shift;              /**< The bit shift for obtaining a hash table index */
+    int        nkey;               /**< The number of entries in the hash table */
+    int        nalloc;             /**< The alloction size of laa or lal */
     gmx_laa_t *laa;                /**< The direct list */
     gmx_lal_t *lal;                /**< The hash table list */
-    int        start_space_search; /**< Index in lal at which to start looking for empty space */
 };
 
+/*! \brief Returns the index in the hash table where the search for \p a_gl starts */
+static inline int ga2la_start_index(const gmx_ga2la_t *ga2la, int a_gl)
+{
+    /* Fibonacci hashing, scatters contiguous global index ranges */
+    return static_cast<int>((static_cast<unsigned int>(a_gl)*2654435769U) >> ga2la->shift);
+}
+
+/*! \brief Returns the hash table index of the entry for \p a_gl
+ *
+ * When \p a_gl is not present, the index of the empty entry
+ * where it should be stored is returned.
+ */
+static inline int ga2la_find_index(const gmx_ga2la_t *ga2la, int a_gl)
+{
+    int ind = ga2la_start_index(ga2la, a_gl);
+
+    while (ga2la->lal[ind].ga >= 0 && ga2la->lal[ind].ga != a_gl)
+    {
+        ind = (ind + 1) & ga2la->mask;
+    }
+
+    return ind;
+}
+
 /*! \brief Clear all the entries in the ga2la list
  *
- * \param[in,out] ga2la The global to local atom struct
+ * The direct list has the size of the whole system,
+ * so it is worth using multiple threads here.
+ *
+ * \param[in,out] ga2la   The global to local atom struct
+ * \param[in]     nthread The number of OpenMP threads to use
  */
-static void ga2la_clear(gmx_ga2la_t *ga2la)
+static void ga2la_clear(gmx_ga2la_t *ga2la, int nthread)
 {
     int i;
 
     if (ga2la->bDirectList)
     {
+#pragma omp parallel for num_threads(nthread) schedule(static)
         for (i = 0; i < ga2la->nalloc; i++)
         {
             ga2la->laa[i].cell = -1;
@@ -93,15 +127,34 @@ static void ga2la_clear(gmx_ga2la_t *ga2la)
     }
     else
     {
+#pragma omp parallel for num_threads(nthread) schedule(static)
         for (i = 0; i < ga2la->nalloc; i++)
         {
             ga2la->lal[i].ga   = -1;
-            ga2la->lal[i].next = -1;
+            ga2la->lal[i].cell = -1;
         }
-        ga2la->start_space_search = ga2la->mod;
+        ga2la->nkey = 0;
     }
 }
 
+/*! \brief Sets the hash table size to at least double \p nkey_estimate
+ *
+ * The contents are not preserved.
+ */
+static void ga2la_realloc_hash(gmx_ga2la_t *ga2la, int nkey_estimate)
+{
+    ga2la->mod   = 4;
+    ga2la->shift = 30;
+    while (2*nkey_estimate > ga2la->mod)
+    {
+        ga2la->mod   *= 2;
+        ga2la->shift -= 1;
+    }
+    ga2la->mask   = ga2la->mod - 1;
+    ga2la->nalloc = ga2la->mod;
+    srenew(ga2la->lal, ga2la->nalloc);
+}
+
 /*! \brief Initializes and returns a pointer to a gmx_ga2la_t structure
  *
  * \param[in] natoms_total  The total number of atoms in the system
@@ -117,11 +170,11 @@ static gmx_ga2la_t *ga2la_init(int natoms_total, int natoms_local)
     /* There are two methods implemented for finding the local atom number
      * belonging to a global atom number:
      * 1) a simple, direct array
-     * 2) a hash table consisting of list of linked lists indexed with
-     *    the global number modulo mod.
+     * 2) an open addressing hash table with at least double the number
+     *    of entries as local atoms.
      * Memory requirements:
      * 1) nat_tot*2 ints
-     * 2) nat_loc*(2+1-2(1-e^-1/2))*4 ints
+     * 2) nat_loc*(2 to 4)*3 ints
      * where nat_loc is the number of atoms in the home + communicated zones.
      * Method 1 is faster for low parallelization, 2 for high parallelization.
      * We switch to method 2 when it uses less than half the memory method 1.
@@ -136,23 +189,27 @@ static gmx_ga2la_t *ga2la_init(int natoms_total, int natoms_local)
     }
     else
     {
-        /* Make the direct list twice as long as the number of local atoms.
-         * The fraction of entries in the list with:
-         * 0   size lists: e^-1/f
-         * >=1 size lists: 1 - e^-1/f
-         * where f is: the direct list length / #local atoms
-         * The fraction of atoms not in the direct list is: 1-f(1-e^-1/f).
-         */
-        ga2la->mod    = 2*natoms_local;
-        ga2la->nalloc = over_alloc_dd(ga2la->mod);
-        snew(ga2la->lal, ga2la->nalloc);
+        ga2la_realloc_hash(ga2la, natoms_local);
     }
 
-    ga2la_clear(ga2la);
+    /* We are called before the thread counts are set */
+    ga2la_clear(ga2la, 1);
 
     return ga2la;
 }
 
+/*! \brief Returns whether ga2la_set can be called concurrently for different atoms
+ *
+ * This is the case with the direct list, where each global atom
+ * has its own entry, but not with the hash table.
+ *
+ * \param[in] ga2la The global to local atom struct
+ */
+static gmx_bool ga2la_is_thread_safe(const gmx_ga2la_t *ga2la)
+{
+    return ga2la->bDirectList;
+}
+
 /*! \brief Sets the ga2la entry for global atom a_gl
  *
  * \param[in,out] ga2la The global to local atom struct
@@ -162,7 +219,7 @@ static gmx_ga2la_t *ga2la_init(int natoms_total, int natoms_local)
  */
 static void ga2la_set(gmx_ga2la_t *ga2la, int a_gl, int a_loc, int cell)
 {
-    int ind, ind_prev, i;
+    int ind;
 
     if (ga2la->bDirectList)
     {
@@ -172,36 +229,30 @@ static void ga2la_set(gmx_ga2la_t *ga2la, int a_gl, int a_loc, int cell)
         return;
     }
 
-    ind = a_gl % ga2la->mod;
-
-    if (ga2la->lal[ind].ga >= 0)
+    if (2*(ga2la->nkey + 1) > ga2la->mod)
     {
-        /* Search the last entry in the linked list for this index */
-        ind_prev = ind;
-        while (ga2la->lal[ind_prev].next >= 0)
-        {
-            ind_prev = ga2la->lal[ind_prev].next;
-        }
-        /* Search for space in the array */
-        ind = ga2la->start_space_search;
-        while (ind < ga2la->nalloc && ga2la->lal[ind].ga >= 0)
-        {
-            ind++;
-        }
-        /* If we are at the end of the list we need to increase the size */
-        if (ind == ga2la->nalloc)
+        /* Double the table size and re-insert all entries */
+        gmx_lal_t *old_lal = ga2la->lal;
+        int        old_mod = ga2la->mod;
+
+        ga2la->lal = nullptr;
+        ga2la_realloc_hash(ga2la, old_mod);
+        ga2la_clear(ga2la, 1);
+        for (int i = 0; i < old_mod; i++)
         {
-            ga2la->nalloc = over_alloc_dd(ind+1);
-            srenew(ga2la->lal, ga2la->nalloc);
-            for (i = ind; i < ga2la->nalloc; i++)
+            if (old_lal[i].ga >= 0)
             {
-                ga2la->lal[i].ga   = -1;
-                ga2la->lal[i].next = -1;
+                ga2la->lal[ga2la_find_index(ga2la, old_lal[i].ga)] = old_lal[i];
+                ga2la->nkey++;
             }
         }
-        ga2la->lal[ind_prev].next = ind;
+        sfree(old_lal);
+    }
 
-        ga2la->start_space_search = ind + 1;
+    ind = ga2la_find_index(ga2la, a_gl);
+    if (ga2la->lal[ind].ga < 0)
+    {
+        ga2la->nkey++;
     }
     ga2la->lal[ind].ga   = a_gl;
     ga2la->lal[ind].la   = a_loc;
@@ -215,7 +266,7 @@ static void ga2la_set(gmx_ga2la_t *ga2la, int a_gl, int a_loc, int cell)
  */
 static void ga2la_del(gmx_ga2la_t *ga2la, int a_gl)
 {
-    int ind, ind_prev;
+    int ind, next;
 
     if (ga2la->bDirectList)
     {
@@ -224,36 +275,35 @@ static void ga2la_del(gmx_ga2la_t *ga2la, int a_gl)
         return;
     }
 
-    ind_prev = -1;
-    ind      = a_gl % ga2la->mod;
-    do
+    ind = ga2la_find_index(ga2la, a_gl);
+    if (ga2la->lal[ind].ga < 0)
     {
-        if (ga2la->lal[ind].ga == a_gl)
-        {
-            if (ind_prev >= 0)
-            {
-                ga2la->lal[ind_prev].next = ga2la->lal[ind].next;
-
-                /* This index is a linked entry, so we free an entry.
-                 * Check if we are creating the first empty space.
-                 */
-                if (ind < ga2la->start_space_search)
-                {
-                    ga2la->start_space_search = ind;
-                }
-            }
-            ga2la->lal[ind].ga   = -1;
-            ga2la->lal[ind].cell = -1;
-            ga2la->lal[ind].next = -1;
+        return;
+    }
 
-            return;
+    /* Move entries later in the probe sequence into the free position
+     * when their start index does not lie cyclically in (ind, next].
+     */
+    next = ind;
+    while (true)
+    {
+        next = (next + 1) & ga2la->mask;
+        if (ga2la->lal[next].ga < 0)
+        {
+            break;
+        }
+        int start = ga2la_start_index(ga2la, ga2la->lal[next].ga);
+        if ((ind <= next) ? (ind < start && start <= next) : (ind < start || start <= next))
+        {
+            continue;
         }
-        ind_prev = ind;
-        ind      = ga2la->lal[ind].next;
+        ga2la->lal[ind] = ga2la->lal[next];
+        ind             = next;
     }
-    while (ind >= 0);
+    ga2la->lal[ind].ga   = -1;
+    ga2la->lal[ind].cell = -1;
 
-    return;
+    ga2la->nkey--;
 }
 
 /*! \brief Change the local atom for present ga2la entry for global atom a_gl
@@ -273,20 +323,11 @@ static void ga2la_change_la(gmx_ga2la_t *ga2la, int a_gl, int a_loc)
         return;
     }
 
-    ind = a_gl % ga2la->mod;
-    do
+    ind = ga2la_find_index(ga2la, a_gl);
+    if (ga2la->lal[ind].ga == a_gl)
     {
-        if (ga2la->lal[ind].ga == a_gl)
-        {
-            ga2la->lal[ind].la = a_loc;
-
-            return;
-        }
-        ind = ga2la->lal[ind].next;
+        ga2la->lal[ind].la = a_loc;
     }
-    while (ind >= 0);
-
-    return;
 }
 
 /*! \brief Returns if the global atom a_gl available locally
@@ -309,19 +350,14 @@ static gmx_bool ga2la_get(const gmx_ga2la_t *ga2la, int a_gl, int *a_loc, int *c
         return (ga2la->laa[a_gl].cell >= 0);
     }
 
-    ind = a_gl % ga2la->mod;
-    do
+    ind = ga2la_find_index(ga2la, a_gl);
+    if (ga2la->lal[ind].ga == a_gl)
     {
-        if (ga2la->lal[ind].ga == a_gl)
-        {
-            *a_loc = ga2la->lal[ind].la;
-            *cell  = ga2la->lal[ind].cell;
+        *a_loc = ga2la->lal[ind].la;
+        *cell  = ga2la->lal[ind].cell;
 
-            return TRUE;
-        }
-        ind = ga2la->lal[ind].next;
+        return TRUE;
     }
-    while (ind >= 0);
 
     return FALSE;
 }
@@ -344,29 +380,41 @@ static gmx_bool ga2la_get_home(const gmx_ga2la_t *ga2la, int a_gl, int *a_loc)
         return (ga2la->laa[a_gl].cell == 0);
     }
 
-    ind = a_gl % ga2la->mod;
-    do
+    /* Empty entries have cell -1, so we do not need to check the index */
+    ind = ga2la_find_index(ga2la, a_gl);
+    if (ga2la->lal[ind].cell == 0)
     {
-        if (ga2la->lal[ind].ga == a_gl)
-        {
-            if (ga2la->lal[ind].cell == 0)
-            {
-                *a_loc = ga2la->lal[ind].la;
+        *a_loc = ga2la->lal[ind].la;
 
-                return TRUE;
-            }
-            else
-            {
-                return FALSE;
-            }
-        }
-        ind = ga2la->lal[ind].next;
+        return TRUE;
     }
-    while (ind >= 0);
 
     return FALSE;
 }
 
+/*! \brief Looks up the local index of \p n home atoms
+ *
+ * Sets \p a_loc[i] to the local index of global atom \p a_gl[i] when
+ * it is a home atom, to -1 otherwise. The lookups are independent,
+ * so the processor can have the memory accesses for multiple atoms
+ * in flight at the same time.
+ *
+ * \param[in]  ga2la The global to local atom struct
+ * \param[in]  n     The number of atoms
+ * \param[in]  a_gl  The global atom indices
+ * \param[out] a_loc The local atom indices or -1
+ */
+static void ga2la_get_home_batch(const gmx_ga2la_t *ga2la, int n,
+                                 const int *a_gl, int *a_loc)
+{
+    for (int i = 0; i < n; i++)
+    {
+        int a;
+
+        a_loc[i] = (ga2la_get_home(ga2la, a_gl[i], &a) ? a : -1);
+    }
+}
+
 /*! \brief Returns if the global atom a_gl is a home atom
  *
  * \param[in]  ga2la The global to local atom struct
@@ -375,25 +423,12 @@ static gmx_bool ga2la_get_home(const gmx_ga2la_t *ga2la, int a_gl, int *a_loc)
  */
 static gmx_bool ga2la_is_home(const gmx_ga2la_t *ga2la, int a_gl)
 {
-    int ind;
-
     if (ga2la->bDirectList)
     {
         return (ga2la->laa[a_gl].cell == 0);
     }
 
-    ind = a_gl % ga2la->mod;
-    do
-    {
-        if (ga2la->lal[ind].ga == a_gl)
-        {
-            return (ga2la->lal[ind].cell == 0);
-        }
-        ind = ga2la->lal[ind].next;
-    }
-    while (ind >= 0);
-
-    return FALSE;
+    return (ga2la->lal[ga2la_find_index(ga2la, a_gl)].cell == 0);
 }
 
 #endif
@@ -41,6 +41,16 @@
  * efficiency and lowest memory usage possible.  Thus the code is in a header,
  * so it can be inlined where it is used.
  *
+ * The hash table uses open addressing with linear probing in a single,
+ * contiguous array of key/value pairs. The table size is a power of 2
+ * and kept at least double the number of keys, so probe sequences are
+ * short and usually stay within one cache line. The keys are scattered
+ * over the table with multiplicative hashing, since the keys stored
+ * in domain decomposition are often contiguous ranges of global indices
+ * which would otherwise form long probe sequences.
+ * Entries are deleted by shifting back later entries in the probe
+ * sequence, so no deleted-entry markers are needed.
+ *
  * \author Berk Hess <hess@kth.se>
  * \ingroup module_domdec
  */
@@ -54,82 +64,124 @@
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/smalloc.h"
 
-/*! \internal \brief Hashing key-generation helper struct */
+/*! \internal \brief Hash table entry */
 struct gmx_hash_e_t
 {
     public:
-        //! The (unique) key for storing/looking up a value
+        //! The (unique) key for storing/looking up a value, -1 for an empty entry
         int  key;
         //! The value belonging to key
         int  val;
-        //! Index for the next element in the array with indentical value key%mod, -1 if there is no next element
-        int  next;
 };
 
 /*! \internal \brief Hashing helper struct */
 struct gmx_hash_t
 {
     public:
-        //! Keys are looked up by first checking array index key%mod in hash
+        //! The size of the table, a power of 2
         int           mod;
-        //! mask=log2(mod), used to replace a % by the faster & operation
+        //! mask=mod-1, used to replace a % by the faster & operation
         int           mask;
-        //! Allocated size of hash
-        int           nalloc;
-        //! The actual array containing the keys, values and next indices
+        //! The bit shift for obtaining a table index from the hashed key
+        int           shift;
+        //! The actual array containing the keys and values
         gmx_hash_e_t *hash;
         //! The number of keys stored
         int           nkey;
-        //! Index in hash where we should start searching for space to store a new key/value
-        int           start_space_search;
 };
 
+//! Returns the index in the table where the search for \p key should start.
+static inline int gmx_hash_start_index(const gmx_hash_t *hash, int key)
+{
+    /* Fibonacci hashing: multiply by 2^32 divided by the golden ratio
+     * and use the high bits of the (wrapping) unsigned product.
+     */
+    return static_cast<int>((static_cast<unsigned int>(key)*2654435769U) >> hash->shift);
+}
+
+/*! \brief Returns the index of the entry for \p key
+ *
+ * When \p key is not present, the index of the empty entry
+ * where it should be stored is returned.
+ */
+static inline int gmx_hash_find_index(const gmx_hash_t *hash, int key)
+{
+    int ind = gmx_hash_start_index(hash, key);
+
+    while (hash->hash[ind].key >= 0 && hash->hash[ind].key != key)
+    {
+        ind = (ind + 1) & hash->mask;
+    }
+
+    return ind;
+}
+
 //! Clear all the entries in the hash table.
 static void gmx_hash_clear(gmx_hash_t *hash)
 {
     int i;
 
-    for (i = 0; i < hash->nalloc; i++)
+    for (i = 0; i < hash->mod; i++)
     {
-        hash->hash[i].key  = -1;
-        hash->hash[i].next = -1;
+        hash->hash[i].key = -1;
+        hash->hash[i].val = -1;
     }
-    hash->start_space_search = hash->mod;
 
     hash->nkey = 0;
 }
 
-//! Reallocate hash table data structures.
+/*! \brief Reallocate hash table data structures.
+ *
+ * The contents of the table are not preserved, the table should be
+ * cleared after calling this function.
+ */
 static void gmx_hash_realloc(gmx_hash_t *hash, int nkey_used_estimate)
 {
-    /* Memory requirements:
-     * nkey_used_est*(2+1-2(1-e^-1/2))*3 ints
-     * where nkey_used_est is the local number of keys used.
-     *
-     * Make the direct list twice as long as the number of local keys.
-     * The fraction of entries in the list with:
-     * 0   size lists: e^-f
-     * >=1 size lists: 1 - e^-f
-     * where f is: the #keys / mod
-     * The fraction of keys not in the direct list is: 1-1/f(1-e^-f).
-     * The optimal table size is roughly double the number of keys.
+    /* Make the hash table a power of 2 and at least double the number of keys,
+     * this gives an average of at most 2.5 probes for keys that are not
+     * present, and 1.5 for keys that are present.
      */
-    /* Make the hash table a power of 2 and at least double the number of keys */
-    hash->mod = 4;
+    hash->mod   = 4;
+    hash->shift = 30;
     while (2*nkey_used_estimate > hash->mod)
     {
-        hash->mod *= 2;
+        hash->mod   *= 2;
+        hash->shift -= 1;
     }
-    hash->mask   = hash->mod - 1;
-    hash->nalloc = over_alloc_dd(hash->mod);
-    srenew(hash->hash, hash->nalloc);
+    hash->mask = hash->mod - 1;
+    srenew(hash->hash, hash->mod);
 
     if (debug != nullptr)
     {
-        fprintf(debug, "Hash table mod %d nalloc %d\n", hash->mod, hash->nalloc);
+        fprintf(debug, "Hash table mod %d\n", hash->mod);
     }
 }
 
+//! Doubles the table size, while preserving the contents.
+static void gmx_hash_grow(gmx_hash_t *hash)
+{
+    gmx_hash_e_t *old_hash = hash->hash;
+    int           old_mod  = hash->mod;
+    int           i;
+
+    hash->hash = nullptr;
+    gmx_hash_realloc(hash, old_mod);
+    gmx_hash_clear(hash);
+
+    for (i = 0; i < old_mod; i++)
+    {
+        if (old_hash[i].key >= 0)
+        {
+            int ind = gmx_hash_find_index(hash, old_hash[i].key);
+
+            hash->hash[ind] = old_hash[i];
+            hash->nkey++;
+        }
+    }
+
+    sfree(old_hash);
+}
+
 /*! \brief Clear all the entries in the hash table.
  *
  * With the current number of keys check if the table size is still
@@ -137,9 +189,10 @@ static void gmx_hash_realloc(gmx_hash_t *hash, int nkey_used_estimate)
  */
 static void gmx_hash_clear_and_optimize(gmx_hash_t *hash)
 {
-    /* Resize the hash table when the occupation is < 1/4 or > 2/3 */
-    if (hash->nkey > 0 &&
-        (4*hash->nkey < hash->mod || 3*hash->nkey > 2*hash->mod))
+    /* Shrink the hash table when the occupation is < 1/8,
+     * the table grows automatically when keys are added.
+     */
+    if (hash->nkey > 0 && 8*hash->nkey < hash->mod)
     {
         if (debug != nullptr)
         {
@@ -167,85 +220,67 @@ static gmx_hash_t *gmx_hash_init(int nkey_used_estimate)
     return hash;
 }
 
+//! Frees the hash table.
+static void gmx_hash_destroy(gmx_hash_t *hash)
+{
+    sfree(hash->hash);
+    sfree(hash);
+}
+
 //! Set the hash entry for key to value.
 static void gmx_hash_set(gmx_hash_t *hash, int key, int value)
 {
-    int ind, ind_prev, i;
-
-    ind = key & hash->mask;
+    int ind;
 
-    if (hash->hash[ind].key >= 0)
+    if (2*(hash->nkey + 1) > hash->mod)
     {
-        /* Search the last entry in the linked list for this index */
-        ind_prev = ind;
-        while (hash->hash[ind_prev].next >= 0)
-        {
-            ind_prev = hash->hash[ind_prev].next;
-        }
-        /* Search for space in the array */
-        ind = hash->start_space_search;
-        while (ind < hash->nalloc && hash->hash[ind].key >= 0)
-        {
-            ind++;
-        }
-        /* If we are at the end of the list we need to increase the size */
-        if (ind == hash->nalloc)
-        {
-            hash->nalloc = over_alloc_dd(ind+1);
-            srenew(hash->hash, hash->nalloc);
-            for (i = ind; i < hash->nalloc; i++)
-            {
-                hash->hash[i].key  = -1;
-                hash->hash[i].next = -1;
-            }
-        }
-        hash->hash[ind_prev].next = ind;
+        gmx_hash_grow(hash);
+    }
 
-        hash->start_space_search = ind + 1;
+    ind = gmx_hash_find_index(hash, key);
+
+    if (hash->hash[ind].key < 0)
+    {
+        hash->hash[ind].key = key;
+        hash->nkey++;
     }
-    hash->hash[ind].key = key;
     hash->hash[ind].val = value;
-
-    hash->nkey++;
 }
 
 //! Delete the hash entry for key.
 static void gmx_hash_del(gmx_hash_t *hash, int key)
 {
-    int ind, ind_prev;
+    int ind, next;
+
+    ind = gmx_hash_find_index(hash, key);
+    if (hash->hash[ind].key < 0)
+    {
+        return;
+    }
 
-    ind_prev = -1;
-    ind      = key & hash->mask;
-    do
+    /* Move entries later in the probe sequence into the free position
+     * when their start index does not lie cyclically in (ind, next].
+     */
+    next = ind;
+    while (true)
     {
-        if (hash->hash[ind].key == key)
+        next = (next + 1) & hash->mask;
+        if (hash->hash[next].key < 0)
+        {
+            break;
+        }
+        int start = gmx_hash_start_index(hash, hash->hash[next].key);
+        if ((ind <= next) ? (ind < start && start <= next) : (ind < start || start <= next))
         {
-            if (ind_prev >= 0)
-            {
-                hash->hash[ind_prev].next = hash->hash[ind].next;
-
-                /* This index is a linked entry, so we free an entry.
-                 * Check if we are creating the first empty space.
-                 */
-                if (ind < hash->start_space_search)
-                {
-                    hash->start_space_search = ind;
-                }
-            }
-            hash->hash[ind].key  = -1;
-            hash->hash[ind].val  = -1;
-            hash->hash[ind].next = -1;
-
-            hash->nkey--;
-
-            return;
+            continue;
         }
-        ind_prev = ind;
-        ind      = hash->hash[ind].next;
+        hash->hash[ind] = hash->hash[next];
+        ind             = next;
     }
-    while (ind >= 0);
+    hash->hash[ind].key = -1;
+    hash->hash[ind].val = -1;
 
-    return;
+    hash->nkey--;
 }
 
 //! Change the value for present hash entry for key.
@@ -253,43 +288,17 @@ static void gmx_hash_change_value(gmx_hash_t *hash, int key, int value)
 {
     int ind;
 
-    ind = key & hash->mask;
-    do
+    ind = gmx_hash_find_index(hash, key);
+    if (hash->hash[ind].key == key)
     {
-        if (hash->hash[ind].key == key)
-        {
-            hash->hash[ind].val = value;
-
-            return;
-        }
-        ind = hash->hash[ind].next;
+        hash->hash[ind].val = value;
     }
-    while (ind >= 0);
-
-    return;
 }
 
 //! Change the hash value if already set, otherwise set the hash value.
 static void gmx_hash_change_or_set(gmx_hash_t *hash, int key, int value)
 {
-    int ind;
-
-    ind = key & hash->mask;
-    do
-    {
-        if (hash->hash[ind].key == key)
-        {
-            hash->hash[ind].val = value;
-
-            return;
-        }
-        ind = hash->hash[ind].next;
-    }
-    while (ind >= 0);
-
     gmx_hash_set(hash, key, value);
-
-    return;
 }
 
 //! Returns if the key is present, if the key is present *value is set.
@@ -297,18 +306,13 @@ static gmx_bool gmx_hash_get(const gmx_hash_t *hash, int key, int *value)
 {
     int ind;
 
-    ind = key & hash->mask;
-    do
+    ind = gmx_hash_find_index(hash, key);
+    if (hash->hash[ind].key == key)
     {
-        if (hash->hash[ind].key == key)
-        {
-            *value = hash->hash[ind].val;
+        *value = hash->hash[ind].val;
 
-            return TRUE;
-        }
-        ind = hash->hash[ind].next;
+        return TRUE;
     }
-    while (ind >= 0);
 
     return FALSE;
 }
@@ -316,20 +320,8 @@ static gmx_bool gmx_hash_get(const gmx_hash_t *hash, int key, int *value)
 //! Returns the value or -1 if the key is not present.
 static int gmx_hash_get_minone(const gmx_hash_t *hash, int key)
 {
-    int ind;
-
-    ind = key & hash->mask;
-    do
-    {
-        if (hash->hash[ind].key == key)
-        {
-            return hash->hash[ind].val;
-        }
-        ind = hash->hash[ind].next;
-    }
-    while (ind >= 0);
-
-    return -1;
+    /* Empty entries have value -1, so we do not need to check the key */
+    return hash->hash[gmx_hash_find_index(hash, key)].val;
 }
 
 #endif
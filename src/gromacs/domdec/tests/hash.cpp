@@ -0,0 +1,156 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the domain decomposition hash table and the global to
+ * local atom index lookup.
+ *
+ * \ingroup module_domdec
+ */
+#include "gmxpre.h"
+
+#include "gromacs/domdec/hash.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/domdec/ga2la.h"
+#include "gromacs/utility/smalloc.h"
+
+namespace
+{
+
+TEST(DomdecHashTest, SetsAndGetsValues)
+{
+    gmx_hash_t *hash = gmx_hash_init(10);
+
+    /* Use enough keys to force growing the table several times */
+    for (int key = 0; key < 1000; key++)
+    {
+        gmx_hash_set(hash, 5*key, key);
+    }
+    for (int key = 0; key < 1000; key++)
+    {
+        int value = -1;
+        EXPECT_TRUE(gmx_hash_get(hash, 5*key, &value));
+        EXPECT_EQ(key, value);
+        EXPECT_EQ(-1, gmx_hash_get_minone(hash, 5*key + 1));
+    }
+    gmx_hash_change_value(hash, 10, 123);
+    EXPECT_EQ(123, gmx_hash_get_minone(hash, 10));
+    gmx_hash_change_or_set(hash, 11, 7);
+    EXPECT_EQ(7, gmx_hash_get_minone(hash, 11));
+
+    gmx_hash_clear_and_optimize(hash);
+    for (int key = 0; key < 1000; key++)
+    {
+        EXPECT_EQ(-1, gmx_hash_get_minone(hash, 5*key));
+    }
+
+    gmx_hash_destroy(hash);
+}
+
+TEST(DomdecHashTest, DeletesKeysInContiguousRange)
+{
+    gmx_hash_t *hash = gmx_hash_init(100);
+
+    /* Contiguous keys are what domain decomposition mostly stores */
+    const int   nkey = 200;
+    for (int key = 0; key < nkey; key++)
+    {
+        gmx_hash_set(hash, 1000 + key, key);
+    }
+    /* Deleting entries should not break the probe sequences of others */
+    for (int key = 0; key < nkey; key += 3)
+    {
+        gmx_hash_del(hash, 1000 + key);
+    }
+    gmx_hash_del(hash, 5);
+    for (int key = 0; key < nkey; key++)
+    {
+        EXPECT_EQ(key % 3 == 0 ? -1 : key, gmx_hash_get_minone(hash, 1000 + key));
+    }
+
+    gmx_hash_destroy(hash);
+}
+
+TEST(DomdecGa2laTest, WorksWithHashTable)
+{
+    /* A small fraction of local atoms selects the hash table */
+    gmx_ga2la_t *ga2la = ga2la_init(100000, 100);
+    ASSERT_FALSE(ga2la_is_thread_safe(ga2la));
+
+    const int    natoms = 1000;
+    for (int a = 0; a < natoms; a++)
+    {
+        ga2la_set(ga2la, 50000 + a, a, a % 2);
+    }
+    for (int a = 0; a < natoms; a += 4)
+    {
+        ga2la_del(ga2la, 50000 + a);
+    }
+    ga2la_change_la(ga2la, 50001, 7);
+
+    std::vector<int> globalIndices, localIndices(natoms);
+    for (int a = 0; a < natoms; a++)
+    {
+        globalIndices.push_back(50000 + a);
+    }
+    ga2la_get_home_batch(ga2la, natoms, globalIndices.data(), localIndices.data());
+    for (int a = 0; a < natoms; a++)
+    {
+        int      aLocal, cell;
+        bool     bPresent = (a % 4 != 0);
+        int      aExpected = (a == 1 ? 7 : a);
+        EXPECT_EQ(bPresent, static_cast<bool>(ga2la_get(ga2la, 50000 + a, &aLocal, &cell)));
+        if (bPresent)
+        {
+            EXPECT_EQ(aExpected, aLocal);
+            EXPECT_EQ(a % 2, cell);
+        }
+        EXPECT_EQ(bPresent && a % 2 == 0, static_cast<bool>(ga2la_is_home(ga2la, 50000 + a)));
+        EXPECT_EQ(bPresent && a % 2 == 0 ? aExpected : -1, localIndices[a]);
+    }
+
+    ga2la_clear(ga2la, 1);
+    EXPECT_FALSE(ga2la_is_home(ga2la, 50002));
+
+    sfree(ga2la->laa);
+    sfree(ga2la->lal);
+    sfree(ga2la);
+}
+
+} // namespace
@@ -0,0 +1,321 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests that the OpenMP threaded parts of domain decomposition
+ * repartitioning give the same home atom order, count and atom
+ * indices as a single thread.
+ *
+ * \ingroup module_domdec
+ */
+#include "gmxpre.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/domdec/domdec_internal.h"
+#include "gromacs/domdec/domdec_struct.h"
+#include "gromacs/domdec/ga2la.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/utility/smalloc.h"
+
+namespace
+{
+
+//! The thread counts to compare with a single thread.
+const int c_threadCounts[] = { 2, 3, 4, 7 };
+
+//! Returns the nbnxn atom order of \p na entries with filler particles.
+std::vector<int> atomOrderWithFillers(int na)
+{
+    std::vector<int> a(na);
+    int              atom = 0;
+    for (int i = 0; i < na; i++)
+    {
+        /* Irregular runs of fillers, as at the end of grid cells */
+        a[i] = ((i*7) % 11 < 3) ? -1 : atom++;
+    }
+    return a;
+}
+
+TEST(DomdecRepartitionTest, CompactsAtomOrderAsSingleThread)
+{
+    for (int na : { 0, 1, 5, 37, 1000 })
+    {
+        std::vector<int>          a = atomOrderWithFillers(na);
+        std::vector<gmx_cgsort_t> ref(na + 1);
+        int                       nref = dd_compact_atom_order(a.data(), na, ref.data(), 1);
+
+        int                       nexpected = 0;
+        for (int i = 0; i < na; i++)
+        {
+            if (a[i] >= 0)
+            {
+                EXPECT_EQ(a[i], ref[nexpected].ind);
+                nexpected++;
+            }
+        }
+        EXPECT_EQ(nexpected, nref);
+
+        for (int nthread : c_threadCounts)
+        {
+            std::vector<gmx_cgsort_t> sort(na + 1);
+            ASSERT_EQ(nref, dd_compact_atom_order(a.data(), na, sort.data(), nthread))
+            << "with " << nthread << " threads and " << na << " entries";
+            for (int i = 0; i < nref; i++)
+            {
+                EXPECT_EQ(ref[i].ind, sort[i].ind)
+                << "home atom " << i << " with " << nthread << " threads";
+            }
+        }
+    }
+}
+
+//! Returns \p n coordinates that differ for each atom.
+std::vector<gmx::RVec> makeCoordinates(int n)
+{
+    std::vector<gmx::RVec> x;
+    for (int i = 0; i < n; i++)
+    {
+        x.emplace_back(i, 0.5*i, -0.25*i);
+    }
+    return x;
+}
+
+TEST(DomdecRepartitionTest, OrdersHomeStateAsSingleThread)
+{
+    /* Charge groups of 1 to 3 atoms */
+    const int        ncg = 50;
+    std::vector<int> cgindex(ncg + 1, 0);
+    for (int cg = 0; cg < ncg; cg++)
+    {
+        cgindex[cg + 1] = cgindex[cg] + 1 + cg % 3;
+    }
+    const int                 natoms = cgindex[ncg];
+
+    std::vector<gmx_cgsort_t> sort(ncg);
+    for (int cg = 0; cg < ncg; cg++)
+    {
+        sort[cg].ind = (cg*17) % ncg;
+    }
+
+    /* Without and with charge groups */
+    const std::vector<const int *> cgindices = { nullptr, cgindex.data() };
+    for (const int *index : cgindices)
+    {
+        const int              n   = (index ? natoms : ncg);
+        std::vector<gmx::RVec> ref = makeCoordinates(n);
+        std::vector<gmx::RVec> buf(n);
+        order_vec_atom(ncg, index, sort.data(), as_rvec_array(ref.data()),
+                       as_rvec_array(buf.data()), 1);
+
+        for (int nthread : c_threadCounts)
+        {
+            std::vector<gmx::RVec> x = makeCoordinates(n);
+            order_vec_atom(ncg, index, sort.data(), as_rvec_array(x.data()),
+                           as_rvec_array(buf.data()), nthread);
+            for (int i = 0; i < n; i++)
+            {
+                EXPECT_EQ(ref[i][XX], x[i][XX]) << "atom " << i << " with " << nthread << " threads";
+            }
+        }
+    }
+}
+
+/*! \brief
+ * Test fixture with a domain decomposition setup of two zones,
+ * with global charge groups of 1 to 3 atoms in a shuffled order.
+ */
+class MakeIndicesTest : public ::testing::Test
+{
+    public:
+        MakeIndicesTest() : dd_(nullptr), nthreadDomdec_(gmx_omp_nthreads_get(emntDomdec))
+        {
+            /* The global charge group index */
+            gcgsIndex_.push_back(0);
+            for (int cg = 0; cg < c_ncgGlobal; cg++)
+            {
+                gcgsIndex_.push_back(gcgsIndex_.back() + 1 + (cg*5) % 3);
+            }
+        }
+        ~MakeIndicesTest()
+        {
+            clearDD();
+            gmx_omp_nthreads_set(emntDomdec, nthreadDomdec_);
+        }
+
+        //! Frees the domain decomposition setup.
+        void clearDD()
+        {
+            if (dd_ != nullptr)
+            {
+                sfree(dd_->ga2la->laa);
+                sfree(dd_->ga2la->lal);
+                sfree(dd_->ga2la);
+                sfree(dd_->gatindex);
+                sfree(dd_->comm);
+                sfree(dd_);
+                dd_ = nullptr;
+            }
+        }
+
+        /*! \brief Sets up the local charge groups and makes the indices with \p nthread threads
+         *
+         * With \p bCGs the atoms of the charge groups in gcgsIndex_ are used,
+         * otherwise each charge group is one atom. With \p bHashTable
+         * the global to local atom index uses a hash table.
+         */
+        void makeIndices(bool bCGs, bool bHashTable, int nthread)
+        {
+            clearDD();
+            snew(dd_, 1);
+            snew(dd_->comm, 1);
+
+            /* Every third global charge group is local, in shuffled order */
+            indexGlobal_.clear();
+            for (int i = 0; i < c_ncgGlobal/3; i++)
+            {
+                indexGlobal_.push_back((i*31) % (c_ncgGlobal/3)*3);
+            }
+            const int ncg = indexGlobal_.size();
+            cgindex_.assign(1, 0);
+            for (int cg = 0; cg < ncg; cg++)
+            {
+                int cg_gl = indexGlobal_[cg];
+                cgindex_.push_back(cgindex_.back() +
+                                   (bCGs ? gcgsIndex_[cg_gl + 1] - gcgsIndex_[cg_gl] : 1));
+            }
+            const int natomsTotal = (bCGs ? gcgsIndex_[c_ncgGlobal] : c_ncgGlobal);
+
+            gmx_domdec_comm_t *comm = dd_->comm;
+            comm->bCGs              = bCGs;
+            comm->zones.n           = 2;
+            comm->zones.cg_range[0] = 0;
+            comm->zones.cg_range[1] = c_ncgHome;
+            comm->zones.cg_range[2] = ncg;
+            comm->zone_ncg1[0]      = c_ncgHome;
+            /* Part of zone 1 is more than one pulse away */
+            comm->zone_ncg1[1]      = (ncg - c_ncgHome)/2;
+
+            dd_->ncg_home = c_ncgHome;
+            dd_->index_gl = indexGlobal_.data();
+            dd_->cgindex  = cgindex_.data();
+            dd_->nat_tot  = cgindex_[ncg];
+            /* A small local atom estimate gives a hash table */
+            dd_->ga2la    = ga2la_init(bHashTable ? 100*natomsTotal : natomsTotal,
+                                       bHashTable ? 10 : natomsTotal);
+
+            gmx_omp_nthreads_set(emntDomdec, nthread);
+            make_dd_indices(dd_, gcgsIndex_.data(), 0);
+        }
+
+        //! Checks the indices for \p nthread threads against those of a single thread.
+        void checkIndices(bool bCGs, bool bHashTable)
+        {
+            makeIndices(bCGs, bHashTable, 1);
+            ASSERT_EQ(bHashTable, !ga2la_is_thread_safe(dd_->ga2la));
+            const int        natoms = dd_->nat_tot;
+            std::vector<int> refGatindex(dd_->gatindex, dd_->gatindex + natoms);
+            std::vector<int> refLocal, refCell;
+            for (int cg = 0; cg < static_cast<int>(indexGlobal_.size()); cg++)
+            {
+                /* Zone 1 charge groups beyond zone_ncg1 have cell nzone + 1 */
+                const int zone       = (cg < c_ncgHome ? 0 : 1);
+                const int cgZone1End = (zone == 0 ? c_ncgHome : c_ncgHome + dd_->comm->zone_ncg1[1]);
+                const int cellCg     = (cg < cgZone1End ? zone : zone + 2);
+                int       a_gl       = (bCGs ? gcgsIndex_[indexGlobal_[cg]] : indexGlobal_[cg]);
+                for (int a = cgindex_[cg]; a < cgindex_[cg + 1]; a++)
+                {
+                    EXPECT_EQ(a_gl, refGatindex[a]);
+                    int a_loc, cell;
+                    ASSERT_TRUE(ga2la_get(dd_->ga2la, refGatindex[a], &a_loc, &cell));
+                    EXPECT_EQ(a, a_loc);
+                    EXPECT_EQ(cellCg, cell);
+                    refLocal.push_back(a_loc);
+                    refCell.push_back(cell);
+                    a_gl++;
+                }
+            }
+
+            for (int nthread : c_threadCounts)
+            {
+                makeIndices(bCGs, bHashTable, nthread);
+                ASSERT_EQ(natoms, dd_->nat_tot);
+                for (int a = 0; a < natoms; a++)
+                {
+                    EXPECT_EQ(refGatindex[a], dd_->gatindex[a])
+                    << "atom " << a << " with " << nthread << " threads";
+                    int a_loc, cell;
+                    ASSERT_TRUE(ga2la_get(dd_->ga2la, refGatindex[a], &a_loc, &cell));
+                    EXPECT_EQ(refLocal[a], a_loc);
+                    EXPECT_EQ(refCell[a], cell);
+                }
+            }
+        }
+
+        //! The number of global charge groups.
+        static const int  c_ncgGlobal = 300;
+        //! The number of home charge groups.
+        static const int  c_ncgHome   = 40;
+        gmx_domdec_t     *dd_;
+        int               nthreadDomdec_;
+        std::vector<int>  gcgsIndex_;
+        std::vector<int>  indexGlobal_;
+        std::vector<int>  cgindex_;
+};
+
+TEST_F(MakeIndicesTest, DirectListWithChargeGroups)
+{
+    checkIndices(true, false);
+}
+
+TEST_F(MakeIndicesTest, DirectListWithAtoms)
+{
+    checkIndices(false, false);
+}
+
+TEST_F(MakeIndicesTest, HashTableWithChargeGroups)
+{
+    checkIndices(true, true);
+}
+
+TEST_F(MakeIndicesTest, HashTableWithAtoms)
+{
+    checkIndices(false, true);
+}
+
+} // namespace
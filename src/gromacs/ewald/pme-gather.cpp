@@ -139,7 +139,10 @@ void gather_f_bsplines(struct gmx_pme_t *pme, real *grid,
             switch (order)
             {
                 case 4:
-#ifdef PME_SIMD4_SPREAD_GATHER
+#if defined PME_4NSIMD_SPREAD_GATHER
+#define PME_GATHER_F_4NSIMD_ORDER4
+#include "pme-simd4.h"
+#elif defined PME_SIMD4_SPREAD_GATHER
 #ifdef PME_SIMD4_UNALIGNED
 #define PME_GATHER_F_SIMD4_ORDER4
 #else
@@ -62,6 +62,7 @@
 #include "gromacs/math/functions.h"
 #include "gromacs/math/vec.h"
 #include "gromacs/mdlib/forcerec.h"
+#include "gromacs/mdlib/nb_verlet.h"
 #include "gromacs/mdlib/nbnxn_gpu_data_mgmt.h"
 #include "gromacs/mdlib/sim_util.h"
 #include "gromacs/mdtypes/commrec.h"
@@ -766,6 +767,10 @@ pme_load_balance(pme_load_balancing_t      *pme_lb,
 
     set = &pme_lb->setup[pme_lb->cur];
 
+    /* The buffer of the dynamically pruned list does not depend on the cut-off */
+    const bool useDynamicPruning = (nbv != nullptr && nbv->useDynamicPruning);
+    const real rbufInner         = (useDynamicPruning ? nbv->rlistInner - std::max(ic->rcoulomb, ic->rvdw) : 0);
+
     ic->rcoulomb     = set->rcut_coulomb;
     ic->rlist        = set->rlist;
     ic->ewaldcoeff_q = set->ewaldcoeff_q;
@@ -791,6 +796,12 @@ pme_load_balance(pme_load_balancing_t      *pme_lb,
         }
     }
 
+    if (useDynamicPruning)
+    {
+        nbv->rlistInner = std::min(std::max(ic->rcoulomb, ic->rvdw) + rbufInner,
+                                   ic->rlist);
+    }
+
     /* We always re-initialize the tables whether they are used or not */
     init_interaction_const_tables(nullptr, ic, rtab);
 
@@ -53,6 +53,16 @@
 #    endif
 #endif
 
+/* Check if we have full-width SIMD support for groups of 4 elements */
+#if GMX_SIMD_HAVE_4NSIMD_UTIL_REAL && GMX_SIMD_REAL_WIDTH >= 8 && GMX_SIMD_REAL_WIDTH <= 16
+/* Do PME spread and gather with pme-order 4 using the full SIMD width,
+ * processing GMX_SIMD_REAL_WIDTH/4 grid lines along y per instruction.
+ * This also works with unaligned grids, as the SIMD4 code does with
+ * PME_SIMD4_UNALIGNED.
+ */
+#    define PME_4NSIMD_SPREAD_GATHER
+#endif
+
 #ifdef PME_SIMD4_SPREAD_GATHER
 #    define SIMD4_ALIGNMENT  (GMX_SIMD4_WIDTH*sizeof(real))
 #else
@@ -87,6 +87,37 @@
 #endif
 
 
+#ifdef PME_SPREAD_4NSIMD_ORDER4
+/* Spread one charge with pme_order=4 with full-width SIMD, using unaligned
+ * load+store of GMX_SIMD_REAL_WIDTH/4 grid lines along y at once.
+ * This code does not assume any memory alignment for the grid.
+ */
+{
+    /* With order 4 the z-spline is actually aligned */
+    const SimdReal tz_S = load4DuplicateN(thz);
+
+    for (ithx = 0; (ithx < 4); ithx++)
+    {
+        index_x = (i0+ithx)*pny*pnz;
+        valx    = coefficient*thx[ithx];
+
+        const SimdReal vx_tz_S = SimdReal(valx) * tz_S;
+
+        for (ithy = 0; (ithy < 4); ithy += GMX_SIMD_REAL_WIDTH/4)
+        {
+            index_xy = index_x+(j0+ithy)*pnz+k0;
+
+            const SimdReal ty_S  = loadUNDuplicate4(thy+ithy);
+            const SimdReal gri_S = loadU4NOffset(grid+index_xy, pnz);
+
+            storeU4NOffset(grid+index_xy, pnz, fma(vx_tz_S, ty_S, gri_S));
+        }
+    }
+}
+#undef PME_SPREAD_4NSIMD_ORDER4
+#endif
+
+
 #ifdef PME_GATHER_F_SIMD4_ORDER4
 /* Gather for one charge with pme_order=4 with unaligned SIMD4 load+store.
  * This code does not assume any memory alignment for the grid.
@@ -141,6 +172,51 @@
 #endif
 
 
+#ifdef PME_GATHER_F_4NSIMD_ORDER4
+/* Gather for one charge with pme_order=4 with full-width SIMD, using
+ * unaligned loads of GMX_SIMD_REAL_WIDTH/4 grid lines along y at once.
+ * This code does not assume any memory alignment for the grid.
+ */
+{
+    SimdReal fx_S = setZero();
+    SimdReal fy_S = setZero();
+    SimdReal fz_S = setZero();
+
+    /* With order 4 the z-spline is actually aligned */
+    const SimdReal tz_S = load4DuplicateN(thz);
+    const SimdReal dz_S = load4DuplicateN(dthz);
+
+    for (int ithx = 0; (ithx < 4); ithx++)
+    {
+        const int      index_x = (i0+ithx)*pny*pnz;
+        const SimdReal tx_S    = SimdReal(thx[ithx]);
+        const SimdReal dx_S    = SimdReal(dthx[ithx]);
+
+        for (int ithy = 0; (ithy < 4); ithy += GMX_SIMD_REAL_WIDTH/4)
+        {
+            const int      index_xy = index_x+(j0+ithy)*pnz;
+            const SimdReal ty_S     = loadUNDuplicate4(thy+ithy);
+            const SimdReal dy_S     = loadUNDuplicate4(dthy+ithy);
+
+            const SimdReal gval_S   = loadU4NOffset(grid+index_xy+k0, pnz);
+
+            const SimdReal fxy1_S   = tz_S * gval_S;
+            const SimdReal fz1_S    = dz_S * gval_S;
+
+            fx_S = fma(dx_S * ty_S, fxy1_S, fx_S);
+            fy_S = fma(tx_S * dy_S, fxy1_S, fy_S);
+            fz_S = fma(tx_S * ty_S, fz1_S, fz_S);
+        }
+    }
+
+    fx += reduce(fx_S);
+    fy += reduce(fy_S);
+    fz += reduce(fz_S);
+}
+#undef PME_GATHER_F_4NSIMD_ORDER4
+#endif
+
+
 #ifdef PME_SPREAD_SIMD4_ALIGNED
 /* This code assumes that the grid is allocated 4-real aligned
  * and that pnz is a multiple of 4.
@@ -370,7 +370,10 @@ static void spread_coefficients_bsplines_thread(const pmegrid_t
             switch (order)
             {
                 case 4:
-#ifdef PME_SIMD4_SPREAD_GATHER
+#if defined PME_4NSIMD_SPREAD_GATHER
+#define PME_SPREAD_4NSIMD_ORDER4
+#include "pme-simd4.h"
+#elif defined PME_SIMD4_SPREAD_GATHER
 #ifdef PME_SIMD4_UNALIGNED
 #define PME_SPREAD_SIMD4_ORDER4
 #else
@@ -450,11 +453,19 @@ static void copy_local_grid(const gmx_pme_t *pme, const pmegrids_t *pmegrids,
     }
 }
 
+/*! \brief Sums the thread-grid contributions for our thread's part of the fftgrid
+ *
+ * With \p bReduceLocal contributions to the rank-local fftgrid are summed,
+ * with \p bReduceComm contributions to the overlap communication buffers
+ * are summed. This allows filling the communication buffers first, starting
+ * the communication and reducing the local part while communicating.
+ */
 static void
 reduce_threadgrid_overlap(const gmx_pme_t *pme,
                           const pmegrids_t *pmegrids, int thread,
                           real *fftgrid, real *commbuf_x, real *commbuf_y,
-                          int grid_index)
+                          int grid_index,
+                          gmx_bool bReduceLocal, gmx_bool bReduceComm)
 {
     ivec local_fft_ndata, local_fft_offset, local_fft_size;
     int  fft_nx, fft_ny, fft_nz;
@@ -618,6 +629,10 @@ reduce_threadgrid_overlap(const gmx_pme_t *pme,
 
                 if (!(bCommX || bCommY))
                 {
+                    if (!bReduceLocal)
+                    {
+                        continue;
+                    }
                     /* Copy from the thread local grid to the node grid */
                     for (x = offx; x < tx1; x++)
                     {
@@ -632,7 +647,7 @@ reduce_threadgrid_overlap(const gmx_pme_t *pme,
                         }
                     }
                 }
-                else
+                else if (bReduceComm)
                 {
                     /* The order of this conditional decides
                      * where the corner volume gets stored with x+y decomp.
@@ -701,13 +716,85 @@ reduce_threadgrid_overlap(const gmx_pme_t *pme,
 }
 
 
-static void sum_fftgrid_dd(const gmx_pme_t *pme, real *fftgrid, int grid_index)
+/*! \brief Starts the first step of the forward fftgrid overlap communication
+ *
+ * Posts non-blocking receive and send calls for the first minor-dimension
+ * pulse or, without minor-dimension decomposition, for the major dimension.
+ * This only requires the communication buffers to be filled, so the
+ * reduction of the rank-local part of the fftgrid can overlap with it.
+ * The other communication steps depend on the data received here.
+ * The requests are stored in \p req, which should have space for two
+ * requests, and completed by sum_fftgrid_dd.
+ *
+ * \returns the number of requests stored in \p req.
+ */
+static int sum_fftgrid_dd_start(const gmx_pme_t *pme, int grid_index,
+                                MPI_Request *req)
+{
+    int nreq = 0;
+#if GMX_MPI
+    ivec local_fft_ndata, local_fft_offset, local_fft_size;
+
+    gmx_parallel_3dfft_real_limits(pme->pfft_setup[grid_index],
+                                   local_fft_ndata,
+                                   local_fft_offset,
+                                   local_fft_size);
+
+    if (pme->nnodes_minor > 1)
+    {
+        const pme_overlap_t *overlap = &pme->overlap[1];
+        int                  size_yx = 0;
+
+        if (pme->nnodes_major > 1)
+        {
+            size_yx = pme->overlap[0].comm_data[0].send_nindex;
+        }
+        int datasize = (local_fft_ndata[XX] + size_yx)*local_fft_ndata[ZZ];
+
+        MPI_Irecv(overlap->recvbuf, overlap->comm_data[0].recv_size*datasize,
+                  GMX_MPI_REAL, overlap->recv_id[0], 0,
+                  overlap->mpi_comm, &req[nreq++]);
+        MPI_Isend(overlap->sendbuf, overlap->send_size*datasize,
+                  GMX_MPI_REAL, overlap->send_id[0], 0,
+                  overlap->mpi_comm, &req[nreq++]);
+    }
+    else if (pme->nnodes_major > 1)
+    {
+        const pme_overlap_t *overlap  = &pme->overlap[0];
+        int                  datasize = local_fft_ndata[YY]*local_fft_ndata[ZZ];
+
+        MPI_Irecv(overlap->recvbuf, overlap->comm_data[0].recv_nindex*datasize,
+                  GMX_MPI_REAL, overlap->recv_id[0], 0,
+                  overlap->mpi_comm, &req[nreq++]);
+        MPI_Isend(overlap->sendbuf, overlap->comm_data[0].send_nindex*datasize,
+                  GMX_MPI_REAL, overlap->send_id[0], 0,
+                  overlap->mpi_comm, &req[nreq++]);
+    }
+#else
+    GMX_UNUSED_VALUE(pme);
+    GMX_UNUSED_VALUE(grid_index);
+    GMX_UNUSED_VALUE(req);
+#endif
+
+    return nreq;
+}
+
+/*! \brief Sums the overlapping parts of the fftgrid over the PME ranks
+ *
+ * When \p nreq > 0, the first communication step has been started
+ * with sum_fftgrid_dd_start and is completed here.
+ */
+static void sum_fftgrid_dd(const gmx_pme_t *pme, real *fftgrid, int grid_index,
+                           int nreq, MPI_Request *req)
 {
     ivec local_fft_ndata, local_fft_offset, local_fft_size;
     int  send_index0, send_nindex;
     int  recv_nindex;
 #if GMX_MPI
     MPI_Status stat;
+#else
+    GMX_UNUSED_VALUE(nreq);
+    GMX_UNUSED_VALUE(req);
 #endif
     int  recv_size_y;
     int  ipulse, size_yx;
@@ -765,13 +852,20 @@ static void sum_fftgrid_dd(const gmx_pme_t *pme, real *fftgrid, int grid_index)
             }
 
 #if GMX_MPI
-            int send_id = overlap->send_id[ipulse];
-            int recv_id = overlap->recv_id[ipulse];
-            MPI_Sendrecv(sendptr, send_size_y*datasize, GMX_MPI_REAL,
-                         send_id, ipulse,
-                         recvptr, recv_size_y*datasize, GMX_MPI_REAL,
-                         recv_id, ipulse,
-                         overlap->mpi_comm, &stat);
+            if (ipulse == 0 && nreq > 0)
+            {
+                MPI_Waitall(nreq, req, MPI_STATUSES_IGNORE);
+            }
+            else
+            {
+                int send_id = overlap->send_id[ipulse];
+                int recv_id = overlap->recv_id[ipulse];
+                MPI_Sendrecv(sendptr, send_size_y*datasize, GMX_MPI_REAL,
+                             send_id, ipulse,
+                             recvptr, recv_size_y*datasize, GMX_MPI_REAL,
+                             recv_id, ipulse,
+                             overlap->mpi_comm, &stat);
+            }
 #endif
 
             for (x = 0; x < local_fft_ndata[XX]; x++)
@@ -831,15 +925,22 @@ static void sum_fftgrid_dd(const gmx_pme_t *pme, real *fftgrid, int grid_index)
         }
 
 #if GMX_MPI
-        int datasize = local_fft_ndata[YY]*local_fft_ndata[ZZ];
-        int send_id  = overlap->send_id[ipulse];
-        int recv_id  = overlap->recv_id[ipulse];
-        sendptr      = overlap->sendbuf;
-        MPI_Sendrecv(sendptr, send_nindex*datasize, GMX_MPI_REAL,
-                     send_id, ipulse,
-                     recvptr, recv_nindex*datasize, GMX_MPI_REAL,
-                     recv_id, ipulse,
-                     overlap->mpi_comm, &stat);
+        if (pme->nnodes_minor == 1 && nreq > 0)
+        {
+            MPI_Waitall(nreq, req, MPI_STATUSES_IGNORE);
+        }
+        else
+        {
+            int datasize = local_fft_ndata[YY]*local_fft_ndata[ZZ];
+            int send_id  = overlap->send_id[ipulse];
+            int recv_id  = overlap->recv_id[ipulse];
+            sendptr      = overlap->sendbuf;
+            MPI_Sendrecv(sendptr, send_nindex*datasize, GMX_MPI_REAL,
+                         send_id, ipulse,
+                         recvptr, recv_nindex*datasize, GMX_MPI_REAL,
+                         recv_id, ipulse,
+                         overlap->mpi_comm, &stat);
+        }
 #endif
 
         for (x = 0; x < recv_nindex; x++)
@@ -972,6 +1073,32 @@ void spread_on_grid(const gmx_pme_t *pme,
 #ifdef PME_TIME_THREADS
         c3 = omp_cyc_start();
 #endif
+        MPI_Request req[2];
+        int         nreq = 0;
+
+        if (pme->nnodes > 1)
+        {
+            /* First sum only the contributions to the communication buffers,
+             * so we can start communicating them while reducing the local part.
+             */
+#pragma omp parallel for num_threads(grids->nthread) schedule(static)
+            for (thread = 0; thread < grids->nthread; thread++)
+            {
+                try
+                {
+                    reduce_threadgrid_overlap(pme, grids, thread,
+                                              fftgrid,
+                                              pme->overlap[0].sendbuf,
+                                              pme->overlap[1].sendbuf,
+                                              grid_index,
+                                              FALSE, TRUE);
+                }
+                GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+            }
+
+            nreq = sum_fftgrid_dd_start(pme, grid_index, req);
+        }
+
 #pragma omp parallel for num_threads(grids->nthread) schedule(static)
         for (thread = 0; thread < grids->nthread; thread++)
         {
@@ -981,7 +1108,8 @@ void spread_on_grid(const gmx_pme_t *pme,
                                           fftgrid,
                                           pme->overlap[0].sendbuf,
                                           pme->overlap[1].sendbuf,
-                                          grid_index);
+                                          grid_index,
+                                          TRUE, pme->nnodes == 1);
             }
             GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
         }
@@ -996,7 +1124,7 @@ void spread_on_grid(const gmx_pme_t *pme,
              * For this communication call we need to check pme->bUseThreads
              * to have all ranks communicate here, regardless of pme->nthread.
              */
-            sum_fftgrid_dd(pme, fftgrid, grid_index);
+            sum_fftgrid_dd(pme, fftgrid, grid_index, nreq, req);
         }
     }
 
@@ -43,9 +43,11 @@
 #include "gmxpre.h"
 
 #include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 
+#include "gromacs/math/invertmatrix.h"
 #include "gromacs/mdtypes/inputrec.h"
 #include "gromacs/utility/stringutil.h"
 
@@ -450,6 +452,120 @@ INSTANTIATE_TEST_CASE_P(SaneInput, PmeGatherTest, ::testing::Combine(::testing::
                                                                          ::testing::Values(PmeGatherInputHandling::Overwrite, PmeGatherInputHandling::ReduceWith),
                                                                          ::testing::ValuesIn(atomCounts)));
 
+/*! \brief Test that checks the force gathering against a plain scalar loop
+ * over all grid points of the splines.
+ *
+ * The grid is filled completely, such that all the vectorized gathering
+ * kernels (used for PME orders 4 and 5) read non-zero values along all
+ * dimensions of the spline support.
+ */
+TEST(PmeGatherReferenceTest, MatchesScalarGather)
+{
+    const size_t atomCount = 13;
+    const IVec   gridSize  = c_sampleGridSizes[0];
+
+    matrix       box, recipBox;
+    for (int i = 0; i < DIM; i++)
+    {
+        for (int j = 0; j < DIM; j++)
+        {
+            box[i][j] = c_sampleBoxes[1][i * DIM + j];
+        }
+    }
+    invertBoxMatrix(box, recipBox);
+
+    /* A dense grid with varying values */
+    SparseRealGridValuesInput gridValues;
+    std::vector<real>         denseGrid(gridSize[XX] * gridSize[YY] * gridSize[ZZ]);
+    for (int ix = 0; ix < gridSize[XX]; ix++)
+    {
+        for (int iy = 0; iy < gridSize[YY]; iy++)
+        {
+            for (int iz = 0; iz < gridSize[ZZ]; iz++)
+            {
+                const real value = 0.1*((7*ix + 13*iy + 17*iz) % 23) - 1.1;
+                denseGrid[(ix * gridSize[YY] + iy) * gridSize[ZZ] + iz] = value;
+                gridValues[IVec {ix, iy, iz}] = value;
+            }
+        }
+    }
+
+    auto gridLineIndices = GridLineIndicesVector::fromVector(c_sampleGridLineIndicesFull.begin(),
+                                                             c_sampleGridLineIndicesFull.begin() + atomCount);
+    auto charges         = ChargesVector::fromVector(c_sampleChargesFull.begin(),
+                                                     c_sampleChargesFull.begin() + atomCount);
+    CoordinatesVector coordinates(atomCount, RVec {1e6, 1e7, -1e8});
+
+    for (int pmeOrder : pmeOrders)
+    {
+        SCOPED_TRACE(formatString("Testing force gathering against the scalar reference with order %d", pmeOrder));
+
+        t_inputrec inputRec;
+        inputRec.nkx         = gridSize[XX];
+        inputRec.nky         = gridSize[YY];
+        inputRec.nkz         = gridSize[ZZ];
+        inputRec.pme_order   = pmeOrder;
+        inputRec.coulombtype = eelPME;
+
+        PmeSafePointer     pmeSafe = pmeInitWithAtoms(&inputRec, coordinates, charges, c_sampleBoxes[1]);
+        pmeSetRealGrid(pmeSafe.get(), CodePath::CPU, gridValues);
+        pmeSetGridLineIndices(pmeSafe.get(), CodePath::CPU, gridLineIndices);
+
+        const size_t       splineSize = pmeOrder * atomCount;
+        SplineParamsVector theta, dtheta;
+        for (int dimIndex = 0; dimIndex < DIM; dimIndex++)
+        {
+            theta[dimIndex]  = SplineParamsDimVector::fromVector(c_sampleSplineValuesFull.begin() + dimIndex * splineSize,
+                                                                 c_sampleSplineValuesFull.begin() + (dimIndex + 1) * splineSize);
+            dtheta[dimIndex] = SplineParamsDimVector::fromVector(c_sampleSplineDerivativesFull.begin() + dimIndex * splineSize,
+                                                                 c_sampleSplineDerivativesFull.begin() + (dimIndex + 1) * splineSize);
+            pmeSetSplineData(pmeSafe.get(), CodePath::CPU, theta[dimIndex], PmeSplineDataType::Values, dimIndex);
+            pmeSetSplineData(pmeSafe.get(), CodePath::CPU, dtheta[dimIndex], PmeSplineDataType::Derivatives, dimIndex);
+        }
+
+        std::vector<RVec> outputForces(atomCount, RVec {0, 0, 0});
+        auto              forces = ForcesVector::fromVector(outputForces.begin(), outputForces.end());
+        pmePerformGather(pmeSafe.get(), CodePath::CPU, PmeGatherInputHandling::Overwrite, forces);
+
+        FloatingPointTolerance tolerance(relativeToleranceAsUlp(10.0, 4 * pmeOrder * pmeOrder));
+        for (size_t atom = 0; atom < atomCount; atom++)
+        {
+            const IVec &idx = gridLineIndices[atom];
+            real        fx  = 0, fy = 0, fz = 0;
+            for (int ithx = 0; ithx < pmeOrder; ithx++)
+            {
+                const int  ix = (idx[XX] + ithx) % gridSize[XX];
+                const real tx = theta[XX][atom * pmeOrder + ithx];
+                const real dx = dtheta[XX][atom * pmeOrder + ithx];
+                for (int ithy = 0; ithy < pmeOrder; ithy++)
+                {
+                    const int  iy = (idx[YY] + ithy) % gridSize[YY];
+                    const real ty = theta[YY][atom * pmeOrder + ithy];
+                    const real dy = dtheta[YY][atom * pmeOrder + ithy];
+                    for (int ithz = 0; ithz < pmeOrder; ithz++)
+                    {
+                        const int  iz   = (idx[ZZ] + ithz) % gridSize[ZZ];
+                        const real tz   = theta[ZZ][atom * pmeOrder + ithz];
+                        const real dz   = dtheta[ZZ][atom * pmeOrder + ithz];
+                        const real gval = denseGrid[(ix * gridSize[YY] + iy) * gridSize[ZZ] + iz];
+                        fx += dx * ty * tz * gval;
+                        fy += tx * dy * tz * gval;
+                        fz += tx * ty * dz * gval;
+                    }
+                }
+            }
+            fx *= gridSize[XX];
+            fy *= gridSize[YY];
+            fz *= gridSize[ZZ];
+            const real q = charges[atom];
+            SCOPED_TRACE(formatString("Atom %zu", atom));
+            EXPECT_REAL_EQ_TOL(-q * fx * recipBox[XX][XX], forces[atom][XX], tolerance);
+            EXPECT_REAL_EQ_TOL(-q * (fx * recipBox[YY][XX] + fy * recipBox[YY][YY]), forces[atom][YY], tolerance);
+            EXPECT_REAL_EQ_TOL(-q * (fx * recipBox[ZZ][XX] + fy * recipBox[ZZ][YY] + fz * recipBox[ZZ][ZZ]), forces[atom][ZZ], tolerance);
+        }
+    }
+}
+
 }
 }
 }
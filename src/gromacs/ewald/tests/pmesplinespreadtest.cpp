@@ -43,6 +43,7 @@
 #include "gmxpre.h"
 
 #include <string>
+#include <vector>
 
 #include <gmock/gmock.h>
 
@@ -302,6 +303,84 @@ auto inputPmeOrders = ::testing::Range(3, 5 + 1);
 //! moved out from instantiantions for readability
 auto inputGridSizes = ::testing::ValuesIn(sampleGridSizes);
 
+/*! \brief Test that checks the spread grid against a plain scalar loop
+ * over all grid points of the computed splines.
+ *
+ * This compares the vectorized spreading kernels (used for PME orders
+ * 4 and 5) with the straightforward implementation of the spreading.
+ */
+TEST(PmeSpreadReferenceTest, MatchesScalarSpread)
+{
+    const IVec gridSize  = sampleGridSizes[1];
+    const auto atomCount = sampleCoordinates13.size();
+
+    for (int pmeOrder = 3; pmeOrder <= 5; pmeOrder++)
+    {
+        SCOPED_TRACE(formatString("Testing charge spreading against the scalar reference with order %d", pmeOrder));
+
+        t_inputrec inputRec;
+        inputRec.nkx         = gridSize[XX];
+        inputRec.nky         = gridSize[YY];
+        inputRec.nkz         = gridSize[ZZ];
+        inputRec.pme_order   = pmeOrder;
+        inputRec.coulombtype = eelPME;
+
+        PmeSafePointer pmeSafe = pmeInitWithAtoms(&inputRec, sampleCoordinates13, sampleCharges13, sampleBoxes[1]);
+        pmePerformSplineAndSpread(pmeSafe.get(), CodePath::CPU, true, true);
+
+        /* Spread the charges with the computed splines onto a periodic grid */
+        SplineParamsVector theta;
+        for (int dimIndex = 0; dimIndex < DIM; dimIndex++)
+        {
+            theta[dimIndex] = pmeGetSplineData(pmeSafe.get(), CodePath::CPU, PmeSplineDataType::Values, dimIndex);
+        }
+        auto              gridLineIndices = pmeGetGridlineIndices(pmeSafe.get(), CodePath::CPU);
+        std::vector<real> denseGrid(gridSize[XX] * gridSize[YY] * gridSize[ZZ], 0);
+        for (size_t atom = 0; atom < atomCount; atom++)
+        {
+            const IVec &idx = gridLineIndices[atom];
+            for (int ithx = 0; ithx < pmeOrder; ithx++)
+            {
+                const int ix = (idx[XX] + ithx) % gridSize[XX];
+                for (int ithy = 0; ithy < pmeOrder; ithy++)
+                {
+                    const int iy = (idx[YY] + ithy) % gridSize[YY];
+                    for (int ithz = 0; ithz < pmeOrder; ithz++)
+                    {
+                        const int iz = (idx[ZZ] + ithz) % gridSize[ZZ];
+                        denseGrid[(ix * gridSize[YY] + iy) * gridSize[ZZ] + iz] +=
+                            sampleCharges13[atom] * theta[XX][atom * pmeOrder + ithx] *
+                            theta[YY][atom * pmeOrder + ithy] * theta[ZZ][atom * pmeOrder + ithz];
+                    }
+                }
+            }
+        }
+
+        SparseRealGridValuesOutput nonZeroGridValues = pmeGetRealGrid(pmeSafe.get(), CodePath::CPU);
+        FloatingPointTolerance     tolerance(relativeToleranceAsUlp(1.0, 4 * pmeOrder * pmeOrder));
+        size_t                     nonZeroCount = 0;
+        for (int ix = 0; ix < gridSize[XX]; ix++)
+        {
+            for (int iy = 0; iy < gridSize[YY]; iy++)
+            {
+                for (int iz = 0; iz < gridSize[ZZ]; iz++)
+                {
+                    const real expected = denseGrid[(ix * gridSize[YY] + iy) * gridSize[ZZ] + iz];
+                    if (expected != 0)
+                    {
+                        const std::string key   = formatString("Cell %d %d %d", ix, iy, iz);
+                        const auto        point = nonZeroGridValues.find(key);
+                        ASSERT_TRUE(point != nonZeroGridValues.end()) << key;
+                        EXPECT_REAL_EQ_TOL(expected, point->second, tolerance) << key;
+                        nonZeroCount++;
+                    }
+                }
+            }
+        }
+        EXPECT_EQ(nonZeroCount, nonZeroGridValues.size());
+    }
+}
+
 /*! \brief Instantiation of the PME spline computation test with valid input and 1 atom */
 INSTANTIATE_TEST_CASE_P(SaneInput1, PmeSplineAndSpreadTest, ::testing::Combine(inputBoxes, inputPmeOrders, inputGridSizes,
                                                                                    ::testing::Values(sampleCoordinates1),
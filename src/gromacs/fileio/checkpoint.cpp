@@ -1553,41 +1553,16 @@ static int do_cpt_files(XDR *xd, gmx_bool bRead,
 }
 
 
-void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
-                      FILE *fplog, t_commrec *cr,
-                      ivec domdecCells, int nppnodes,
-                      int eIntegrator, int simulation_part,
-                      gmx_bool bExpanded, int elamstats,
-                      gmx_int64_t step, double t,
-                      t_state *state, ObservablesHistory *observablesHistory)
+/* Returns the name of the file the checkpoint for step is written to
+ * before it is moved to fn
+ */
+static char *checkpoint_temp_filename(const char *fn, gmx_int64_t step)
 {
-    t_fileio            *fp;
-    int                  file_version;
-    char                *version;
-    char                *btime;
-    char                *buser;
-    char                *bhost;
-    int                  double_prec;
-    char                *fprog;
-    char                *fntemp; /* the temporary checkpoint file name */
-    char                 timebuf[STRLEN];
-    int                  npmenodes;
-    char                 buf[1024], suffix[5+STEPSTRSIZE], sbuf[STEPSTRSIZE];
-    gmx_file_position_t *outputfiles;
-    int                  noutputfiles;
-    char                *ftime;
-    t_fileio            *ret;
-
-    if (DOMAINDECOMP(cr))
-    {
-        npmenodes = cr->npmenodes;
-    }
-    else
-    {
-        npmenodes = 0;
-    }
+    char *fntemp;
 
 #if !GMX_NO_RENAME
+    char  suffix[5+STEPSTRSIZE], sbuf[STEPSTRSIZE];
+
     /* make the new temporary filename */
     snew(fntemp, std::strlen(fn)+5+STEPSTRSIZE);
     std::strcpy(fntemp, fn);
@@ -1596,24 +1571,46 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
     std::strcat(fntemp, suffix);
     std::strcat(fntemp, fn+std::strlen(fn) - std::strlen(ftp2ext(fn2ftp(fn))) - 1);
 #else
+    GMX_UNUSED_VALUE(step);
     /* if we can't rename, we just overwrite the cpt file.
      * dangerous if interrupted.
      */
-    snew(fntemp, std::strlen(fn));
+    snew(fntemp, std::strlen(fn) + 1);
     std::strcpy(fntemp, fn);
 #endif
-    gmx_format_current_time(timebuf, STRLEN);
 
-    if (fplog)
-    {
-        fprintf(fplog, "Writing checkpoint, step %s at %s\n\n",
-                gmx_step_str(step, buf), timebuf);
-    }
+    return fntemp;
+}
 
-    /* Get offsets for open files */
-    gmx_fio_get_output_file_positions(&outputfiles, &noutputfiles);
+/* Writes the checkpoint header and all state and history data to xd,
+ * returns the checkpoint file version
+ */
+static int do_cpt_write_state(XDR *xd, t_commrec *cr,
+                              ivec domdecCells, int nppnodes,
+                              int eIntegrator, int simulation_part,
+                              gmx_bool bExpanded, int elamstats,
+                              gmx_int64_t step, double t,
+                              t_state *state, ObservablesHistory *observablesHistory,
+                              char *timebuf)
+{
+    int                  file_version;
+    char                *version;
+    char                *btime;
+    char                *buser;
+    char                *bhost;
+    int                  double_prec;
+    char                *fprog;
+    int                  npmenodes;
+    char                *ftime;
 
-    fp = gmx_fio_open(fntemp, "w");
+    if (DOMAINDECOMP(cr))
+    {
+        npmenodes = cr->npmenodes;
+    }
+    else
+    {
+        npmenodes = 0;
+    }
 
     int flags_eks;
     if (state->ekinstate.bUpToDate)
@@ -1694,7 +1691,7 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
     swaphistory_t  *swaphist    = observablesHistory->swapHistory.get();
     int             eSwapCoords = (swaphist ? swaphist->eSwapCoords : eswapNO);
 
-    do_cpt_header(gmx_fio_getxdr(fp), FALSE, &file_version,
+    do_cpt_header(xd, FALSE, &file_version,
                   &version, &btime, &buser, &bhost, &double_prec, &fprog, &ftime,
                   &eIntegrator, &simulation_part, &step, &t, &nppnodes,
                   DOMAINDECOMP(cr) ? domdecCells : nullptr, &npmenodes,
@@ -1709,19 +1706,28 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
     sfree(bhost);
     sfree(fprog);
 
-    if ((do_cpt_state(gmx_fio_getxdr(fp), state->flags, state, nullptr) < 0)        ||
-        (do_cpt_ekinstate(gmx_fio_getxdr(fp), flags_eks, &state->ekinstate, nullptr) < 0) ||
-        (do_cpt_enerhist(gmx_fio_getxdr(fp), FALSE, flags_enh, enerhist, nullptr) < 0)  ||
-        (do_cpt_df_hist(gmx_fio_getxdr(fp), flags_dfh, nlambda, &state->dfhist, nullptr) < 0)  ||
-        (do_cpt_EDstate(gmx_fio_getxdr(fp), FALSE, nED, edsamhist, nullptr) < 0)      ||
-        (do_cpt_swapstate(gmx_fio_getxdr(fp), FALSE, eSwapCoords, swaphist, nullptr) < 0) ||
-        (do_cpt_files(gmx_fio_getxdr(fp), FALSE, &outputfiles, &noutputfiles, nullptr,
-                      file_version) < 0))
+    if ((do_cpt_state(xd, state->flags, state, nullptr) < 0)        ||
+        (do_cpt_ekinstate(xd, flags_eks, &state->ekinstate, nullptr) < 0) ||
+        (do_cpt_enerhist(xd, FALSE, flags_enh, enerhist, nullptr) < 0)  ||
+        (do_cpt_df_hist(xd, flags_dfh, nlambda, &state->dfhist, nullptr) < 0)  ||
+        (do_cpt_EDstate(xd, FALSE, nED, edsamhist, nullptr) < 0)      ||
+        (do_cpt_swapstate(xd, FALSE, eSwapCoords, swaphist, nullptr) < 0))
     {
         gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
     }
 
-    do_cpt_footer(gmx_fio_getxdr(fp), file_version);
+    return file_version;
+}
+
+/* Syncs all output files, including the checkpoint file fp, to disk,
+ * closes fp and moves fntemp to fn as described for write_checkpoint().
+ * Returns 0 on success. On failure an error message is stored
+ * in errorMessage, which should have length STRLEN, and -1 is returned.
+ */
+static int finish_checkpoint_file(t_fileio *fp, const char *fn, const char *fntemp,
+                                  gmx_bool bNumberAndKeep, char *errorMessage)
+{
+    t_fileio *ret;
 
     /* we really, REALLY, want to make sure to physically write the checkpoint,
        and all the files it depends on, out to disk. Because we've
@@ -1738,7 +1744,9 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
 
         if (getenv(GMX_IGNORE_FSYNC_FAILURE_ENV) == nullptr)
         {
-            gmx_file(buf);
+            std::strcpy(errorMessage, buf);
+            gmx_fio_close(fp);
+            return -1;
         }
         else
         {
@@ -1748,7 +1756,8 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
 
     if (gmx_fio_close(fp) != 0)
     {
-        gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
+        std::strcpy(errorMessage, "Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
+        return -1;
     }
 
     /* we don't move the checkpoint if the user specified they didn't want it,
@@ -1758,6 +1767,8 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
     {
         if (gmx_fexist(fn))
         {
+            char buf[STRLEN];
+
             /* Rename the previous checkpoint file */
             std::strcpy(buf, fn);
             buf[std::strlen(fn) - std::strlen(ftp2ext(fn2ftp(fn))) - 1] = '\0';
@@ -1779,11 +1790,70 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
         }
         if (gmx_file_rename(fntemp, fn) != 0)
         {
-            gmx_file("Cannot rename checkpoint file; maybe you are out of disk space?");
+            std::strcpy(errorMessage, "Cannot rename checkpoint file; maybe you are out of disk space?");
+            return -1;
         }
     }
+#else
+    GMX_UNUSED_VALUE(fn);
+    GMX_UNUSED_VALUE(fntemp);
+    GMX_UNUSED_VALUE(bNumberAndKeep);
 #endif  /* GMX_NO_RENAME */
 
+    return 0;
+}
+
+void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
+                      FILE *fplog, t_commrec *cr,
+                      ivec domdecCells, int nppnodes,
+                      int eIntegrator, int simulation_part,
+                      gmx_bool bExpanded, int elamstats,
+                      gmx_int64_t step, double t,
+                      t_state *state, ObservablesHistory *observablesHistory)
+{
+    t_fileio            *fp;
+    int                  file_version;
+    char                *fntemp; /* the temporary checkpoint file name */
+    char                 timebuf[STRLEN];
+    char                 buf[1024];
+    gmx_file_position_t *outputfiles;
+    int                  noutputfiles;
+    char                 errorMessage[STRLEN];
+
+    fntemp = checkpoint_temp_filename(fn, step);
+
+    gmx_format_current_time(timebuf, STRLEN);
+
+    if (fplog)
+    {
+        fprintf(fplog, "Writing checkpoint, step %s at %s\n\n",
+                gmx_step_str(step, buf), timebuf);
+    }
+
+    /* Get offsets for open files */
+    gmx_fio_get_output_file_positions(&outputfiles, &noutputfiles);
+
+    fp = gmx_fio_open(fntemp, "w");
+
+    file_version = do_cpt_write_state(gmx_fio_getxdr(fp), cr,
+                                      domdecCells, nppnodes,
+                                      eIntegrator, simulation_part,
+                                      bExpanded, elamstats, step, t,
+                                      state, observablesHistory, timebuf);
+
+    if (do_cpt_files(gmx_fio_getxdr(fp), FALSE, &outputfiles, &noutputfiles, nullptr,
+                     file_version) < 0)
+    {
+        gmx_file("Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
+    }
+
+    do_cpt_footer(gmx_fio_getxdr(fp), file_version);
+
+    if (finish_checkpoint_file(fp, fn, fntemp, bNumberAndKeep, errorMessage) != 0)
+    {
+        gmx_file(errorMessage);
+    }
+
     sfree(outputfiles);
     sfree(fntemp);
 
@@ -1798,6 +1868,158 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
 #endif /* end GMX_FAHCORE block */
 }
 
+/* A checkpoint that is serialized in memory, but not yet written to file */
+struct t_checkpoint_snapshot
+{
+    char                *fn;             /* The checkpoint file name */
+    char                *fntemp;         /* The file the checkpoint is written to first */
+    gmx_bool             bNumberAndKeep; /* Keep fntemp instead of moving it to fn */
+    t_fileio            *fp;             /* The open file fntemp */
+    int                  file_version;   /* The checkpoint file format version */
+    char                *data;           /* The serialized header, state and history */
+    size_t               dataSize;       /* The size of data in bytes */
+    gmx_file_position_t *outputfiles;    /* The offsets of the open output files */
+    int                  noutputfiles;   /* The number of open output files */
+};
+
+gmx_bool checkpoint_snapshot_supported()
+{
+    return HAVE_OPEN_MEMSTREAM;
+}
+
+t_checkpoint_snapshot *make_checkpoint_snapshot(const char *fn, gmx_bool bNumberAndKeep,
+                                                FILE *fplog, t_commrec *cr,
+                                                ivec domdecCells, int nppnodes,
+                                                int eIntegrator, int simulation_part,
+                                                gmx_bool bExpanded, int elamstats,
+                                                gmx_int64_t step, double t,
+                                                t_state *state, ObservablesHistory *observablesHistory)
+{
+#if HAVE_OPEN_MEMSTREAM
+    t_checkpoint_snapshot *snapshot;
+    char                   timebuf[STRLEN];
+    char                   buf[1024];
+    FILE                  *fpMem;
+    XDR                    xd;
+
+    snew(snapshot, 1);
+    snapshot->fn             = gmx_strdup(fn);
+    snapshot->fntemp         = checkpoint_temp_filename(fn, step);
+    snapshot->bNumberAndKeep = bNumberAndKeep;
+
+    gmx_format_current_time(timebuf, STRLEN);
+
+    if (fplog)
+    {
+        fprintf(fplog, "Writing checkpoint, step %s at %s\n\n",
+                gmx_step_str(step, buf), timebuf);
+    }
+
+    /* Get offsets for open files, this flushes them, so the checksums
+       can be computed later from the data before these offsets */
+    gmx_fio_get_output_file_offsets(&snapshot->outputfiles, &snapshot->noutputfiles);
+
+    /* Open the file here, so failures are reported by the calling thread */
+    snapshot->fp = gmx_fio_open(snapshot->fntemp, "w");
+
+    fpMem = open_memstream(&snapshot->data, &snapshot->dataSize);
+    if (fpMem == nullptr)
+    {
+        gmx_file("Cannot allocate memory for the checkpoint data");
+    }
+    xdrstdio_create(&xd, fpMem, XDR_ENCODE);
+    snapshot->file_version =
+        do_cpt_write_state(&xd, cr, domdecCells, nppnodes,
+                           eIntegrator, simulation_part,
+                           bExpanded, elamstats, step, t,
+                           state, observablesHistory, timebuf);
+    xdr_destroy(&xd);
+    /* Closing the stream sets the final data pointer and size */
+    std::fclose(fpMem);
+
+    return snapshot;
+#else
+    GMX_UNUSED_VALUE(fn);
+    GMX_UNUSED_VALUE(bNumberAndKeep);
+    GMX_UNUSED_VALUE(fplog);
+    GMX_UNUSED_VALUE(cr);
+    GMX_UNUSED_VALUE(domdecCells);
+    GMX_UNUSED_VALUE(nppnodes);
+    GMX_UNUSED_VALUE(eIntegrator);
+    GMX_UNUSED_VALUE(simulation_part);
+    GMX_UNUSED_VALUE(bExpanded);
+    GMX_UNUSED_VALUE(elamstats);
+    GMX_UNUSED_VALUE(step);
+    GMX_UNUSED_VALUE(t);
+    GMX_UNUSED_VALUE(state);
+    GMX_UNUSED_VALUE(observablesHistory);
+    gmx_incons("Checkpoint snapshots are not supported on this platform");
+
+    return nullptr;
+#endif
+}
+
+int write_checkpoint_snapshot(t_checkpoint_snapshot *snapshot, char *errorMessage)
+{
+    int rc = 0;
+
+#if HAVE_OPEN_MEMSTREAM
+    char  *tail     = nullptr;
+    size_t tailSize = 0;
+    FILE  *fpMem;
+    XDR    xd;
+
+    gmx_fio_compute_output_file_md5s(snapshot->outputfiles, snapshot->noutputfiles);
+
+    /* The file list and footer are also serialized in memory, since write
+       errors with do_cpt_files() are fatal, which we can not handle here */
+    fpMem = open_memstream(&tail, &tailSize);
+    if (fpMem == nullptr)
+    {
+        std::strcpy(errorMessage, "Cannot allocate memory for the checkpoint data");
+        rc = -1;
+    }
+    else
+    {
+        xdrstdio_create(&xd, fpMem, XDR_ENCODE);
+        do_cpt_files(&xd, FALSE, &snapshot->outputfiles, &snapshot->noutputfiles, nullptr,
+                     snapshot->file_version);
+        do_cpt_footer(&xd, snapshot->file_version);
+        xdr_destroy(&xd);
+        std::fclose(fpMem);
+
+        FILE *fp = gmx_fio_getfp(snapshot->fp);
+        if (std::fwrite(snapshot->data, 1, snapshot->dataSize, fp) != snapshot->dataSize ||
+            std::fwrite(tail, 1, tailSize, fp) != tailSize)
+        {
+            std::strcpy(errorMessage, "Cannot read/write checkpoint; corrupt file, or maybe you are out of disk space?");
+            gmx_fio_close(snapshot->fp);
+            rc = -1;
+        }
+        else
+        {
+            rc = finish_checkpoint_file(snapshot->fp, snapshot->fn, snapshot->fntemp,
+                                        snapshot->bNumberAndKeep, errorMessage);
+        }
+        /* Allocated by open_memstream() */
+        std::free(tail);
+    }
+
+    std::free(snapshot->data);
+#else
+    GMX_UNUSED_VALUE(errorMessage);
+    gmx_incons("Checkpoint snapshots are not supported on this platform");
+#endif
+
+    sfree(snapshot->outputfiles);
+    sfree(snapshot->fntemp);
+    sfree(snapshot->fn);
+    sfree(snapshot);
+
+    return rc;
+}
+
+
 static void print_flag_mismatch(FILE *fplog, int sflags, int fflags)
 {
     int i;
@@ -71,6 +71,35 @@ void write_checkpoint(const char *fn, gmx_bool bNumberAndKeep,
                       gmx_int64_t step, double t,
                       t_state *state, ObservablesHistory *observablesHistory);
 
+/* A checkpoint serialized in memory, to be written by write_checkpoint_snapshot() */
+struct t_checkpoint_snapshot;
+
+/* Returns whether make_checkpoint_snapshot() is supported on this platform */
+gmx_bool checkpoint_snapshot_supported();
+
+/* Collects the same data as write_checkpoint() in memory and opens
+ * the checkpoint file, but does not write it. The output files are
+ * flushed and their offsets are stored, their checksums are computed
+ * later by write_checkpoint_snapshot().
+ */
+t_checkpoint_snapshot *make_checkpoint_snapshot(const char *fn, gmx_bool bNumberAndKeep,
+                                                FILE *fplog, t_commrec *cr,
+                                                ivec domdecCells, int nppnodes,
+                                                int eIntegrator, int simulation_part,
+                                                gmx_bool bExpanded, int elamstats,
+                                                gmx_int64_t step, double t,
+                                                t_state *state, ObservablesHistory *observablesHistory);
+
+/* Computes the output file checksums, writes snapshot to file, syncs
+ * all output files and renames the checkpoint files as write_checkpoint()
+ * does, then frees snapshot. Does not access the simulation state and
+ * does not generate fatal errors, so this can be called from a separate
+ * thread while the simulation continues.
+ * Returns 0 on success, otherwise -1 with an error message stored in
+ * errorMessage, which should have length STRLEN.
+ */
+int write_checkpoint_snapshot(t_checkpoint_snapshot *snapshot, char *errorMessage);
+
 /* Loads a checkpoint from fn for run continuation.
  * Generates a fatal error on system size mismatch.
  * The master node reads the file
@@ -443,9 +443,12 @@ int gmx_fio_fclose(FILE *fp)
     return rc;
 }
 
-/* internal variant of get_file_md5 that operates on a locked file */
-static int gmx_fio_int_get_file_md5(t_fileio *fio, gmx_off_t offset,
-                                    unsigned char digest[])
+/* Computes the md5 sum of the (at most) 1MB of fp before offset.
+ * Returns the number of bytes used, or -1 when this failed.
+ * The file position of fp is left undefined.
+ */
+static int get_file_region_md5(FILE *fp, const char *fn, gmx_off_t offset,
+                               unsigned char digest[])
 {
     /*1MB: large size important to catch almost identical files */
 #define CPT_CHK_LEN  1048576
@@ -453,7 +456,7 @@ static int gmx_fio_int_get_file_md5(t_fileio *fio, gmx_off_t offset,
     unsigned char *buf;
     gmx_off_t      read_len;
     gmx_off_t      seek_offset;
-    int            ret = -1;
+    int            ret;
 
     seek_offset = offset - CPT_CHK_LEN;
     if (seek_offset < 0)
@@ -462,33 +465,25 @@ static int gmx_fio_int_get_file_md5(t_fileio *fio, gmx_off_t offset,
     }
     read_len = offset - seek_offset;
 
-
-    if (fio->fp && fio->bReadWrite)
-    {
-        ret = gmx_fseek(fio->fp, seek_offset, SEEK_SET);
-        if (ret)
-        {
-            gmx_fseek(fio->fp, 0, SEEK_END);
-        }
-    }
-    if (ret) /*either no fp, not readwrite, or fseek not successful */
+    ret = gmx_fseek(fp, seek_offset, SEEK_SET);
+    if (ret) /* fseek not successful */
     {
         return -1;
     }
 
     snew(buf, CPT_CHK_LEN);
     /* the read puts the file position back to offset */
-    if ((gmx_off_t)fread(buf, 1, read_len, fio->fp) != read_len)
+    if ((gmx_off_t)fread(buf, 1, read_len, fp) != read_len)
     {
         /* not fatal: md5sum check to prevent overwriting files
          * works (less safe) without
          * */
-        if (ferror(fio->fp))
+        if (ferror(fp))
         {
-            fprintf(stderr, "\nTrying to get md5sum: %s: %s\n", fio->fn,
+            fprintf(stderr, "\nTrying to get md5sum: %s: %s\n", fn,
                     strerror(errno));
         }
-        else if (feof(fio->fp))
+        else if (feof(fp))
         {
             /*
              * For long runs that checkpoint frequently but write e.g. logs
@@ -497,7 +492,7 @@ static int gmx_fio_int_get_file_md5(t_fileio *fio, gmx_off_t offset,
              */
             if (0)
             {
-                fprintf(stderr, "\nTrying to get md5sum: EOF: %s\n", fio->fn);
+                fprintf(stderr, "\nTrying to get md5sum: EOF: %s\n", fn);
             }
         }
         else
@@ -505,19 +500,15 @@ static int gmx_fio_int_get_file_md5(t_fileio *fio, gmx_off_t offset,
             fprintf(
                     stderr,
                     "\nTrying to get md5sum: Unknown reason for short read: %s\n",
-                    fio->fn);
+                    fn);
         }
 
-        gmx_fseek(fio->fp, 0, SEEK_END);
-
         ret = -1;
     }
-    gmx_fseek(fio->fp, 0, SEEK_END); /*is already at end, but under windows
-                                        it gives problems otherwise*/
 
     if (debug)
     {
-        fprintf(debug, "chksum %s readlen %ld\n", fio->fn, (long int)read_len);
+        fprintf(debug, "chksum %s readlen %ld\n", fn, (long int)read_len);
     }
 
     if (!ret)
@@ -531,6 +522,22 @@ static int gmx_fio_int_get_file_md5(t_fileio *fio, gmx_off_t offset,
     return ret;
 }
 
+/* internal variant of get_file_md5 that operates on a locked file */
+static int gmx_fio_int_get_file_md5(t_fileio *fio, gmx_off_t offset,
+                                    unsigned char digest[])
+{
+    int ret = -1;
+
+    if (fio->fp && fio->bReadWrite)
+    {
+        ret = get_file_region_md5(fio->fp, fio->fn, offset, digest);
+        gmx_fseek(fio->fp, 0, SEEK_END); /*is already at end, but under windows
+                                            it gives problems otherwise*/
+    }
+
+    return ret;
+}
+
 
 /*
  * fio: file to compute md5 for
@@ -623,6 +630,79 @@ int gmx_fio_get_output_file_positions(gmx_file_position_t **p_outputfiles,
     return 0;
 }
 
+int gmx_fio_get_output_file_offsets(gmx_file_position_t **p_outputfiles,
+                                    int                  *p_nfiles)
+{
+    int                   nfiles, nalloc;
+    gmx_file_position_t * outputfiles;
+    t_fileio             *cur;
+
+    nfiles = 0;
+
+    /* pre-allocate 100 files */
+    nalloc = 100;
+    snew(outputfiles, nalloc);
+
+    Lock openFilesLock(open_file_mutex);
+    cur = gmx_fio_get_first();
+    while (cur)
+    {
+        /* Skip the checkpoint files themselves, since they could be open when
+           we call this routine... */
+        if (!cur->bRead && cur->iFTP != efCPT)
+        {
+            /* This is an output file currently open for writing, add it */
+            if (nfiles == nalloc)
+            {
+                nalloc += 100;
+                srenew(outputfiles, nalloc);
+            }
+
+            std::strncpy(outputfiles[nfiles].filename, cur->fn, STRLEN - 1);
+
+            /* Get the file position, this also flushes the file */
+            gmx_fio_int_get_file_position(cur, &outputfiles[nfiles].offset);
+#ifndef GMX_FAHCORE
+            /* Mark the files gmx_fio_get_output_file_positions() would
+               compute a checksum for */
+            outputfiles[nfiles].chksum_size = ((cur->fp && cur->bReadWrite) ? 0 : -1);
+#else
+            outputfiles[nfiles].chksum_size = -1;
+#endif
+            nfiles++;
+        }
+
+        cur = gmx_fio_get_next(cur);
+    }
+    *p_nfiles      = nfiles;
+    *p_outputfiles = outputfiles;
+
+    return 0;
+}
+
+void gmx_fio_compute_output_file_md5s(gmx_file_position_t *outputfiles,
+                                      int                  nfiles)
+{
+    for (int i = 0; i < nfiles; i++)
+    {
+        if (outputfiles[i].chksum_size < 0)
+        {
+            continue;
+        }
+        /* Use a separate file pointer, the file might be written to */
+        FILE *fp = std::fopen(outputfiles[i].filename, "rb");
+        if (fp == nullptr)
+        {
+            outputfiles[i].chksum_size = -1;
+            continue;
+        }
+        outputfiles[i].chksum_size =
+            get_file_region_md5(fp, outputfiles[i].filename,
+                                outputfiles[i].offset, outputfiles[i].chksum);
+        std::fclose(fp);
+    }
+}
+
 
 char *gmx_fio_getname(t_fileio *fio)
 {
@@ -160,6 +160,21 @@ int gmx_fio_get_output_file_positions(gmx_file_position_t ** outputfiles,
  * point to a list of open files.
  */
 
+int gmx_fio_get_output_file_offsets(gmx_file_position_t **outputfiles,
+                                    int                  *nfiles);
+/* As gmx_fio_get_output_file_positions(), but without computing the
+ * checksums. chksum_size is set to 0 for the files that should get
+ * a checksum from gmx_fio_compute_output_file_md5s() and to -1 otherwise.
+ */
+
+void gmx_fio_compute_output_file_md5s(gmx_file_position_t *outputfiles,
+                                      int                  nfiles);
+/* Computes the checksums of the files listed by
+ * gmx_fio_get_output_file_offsets(). The files are opened again by name
+ * and only the data before the stored offsets is read, so this can be
+ * called from a separate thread while the files are being appended to.
+ */
+
 t_fileio *gmx_fio_all_output_fsync(void);
 /* fsync all open output files. This is used for checkpointing, where
    we need to ensure that all output is actually written out to
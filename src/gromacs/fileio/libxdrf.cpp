@@ -38,6 +38,7 @@
 
 #include <climits>
 #include <cmath>
+#include <cstdint>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
@@ -164,7 +165,7 @@ static int sizeofint(const int size)
  |
  | given the number of small unsigned integers and the maximum value
  | return the number of bits needed to read or write them with the
- | routines receiveints and sendints. You need this parameter when
+ | routines bitreader_ints and sendints. You need this parameter when
  | calling these routines. Note that for many calls I can use
  | the variable 'smallidx' which is exactly the number of bits, and
  | So I don't need to call 'sizeofints for those calls.
@@ -278,65 +279,80 @@ static void sendints(int buf[], const int num_of_ints, const int num_of_bits,
 }
 
 
-/*___________________________________________________________________________
+/*____________________________________________________________________________
  |
- | receivebits - decode number from buf using specified number of bits
+ | t_bitreader - decode numbers written to buf by sendbits()
  |
- | extract the number of bits from the array buf and construct an integer
- | from it. Return that value.
+ | This is the inverse of sendbits(), used by xdr3dfcoord when reading.
+ | Instead of keeping the state in buf[] like the writer and shifting in
+ | one byte at a time, it keeps up to 64 bits in a local register and
+ | refills it with four bytes at a time.
  |
  */
 
-static int receivebits(int buf[], int num_of_bits)
-{
-
-    int             cnt, num, lastbits;
-    unsigned int    lastbyte;
-    unsigned char * cbuf;
-    int             mask = (1 << num_of_bits) -1;
+typedef struct {
+    const unsigned char *cbuf;      /* the compressed data */
+    int                  nbytes;    /* the number of bytes in cbuf */
+    int                  cnt;       /* the next byte to load from cbuf */
+    std::uint64_t        cache;     /* the lowest ncache bits are unread */
+    int                  ncache;
+} t_bitreader;
 
-    cbuf     = reinterpret_cast<unsigned char *>(buf) + 3 * sizeof(*buf);
-    cnt      = buf[0];
-    lastbits = static_cast<unsigned int>(buf[1]);
-    lastbyte = static_cast<unsigned int>(buf[2]);
+static void bitreader_init(t_bitreader *reader, const int buf[], int nbytes)
+{
+    reader->cbuf   = reinterpret_cast<const unsigned char *>(buf) + 3 * sizeof(*buf);
+    reader->nbytes = nbytes;
+    reader->cnt    = 0;
+    reader->cache  = 0;
+    reader->ncache = 0;
+}
 
-    num = 0;
-    while (num_of_bits >= 8)
-    {
-        lastbyte     = ( lastbyte << 8 ) | cbuf[cnt++];
-        num         |=  (lastbyte >> lastbits) << (num_of_bits - 8);
-        num_of_bits -= 8;
-    }
-    if (num_of_bits > 0)
+/* Extracts the next num_of_bits (at most 32) bits from the data and
+ * constructs an integer from them.
+ */
+static inline int bitreader_bits(t_bitreader *reader, int num_of_bits)
+{
+    if (reader->ncache < num_of_bits)
     {
-        if (lastbits < num_of_bits)
+        if (reader->cnt + 4 <= reader->nbytes)
         {
-            lastbits += 8;
-            lastbyte  = (lastbyte << 8) | cbuf[cnt++];
+            const unsigned char *p = reader->cbuf + reader->cnt;
+            reader->cache   = (reader->cache << 32)
+                | (static_cast<std::uint64_t>(p[0]) << 24)
+                | (static_cast<std::uint64_t>(p[1]) << 16)
+                | (static_cast<std::uint64_t>(p[2]) << 8)
+                | static_cast<std::uint64_t>(p[3]);
+            reader->cnt    += 4;
+            reader->ncache += 32;
+        }
+        else
+        {
+            /* Near the end of the data, never read past it */
+            while (reader->ncache < num_of_bits)
+            {
+                reader->cache = (reader->cache << 8);
+                if (reader->cnt < reader->nbytes)
+                {
+                    reader->cache |= reader->cbuf[reader->cnt];
+                }
+                reader->cnt++;
+                reader->ncache += 8;
+            }
         }
-        lastbits -= num_of_bits;
-        num      |= (lastbyte >> lastbits) & ((1 << num_of_bits) -1);
     }
-    num   &= mask;
-    buf[0] = cnt;
-    buf[1] = lastbits;
-    buf[2] = lastbyte;
-    return num;
+    reader->ncache -= num_of_bits;
+    return static_cast<int>((reader->cache >> reader->ncache)
+                            & ((static_cast<std::uint64_t>(1) << num_of_bits) - 1));
 }
 
-/*____________________________________________________________________________
- |
- | receiveints - decode 'small' integers from the buf array
- |
- | this routine is the inverse from sendints() and decodes the small integers
- | written to buf by calculating the remainder and doing divisions with
- | the given sizes[]. You need to specify the total number of bits to be
- | used from buf in num_of_bits.
- |
+/* Decodes the small integers written by sendints() by calculating the
+ * remainder and doing divisions with the given sizes[]. When the combined
+ * integer fits in 64 bits, which is the case except for the very largest
+ * ranges, plain 64-bit divisions are used instead of long division of
+ * the bytes.
  */
-
-static void receiveints(int buf[], const int num_of_ints, int num_of_bits,
-                        unsigned int sizes[], int nums[])
+static void bitreader_ints(t_bitreader *reader, const int num_of_ints, int num_of_bits,
+                           const unsigned int sizes[], int nums[])
 {
     int bytes[32];
     int i, j, num_of_bytes, p, num;
@@ -345,12 +361,27 @@ static void receiveints(int buf[], const int num_of_ints, int num_of_bits,
     num_of_bytes = 0;
     while (num_of_bits > 8)
     {
-        bytes[num_of_bytes++] = receivebits(buf, 8);
+        bytes[num_of_bytes++] = bitreader_bits(reader, 8);
         num_of_bits          -= 8;
     }
     if (num_of_bits > 0)
     {
-        bytes[num_of_bytes++] = receivebits(buf, num_of_bits);
+        bytes[num_of_bytes++] = bitreader_bits(reader, num_of_bits);
+    }
+    if (num_of_bytes <= 8)
+    {
+        std::uint64_t value = 0;
+        for (j = num_of_bytes-1; j >= 0; j--)
+        {
+            value = (value << 8) | static_cast<unsigned int>(bytes[j]);
+        }
+        for (i = num_of_ints-1; i > 0; i--)
+        {
+            nums[i] = static_cast<int>(value % sizes[i]);
+            value  /= sizes[i];
+        }
+        nums[0] = static_cast<int>(static_cast<unsigned int>(value));
+        return;
     }
     for (i = num_of_ints-1; i > 0; i--)
     {
@@ -418,6 +449,7 @@ int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision)
 
     int          bufsize, lsize;
     unsigned int bitsize;
+    t_bitreader  reader;
     float        inv_precision;
     int          errval = 1;
     int          rc;
@@ -894,7 +926,7 @@ int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision)
 
 
 
-        buf[0] = buf[1] = buf[2] = 0;
+        bitreader_init(&reader, buf, buf[0]);
 
         lfp           = fp;
         inv_precision = 1.0 / *precision;
@@ -907,13 +939,13 @@ int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision)
 
             if (bitsize == 0)
             {
-                thiscoord[0] = receivebits(buf, bitsizeint[0]);
-                thiscoord[1] = receivebits(buf, bitsizeint[1]);
-                thiscoord[2] = receivebits(buf, bitsizeint[2]);
+                thiscoord[0] = bitreader_bits(&reader, bitsizeint[0]);
+                thiscoord[1] = bitreader_bits(&reader, bitsizeint[1]);
+                thiscoord[2] = bitreader_bits(&reader, bitsizeint[2]);
             }
             else
             {
-                receiveints(buf, 3, bitsize, sizeint, thiscoord);
+                bitreader_ints(&reader, 3, bitsize, sizeint, thiscoord);
             }
 
             i++;
@@ -926,11 +958,11 @@ int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision)
             prevcoord[2] = thiscoord[2];
 
 
-            flag       = receivebits(buf, 1);
+            flag       = bitreader_bits(&reader, 1);
             is_smaller = 0;
             if (flag == 1)
             {
-                run        = receivebits(buf, 5);
+                run        = bitreader_bits(&reader, 5);
                 is_smaller = run % 3;
                 run       -= is_smaller;
                 is_smaller--;
@@ -940,7 +972,7 @@ int xdr3dfcoord(XDR *xdrs, float *fp, int *size, float *precision)
                 thiscoord += 3;
                 for (k = 0; k < run; k += 3)
                 {
-                    receiveints(buf, 3, smallidx, sizesmall, thiscoord);
+                    bitreader_ints(&reader, 3, smallidx, sizesmall, thiscoord);
                     i++;
                     thiscoord[0] += prevcoord[0] - smallnum;
                     thiscoord[1] += prevcoord[1] - smallnum;
@@ -0,0 +1,107 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements gmx::test::TestTrajectoryWriter.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "testtrajectories.h"
+
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/math/vec.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace gmx
+{
+namespace test
+{
+
+TestTrajectoryWriter::TestTrajectoryWriter(TestFileManager *fileManager)
+    : fileManager_(*fileManager)
+{
+    clear_mat(box_);
+    box_[XX][XX] = box_[YY][YY] = box_[ZZ][ZZ] = 2;
+    for (int i = 0; i < c_atomCount; ++i)
+    {
+        x_.emplace_back(0.01*i, 0.02*(i % 7), 0.03*(i % 11));
+    }
+}
+
+void TestTrajectoryWriter::moveAtoms(int frame)
+{
+    x_[frame % c_atomCount][XX] += 0.5*frame;
+    x_[(3*frame) % c_atomCount][YY] -= 0.01*frame;
+}
+
+std::string TestTrajectoryWriter::writeXtc(int frameCount)
+{
+    std::string filename = fileManager_.getTemporaryFilePath(".xtc");
+    /* Clean up the index file as well */
+    fileManager_.getTemporaryFilePath(".xtc.idx");
+    t_fileio   *fio      = open_xtc(filename.c_str(), "w");
+    for (int frame = 0; frame < frameCount; ++frame)
+    {
+        moveAtoms(frame);
+        write_xtc(fio, c_atomCount, 10*frame, 0.5*frame, box_,
+                  as_rvec_array(x_.data()), 1000);
+    }
+    close_xtc(fio);
+    return filename;
+}
+
+std::string TestTrajectoryWriter::writeTrr(int frameCount)
+{
+    std::string filename = fileManager_.getTemporaryFilePath(".trr");
+    fileManager_.getTemporaryFilePath(".trr.idx");
+    t_fileio   *fio      = gmx_trr_open(filename.c_str(), "w");
+    for (int frame = 0; frame < frameCount; ++frame)
+    {
+        moveAtoms(frame);
+        gmx_trr_write_frame(fio, 10*frame, 0.5*frame, 0, box_, c_atomCount,
+                            as_rvec_array(x_.data()),
+                            frame % 2 == 0 ? as_rvec_array(x_.data()) : nullptr,
+                            nullptr);
+    }
+    gmx_trr_close(fio);
+    return filename;
+}
+
+} // namespace test
+} // namespace gmx
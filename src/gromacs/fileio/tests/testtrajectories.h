@@ -0,0 +1,94 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Declares a helper for writing short trajectories in fileio tests.
+ *
+ * \ingroup module_fileio
+ */
+#ifndef GMX_FILEIO_TESTS_TESTTRAJECTORIES_H
+#define GMX_FILEIO_TESTS_TESTTRAJECTORIES_H
+
+#include <string>
+#include <vector>
+
+#include "gromacs/math/vectypes.h"
+
+namespace gmx
+{
+namespace test
+{
+
+class TestFileManager;
+
+/*! \internal \brief
+ * Writes short XTC and TRR trajectories in which all frames differ.
+ *
+ * Frame \c i has step \c 10*i and time \c 0.5*i. The atoms are moved
+ * between frames, so the compressed XTC frames have different sizes.
+ * The trajectory index files are cleaned up as well.
+ */
+class TestTrajectoryWriter
+{
+    public:
+        //! Number of atoms in the test trajectories.
+        static const int c_atomCount = 50;
+
+        //! Creates the files with \p fileManager, which should outlive this object.
+        explicit TestTrajectoryWriter(TestFileManager *fileManager);
+
+        //! Writes an XTC file with \p frameCount frames and returns its name.
+        std::string writeXtc(int frameCount);
+        //! Writes a TRR file with \p frameCount frames, with velocities in every other frame.
+        std::string writeTrr(int frameCount);
+
+        //! Returns the box of the frames.
+        const matrix &box() const { return box_; }
+        //! Returns the coordinates of the last frame written.
+        const rvec *x() const { return as_rvec_array(x_.data()); }
+
+    private:
+        //! Changes the coordinates for \p frame, such that all frames differ.
+        void moveAtoms(int frame);
+
+        TestFileManager    &fileManager_;
+        std::vector<RVec>   x_;
+        matrix              box_;
+};
+
+} // namespace test
+} // namespace gmx
+
+#endif
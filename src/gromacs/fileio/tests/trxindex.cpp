@@ -0,0 +1,181 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for gmx::TrajectoryFrameIndex.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/trxindex.h"
+
+#include <cstdio>
+
+#include <memory>
+#include <string>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testfilemanager.h"
+
+#include "testtrajectories.h"
+
+namespace
+{
+
+using gmx::TrajectoryFrameIndex;
+
+/*! \brief
+ * Test fixture that writes short trajectories whose frames have
+ * different sizes and indexes them.
+ */
+class TrajectoryFrameIndexTest : public ::testing::Test
+{
+    public:
+        TrajectoryFrameIndexTest() : writer_(&fileManager_)
+        {
+        }
+
+        //! Checks that the offsets in \p index point to the frames in \p filename.
+        void checkXtcOffsets(const std::string &filename, const TrajectoryFrameIndex &index)
+        {
+            t_fileio *fio = open_xtc(filename.c_str(), "r");
+            rvec     *x;
+            snew(x, c_atomCount);
+            for (int frame = index.frameCount() - 1; frame >= 0; --frame)
+            {
+                gmx_int64_t step;
+                real        time, prec;
+                matrix      box;
+                gmx_bool    bOK;
+                ASSERT_EQ(0, gmx_fio_seek(fio, index.frame(frame).offset));
+                ASSERT_TRUE(read_next_xtc(fio, c_atomCount, &step, &time, box, x, &prec, &bOK));
+                EXPECT_EQ(10*frame, step);
+                EXPECT_EQ(10*frame, index.frame(frame).step);
+                EXPECT_EQ(time, index.frame(frame).time);
+                EXPECT_EQ(frame, index.findFrame(index.frame(frame).offset));
+            }
+            sfree(x);
+            close_xtc(fio);
+        }
+
+        //! Number of atoms in the test trajectories.
+        static const int                c_atomCount = gmx::test::TestTrajectoryWriter::c_atomCount;
+
+        gmx::test::TestFileManager      fileManager_;
+        gmx::test::TestTrajectoryWriter writer_;
+};
+
+TEST_F(TrajectoryFrameIndexTest, IndexesXtcFrames)
+{
+    std::string                           filename = writer_.writeXtc(5);
+    std::unique_ptr<TrajectoryFrameIndex> index
+        = TrajectoryFrameIndex::readOrCreate(filename);
+    ASSERT_TRUE(index != nullptr);
+    ASSERT_EQ(5, index->frameCount());
+    EXPECT_EQ(-1, index->findFrame(index->frame(1).offset + 4));
+    checkXtcOffsets(filename, *index);
+}
+
+TEST_F(TrajectoryFrameIndexTest, IndexesTrrFrames)
+{
+    std::string                           filename = writer_.writeTrr(4);
+    std::unique_ptr<TrajectoryFrameIndex> index
+        = TrajectoryFrameIndex::readOrCreate(filename);
+    ASSERT_TRUE(index != nullptr);
+    ASSERT_EQ(4, index->frameCount());
+    t_fileio *fio = gmx_trr_open(filename.c_str(), "r");
+    for (int frame = index->frameCount() - 1; frame >= 0; --frame)
+    {
+        gmx_trr_header_t sh;
+        gmx_bool         bOK;
+        ASSERT_EQ(0, gmx_fio_seek(fio, index->frame(frame).offset));
+        ASSERT_TRUE(gmx_trr_read_frame_header(fio, &sh, &bOK));
+        EXPECT_EQ(10*frame, sh.step);
+        EXPECT_EQ(sh.t, index->frame(frame).time);
+    }
+    gmx_trr_close(fio);
+}
+
+TEST_F(TrajectoryFrameIndexTest, IgnoresIncompleteLastFrame)
+{
+    std::string filename = writer_.writeXtc(3);
+    std::unique_ptr<TrajectoryFrameIndex> full
+        = TrajectoryFrameIndex::readOrCreate(filename);
+    ASSERT_TRUE(full != nullptr);
+    std::remove(TrajectoryFrameIndex::indexFilename(filename).c_str());
+    ASSERT_EQ(0, gmx_truncate(filename.c_str(), full->frame(2).offset + 100));
+    std::unique_ptr<TrajectoryFrameIndex> index
+        = TrajectoryFrameIndex::readOrCreate(filename);
+    ASSERT_TRUE(index != nullptr);
+    EXPECT_EQ(2, index->frameCount());
+    EXPECT_EQ(full->frame(2).offset, index->endOffset());
+}
+
+TEST_F(TrajectoryFrameIndexTest, ReusesIndexFileOnlyForSameTrajectory)
+{
+    std::string filename = writer_.writeXtc(3);
+    ASSERT_TRUE(TrajectoryFrameIndex::readOrCreate(filename) != nullptr);
+
+    std::unique_ptr<TrajectoryFrameIndex> index
+        = TrajectoryFrameIndex::readOrCreate(filename);
+    ASSERT_TRUE(index != nullptr);
+    EXPECT_EQ(3, index->frameCount());
+    checkXtcOffsets(filename, *index);
+
+    /* Appending frames changes the size, so the index is rebuilt */
+    t_fileio *fio = open_xtc(filename.c_str(), "a");
+    write_xtc(fio, c_atomCount, 30, 1.5, writer_.box(), writer_.x(), 1000);
+    close_xtc(fio);
+    index = TrajectoryFrameIndex::readOrCreate(filename);
+    ASSERT_TRUE(index != nullptr);
+    EXPECT_EQ(4, index->frameCount());
+    checkXtcOffsets(filename, *index);
+}
+
+TEST_F(TrajectoryFrameIndexTest, DoesNotIndexOtherFormats)
+{
+    EXPECT_TRUE(TrajectoryFrameIndex::readOrCreate("test.gro") == nullptr);
+}
+
+} // namespace
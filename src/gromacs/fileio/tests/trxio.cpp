@@ -0,0 +1,308 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for reading trajectory frames with read_first_frame() and
+ * read_next_frame().
+ *
+ * Frames read with TRX_READ_AHEAD, which decodes the frames in a
+ * background thread, or with the frame index enabled by GMX_TRX_INDEX,
+ * are compared with frames read directly.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/trxio.h"
+
+#include "config.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/oenv.h"
+#include "gromacs/fileio/timecontrol.h"
+#include "gromacs/fileio/trxindex.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/trajectory/trajectoryframe.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/testfilemanager.h"
+
+#include "testtrajectories.h"
+
+namespace
+{
+
+//! Returns the size of file \p filename.
+gmx_off_t fileSize(const std::string &filename)
+{
+    FILE     *fp = gmx_ffopen(filename.c_str(), "r");
+    gmx_fseek(fp, 0, SEEK_END);
+    gmx_off_t size = gmx_ftell(fp);
+    gmx_ffclose(fp);
+    return size;
+}
+
+/*! \brief
+ * Sets the -b and -dt time selection, and optionally GMX_TRX_INDEX,
+ * while in scope.
+ */
+class TimeSelection
+{
+    public:
+        //! Selects frames from \p begin with interval \p delta.
+        TimeSelection(real begin, real delta, bool useIndex) : useIndex_(useIndex)
+        {
+            if (useIndex_)
+            {
+#if GMX_NATIVE_WINDOWS
+                GMX_RELEASE_ASSERT(_putenv_s("GMX_TRX_INDEX", "1") == 0, "Could not set GMX_TRX_INDEX");
+#else
+                GMX_RELEASE_ASSERT(setenv("GMX_TRX_INDEX", "1", 1) == 0, "Could not set GMX_TRX_INDEX");
+#endif
+            }
+            setTimeValue(TBEGIN, begin);
+            setTimeValue(TDELTA, delta);
+        }
+        ~TimeSelection()
+        {
+            if (useIndex_)
+            {
+#if GMX_NATIVE_WINDOWS
+                _putenv_s("GMX_TRX_INDEX", "");
+#else
+                unsetenv("GMX_TRX_INDEX");
+#endif
+            }
+            unsetTimeValue(TBEGIN);
+            unsetTimeValue(TDELTA);
+        }
+
+    private:
+        bool useIndex_;
+};
+
+//! The data of a frame that is compared between reads.
+struct FrameData
+{
+    gmx_int64_t            step;
+    real                   time;
+    bool                   haveV;
+    std::vector<gmx::RVec> x;
+};
+
+/*! \brief
+ * Test fixture that writes trajectories and reads them back with and
+ * without read-ahead.
+ */
+class TrajectoryReadTest : public ::testing::Test
+{
+    public:
+        TrajectoryReadTest() : writer_(&fileManager_), oenv_(nullptr)
+        {
+            output_env_init_default(&oenv_);
+        }
+        ~TrajectoryReadTest()
+        {
+            output_env_done(oenv_);
+        }
+
+        /*! \brief Reads all frames of \p filename with read \p flags.
+         *
+         * The step and time left in the frame after reading fails at
+         * the end of the file are returned in \p endFrame.
+         */
+        std::vector<FrameData> readFrames(const std::string &filename, int flags,
+                                          FrameData *endFrame)
+        {
+            std::vector<FrameData> frames;
+            t_trxstatus           *status;
+            t_trxframe             fr;
+            bool                   bHaveFrame = read_first_frame(oenv_, &status, filename.c_str(), &fr, flags);
+            while (bHaveFrame)
+            {
+                FrameData frame;
+                frame.step  = fr.step;
+                frame.time  = fr.time;
+                frame.haveV = fr.bV;
+                frame.x.assign(fr.x, fr.x + fr.natoms);
+                frames.push_back(frame);
+                bHaveFrame = read_next_frame(oenv_, status, &fr);
+            }
+            endFrame->step = fr.step;
+            endFrame->time = fr.time;
+            /* Reading at the end of the file should keep returning false */
+            EXPECT_FALSE(read_next_frame(oenv_, status, &fr));
+            EXPECT_EQ(endFrame->step, fr.step);
+            EXPECT_EQ(endFrame->time, fr.time);
+            close_trx(status);
+            done_frame(&fr);
+            return frames;
+        }
+
+        /*! \brief Checks that reading \p filename with read-ahead gives the same
+         * frames and end of file state as \p reference and \p referenceEnd.
+         */
+        void compareWithReadAhead(const std::string            &filename,
+                                  int                           flags,
+                                  const std::vector<FrameData> &reference,
+                                  const FrameData              &referenceEnd)
+        {
+            FrameData              end;
+            std::vector<FrameData> actual = readFrames(filename, flags | TRX_READ_AHEAD, &end);
+            EXPECT_EQ(referenceEnd.step, end.step);
+            EXPECT_EQ(referenceEnd.time, end.time);
+            compareFrames(reference, actual);
+        }
+
+        /*! \brief Checks that reading \p filename with the frame index skips
+         * the frames before time 2 and between multiples of 1.
+         *
+         * The frames should agree with those read with the same time
+         * selection without index, both with and without read-ahead.
+         */
+        void checkIndexedSkipping(const std::string &filename, int flags,
+                                  int frameCount)
+        {
+            std::remove(gmx::TrajectoryFrameIndex::indexFilename(filename).c_str());
+            FrameData              end;
+            std::vector<FrameData> reference;
+            {
+                TimeSelection selection(2, 1, false);
+                reference = readFrames(filename, flags, &end);
+            }
+            ASSERT_EQ(static_cast<size_t>((frameCount - 4 + 1)/2), reference.size());
+            for (size_t i = 0; i < reference.size(); ++i)
+            {
+                EXPECT_EQ(static_cast<gmx_int64_t>(40 + 20*i), reference[i].step);
+                EXPECT_EQ(2.0 + i, reference[i].time);
+            }
+
+            for (int readAhead = 0; readAhead <= 1; ++readAhead)
+            {
+                SCOPED_TRACE(readAhead ? "with read-ahead" : "without read-ahead");
+                TimeSelection          selection(2, 1, true);
+                FrameData              indexedEnd;
+                std::vector<FrameData> indexed =
+                    readFrames(filename, flags | (readAhead ? TRX_READ_AHEAD : 0), &indexedEnd);
+                /* The index file shows that the index was used */
+                EXPECT_TRUE(gmx_fexist(gmx::TrajectoryFrameIndex::indexFilename(filename).c_str()));
+                compareFrames(reference, indexed);
+            }
+        }
+
+        //! Checks that \p actual contains the same frames as \p reference.
+        void compareFrames(const std::vector<FrameData> &reference,
+                           const std::vector<FrameData> &actual)
+        {
+            ASSERT_EQ(reference.size(), actual.size());
+            for (size_t i = 0; i < reference.size(); ++i)
+            {
+                SCOPED_TRACE(gmx::formatString("frame %d", static_cast<int>(i)));
+                EXPECT_EQ(reference[i].step, actual[i].step);
+                EXPECT_EQ(reference[i].time, actual[i].time);
+                EXPECT_EQ(reference[i].haveV, actual[i].haveV);
+                ASSERT_EQ(reference[i].x.size(), actual[i].x.size());
+                for (size_t a = 0; a < reference[i].x.size(); ++a)
+                {
+                    for (int d = 0; d < DIM; ++d)
+                    {
+                        EXPECT_EQ(reference[i].x[a][d], actual[i].x[a][d]);
+                    }
+                }
+            }
+        }
+
+        gmx::test::TestFileManager      fileManager_;
+        gmx::test::TestTrajectoryWriter writer_;
+        gmx_output_env_t               *oenv_;
+};
+
+TEST_F(TrajectoryReadTest, ReadAheadGivesSameXtcFrames)
+{
+    /* More frames than the read-ahead thread buffers */
+    std::string            filename = writer_.writeXtc(11);
+    FrameData              end;
+    std::vector<FrameData> reference = readFrames(filename, TRX_NEED_X, &end);
+    ASSERT_EQ(11U, reference.size());
+    for (size_t i = 0; i < reference.size(); ++i)
+    {
+        EXPECT_EQ(static_cast<gmx_int64_t>(10*i), reference[i].step);
+        EXPECT_EQ(0.5*i, reference[i].time);
+    }
+    compareWithReadAhead(filename, TRX_NEED_X, reference, end);
+}
+
+TEST_F(TrajectoryReadTest, ReadAheadGivesSameTrrFrames)
+{
+    std::string            filename = writer_.writeTrr(9);
+    FrameData              end;
+    std::vector<FrameData> reference = readFrames(filename, TRX_READ_X | TRX_READ_V, &end);
+    ASSERT_EQ(9U, reference.size());
+    compareWithReadAhead(filename, TRX_READ_X | TRX_READ_V, reference, end);
+}
+
+TEST_F(TrajectoryReadTest, ReadAheadGivesSameFramesWithIncompleteLastFrame)
+{
+    std::string filename = writer_.writeXtc(7);
+    /* Cut the file in the middle of the last frame */
+    ASSERT_EQ(0, gmx_truncate(filename.c_str(), fileSize(filename) - 20));
+    FrameData              end;
+    std::vector<FrameData> reference = readFrames(filename, TRX_NEED_X, &end);
+    ASSERT_EQ(6U, reference.size());
+    compareWithReadAhead(filename, TRX_NEED_X, reference, end);
+}
+
+TEST_F(TrajectoryReadTest, IndexSkipsXtcFrames)
+{
+    std::string filename = writer_.writeXtc(13);
+    checkIndexedSkipping(filename, TRX_NEED_X, 13);
+}
+
+TEST_F(TrajectoryReadTest, IndexSkipsTrrFrames)
+{
+    std::string filename = writer_.writeTrr(12);
+    checkIndexedSkipping(filename, TRX_READ_X | TRX_READ_V, 12);
+}
+
+} // namespace
@@ -0,0 +1,244 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for XTC coordinate compression.
+ *
+ * The decoded coordinates are compared exactly against the values
+ * obtained by rounding the input to the requested precision, which is
+ * what the encoder stores.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/xtcio.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace
+{
+
+//! Returns the value that XTC compression stores for \p x.
+float quantize(float x, float precision)
+{
+    float value = (x >= 0 ? x * precision + 0.5 : x * precision - 0.5);
+    float scale = 1.0 / precision;
+    return static_cast<int>(value) * scale;
+}
+
+/*! \brief
+ * Test fixture for writing and reading back XTC frames.
+ */
+class XtcCompressionTest : public ::testing::Test
+{
+    public:
+        XtcCompressionTest() : rng_(12345)
+        {
+            filename_ = fileManager_.getTemporaryFilePath(".xtc");
+            clear_mat(box_);
+            box_[XX][XX] = box_[YY][YY] = box_[ZZ][ZZ] = 3;
+        }
+
+        //! Adds \p count atoms randomly distributed in a cube of size \p size.
+        void addRandomAtoms(int count, real size)
+        {
+            gmx::UniformRealDistribution<real> dist(0, size);
+            for (int i = 0; i < count; ++i)
+            {
+                x_.emplace_back(dist(rng_), dist(rng_), dist(rng_));
+            }
+        }
+        //! Adds \p count water-like triplets of atoms in a cube of size \p size.
+        void addWaters(int count, real size)
+        {
+            gmx::UniformRealDistribution<real> dist(0, size);
+            gmx::UniformRealDistribution<real> bond(-0.1, 0.1);
+            for (int i = 0; i < count; ++i)
+            {
+                gmx::RVec o(dist(rng_), dist(rng_), dist(rng_));
+                x_.push_back(o);
+                for (int h = 0; h < 2; ++h)
+                {
+                    x_.emplace_back(o[XX] + bond(rng_), o[YY] + bond(rng_),
+                                    o[ZZ] + bond(rng_));
+                }
+            }
+        }
+
+        //! Writes \p frameCount frames with the coordinates, reads and checks them.
+        void runTest(real precision, int frameCount)
+        {
+            const int natoms = static_cast<int>(x_.size());
+            t_fileio *fio    = open_xtc(filename_.c_str(), "w");
+            for (int frame = 0; frame < frameCount; ++frame)
+            {
+                ASSERT_TRUE(write_xtc(fio, natoms, frame, frame, box_,
+                                      as_rvec_array(x_.data()), precision));
+            }
+            close_xtc(fio);
+
+            fio = open_xtc(filename_.c_str(), "r");
+            int         readNatoms = 0;
+            gmx_int64_t step;
+            real        time, readPrecision;
+            matrix      box;
+            rvec       *x   = nullptr;
+            gmx_bool    bOK = FALSE;
+            ASSERT_TRUE(read_first_xtc(fio, &readNatoms, &step, &time, box, &x,
+                                       &readPrecision, &bOK));
+            ASSERT_TRUE(bOK);
+            ASSERT_EQ(natoms, readNatoms);
+            for (int frame = 0; frame < frameCount; ++frame)
+            {
+                if (frame > 0)
+                {
+                    ASSERT_TRUE(read_next_xtc(fio, natoms, &step, &time, box, x,
+                                              &readPrecision, &bOK));
+                    ASSERT_TRUE(bOK);
+                }
+                EXPECT_EQ(frame, step);
+                for (int i = 0; i < natoms; ++i)
+                {
+                    for (int d = 0; d < DIM; ++d)
+                    {
+                        const float expected =
+                            (natoms <= 9 ? static_cast<float>(x_[i][d])
+                             : quantize(x_[i][d], precision));
+                        EXPECT_EQ(expected, static_cast<float>(x[i][d]))
+                        << "atom " << i << " dim " << d;
+                    }
+                }
+            }
+            EXPECT_FALSE(read_next_xtc(fio, natoms, &step, &time, box, x,
+                                       &readPrecision, &bOK));
+            sfree(x);
+            close_xtc(fio);
+        }
+
+    protected:
+        gmx::test::TestFileManager  fileManager_;
+        std::string                 filename_;
+        gmx::DefaultRandomEngine    rng_;
+        std::vector<gmx::RVec>      x_;
+        matrix                      box_;
+};
+
+TEST_F(XtcCompressionTest, HandlesFewAtoms)
+{
+    addRandomAtoms(7, 3);
+    runTest(1000, 2);
+}
+
+TEST_F(XtcCompressionTest, HandlesRandomAtoms)
+{
+    addRandomAtoms(1000, 5);
+    runTest(1000, 3);
+}
+
+TEST_F(XtcCompressionTest, HandlesWater)
+{
+    addWaters(1000, 5);
+    runTest(1000, 3);
+}
+
+TEST_F(XtcCompressionTest, HandlesMixedSystemAtHighPrecision)
+{
+    addRandomAtoms(100, 5);
+    addWaters(500, 5);
+    addRandomAtoms(10, 5);
+    runTest(100000, 2);
+}
+
+TEST_F(XtcCompressionTest, HandlesRangesNotFittingIn64Bits)
+{
+    addWaters(100, 5000);
+    runTest(1000, 2);
+}
+
+TEST_F(XtcCompressionTest, HandlesRangesNotFittingIn24Bits)
+{
+    addRandomAtoms(50, 20000);
+    addWaters(50, 20000);
+    runTest(1000, 2);
+}
+
+TEST_F(XtcCompressionTest, CompressesToMemory)
+{
+    addWaters(300, 5);
+    addRandomAtoms(5, 5);
+    for (int natoms : { 0, 5, static_cast<int>(x_.size()) })
+    {
+        std::vector<char> buf(xtc_compressed_size_max(natoms));
+        int               nbytes = xtc_compress_coords(natoms, as_rvec_array(x_.data()), 1000,
+                                                       buf.data(), buf.size());
+        ASSERT_GT(nbytes, 0);
+        EXPECT_LE(nbytes, static_cast<int>(buf.size()));
+        std::vector<gmx::RVec> x(natoms);
+        ASSERT_TRUE(xtc_decompress_coords(buf.data(), nbytes, natoms, as_rvec_array(x.data())));
+        for (int i = 0; i < natoms; ++i)
+        {
+            for (int d = 0; d < DIM; ++d)
+            {
+                const float expected =
+                    (natoms <= 9 ? static_cast<float>(x_[i][d])
+                     : quantize(x_[i][d], 1000));
+                EXPECT_EQ(expected, static_cast<float>(x[i][d]))
+                << "atom " << i << " dim " << d;
+            }
+        }
+        if (natoms > 0)
+        {
+            EXPECT_EQ(0, xtc_compress_coords(natoms, as_rvec_array(x_.data()), 1000,
+                                             buf.data(), nbytes - 4));
+            EXPECT_FALSE(xtc_decompress_coords(buf.data(), nbytes - 4, natoms,
+                                               as_rvec_array(x.data())));
+        }
+    }
+}
+
+} // namespace
@@ -0,0 +1,274 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements gmx::TrajectoryFrameIndex.
+ *
+ * \ingroup module_fileio
+ */
+#include "gmxpre.h"
+
+#include "trxindex.h"
+
+#include <cstdio>
+
+#include <algorithm>
+
+#include <sys/stat.h>
+
+#include "gromacs/fileio/filetypes.h"
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/gmxfio-xdr.h"
+#include "gromacs/fileio/trrio.h"
+#include "gromacs/fileio/xdrf.h"
+
+namespace gmx
+{
+
+namespace
+{
+
+//! Magic number at the start of each XTC frame.
+const int c_xtcMagic = 1995;
+//! Bytes in an XTC frame before the compressed coordinates (header, box and natoms).
+const int c_xtcHeaderSize = 56;
+//! Bytes of compression parameters before the compressed data size.
+const int c_xtcCompressionHeaderSize = 32;
+//! First line of an index file.
+const char c_indexFileHeader[] = "GROMACS trajectory frame index 1";
+
+//! Gets the size and modification time of a file, returns false on failure.
+bool getFileStatus(const std::string &filename, gmx_int64_t *size, gmx_int64_t *time)
+{
+    struct stat info;
+    if (stat(filename.c_str(), &info) != 0)
+    {
+        return false;
+    }
+    *size = info.st_size;
+    *time = info.st_mtime;
+    return true;
+}
+
+} // namespace
+
+TrajectoryFrameIndex::TrajectoryFrameIndex()
+    : endOffset_(0), fileSize_(0), fileTime_(0)
+{
+}
+
+std::string TrajectoryFrameIndex::indexFilename(const std::string &filename)
+{
+    return filename + ".idx";
+}
+
+std::unique_ptr<TrajectoryFrameIndex>
+TrajectoryFrameIndex::readOrCreate(const std::string &filename)
+{
+    const int ftp = fn2ftp(filename.c_str());
+    std::unique_ptr<TrajectoryFrameIndex> index;
+    if (ftp != efXTC && ftp != efTRR)
+    {
+        return index;
+    }
+    index.reset(new TrajectoryFrameIndex);
+    if (!getFileStatus(filename, &index->fileSize_, &index->fileTime_))
+    {
+        index.reset();
+        return index;
+    }
+    const std::string indexFile = indexFilename(filename);
+    if (!index->read(indexFile))
+    {
+        if (!index->scan(filename, ftp))
+        {
+            index.reset();
+            return index;
+        }
+        index->write(indexFile);
+    }
+    return index;
+}
+
+int TrajectoryFrameIndex::findFrame(gmx_off_t offset) const
+{
+    auto frame = std::lower_bound(frames_.begin(), frames_.end(), offset,
+                                  [](const Frame &frame, gmx_off_t offset)
+                                  {
+                                      return frame.offset < offset;
+                                  });
+    if (frame == frames_.end() || frame->offset != offset)
+    {
+        return -1;
+    }
+    return static_cast<int>(frame - frames_.begin());
+}
+
+bool TrajectoryFrameIndex::scan(const std::string &filename, int ftp)
+{
+    frames_.clear();
+    t_fileio  *fio    = gmx_fio_open(filename.c_str(), "r");
+    gmx_off_t  offset = 0;
+    if (ftp == efXTC)
+    {
+        FILE *fp = gmx_fio_getfp(fio);
+        XDR  *xd = gmx_fio_getxdr(fio);
+        while (offset < fileSize_)
+        {
+            int   magic, natoms, step, nbytes;
+            float time;
+            if (gmx_fseek(fp, offset, SEEK_SET) != 0
+                || !xdr_int(xd, &magic) || magic != c_xtcMagic
+                || !xdr_int(xd, &natoms) || !xdr_int(xd, &step)
+                || !xdr_float(xd, &time))
+            {
+                break;
+            }
+            gmx_off_t next = offset + c_xtcHeaderSize;
+            if (natoms <= 9)
+            {
+                /* Small frames are stored uncompressed */
+                next += 3*natoms*sizeof(float);
+            }
+            else
+            {
+                next += c_xtcCompressionHeaderSize;
+                if (gmx_fseek(fp, next, SEEK_SET) != 0 || !xdr_int(xd, &nbytes))
+                {
+                    break;
+                }
+                /* The compressed data is padded to a multiple of four bytes */
+                next += sizeof(int) + (nbytes + 3)/4*4;
+            }
+            if (next > fileSize_)
+            {
+                break;
+            }
+            frames_.push_back({step, time, offset});
+            offset = next;
+        }
+    }
+    else
+    {
+        gmx_trr_header_t sh;
+        gmx_bool         bOK;
+        while (gmx_trr_read_frame_header(fio, &sh, &bOK))
+        {
+            const gmx_off_t next = gmx_fio_ftell(fio)
+                + sh.box_size + sh.vir_size + sh.pres_size
+                + sh.x_size + sh.v_size + sh.f_size;
+            if (next > fileSize_)
+            {
+                break;
+            }
+            frames_.push_back({sh.step, sh.t, offset});
+            offset = next;
+            if (gmx_fio_seek(fio, offset) != 0)
+            {
+                break;
+            }
+        }
+    }
+    gmx_fio_close(fio);
+    endOffset_ = offset;
+    return !frames_.empty();
+}
+
+bool TrajectoryFrameIndex::read(const std::string &indexFilename)
+{
+    FILE *fp = std::fopen(indexFilename.c_str(), "r");
+    if (fp == nullptr)
+    {
+        return false;
+    }
+    char        header[sizeof(c_indexFileHeader) + 1];
+    gmx_int64_t size, time, end;
+    int         count;
+    bool        bOK =
+        std::fgets(header, sizeof(header), fp) != nullptr
+        && std::string(header) == std::string(c_indexFileHeader) + "\n"
+        && std::fscanf(fp, "%" GMX_SCNd64 " %" GMX_SCNd64 " %" GMX_SCNd64 " %d",
+                       &size, &time, &end, &count) == 4
+        && size == fileSize_ && time == fileTime_ && count >= 0;
+    if (bOK)
+    {
+        frames_.resize(count);
+        for (Frame &frame : frames_)
+        {
+            double frameTime;
+            if (std::fscanf(fp, "%" GMX_SCNd64 " %lf %" GMX_SCNd64,
+                            &frame.step, &frameTime, &frame.offset) != 3)
+            {
+                bOK = false;
+                break;
+            }
+            frame.time = frameTime;
+        }
+        endOffset_ = end;
+    }
+    std::fclose(fp);
+    if (!bOK)
+    {
+        frames_.clear();
+    }
+    return bOK && !frames_.empty();
+}
+
+bool TrajectoryFrameIndex::write(const std::string &indexFilename) const
+{
+    FILE *fp = std::fopen(indexFilename.c_str(), "w");
+    if (fp == nullptr)
+    {
+        return false;
+    }
+    std::fprintf(fp, "%s\n", c_indexFileHeader);
+    std::fprintf(fp, "%" GMX_PRId64 " %" GMX_PRId64 " %" GMX_PRId64 " %d\n",
+                 fileSize_, fileTime_, endOffset_, frameCount());
+    for (const Frame &frame : frames_)
+    {
+        /* Enough digits to read back the exact same time */
+        std::fprintf(fp, "%" GMX_PRId64 " %.17g %" GMX_PRId64 "\n",
+                     frame.step, static_cast<double>(frame.time), frame.offset);
+    }
+    bool bOK = (std::ferror(fp) == 0);
+    bOK = (std::fclose(fp) == 0) && bOK;
+    if (!bOK)
+    {
+        std::remove(indexFilename.c_str());
+    }
+    return bOK;
+}
+
+} // namespace gmx
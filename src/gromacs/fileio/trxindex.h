@@ -0,0 +1,133 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares gmx::TrajectoryFrameIndex.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+#ifndef GMX_FILEIO_TRXINDEX_H
+#define GMX_FILEIO_TRXINDEX_H
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/real.h"
+
+namespace gmx
+{
+
+/*! \libinternal \brief
+ * Byte offsets of the frames in an XTC or TRR file.
+ *
+ * The index is built by reading only the frame headers and skipping over
+ * the coordinate data, so it is much cheaper to build than reading the
+ * trajectory.  It is stored next to the trajectory in a file with
+ * \c .idx appended to the trajectory file name, together with the size
+ * and modification time of the trajectory, such that it is only reused
+ * while the trajectory is unchanged.
+ *
+ * With the index, trajectory readers can seek directly to a frame and
+ * skip frames without decoding them.
+ *
+ * \inlibraryapi
+ * \ingroup module_fileio
+ */
+class TrajectoryFrameIndex
+{
+    public:
+        //! Information about one frame.
+        struct Frame
+        {
+            //! MD step of the frame.
+            gmx_int64_t step;
+            //! Time of the frame.
+            real        time;
+            //! Byte offset of the start of the frame in the file.
+            gmx_off_t   offset;
+        };
+
+        /*! \brief
+         * Reads the index for a trajectory, or creates it if it does not
+         * exist or is out of date.
+         *
+         * \param[in] filename  Name of an XTC or TRR file.
+         * \returns   The index, or `nullptr` if the file format is not
+         *     supported or the file could not be scanned.
+         *
+         * A newly created index is written to disk if possible; failing to
+         * write it is not an error.
+         */
+        static std::unique_ptr<TrajectoryFrameIndex>
+        readOrCreate(const std::string &filename);
+
+        //! Returns the name of the index file for a trajectory file.
+        static std::string indexFilename(const std::string &filename);
+
+        //! Returns the number of complete frames in the trajectory.
+        int frameCount() const { return static_cast<int>(frames_.size()); }
+        //! Returns information for frame \p index.
+        const Frame &frame(int index) const { return frames_[index]; }
+        //! Returns the offset just past the last complete frame.
+        gmx_off_t endOffset() const { return endOffset_; }
+        /*! \brief
+         * Returns the frame that starts at \p offset, or -1 if no frame
+         * starts there.
+         */
+        int findFrame(gmx_off_t offset) const;
+
+    private:
+        TrajectoryFrameIndex();
+
+        //! Scans the frame headers of \p filename.
+        bool scan(const std::string &filename, int ftp);
+        //! Reads an index file, returns false if it is missing or stale.
+        bool read(const std::string &indexFilename);
+        //! Writes the index file, returns false on failure.
+        bool write(const std::string &indexFilename) const;
+
+        std::vector<Frame>  frames_;
+        gmx_off_t           endOffset_;
+        gmx_int64_t         fileSize_;
+        gmx_int64_t         fileTime_;
+};
+
+} // namespace gmx
+
+#endif
@@ -42,8 +42,15 @@
 
 #include <cassert>
 #include <cmath>
+#include <cstdlib>
 #include <cstring>
 
+#include <condition_variable>
+#include <exception>
+#include <mutex>
+#include <thread>
+#include <vector>
+
 #include "gromacs/fileio/checkpoint.h"
 #include "gromacs/fileio/confio.h"
 #include "gromacs/fileio/filetypes.h"
@@ -57,6 +64,7 @@
 #include "gromacs/fileio/tngio.h"
 #include "gromacs/fileio/tpxio.h"
 #include "gromacs/fileio/trrio.h"
+#include "gromacs/fileio/trxindex.h"
 #include "gromacs/fileio/xdrf.h"
 #include "gromacs/fileio/xtcio.h"
 #include "gromacs/math/vec.h"
@@ -79,6 +87,14 @@
 #define SKIP2  100
 #define SKIP3 1000
 
+/* Number of frames decoded ahead of the reader with TRX_READ_AHEAD */
+static const int c_readAheadFrameCount = 4;
+
+namespace
+{
+class TrajectoryReadAhead;
+}
+
 struct t_trxstatus
 {
     int                     flags;            /* flags for read_first/next_frame  */
@@ -93,11 +109,15 @@ struct t_trxstatus
     double                  DT, BOX[3];
     gmx_bool                bReadBox;
     char                   *persistent_line; /* Persistent line for reading g96 trajectories */
+    TrajectoryReadAhead    *readAhead;       /* Background reader, can be NULL */
+    gmx::TrajectoryFrameIndex *frameIndex;   /* Frame offsets, can be NULL */
 #if GMX_USE_PLUGINS
     gmx_vmdplugin_t        *vmdplugin;
 #endif
 };
 
+static void stop_read_ahead(t_trxstatus *status);
+
 /* utility functions */
 
 gmx_bool bRmod_fd(double a, double b, double c, gmx_bool bDouble)
@@ -175,6 +195,8 @@ static void status_init(t_trxstatus *status)
     status->tf              = 0;
     status->persistent_line = nullptr;
     status->tng             = nullptr;
+    status->readAhead       = nullptr;
+    status->frameIndex      = nullptr;
 }
 
 
@@ -242,6 +264,8 @@ real ndec2prec(int ndec)
 
 t_fileio *trx_get_fileio(t_trxstatus *status)
 {
+    /* The caller may read or seek, so the read-ahead thread can not continue */
+    stop_read_ahead(status);
     return status->fio;
 }
 
@@ -623,6 +647,8 @@ void close_trx(t_trxstatus *status)
     {
         return;
     }
+    stop_read_ahead(status);
+    delete status->frameIndex;
     gmx_tng_close(&status->tng);
     if (status->fio)
     {
@@ -715,6 +741,345 @@ static gmx_bool gmx_next_frame(t_trxstatus *status, t_trxframe *fr)
     return bRet;
 }
 
+/* Uses the frame index to seek over the frames that will be skipped
+ * because of their time, such that they are not read at all.
+ * Returns the number of skipped frames, with the time of the last one
+ * in *lastTime.
+ */
+static int skip_indexed_frames(t_trxstatus *status, real *lastTime)
+{
+    const gmx::TrajectoryFrameIndex *index = status->frameIndex;
+    if (status->flags & TRX_DONT_SKIP)
+    {
+        return 0;
+    }
+    const int first = index->findFrame(gmx_fio_ftell(status->fio));
+    if (first < 0)
+    {
+        return 0;
+    }
+    int frame = first;
+    while (frame < index->frameCount() &&
+           check_times2(index->frame(frame).time, status->t0, FALSE) < 0)
+    {
+        *lastTime = index->frame(frame).time;
+        frame++;
+    }
+    if (frame > first)
+    {
+        gmx_fio_seek(status->fio, frame < index->frameCount()
+                     ? index->frame(frame).offset : index->endOffset());
+    }
+    return frame - first;
+}
+
+static gmx_bool xtc_next_frame(t_fileio *fio, t_trxframe *fr)
+{
+    gmx_bool bOK, bRet;
+
+    bRet = read_next_xtc(fio, fr->natoms, &fr->step, &fr->time, fr->box,
+                         fr->x, &fr->prec, &bOK);
+    fr->bPrec = (bRet && fr->prec > 0);
+    fr->bStep = bRet;
+    fr->bTime = bRet;
+    fr->bX    = bRet;
+    fr->bBox  = bRet;
+    if (!bOK)
+    {
+        /* Actually the header could also be not ok,
+           but from bOK from read_next_xtc this can't be distinguished */
+        fr->not_ok = DATA_NOT_OK;
+    }
+    return bRet;
+}
+
+namespace
+{
+
+/*! \brief
+ * Reads and decompresses XTC or TRR frames in a background thread.
+ *
+ * The thread reads up to c_readAheadFrameCount frames ahead of the
+ * consumer into a ring of frame buffers that are allocated once and
+ * recycled.  nextFrame() copies the oldest frame into the caller's
+ * frame, so the caller keeps ownership of its own coordinate arrays.
+ * The time-based selection of frames (-b, -e, -dt) is still done by
+ * read_next_frame(), but with a frame index the thread seeks over
+ * frames that will be skipped instead of decoding them.
+ */
+class TrajectoryReadAhead
+{
+    public:
+        TrajectoryReadAhead(t_trxstatus *status, int ftp, int natoms);
+        ~TrajectoryReadAhead();
+
+        /*! \brief
+         * Returns the next frame, waiting for it to be decoded if necessary.
+         *
+         * Has the same return value as the serial reading routines.
+         * After the end of the file (or a read error) is reached, keeps
+         * returning FALSE.
+         * The number of frames skipped with the frame index before the
+         * returned frame is returned in \p *skippedCount, and the time of
+         * the last of those in \p *skippedTime.
+         */
+        gmx_bool nextFrame(t_trxframe *fr, int *skippedCount, real *skippedTime);
+        /*! \brief
+         * Stops the thread and positions the file at the oldest frame
+         * not yet returned by nextFrame().
+         */
+        void stop();
+
+    private:
+        //! Buffer for one decoded frame.
+        struct Frame
+        {
+            t_trxframe          fr;
+            gmx_bool            bRet;
+            gmx_off_t           offset;
+            int                 skippedCount;
+            real                skippedTime;
+            std::exception_ptr  exception;
+        };
+
+        void readFrame(Frame *frame);
+        void readFrames();
+
+        t_trxstatus              *status_;
+        int                       ftp_;
+        std::vector<Frame>        frames_;
+        //! Index of the oldest decoded frame in \p frames_.
+        int                       first_;
+        //! Number of decoded frames not yet returned.
+        int                       count_;
+        bool                      bStop_;
+        std::mutex                mutex_;
+        std::condition_variable   frameRead_;
+        std::condition_variable   frameFreed_;
+        std::thread               thread_;
+};
+
+TrajectoryReadAhead::TrajectoryReadAhead(t_trxstatus *status, int ftp, int natoms)
+    : status_(status), ftp_(ftp), frames_(c_readAheadFrameCount),
+      first_(0), count_(0), bStop_(false)
+{
+    for (Frame &frame : frames_)
+    {
+        clear_trxframe(&frame.fr, TRUE);
+        frame.fr.natoms = natoms;
+        frame.bRet         = FALSE;
+        frame.offset       = 0;
+        frame.skippedCount = 0;
+        frame.skippedTime  = 0;
+        if (ftp_ == efXTC)
+        {
+            snew(frame.fr.x, natoms);
+        }
+    }
+    thread_ = std::thread(&TrajectoryReadAhead::readFrames, this);
+}
+
+TrajectoryReadAhead::~TrajectoryReadAhead()
+{
+    stop();
+    for (Frame &frame : frames_)
+    {
+        sfree(frame.fr.x);
+        sfree(frame.fr.v);
+        sfree(frame.fr.f);
+    }
+}
+
+void TrajectoryReadAhead::readFrame(Frame *frame)
+{
+    frame->skippedCount = 0;
+    if (status_->frameIndex != nullptr)
+    {
+        frame->skippedCount = skip_indexed_frames(status_, &frame->skippedTime);
+    }
+    frame->offset = gmx_fio_ftell(status_->fio);
+    clear_trxframe(&frame->fr, FALSE);
+    if (ftp_ == efXTC)
+    {
+        frame->bRet = xtc_next_frame(status_->fio, &frame->fr);
+    }
+    else
+    {
+        frame->bRet = gmx_next_frame(status_, &frame->fr);
+    }
+}
+
+void TrajectoryReadAhead::readFrames()
+{
+    const int frameCount = static_cast<int>(frames_.size());
+    bool      bEnd       = false;
+    Frame    *previous   = nullptr;
+    while (!bEnd)
+    {
+        Frame *frame;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            frameFreed_.wait(lock, [this, frameCount] {
+                                 return bStop_ || count_ < frameCount;
+                             });
+            if (bStop_)
+            {
+                return;
+            }
+            frame = &frames_[(first_ + count_) % frameCount];
+        }
+        if (previous != nullptr)
+        {
+            /* A failed read leaves the frame data unchanged, so start
+             * from the previous frame, as serial reading into one
+             * frame does.
+             */
+            frame->fr.step      = previous->fr.step;
+            frame->fr.time      = previous->fr.time;
+            frame->fr.lambda    = previous->fr.lambda;
+            frame->fr.fep_state = previous->fr.fep_state;
+            frame->fr.prec      = previous->fr.prec;
+            copy_mat(previous->fr.box, frame->fr.box);
+        }
+        try
+        {
+            readFrame(frame);
+        }
+        catch (...)
+        {
+            frame->bRet      = FALSE;
+            frame->exception = std::current_exception();
+        }
+        bEnd     = !frame->bRet;
+        previous = frame;
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++count_;
+        }
+        frameRead_.notify_one();
+    }
+}
+
+gmx_bool TrajectoryReadAhead::nextFrame(t_trxframe *fr, int *skippedCount, real *skippedTime)
+{
+    Frame *frame;
+    {
+        std::unique_lock<std::mutex> lock(mutex_);
+        frameRead_.wait(lock, [this] { return count_ > 0; });
+        frame = &frames_[first_];
+    }
+    if (frame->exception)
+    {
+        std::rethrow_exception(frame->exception);
+    }
+    *skippedCount = frame->skippedCount;
+    *skippedTime  = frame->skippedTime;
+    /* Only report the skipped frames once */
+    frame->skippedCount = 0;
+    const t_trxframe &src = frame->fr;
+    fr->not_ok    = src.not_ok;
+    fr->bDouble   = src.bDouble;
+    fr->natoms    = src.natoms;
+    fr->bStep     = src.bStep;
+    fr->step      = src.step;
+    fr->bTime     = src.bTime;
+    fr->time      = src.time;
+    fr->bLambda   = src.bLambda;
+    fr->bFepState = src.bFepState;
+    fr->lambda    = src.lambda;
+    fr->fep_state = src.fep_state;
+    fr->bPrec     = src.bPrec;
+    fr->prec      = src.prec;
+    fr->bBox      = src.bBox;
+    copy_mat(src.box, fr->box);
+    fr->bX        = src.bX;
+    fr->bV        = src.bV;
+    fr->bF        = src.bF;
+    if (src.bX)
+    {
+        if (fr->x == nullptr)
+        {
+            snew(fr->x, src.natoms);
+        }
+        std::memcpy(fr->x, src.x, src.natoms*sizeof(*fr->x));
+    }
+    if (src.bV)
+    {
+        if (fr->v == nullptr)
+        {
+            snew(fr->v, src.natoms);
+        }
+        std::memcpy(fr->v, src.v, src.natoms*sizeof(*fr->v));
+    }
+    if (src.bF)
+    {
+        if (fr->f == nullptr)
+        {
+            snew(fr->f, src.natoms);
+        }
+        std::memcpy(fr->f, src.f, src.natoms*sizeof(*fr->f));
+    }
+    if (!frame->bRet)
+    {
+        /* Keep the last frame in the queue to keep returning FALSE */
+        return FALSE;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        first_ = (first_ + 1) % static_cast<int>(frames_.size());
+        --count_;
+    }
+    frameFreed_.notify_one();
+    return TRUE;
+}
+
+void TrajectoryReadAhead::stop()
+{
+    if (!thread_.joinable())
+    {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bStop_ = true;
+    }
+    frameFreed_.notify_one();
+    thread_.join();
+    if (count_ > 0)
+    {
+        gmx_fio_seek(status_->fio, frames_[first_].offset);
+    }
+}
+
+} // namespace
+
+/* Returns whether frames of type ftp should be read in a background thread */
+static gmx_bool use_read_ahead(const t_trxstatus *status, int ftp, const t_trxframe *fr)
+{
+    if (!(status->flags & TRX_READ_AHEAD) || (ftp != efXTC && ftp != efTRR))
+    {
+        return FALSE;
+    }
+    /* Without an index, seeking to the start time is done by read_next_frame */
+    if (ftp == efXTC &&
+        (fr->natoms <= 0 ||
+         (status->frameIndex == nullptr && bTimeSet(TBEGIN) && (status->tf < rTimeValue(TBEGIN)))))
+    {
+        return FALSE;
+    }
+    return TRUE;
+}
+
+static void stop_read_ahead(t_trxstatus *status)
+{
+    if (status->readAhead != nullptr)
+    {
+        status->readAhead->stop();
+        delete status->readAhead;
+        status->readAhead = nullptr;
+    }
+}
+
 static gmx_bool pdb_next_x(t_trxstatus *status, FILE *fp, t_trxframe *fr)
 {
     t_atoms   atoms;
@@ -811,9 +1176,9 @@ static int pdb_first_x(t_trxstatus *status, FILE *fp, t_trxframe *fr)
 
 gmx_bool read_next_frame(const gmx_output_env_t *oenv, t_trxstatus *status, t_trxframe *fr)
 {
-    real     pt;
-    int      ct;
-    gmx_bool bOK, bRet, bMissingData = FALSE, bSkip = FALSE;
+    real     pt, skippedTime = 0;
+    int      ct, skippedCount = 0;
+    gmx_bool bRet, bMissingData = FALSE, bSkip = FALSE;
     int      ftp;
 
     bRet = FALSE;
@@ -832,10 +1197,25 @@ gmx_bool read_next_frame(const gmx_output_env_t *oenv, t_trxstatus *status, t_tr
         {
             ftp = gmx_fio_getftp(status->fio);
         }
+        if (status->readAhead == nullptr && use_read_ahead(status, ftp, fr))
+        {
+            status->readAhead = new TrajectoryReadAhead(status, ftp, fr->natoms);
+        }
+        if (status->readAhead == nullptr && status->frameIndex != nullptr)
+        {
+            skippedCount = skip_indexed_frames(status, &skippedTime);
+        }
         switch (ftp)
         {
             case efTRR:
-                bRet = gmx_next_frame(status, fr);
+                if (status->readAhead != nullptr)
+                {
+                    bRet = status->readAhead->nextFrame(fr, &skippedCount, &skippedTime);
+                }
+                else
+                {
+                    bRet = gmx_next_frame(status, fr);
+                }
                 break;
             case efCPT:
                 /* Checkpoint files can not contain mulitple frames */
@@ -849,7 +1229,13 @@ gmx_bool read_next_frame(const gmx_output_env_t *oenv, t_trxstatus *status, t_tr
                 break;
             }
             case efXTC:
-                if (bTimeSet(TBEGIN) && (status->tf < rTimeValue(TBEGIN)))
+                if (status->readAhead != nullptr)
+                {
+                    bRet = status->readAhead->nextFrame(fr, &skippedCount, &skippedTime);
+                    break;
+                }
+                if (status->frameIndex == nullptr &&
+                    bTimeSet(TBEGIN) && (status->tf < rTimeValue(TBEGIN)))
                 {
                     if (xtc_seek_time(status->fio, rTimeValue(TBEGIN), fr->natoms, TRUE))
                     {
@@ -858,19 +1244,7 @@ gmx_bool read_next_frame(const gmx_output_env_t *oenv, t_trxstatus *status, t_tr
                     }
                     initcount(status);
                 }
-                bRet = read_next_xtc(status->fio, fr->natoms, &fr->step, &fr->time, fr->box,
-                                     fr->x, &fr->prec, &bOK);
-                fr->bPrec = (bRet && fr->prec > 0);
-                fr->bStep = bRet;
-                fr->bTime = bRet;
-                fr->bX    = bRet;
-                fr->bBox  = bRet;
-                if (!bOK)
-                {
-                    /* Actually the header could also be not ok,
-                       but from bOK from read_next_xtc this can't be distinguished */
-                    fr->not_ok = DATA_NOT_OK;
-                }
+                bRet = xtc_next_frame(status->fio, fr);
                 break;
             case efTNG:
                 bRet = gmx_read_next_tng_frame(status->tng, fr, nullptr, 0);
@@ -890,6 +1264,10 @@ gmx_bool read_next_frame(const gmx_output_env_t *oenv, t_trxstatus *status, t_tr
                           gmx_fio_getname(status->fio));
 #endif
         }
+        for (; skippedCount > 0; skippedCount--)
+        {
+            printcount(status, oenv, skippedTime, TRUE);
+        }
         status->tf = fr->time;
 
         if (bRet)
@@ -947,7 +1325,8 @@ int read_first_frame(const gmx_output_env_t *oenv, t_trxstatus **status,
 
     status_init( *status );
     initcount(*status);
-    (*status)->flags = flags;
+    /* Reading ahead is only started after the first frame, when t0 is known */
+    (*status)->flags = (flags & ~TRX_READ_AHEAD);
 
     if (efTNG == ftp)
     {
@@ -958,6 +1337,10 @@ int read_first_frame(const gmx_output_env_t *oenv, t_trxstatus **status,
     {
         fio = (*status)->fio = gmx_fio_open(fn, "r");
     }
+    if ((ftp == efXTC || ftp == efTRR) && getenv("GMX_TRX_INDEX") != nullptr)
+    {
+        (*status)->frameIndex = gmx::TrajectoryFrameIndex::readOrCreate(fn).release();
+    }
     switch (ftp)
     {
         case efTRR:
@@ -1084,6 +1467,11 @@ int read_first_frame(const gmx_output_env_t *oenv, t_trxstatus **status,
      */
     (*status)->natoms = fr->natoms;
 
+    if ((flags & TRX_READ_AHEAD) || getenv("GMX_TRX_READ_AHEAD") != nullptr)
+    {
+        (*status)->flags |= TRX_READ_AHEAD;
+    }
+
     return (fr->natoms > 0);
 }
 
@@ -1121,6 +1509,7 @@ gmx_bool read_next_x(const gmx_output_env_t *oenv, t_trxstatus *status, real *t,
 
 void rewind_trj(t_trxstatus *status)
 {
+    stop_read_ahead(status);
     initcount(status);
 
     gmx_fio_rewind(status->fio);
@@ -141,7 +141,10 @@ t_trxstatus *open_trx(const char *outfile, const char *filemode);
 /* Open a TRX file and return an allocated status pointer */
 
 struct t_fileio *trx_get_fileio(t_trxstatus *status);
-/* get a fileio from a trxstatus */
+/* get a fileio from a trxstatus.
+ * Stops any read-ahead, such that the file position is at the start
+ * of the next frame that read_next_frame would return.
+ */
 
 float trx_get_time_of_final_frame(t_trxstatus *status);
 /* get time of final frame. Only supported for TNG and XTC */
@@ -192,6 +195,10 @@ int check_times(real t);
 #define TRX_NEED_F    (1<<5)
 /* Useful for reading natoms from a trajectory without skipping */
 #define TRX_DONT_SKIP (1<<6)
+/* Read and decompress XTC/TRR frames ahead in a background thread.
+ * Also enabled for all readers by setting GMX_TRX_READ_AHEAD.
+ */
+#define TRX_READ_AHEAD (1<<7)
 
 /* For trxframe.not_ok */
 #define HEADER_NOT_OK (1<<0)
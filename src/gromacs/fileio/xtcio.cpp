@@ -137,30 +137,14 @@ static int xtc_header(XDR *xd, int *magic, int *natoms, gmx_int64_t *step, real
     return result;
 }
 
-static int xtc_coord(XDR *xd, int *natoms, rvec *box, rvec *x, real *prec, gmx_bool bRead)
+static int xtc_x(XDR *xd, int *natoms, rvec *x, real *prec, gmx_bool gmx_unused bRead)
 {
-    int    i, j, result;
+    int    result;
 #if GMX_DOUBLE
+    int    i;
     float *ftmp;
     float  fprec;
-#endif
-
-    /* box */
-    result = 1;
-    for (i = 0; ((i < DIM) && result); i++)
-    {
-        for (j = 0; ((j < DIM) && result); j++)
-        {
-            result = XTC_CHECK("box", xdr_r2f(xd, &(box[i][j]), bRead));
-        }
-    }
-
-    if (!result)
-    {
-        return result;
-    }
 
-#if GMX_DOUBLE
     /* allocate temp. single-precision array */
     snew(ftmp, (*natoms)*DIM);
 
@@ -196,6 +180,30 @@ static int xtc_coord(XDR *xd, int *natoms, rvec *box, rvec *x, real *prec, gmx_b
     return result;
 }
 
+static int xtc_coord(XDR *xd, int *natoms, rvec *box, rvec *x, real *prec, gmx_bool bRead)
+{
+    int    i, j, result;
+
+    /* box */
+    result = 1;
+    for (i = 0; ((i < DIM) && result); i++)
+    {
+        for (j = 0; ((j < DIM) && result); j++)
+        {
+            result = XTC_CHECK("box", xdr_r2f(xd, &(box[i][j]), bRead));
+        }
+    }
+
+    if (!result)
+    {
+        return result;
+    }
+
+    result = xtc_x(xd, natoms, x, prec, bRead);
+
+    return result;
+}
+
 
 
 int write_xtc(t_fileio *fio,
@@ -290,3 +298,40 @@ int read_next_xtc(t_fileio* fio,
 
     return *bOK;
 }
+
+int xtc_compressed_size_max(int natoms)
+{
+    /* xdr3dfcoord uses a buffer of 1.2 ints per coordinate for the
+     * compressed data, plus a header of at most ten ints */
+    return static_cast<int>(natoms*DIM*sizeof(int)*1.2) + 10*sizeof(int);
+}
+
+int xtc_compress_coords(int natoms, const rvec *x, real prec, char *buf, int bufsize)
+{
+    XDR xd;
+    int result;
+
+    xdrmem_create(&xd, buf, bufsize, XDR_ENCODE);
+    result = xtc_x(&xd, &natoms, const_cast<rvec *>(x), &prec, FALSE);
+    if (result)
+    {
+        result = xdr_getpos(&xd);
+    }
+    xdr_destroy(&xd);
+
+    return result;
+}
+
+int xtc_decompress_coords(const char *buf, int nbytes, int natoms, rvec *x)
+{
+    XDR  xd;
+    int  result, n;
+    real prec = 0;
+
+    xdrmem_create(&xd, const_cast<char *>(buf), nbytes, XDR_DECODE);
+    n      = natoms;
+    result = xtc_x(&xd, &n, x, &prec, TRUE);
+    xdr_destroy(&xd);
+
+    return (result && n == natoms) ? 1 : 0;
+}
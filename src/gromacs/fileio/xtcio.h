@@ -80,6 +80,20 @@ int write_xtc(struct t_fileio *fio,
               const rvec *box, const rvec *x, real prec);
 /* Write a frame to xtc file */
 
+int xtc_compressed_size_max(int natoms);
+/* Returns the maximum number of bytes xtc_compress_coords can use
+ * for natoms atoms */
+
+int xtc_compress_coords(int natoms, const rvec *x, real prec, char *buf, int bufsize);
+/* Compresses the coordinates of natoms atoms into buf, in the same
+ * format as used for the coordinates in xtc frames.
+ * Returns the number of bytes written, 0 if buf is too small.
+ */
+
+int xtc_decompress_coords(const char *buf, int nbytes, int natoms, rvec *x);
+/* Decompresses the coordinates of natoms atoms compressed
+ * with xtc_compress_coords */
+
 #ifdef __cplusplus
 }
 #endif
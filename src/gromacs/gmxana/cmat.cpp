@@ -38,12 +38,19 @@
 
 #include "cmat.h"
 
+#include "config.h"
+
 #include <algorithm>
 
+#if !GMX_NATIVE_WINDOWS
+#include <sys/mman.h>
+#endif
+
 #include "gromacs/fileio/matio.h"
 #include "gromacs/fileio/xvgr.h"
 #include "gromacs/math/functions.h"
 #include "gromacs/math/vec.h"
+#include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/futil.h"
 #include "gromacs/utility/smalloc.h"
 
@@ -147,6 +154,109 @@ void done_mat(t_mat **m)
     *m = nullptr;
 }
 
+/* Identifies binary matrix files, followed by the version and the size */
+static const gmx_int32_t c_matBinaryMagic   = 0x584d4752;
+static const gmx_int32_t c_matBinaryVersion = 1;
+
+void write_mat_binary(const char *fn, t_mat *m)
+{
+    FILE       *fp;
+    gmx_int32_t header[4] = { c_matBinaryMagic, c_matBinaryVersion, m->nn, 0 };
+    float      *row;
+    int         i, j, nrow;
+
+    fp = gmx_ffopen(fn, "wb");
+    if (fwrite(header, sizeof(header), 1, fp) != 1)
+    {
+        gmx_fatal(FARGS, "Error writing to file %s", fn);
+    }
+    snew(row, m->nn);
+    for (i = 0; i < m->nn - 1; i++)
+    {
+        nrow = m->nn - i - 1;
+        for (j = 0; j < nrow; j++)
+        {
+            row[j] = m->mat[i][i + 1 + j];
+        }
+        if (static_cast<int>(fwrite(row, sizeof(*row), nrow, fp)) != nrow)
+        {
+            gmx_fatal(FARGS, "Error writing to file %s", fn);
+        }
+    }
+    sfree(row);
+    gmx_ffclose(fp);
+}
+
+t_mat *read_mat_binary(const char *fn, gmx_bool b1D)
+{
+    FILE       *fp;
+    gmx_int32_t header[4];
+    gmx_off_t   size;
+    t_mat      *m;
+    int         i, j, n;
+
+    fp = gmx_ffopen(fn, "rb");
+    if (fread(header, sizeof(header), 1, fp) != 1 || header[0] != c_matBinaryMagic)
+    {
+        gmx_fatal(FARGS, "File %s is not a binary matrix file", fn);
+    }
+    if (header[1] != c_matBinaryVersion)
+    {
+        gmx_fatal(FARGS, "Binary matrix file %s has version %d, expected %d",
+                  fn, header[1], c_matBinaryVersion);
+    }
+    n    = header[2];
+    size = sizeof(header) + static_cast<gmx_off_t>(n)*(n - 1)/2*sizeof(float);
+    if (gmx_fseek(fp, 0, SEEK_END) != 0 || gmx_ftell(fp) != size)
+    {
+        gmx_fatal(FARGS, "Binary matrix file %s is truncated or corrupt", fn);
+    }
+
+    m = init_mat(n, b1D);
+#if !GMX_NATIVE_WINDOWS
+    /* Map the file instead of reading it, so the matrix data does not
+     * need to be buffered a second time.
+     */
+    void        *map = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fileno(fp), 0);
+    const float *val;
+
+    if (map == MAP_FAILED)
+    {
+        gmx_fatal(FARGS, "Could not memory map file %s", fn);
+    }
+    val = reinterpret_cast<const float *>(static_cast<const char *>(map) + sizeof(header));
+    for (i = 0; i < n; i++)
+    {
+        for (j = i + 1; j < n; j++)
+        {
+            set_mat_entry(m, i, j, *val++);
+        }
+    }
+    munmap(map, size);
+#else
+    float *row;
+
+    gmx_fseek(fp, sizeof(header), SEEK_SET);
+    snew(row, n);
+    for (i = 0; i < n; i++)
+    {
+        if (static_cast<int>(fread(row, sizeof(*row), n - i - 1, fp)) != n - i - 1)
+        {
+            gmx_fatal(FARGS, "Error reading from file %s", fn);
+        }
+        for (j = i + 1; j < n; j++)
+        {
+            set_mat_entry(m, i, j, row[j - i - 1]);
+        }
+    }
+    sfree(row);
+#endif
+    m->nn = n;
+    gmx_ffclose(fp);
+
+    return m;
+}
+
 real mat_energy(t_mat *m)
 {
     int  j;
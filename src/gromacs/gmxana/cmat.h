@@ -83,6 +83,16 @@ extern void set_mat_entry(t_mat *m, int i, int j, real val);
 
 extern void done_mat(t_mat **m);
 
+extern void write_mat_binary(const char *fn, t_mat *m);
+/* Writes the upper triangle of the symmetric matrix m in single precision
+ * to the binary file fn, so it can be reused without loss of resolution.
+ */
+
+extern t_mat *read_mat_binary(const char *fn, gmx_bool b1D);
+/* Returns a matrix read from a file written by write_mat_binary.
+ * The file is memory mapped when the system supports it.
+ */
+
 extern real mat_energy(t_mat *mat);
 
 extern void swap_mat(t_mat *m);
@@ -41,6 +41,9 @@
 #include <cstring>
 
 #include <algorithm>
+#include <set>
+#include <utility>
+#include <vector>
 
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/commandline/viewit.h"
@@ -50,6 +53,7 @@
 #include "gromacs/fileio/xvgr.h"
 #include "gromacs/gmxana/cmat.h"
 #include "gromacs/gmxana/gmx_ana.h"
+#include "gromacs/gmxana/rmsdmatrix.h"
 #include "gromacs/linearalgebra/eigensolver.h"
 #include "gromacs/math/do_fit.h"
 #include "gromacs/math/vec.h"
@@ -762,6 +766,132 @@ static void gromos(int n1, real **mat, real rmsdcut, t_clusters *clust)
     clust->ncl = k-1;
 }
 
+/* The gromos algorithm on a neighbor list, stores the central structure
+ * of each cluster in center.
+ */
+static void gromos_sparse(const t_rmsd_neighbors *nbl, t_clusters *clust, int *center)
+{
+    /* Pool of unassigned structures ordered on number of neighbors,
+     * largest first, and on index for equal counts.
+     */
+    std::set<std::pair<int, int> >    pool;
+    std::vector<int>                  nr(nbl->n), members;
+    int                               i, k;
+
+    for (i = 0; i < nbl->n; i++)
+    {
+        /* Count the structure itself, as the dense version does */
+        nr[i] = static_cast<int>(nbl->index[i + 1] - nbl->index[i]) + 1;
+        pool.insert(std::make_pair(-nr[i], i));
+    }
+
+    fprintf(stderr, "Finding clusters %4d", 0);
+    k = 0;
+    while (!pool.empty())
+    {
+        int c = pool.begin()->second;
+
+        k++;
+        center[k - 1] = c;
+        /* Remove the structure with most neighbors and its neighbors */
+        members.clear();
+        members.push_back(c);
+        pool.erase(pool.begin());
+        clust->cl[c] = k;
+        for (gmx_int64_t j = nbl->index[c]; j < nbl->index[c + 1]; j++)
+        {
+            int m = nbl->nb[j];
+
+            if (clust->cl[m] == 0)
+            {
+                clust->cl[m] = k;
+                pool.erase(std::make_pair(-nr[m], m));
+                members.push_back(m);
+            }
+        }
+        /* Update the neighbor counts of the remaining structures */
+        for (int m : members)
+        {
+            for (gmx_int64_t j = nbl->index[m]; j < nbl->index[m + 1]; j++)
+            {
+                int l = nbl->nb[j];
+
+                if (clust->cl[l] == 0)
+                {
+                    pool.erase(std::make_pair(-nr[l], l));
+                    nr[l]--;
+                    pool.insert(std::make_pair(-nr[l], l));
+                }
+            }
+        }
+        fprintf(stderr, "\b\b\b\b%4d", k);
+    }
+    fprintf(stderr, "\n");
+
+    clust->ncl = k;
+}
+
+static int find_root(int *parent, int i)
+{
+    while (parent[i] != i)
+    {
+        parent[i] = parent[parent[i]];
+        i         = parent[i];
+    }
+
+    return i;
+}
+
+/* Single linkage on a neighbor list, stores the structure with the most
+ * neighbors within the cluster in center.
+ */
+static void linkage_sparse(const t_rmsd_neighbors *nbl, t_clusters *clust, int *center)
+{
+    std::vector<int> parent(nbl->n), nr(nbl->n, -1);
+    int              i, k;
+
+    for (i = 0; i < nbl->n; i++)
+    {
+        parent[i] = i;
+    }
+    for (i = 0; i < nbl->n; i++)
+    {
+        for (gmx_int64_t j = nbl->index[i]; j < nbl->index[i + 1]; j++)
+        {
+            int ri = find_root(parent.data(), i);
+            int rj = find_root(parent.data(), nbl->nb[j]);
+
+            /* Use the lowest index as root */
+            parent[std::max(ri, rj)] = std::min(ri, rj);
+        }
+    }
+    /* Number the clusters in order of their first structure, as gather does */
+    k = 0;
+    for (i = 0; i < nbl->n; i++)
+    {
+        int r = find_root(parent.data(), i);
+
+        if (r == i)
+        {
+            k++;
+            clust->cl[i] = k;
+        }
+        else
+        {
+            clust->cl[i] = clust->cl[r];
+        }
+        /* All neighbors are in the same cluster */
+        int nnb = static_cast<int>(nbl->index[i + 1] - nbl->index[i]);
+        if (nnb > nr[clust->cl[i] - 1])
+        {
+            nr[clust->cl[i] - 1]     = nnb;
+            center[clust->cl[i] - 1] = i;
+        }
+    }
+
+    clust->ncl = k;
+}
+
 rvec **read_whole_trj(const char *fn, int isize, int index[], int skip,
                       int *nframe, real **time, const gmx_output_env_t *oenv, gmx_bool bPBC, gmx_rmpbc_t gpbc)
 {
@@ -814,6 +944,60 @@ rvec **read_whole_trj(const char *fn, int isize, int index[], int skip,
     return xx;
 }
 
+/* Reads every skip-th frame of trajectory fn for the isize atoms in index
+ * into compact storage for RMSD calculation, with weights w.
+ * Only the trajectory times are stored for every frame.
+ */
+static t_rmsd_frames *read_rmsd_frames(const char *fn, int isize, const int index[],
+                                       const real *w, gmx_bool bFit, int skip,
+                                       real **time, const gmx_output_env_t *oenv,
+                                       gmx_bool bPBC, gmx_rmpbc_t gpbc)
+{
+    t_rmsd_frames *fr;
+    t_trxstatus   *status;
+    rvec          *x, *xs;
+    matrix         box;
+    real           t;
+    int            natom, i, j, nalloc;
+
+    fr = new_rmsd_frames(isize, w, bFit);
+    snew(xs, isize);
+    *time  = nullptr;
+    nalloc = 0;
+    natom  = read_first_x(oenv, &status, fn, &t, &x, box);
+    i      = 0;
+    do
+    {
+        if ((i % skip) == 0)
+        {
+            if (bPBC)
+            {
+                gmx_rmpbc(gpbc, natom, box, x);
+            }
+            for (j = 0; j < isize; j++)
+            {
+                copy_rvec(x[index[j]], xs[j]);
+            }
+            add_rmsd_frame(fr, xs);
+            if (fr->nframes > nalloc)
+            {
+                nalloc = over_alloc_large(fr->nframes);
+                srenew(*time, nalloc);
+            }
+            (*time)[fr->nframes - 1] = t;
+        }
+        i++;
+    }
+    while (read_next_x(oenv, status, &t, x, box));
+    close_trx(status);
+    fprintf(stderr, "Stored %d frames of %d atoms from trajectory %s\n",
+            fr->nframes, isize, fn);
+    sfree(xs);
+    sfree(x);
+
+    return fr;
+}
+
 static int plot_clusters(int nf, real **mat, t_clusters *clust,
                          int minstruct)
 {
@@ -982,6 +1166,26 @@ static void ana_trans(t_clusters *clust, int nf,
     sfree(axis);
 }
 
+static void write_cluster_id(const char *clustidfn, int nf, const real *time,
+                             const t_clusters *clust, const gmx_output_env_t *oenv)
+{
+    FILE *fp;
+    int   i;
+
+    fp = xvgropen(clustidfn, "Clusters", output_env_get_xvgr_tlabel(oenv), "Cluster #", oenv);
+    if (output_env_get_print_xvgr_codes(oenv))
+    {
+        fprintf(fp, "@    s0 symbol 2\n");
+        fprintf(fp, "@    s0 symbol size 0.2\n");
+        fprintf(fp, "@    s0 linestyle 0\n");
+    }
+    for (i = 0; i < nf; i++)
+    {
+        fprintf(fp, "%8g %8d\n", time[i], clust->cl[i]);
+    }
+    xvgrclose(fp);
+}
+
 static void analyze_clusters(int nf, t_clusters *clust, real **rmsd,
                              int natom, t_atoms *atoms, rvec *xtps,
                              real *mass, rvec **xx, real *time,
@@ -1069,18 +1273,7 @@ static void analyze_clusters(int nf, t_clusters *clust, real **rmsd,
 
     if (clustidfn)
     {
-        FILE *fp = xvgropen(clustidfn, "Clusters", output_env_get_xvgr_tlabel(oenv), "Cluster #", oenv);
-        if (output_env_get_print_xvgr_codes(oenv))
-        {
-            fprintf(fp, "@    s0 symbol 2\n");
-            fprintf(fp, "@    s0 symbol size 0.2\n");
-            fprintf(fp, "@    s0 linestyle 0\n");
-        }
-        for (i = 0; i < nf; i++)
-        {
-            fprintf(fp, "%8g %8d\n", time[i], clust->cl[i]);
-        }
-        xvgrclose(fp);
+        write_cluster_id(clustidfn, nf, time, clust, oenv);
     }
     if (sizefn)
     {
@@ -1288,6 +1481,174 @@ static void analyze_clusters(int nf, t_clusters *clust, real **rmsd,
     }
 }
 
+/* Sets useatoms to the isize atoms index of atoms and returns their coordinates */
+static rvec *make_useatoms(t_atoms *atoms, rvec *xtps, int isize, const int *index,
+                           t_atoms *useatoms)
+{
+    rvec *usextps;
+    int   i;
+
+    init_t_atoms(useatoms, isize, FALSE);
+    snew(usextps, isize);
+    useatoms->resinfo = atoms->resinfo;
+    for (i = 0; i < isize; i++)
+    {
+        useatoms->atomname[i]    = atoms->atomname[index[i]];
+        useatoms->atom[i].resind = atoms->atom[index[i]].resind;
+        useatoms->nres           = std::max(useatoms->nres, useatoms->atom[i].resind+1);
+        copy_rvec(xtps[index[i]], usextps[i]);
+    }
+    useatoms->nr = isize;
+
+    return usextps;
+}
+
+/* Writes the cluster analysis for clusters found with a neighbor list.
+ * The central structures are read in a second pass over the trajectory.
+ */
+static void analyze_sparse_clusters(int nf, t_clusters *clust, const int *center,
+                                    const char *trjfn, int skip, int natom,
+                                    const int *index, t_atoms *atoms, rvec *xtps,
+                                    real *mass, real *time, int ifsize, int *fitidx,
+                                    int iosize, int *outidx,
+                                    const char *trxfn, const char *sizefn,
+                                    const char *transfn, const char *ntransfn,
+                                    const char *clustidfn, gmx_bool bFit,
+                                    gmx_bool bPBC, gmx_rmpbc_t gpbc, FILE *log,
+                                    t_rgb rlo, t_rgb rhi, const gmx_output_env_t *oenv)
+{
+    FILE  *size_fp = nullptr;
+    char   buf[STRLEN];
+    int    i, cl, *nstr, *first, *next;
+
+    ffprintf_d(stderr, log, buf, "\nFound %d clusters\n\n", clust->ncl);
+
+    if (transfn || ntransfn)
+    {
+        ana_trans(clust, nf, transfn, ntransfn, log, rlo, rhi, oenv);
+    }
+    if (clustidfn)
+    {
+        write_cluster_id(clustidfn, nf, time, clust, oenv);
+    }
+
+    /* Link the members of each cluster in order of time */
+    snew(nstr, clust->ncl);
+    snew(first, clust->ncl);
+    snew(next, nf);
+    for (i = nf - 1; i >= 0; i--)
+    {
+        cl        = clust->cl[i] - 1;
+        next[i]   = (nstr[cl] > 0 ? first[cl] : -1);
+        first[cl] = i;
+        nstr[cl]++;
+    }
+    if (sizefn)
+    {
+        size_fp = xvgropen(sizefn, "Cluster Sizes", "Cluster #", "# Structures", oenv);
+        if (output_env_get_print_xvgr_codes(oenv))
+        {
+            fprintf(size_fp, "@g%d type %s\n", 0, "bar");
+        }
+        for (cl = 0; cl < clust->ncl; cl++)
+        {
+            fprintf(size_fp, "%8d %8d\n", cl + 1, nstr[cl]);
+        }
+        xvgrclose(size_fp);
+    }
+    fprintf(log, "\n%3s | %6s | %6s | cluster members\n", "cl.", "#st", "center");
+    for (cl = 0; cl < clust->ncl; cl++)
+    {
+        fprintf(log, "%3d | %6d | %6g |", cl + 1, nstr[cl], time[center[cl]]);
+        int n = 0;
+        for (i = first[cl]; i >= 0; i = next[i], n++)
+        {
+            if ((n % 7 == 0) && n)
+            {
+                fprintf(log, "\n%3s | %6s | %6s |", "", "", "");
+            }
+            fprintf(log, " %6g", time[i]);
+        }
+        fprintf(log, "\n");
+    }
+    sfree(next);
+    sfree(first);
+    sfree(nstr);
+
+    if (trxfn)
+    {
+        t_trxstatus *status, *trxout;
+        rvec        *x, **xcl;
+        int         *clcenter;
+        matrix       box, zerobox;
+        real         t;
+        int          natoms_trx, j, f;
+
+        ffprintf_s(stderr, log, buf, "Writing central structure for each cluster to %s\n", trxfn);
+        /* Look up the cluster of each central structure */
+        snew(clcenter, nf);
+        for (cl = 0; cl < clust->ncl; cl++)
+        {
+            clcenter[center[cl]] = cl + 1;
+        }
+        snew(xcl, clust->ncl);
+        natoms_trx = read_first_x(oenv, &status, trjfn, &t, &x, box);
+        i          = 0;
+        f          = 0;
+        do
+        {
+            if ((i % skip) == 0)
+            {
+                if (f < nf && clcenter[f] > 0)
+                {
+                    if (bPBC)
+                    {
+                        gmx_rmpbc(gpbc, natoms_trx, box, x);
+                    }
+                    cl = clcenter[f] - 1;
+                    snew(xcl[cl], natom);
+                    for (j = 0; j < natom; j++)
+                    {
+                        copy_rvec(x[index[j]], xcl[cl][j]);
+                    }
+                }
+                f++;
+            }
+            i++;
+        }
+        while (read_next_x(oenv, status, &t, x, box));
+        close_trx(status);
+        sfree(x);
+        if (f != nf)
+        {
+            gmx_fatal(FARGS, "The number of frames in %s changed from %d to %d",
+                      trjfn, nf, f);
+        }
+
+        /* Orient the clusters on the reference structure */
+        if (bFit)
+        {
+            reset_x(ifsize, fitidx, natom, nullptr, xtps, mass);
+        }
+        clear_mat(zerobox);
+        trxout = open_trx(trxfn, "w");
+        for (cl = 0; cl < clust->ncl; cl++)
+        {
+            if (bFit)
+            {
+                reset_x(ifsize, fitidx, natom, nullptr, xcl[cl], mass);
+                do_fit(natom, mass, xtps, xcl[cl]);
+            }
+            write_trx(trxout, iosize, outidx, atoms, cl + 1, time[center[cl]], zerobox,
+                      xcl[cl], nullptr, nullptr);
+            sfree(xcl[cl]);
+        }
+        close_trx(trxout);
+        sfree(xcl);
+        sfree(clcenter);
+    }
+}
+
 static void convert_mat(t_matrix *mat, t_mat *rms)
 {
     int i, j;
@@ -1323,7 +1684,26 @@ int gmx_cluster(int argc, char *argv[])
         "Distances between structures can be determined from a trajectory",
         "or read from an [REF].xpm[ref] matrix file with the [TT]-dm[tt] option.",
         "RMS deviation after fitting or RMS deviation of atom-pair distances",
-        "can be used to define the distance between structures.[PAR]",
+        "can be used to define the distance between structures.",
+        "The matrix is computed in parallel using the OpenMP threads",
+        "set by the [TT]OMP_NUM_THREADS[tt] environment variable.",
+        "To reuse the matrix without the loss of resolution of the",
+        "[REF].xpm[ref] levels, it can be written to a binary file with",
+        "[TT]-omb[tt] and read back with [TT]-dmb[tt].[PAR]",
+
+        "For trajectories too long to store the full matrix, [TT]-sparse[tt]",
+        "clusters with the single linkage or gromos method using only the",
+        "pairs of structures within [TT]-cutoff[tt]. The fit group coordinates",
+        "of the frames are stored while reading the trajectory. The RMSD to",
+        "[TT]-npivot[tt] reference structures bounds the RMSD of each pair",
+        "through the triangle inequality, so most pairs that are far apart",
+        "are never computed. The matrix output files are not written",
+        "and [TT]-cl[tt] writes the central structure of each cluster.",
+        "Since the average RMSD within clusters is not computed, this is",
+        "not the member with the smallest average RMSD to the others, as",
+        "without [TT]-sparse[tt], but the member with the most neighbors.",
+        "For gromos this is the structure the cluster is formed around,",
+        "for single linkage the member with most neighbors overall.[PAR]",
 
         "single linkage: add a structure to a cluster when its distance to any",
         "element of the cluster is less than [TT]cutoff[tt].[PAR]",
@@ -1377,6 +1757,7 @@ int gmx_cluster(int argc, char *argv[])
         "Additionally, a number of optional output files can be written:",
         "",
         " * [TT]-dist[tt] writes the RMSD distribution.",
+        " * [TT]-omb[tt] writes the RMSD matrix in single precision binary format.",
         " * [TT]-ev[tt] writes the eigenvectors of the RMSD matrix",
         "   diagonalization.",
         " * [TT]-sz[tt] writes the cluster sizes.",
@@ -1395,13 +1776,13 @@ int gmx_cluster(int argc, char *argv[])
 
     FILE              *fp, *log;
     int                nf, i, i1, i2, j;
-    gmx_int64_t        nrms = 0;
 
     matrix             box;
-    rvec              *xtps, *usextps, *x1, **xx = nullptr;
+    rvec              *xtps, *usextps, **xx = nullptr;
     const char        *fn, *trx_out_fn;
     t_clusters         clust;
     t_mat             *rms, *orig = nullptr;
+    t_rmsd_frames     *frames;
     real              *eigenvalues;
     t_topology         top;
     int                ePBC;
@@ -1412,9 +1793,9 @@ int gmx_cluster(int argc, char *argv[])
     int                isize = 0, ifsize = 0, iosize = 0;
     int               *index = nullptr, *fitidx = nullptr, *outidx = nullptr;
     char              *grpname;
-    real               rmsd, **d1, **d2, *time = nullptr, time_invfac, *mass = nullptr;
+    real              *time = nullptr, time_invfac, *mass = nullptr;
     char               buf[STRLEN], buf1[80];
-    gmx_bool           bAnalyze, bUseRmsdCut, bJP_RMSD = FALSE, bReadMat, bReadTraj, bPBC = TRUE;
+    gmx_bool           bAnalyze, bUseRmsdCut, bJP_RMSD = FALSE, bReadMat, bReadBinMat, bReadTraj, bPBC = TRUE;
 
     int                method, ncluster = 0;
     static const char *methodname[] = {
@@ -1433,6 +1814,8 @@ int gmx_cluster(int argc, char *argv[])
     static int        nlevels  = 40, skip = 1;
     static real       scalemax = -1.0, rmsdcut = 0.1, rmsmin = 0.0;
     gmx_bool          bRMSdist = FALSE, bBinary = FALSE, bAverage = FALSE, bFit = TRUE;
+    gmx_bool          bSparse  = FALSE;
+    static int        npivot   = 16;
     static int        niter    = 10000, nrandom = 0, seed = 0, write_ncl = 0, write_nst = 1, minstruct = 1;
     static real       kT       = 1e-3;
     static int        M        = 10, P = 3;
@@ -1482,7 +1865,11 @@ int gmx_cluster(int argc, char *argv[])
           "Boltzmann weighting factor for Monte Carlo optimization "
           "(zero turns off uphill steps)" },
         { "-pbc", FALSE, etBOOL,
-          { &bPBC }, "PBC check" }
+          { &bPBC }, "PBC check" },
+        { "-sparse", FALSE, etBOOL, {&bSparse},
+          "Cluster using a neighbor list instead of the full RMSD matrix" },
+        { "-npivot", FALSE, etINT, {&npivot},
+          "Number of reference structures for pruning the neighbor search with [TT]-sparse[tt]" }
     };
     t_filenm          fnm[] = {
         { efTRX, "-f",     nullptr,        ffOPTRD },
@@ -1490,6 +1877,8 @@ int gmx_cluster(int argc, char *argv[])
         { efNDX, nullptr,     nullptr,        ffOPTRD },
         { efXPM, "-dm",   "rmsd",       ffOPTRD },
         { efXPM, "-om",   "rmsd-raw",   ffWRITE },
+        { efDAT, "-dmb",  "rmsd",       ffOPTRD },
+        { efDAT, "-omb",  "rmsd-raw",   ffOPTWR },
         { efXPM, "-o",    "rmsd-clust", ffWRITE },
         { efLOG, "-g",    "cluster",    ffWRITE },
         { efXVG, "-dist", "rmsd-dist",  ffOPTWR },
@@ -1512,8 +1901,13 @@ int gmx_cluster(int argc, char *argv[])
     }
 
     /* parse options */
-    bReadMat   = opt2bSet("-dm", NFILE, fnm);
-    bReadTraj  = opt2bSet("-f", NFILE, fnm) || !bReadMat;
+    bReadBinMat = opt2bSet("-dmb", NFILE, fnm);
+    bReadMat    = opt2bSet("-dm", NFILE, fnm) || bReadBinMat;
+    if (bReadBinMat && opt2bSet("-dm", NFILE, fnm))
+    {
+        gmx_fatal(FARGS, "Options -dm and -dmb can not be used together");
+    }
+    bReadTraj   = opt2bSet("-f", NFILE, fnm) || !bReadMat;
     if (opt2parg_bSet("-av", asize(pa), pa) ||
         opt2parg_bSet("-wcl", asize(pa), pa) ||
         opt2parg_bSet("-nst", asize(pa), pa) ||
@@ -1526,7 +1920,7 @@ int gmx_cluster(int argc, char *argv[])
     {
         trx_out_fn = nullptr;
     }
-    if (bReadMat && output_env_get_time_factor(oenv) != 1)
+    if (bReadMat && !bReadBinMat && output_env_get_time_factor(oenv) != 1)
     {
         fprintf(stderr,
                 "\nWarning: assuming the time unit in %s is %s\n",
@@ -1607,6 +2001,21 @@ int gmx_cluster(int argc, char *argv[])
     {
         gmx_fatal(FARGS, "skip (%d) should be >= 1", skip);
     }
+    if (bSparse)
+    {
+        if (method != m_linkage && method != m_gromos)
+        {
+            gmx_fatal(FARGS, "Option -sparse only supports the linkage and gromos methods");
+        }
+        if (bReadMat || bRMSdist || bAverage || write_ncl > 0)
+        {
+            gmx_fatal(FARGS, "Option -sparse can not be combined with -dm, -dmb, -dista, -av or -wcl");
+        }
+        if (npivot < 1)
+        {
+            gmx_fatal(FARGS, "npivot (%d) should be >= 1", npivot);
+        }
+    }
 
     /* get input */
     if (bReadTraj)
@@ -1668,6 +2077,76 @@ int gmx_cluster(int argc, char *argv[])
         }
     }
 
+    if (bSparse)
+    {
+        t_rmsd_frames    *frames;
+        t_rmsd_neighbors *nbl;
+        real             *fitmass;
+        int              *fitatoms, *center;
+
+        /* Store only the fit group, weighted with the masses */
+        snew(fitatoms, ifsize);
+        snew(fitmass, ifsize);
+        snew(mass, isize);
+        for (i = 0; i < ifsize; i++)
+        {
+            fitatoms[i]     = index[fitidx[i]];
+            fitmass[i]      = top.atoms.atom[fitatoms[i]].m;
+            mass[fitidx[i]] = fitmass[i];
+        }
+        fn     = opt2fn("-f", NFILE, fnm);
+        frames = read_rmsd_frames(fn, ifsize, fitatoms, fitmass, bFit, skip,
+                                  &time, oenv, bPBC, gpbc);
+        nf     = frames->nframes;
+        output_env_conv_times(oenv, nf, time);
+        sfree(fitmass);
+        sfree(fitatoms);
+
+        fprintf(stderr, "Searching pairs of %d structures with RMSD below %g nm\n",
+                nf, rmsdcut);
+        nbl = calc_rmsd_neighbors(frames, bFit, rmsdcut, npivot);
+        done_rmsd_frames(&frames);
+        ffprintf_d(stderr, log, buf, "Number of structures %d\n", nf);
+        sprintf(buf, "Found %" GMX_PRId64 " pairs of structures within the cutoff\n",
+                nbl->index[nf]/2);
+        ffprintf(stderr, log, buf);
+
+        snew(clust.cl, nf);
+        snew(center, nf);
+        if (method == m_gromos)
+        {
+            gromos_sparse(nbl, &clust, center);
+        }
+        else
+        {
+            linkage_sparse(nbl, &clust, center);
+        }
+        done_rmsd_neighbors(&nbl);
+
+        usextps = make_useatoms(&top.atoms, xtps, isize, index, &useatoms);
+        analyze_sparse_clusters(nf, &clust, center, fn, skip, isize, index,
+                                &useatoms, usextps, mass, time,
+                                ifsize, fitidx, iosize, outidx, trx_out_fn,
+                                opt2fn_null("-sz", NFILE, fnm),
+                                opt2fn_null("-tr", NFILE, fnm),
+                                opt2fn_null("-ntr", NFILE, fnm),
+                                opt2fn_null("-clid", NFILE, fnm),
+                                bFit, bPBC, gpbc, log, rlo_bot, rhi_bot, oenv);
+        if (bPBC)
+        {
+            gmx_rmpbc_done(gpbc);
+        }
+        sfree(center);
+        gmx_ffclose(log);
+
+        do_view(oenv, opt2fn_null("-sz", NFILE, fnm), "-nxy");
+        do_view(oenv, opt2fn_null("-tr", NFILE, fnm), "-nxy");
+        do_view(oenv, opt2fn_null("-ntr", NFILE, fnm), "-nxy");
+        do_view(oenv, opt2fn_null("-clid", NFILE, fnm), "-nxy");
+
+        return 0;
+    }
+
     if (bReadTraj)
     {
         /* Loop over first coordinate file */
@@ -1697,7 +2176,27 @@ int gmx_cluster(int argc, char *argv[])
         }
     }
 
-    if (bReadMat)
+    if (bReadBinMat)
+    {
+        fprintf(stderr, "Reading binary rms distance matrix\n");
+        rms = read_mat_binary(opt2fn("-dmb", NFILE, fnm), method == m_diagonalize);
+        if (bReadTraj && rms->nn != nf)
+        {
+            gmx_fatal(FARGS, "Matrix size (%dx%d) does not match the number of "
+                      "frames (%d)", rms->nn, rms->nn, nf);
+        }
+        if (!bReadTraj)
+        {
+            /* Without trajectory we only know the frame numbers */
+            nf = rms->nn;
+            snew(time, nf);
+            for (i = 0; i < nf; i++)
+            {
+                time[i] = i;
+            }
+        }
+    }
+    else if (bReadMat)
     {
         fprintf(stderr, "Reading rms distance matrix ");
         read_xpm_matrix(opt2fn("-dm", NFILE, fnm), &readmat);
@@ -1730,67 +2229,66 @@ int gmx_cluster(int argc, char *argv[])
     else   /* !bReadMat */
     {
         rms  = init_mat(nf, method == m_diagonalize);
-        nrms = (static_cast<gmx_int64_t>(nf)*static_cast<gmx_int64_t>(nf-1))/2;
         if (!bRMSdist)
         {
             fprintf(stderr, "Computing %dx%d RMS deviation matrix\n", nf, nf);
-            /* Initialize work array */
-            snew(x1, isize);
-            for (i1 = 0; i1 < nf; i1++)
-            {
-                for (i2 = i1+1; i2 < nf; i2++)
-                {
-                    for (i = 0; i < isize; i++)
-                    {
-                        copy_rvec(xx[i1][i], x1[i]);
-                    }
-                    if (bFit)
-                    {
-                        do_fit(isize, mass, xx[i2], x1);
-                    }
-                    rmsd = rmsdev(isize, mass, xx[i2], x1);
-                    set_mat_entry(rms, i1, i2, rmsd);
-                }
-                nrms -= nf-i1-1;
-                fprintf(stderr, "\r# RMSD calculations left: " "%" GMX_PRId64 "   ", nrms);
-                fflush(stderr);
-            }
-            sfree(x1);
+            /* The frames have been centered on the fit group, which is
+             * also the only group with non-zero weights.
+             */
+            frames = init_rmsd_frames(nf, xx, isize, mass, bFit);
+            calc_rmsd_matrix(frames, nullptr, bFit, rms->mat);
+            done_rmsd_frames(&frames);
         }
         else /* bRMSdist */
         {
             fprintf(stderr, "Computing %dx%d RMS distance deviation matrix\n", nf, nf);
 
-            /* Initiate work arrays */
-            snew(d1, isize);
-            snew(d2, isize);
-            for (i = 0; (i < isize); i++)
-            {
-                snew(d1[i], isize);
-                snew(d2[i], isize);
-            }
-            for (i1 = 0; i1 < nf; i1++)
+#pragma omp parallel
             {
-                calc_dist(isize, xx[i1], d1);
-                for (i2 = i1+1; (i2 < nf); i2++)
+                real **d1, **d2;
+
+                /* Initiate thread-local work arrays */
+                snew(d1, isize);
+                snew(d2, isize);
+                for (int i = 0; (i < isize); i++)
+                {
+                    snew(d1[i], isize);
+                    snew(d2[i], isize);
+                }
+#pragma omp for schedule(dynamic)
+                for (int i1 = 0; i1 < nf; i1++)
+                {
+                    calc_dist(isize, xx[i1], d1);
+                    for (int i2 = i1+1; (i2 < nf); i2++)
+                    {
+                        calc_dist(isize, xx[i2], d2);
+                        rms->mat[i1][i2] = rms_dist(isize, d1, d2);
+                    }
+                }
+                /* Clean up work arrays */
+                for (int i = 0; (i < isize); i++)
                 {
-                    calc_dist(isize, xx[i2], d2);
-                    set_mat_entry(rms, i1, i2, rms_dist(isize, d1, d2));
+                    sfree(d1[i]);
+                    sfree(d2[i]);
                 }
-                nrms -= nf-i1-1;
-                fprintf(stderr, "\r# RMSD calculations left: " "%" GMX_PRId64 "   ", nrms);
-                fflush(stderr);
+                sfree(d1);
+                sfree(d2);
             }
-            /* Clean up work arrays */
-            for (i = 0; (i < isize); i++)
+        }
+        /* Set the lower half and collect the statistics */
+        for (i1 = 0; i1 < nf; i1++)
+        {
+            for (i2 = i1+1; i2 < nf; i2++)
             {
-                sfree(d1[i]);
-                sfree(d2[i]);
+                set_mat_entry(rms, i1, i2, rms->mat[i1][i2]);
             }
-            sfree(d1);
-            sfree(d2);
         }
-        fprintf(stderr, "\n\n");
+        rms->nn = nf;
+        fprintf(stderr, "\n");
+    }
+    if (opt2bSet("-omb", NFILE, fnm))
+    {
+        write_mat_binary(opt2fn("-omb", NFILE, fnm), rms);
     }
     ffprintf_gg(stderr, log, buf, "The RMSD ranges from %g to %g nm\n",
                 rms->minrms, rms->maxrms);
@@ -1890,17 +2388,7 @@ int gmx_cluster(int argc, char *argv[])
         {
             mark_clusters(nf, rms->mat, rms->maxrms, &clust);
         }
-        init_t_atoms(&useatoms, isize, FALSE);
-        snew(usextps, isize);
-        useatoms.resinfo = top.atoms.resinfo;
-        for (i = 0; i < isize; i++)
-        {
-            useatoms.atomname[i]    = top.atoms.atomname[index[i]];
-            useatoms.atom[i].resind = top.atoms.atom[index[i]].resind;
-            useatoms.nres           = std::max(useatoms.nres, useatoms.atom[i].resind+1);
-            copy_rvec(xtps[index[i]], usextps[i]);
-        }
-        useatoms.nr = isize;
+        usextps = make_useatoms(&top.atoms, xtps, isize, index, &useatoms);
         analyze_clusters(nf, &clust, rms->mat, isize, &useatoms, usextps, mass, xx, time,
                          ifsize, fitidx, iosize, outidx,
                          bReadTraj ? trx_out_fn : nullptr,
@@ -1930,7 +2418,7 @@ int gmx_cluster(int argc, char *argv[])
 
     fp = opt2FILE("-o", NFILE, fnm, "w");
     fprintf(stderr, "Writing rms distance/clustering matrix ");
-    if (bReadMat)
+    if (bReadMat && !bReadBinMat)
     {
         write_xpm(fp, 0, readmat[0].title, readmat[0].legend, readmat[0].label_x,
                   readmat[0].label_y, nf, nf, readmat[0].axis_x, readmat[0].axis_y,
@@ -37,10 +37,15 @@
 #include "gmxpre.h"
 
 #include <cmath>
+#include <cstdio>
 #include <cstring>
 
+#include <algorithm>
+#include <vector>
+
 #include "gromacs/commandline/pargs.h"
 #include "gromacs/commandline/viewit.h"
+#include "gromacs/correlationfunctions/manyautocorrelation.h"
 #include "gromacs/fileio/confio.h"
 #include "gromacs/fileio/trxio.h"
 #include "gromacs/fileio/xvgr.h"
@@ -94,6 +99,14 @@ typedef struct {
     int          *n_offs;
     int         **ndata;      /* the number of msds (particles/mols) per data
                                  point. */
+    gmx_bool      bFFT;       /* use all frames as origins, computed with FFTs */
+    int           fft_nx;     /* the number of unwrapped coordinates stored
+                                 per frame with bFFT */
+    rvec         *fft_x;      /* the stored coordinates, frame after frame */
+    int           fft_nalloc; /* the number of frames allocated in fft_x */
+    FILE         *fft_tmp;    /* temporary file holding the coordinates
+                                 when they do not fit in fft_maxmem */
+    gmx_off_t     fft_maxmem; /* the memory (bytes) to use with bFFT */
 } t_corr;
 
 typedef real t_calc_func (t_corr *curr, int nx, int index[], int nx0, rvec xc[],
@@ -111,7 +124,7 @@ static gmx_bool in_data(t_corr *curr, int nx00)
 
 t_corr *init_corr(int nrgrp, int type, int axis, real dim_factor,
                   int nmol, gmx_bool bTen, gmx_bool bMass, real dt, const t_topology *top,
-                  real beginfit, real endfit)
+                  real beginfit, real endfit, gmx_bool bFFT, real maxmem)
 {
     t_corr  *curr;
     int      i;
@@ -129,6 +142,8 @@ t_corr *init_corr(int nrgrp, int type, int axis, real dim_factor,
     curr->nframes    = 0;
     curr->nlast      = 0;
     curr->dim_factor = dim_factor;
+    curr->bFFT       = bFFT;
+    curr->fft_maxmem = static_cast<gmx_off_t>(maxmem*1024*1024);
 
     snew(curr->ndata, nrgrp);
     snew(curr->data, nrgrp);
@@ -631,6 +646,222 @@ static void printmol(t_corr *curr, const char *fn,
     }
 }
 
+/* with -fft: append the unwrapped coordinates of all groups for this frame,
+   in memory as long as they fit in fft_maxmem, otherwise in a temporary file */
+static void fft_store_frame(t_corr *curr, int gnx[], int *index[], rvec xc[],
+                            gmx_bool bRmCOMM, rvec com)
+{
+    rvec *row;
+    int   g, i, n;
+
+    if (curr->fft_tmp == nullptr &&
+        static_cast<gmx_off_t>(curr->nframes + 1)*curr->fft_nx*static_cast<gmx_off_t>(sizeof(rvec)) > curr->fft_maxmem)
+    {
+        fprintf(stderr, "\nThe coordinates do not fit in %g MB, storing them in a temporary file\n",
+                curr->fft_maxmem/(1024.0*1024.0));
+        curr->fft_tmp = std::tmpfile();
+        if (curr->fft_tmp == nullptr)
+        {
+            gmx_fatal(FARGS, "Could not open a temporary file for the coordinates");
+        }
+        n = curr->nframes*curr->fft_nx;
+        if (static_cast<int>(std::fwrite(curr->fft_x, sizeof(rvec), n, curr->fft_tmp)) != n)
+        {
+            gmx_fatal(FARGS, "Could not write the coordinates to a temporary file");
+        }
+        /* From now on fft_x only holds the current frame */
+        curr->fft_nalloc = 1;
+        srenew(curr->fft_x, curr->fft_nx);
+    }
+    if (curr->fft_tmp == nullptr)
+    {
+        if (curr->nframes >= curr->fft_nalloc)
+        {
+            /* do not over-allocate beyond fft_maxmem */
+            curr->fft_nalloc = static_cast<int>(std::min<gmx_off_t>(over_alloc_large(curr->nframes + 1),
+                                                                    curr->fft_maxmem/(curr->fft_nx*sizeof(rvec))));
+            srenew(curr->fft_x, curr->fft_nalloc*curr->fft_nx);
+        }
+        row = curr->fft_x + curr->nframes*curr->fft_nx;
+    }
+    else
+    {
+        row = curr->fft_x;
+    }
+
+    n = 0;
+    for (g = 0; g < curr->ngrp; g++)
+    {
+        for (i = 0; i < gnx[g]; i++)
+        {
+            if (bRmCOMM)
+            {
+                rvec_sub(xc[index[g][i]], com, row[n]);
+            }
+            else
+            {
+                copy_rvec(xc[index[g][i]], row[n]);
+            }
+            n++;
+        }
+    }
+
+    if (curr->fft_tmp != nullptr &&
+        static_cast<int>(std::fwrite(row, sizeof(rvec), n, curr->fft_tmp)) != n)
+    {
+        gmx_fatal(FARGS, "Could not write the coordinates to a temporary file");
+    }
+}
+
+/* with -fft: copy the stored coordinates c0 to c0+nc of all frames to x */
+static void fft_get_coords(t_corr *curr, int c0, int nc, rvec x[])
+{
+    int f;
+
+    for (f = 0; f < curr->nframes; f++)
+    {
+        if (curr->fft_tmp == nullptr)
+        {
+            std::memcpy(x[f*nc], curr->fft_x[f*curr->fft_nx + c0], nc*sizeof(rvec));
+        }
+        else
+        {
+            if (gmx_fseek(curr->fft_tmp, (static_cast<gmx_off_t>(f)*curr->fft_nx + c0)*sizeof(rvec), SEEK_SET) != 0 ||
+                static_cast<int>(std::fread(x[f*nc], sizeof(rvec), nc, curr->fft_tmp)) != nc)
+            {
+                gmx_fatal(FARGS, "Could not read the coordinates from the temporary file");
+            }
+        }
+    }
+}
+
+/* returns whether n only has prime factors 2, 3, 5 and 7 */
+static gmx_bool fft_size_ok(int n)
+{
+    const int factor[] = { 2, 3, 5, 7 };
+
+    for (int p : factor)
+    {
+        while (n % p == 0)
+        {
+            n /= p;
+        }
+    }
+
+    return n == 1;
+}
+
+/* with -fft: compute the msd of each group using all frames as origins.
+   For each coordinate the sum over origins k of (x[k+m] - x[k])^2 is
+   sum_k x[k]^2 + x[k+m]^2, which follows from a running sum,
+   minus twice the autocorrelation of x, which is computed with FFTs. */
+static void calc_corr_fft(t_corr *curr, int gnx[], int *index[])
+{
+    int                             dims[DIM], ndim, nframes, npad, nblock;
+    int                             c0, g, b0, nb, i, d, s, m;
+    real                            w;
+    double                          wtot, q, mean;
+    gmx_off_t                       stored;
+    rvec                           *x;
+    std::vector<double>             acc;
+    std::vector<std::vector<real> > c;
+
+    ndim = 0;
+    for (d = 0; d < DIM; d++)
+    {
+        if ((curr->type == NORMAL) ||
+            (curr->type == LATERAL && d != curr->axis) ||
+            (curr->type == X + d))
+        {
+            dims[ndim++] = d;
+        }
+    }
+
+    /* many_auto_correl pads to 3/2 of the length we pass, which must
+       be at least twice the number of frames to avoid periodic images */
+    nframes = curr->nframes;
+    npad    = 2*((4*nframes + 5)/6);
+    while (!fft_size_ok(3*npad/2 + 1))
+    {
+        npad += 2;
+    }
+
+    /* the number of coordinates processed at once, fft_x is still
+       allocated so only the rest of fft_maxmem is available for them */
+    stored = static_cast<gmx_off_t>(curr->fft_nalloc)*curr->fft_nx*sizeof(rvec);
+    nblock = static_cast<int>(std::max(curr->fft_maxmem - stored, static_cast<gmx_off_t>(0))/
+                              (nframes*sizeof(rvec) + ndim*(3*npad/2 + 1)*sizeof(real)));
+    nblock = std::max(1, nblock);
+    snew(x, std::min(nblock, curr->fft_nx)*nframes);
+    acc.resize(nframes);
+
+    c0 = 0;
+    for (g = 0; g < curr->ngrp; g++)
+    {
+        std::fill(acc.begin(), acc.end(), 0.0);
+        wtot = 0;
+        for (b0 = 0; b0 < gnx[g]; b0 += nblock)
+        {
+            nb = std::min(nblock, gnx[g] - b0);
+            fft_get_coords(curr, c0 + b0, nb, x);
+            c.resize(nb*ndim);
+            for (i = 0; i < nb; i++)
+            {
+                w     = (curr->mass != nullptr) ? curr->mass[index[g][b0 + i]] : 1;
+                wtot += w;
+                for (d = 0; d < ndim; d++)
+                {
+                    std::vector<real> &y = c[i*ndim + d];
+
+                    /* subtract the average for precision */
+                    mean = 0;
+                    for (m = 0; m < nframes; m++)
+                    {
+                        mean += x[m*nb + i][dims[d]];
+                    }
+                    mean /= nframes;
+                    y.assign(npad, 0);
+                    q = 0;
+                    for (m = 0; m < nframes; m++)
+                    {
+                        y[m] = x[m*nb + i][dims[d]] - mean;
+                        q   += 2*gmx::square(y[m]);
+                    }
+                    for (m = 0; m < nframes; m++)
+                    {
+                        if (m > 0)
+                        {
+                            q -= gmx::square(y[m - 1]) + gmx::square(y[nframes - m]);
+                        }
+                        acc[m] += w*q;
+                    }
+                }
+            }
+            many_auto_correl(&c);
+            for (i = 0; i < nb; i++)
+            {
+                w = (curr->mass != nullptr) ? curr->mass[index[g][b0 + i]] : 1;
+                for (d = 0; d < ndim; d++)
+                {
+                    s = i*ndim + d;
+                    for (m = 0; m < nframes; m++)
+                    {
+                        acc[m] -= 2*w*c[s][m];
+                    }
+                }
+            }
+        }
+        /* do_corr divides by the number of origins */
+        for (m = 0; m < nframes; m++)
+        {
+            curr->data[g][m]  = acc[m]/wtot;
+            curr->ndata[g][m] = nframes - m;
+        }
+        c0 += gnx[g];
+    }
+    sfree(x);
+}
+
 /* this is the main loop for the correlation type functions
  * fx and nx are file pointers to things like read_first_x and
  * read_next_x
@@ -688,6 +919,15 @@ int corr_loop(t_corr *curr, const char *fn, const t_topology *top, int ePBC,
         gpbc = gmx_rmpbc_init(&top->idef, ePBC, natoms);
     }
 
+    if (curr->bFFT)
+    {
+        curr->fft_nx = 0;
+        for (i = 0; i < curr->ngrp; i++)
+        {
+            curr->fft_nx += gnx[i];
+        }
+    }
+
     /* the loop over all frames */
     do
     {
@@ -709,7 +949,7 @@ int corr_loop(t_corr *curr, const char *fn, const t_topology *top, int ePBC,
 
 
         /* check whether we've reached a restart point */
-        if (bRmod(t, curr->t0, dt))
+        if (!curr->bFFT && bRmod(t, curr->t0, dt))
         {
             curr->nrestart++;
 
@@ -804,12 +1044,19 @@ int corr_loop(t_corr *curr, const char *fn, const t_topology *top, int ePBC,
                      &top->atoms, com);
         }
 
-        /* loop over all groups in index file */
-        for (i = 0; (i < curr->ngrp); i++)
+        if (curr->bFFT)
         {
-            /* calculate something useful, like mean square displacements */
-            calc_corr(curr, i, gnx[i], index[i], xa[cur], (gnx_com != nullptr), com,
-                      calc1, bTen);
+            fft_store_frame(curr, gnx, index, xa[cur], (gnx_com != nullptr), com);
+        }
+        else
+        {
+            /* loop over all groups in index file */
+            for (i = 0; (i < curr->ngrp); i++)
+            {
+                /* calculate something useful, like mean square displacements */
+                calc_corr(curr, i, gnx[i], index[i], xa[cur], (gnx_com != nullptr), com,
+                          calc1, bTen);
+            }
         }
         cur    = prev;
         t_prev = t;
@@ -817,11 +1064,29 @@ int corr_loop(t_corr *curr, const char *fn, const t_topology *top, int ePBC,
         curr->nframes++;
     }
     while (read_next_x(oenv, status, &t, x[cur], box));
-    fprintf(stderr, "\nUsed %d restart points spaced %g %s over %g %s\n\n",
-            curr->nrestart,
-            output_env_conv_time(oenv, dt), output_env_get_time_unit(oenv).c_str(),
-            output_env_conv_time(oenv, curr->time[curr->nframes-1]),
-            output_env_get_time_unit(oenv).c_str() );
+    if (curr->bFFT)
+    {
+        curr->nrestart = curr->nframes;
+        fprintf(stderr, "\nUsed all %d frames as restart points over %g %s\n\n",
+                curr->nrestart,
+                output_env_conv_time(oenv, curr->time[curr->nframes-1]),
+                output_env_get_time_unit(oenv).c_str() );
+        calc_corr_fft(curr, gnx, index);
+        if (curr->fft_tmp != nullptr)
+        {
+            std::fclose(curr->fft_tmp);
+            curr->fft_tmp = nullptr;
+        }
+        sfree(curr->fft_x);
+    }
+    else
+    {
+        fprintf(stderr, "\nUsed %d restart points spaced %g %s over %g %s\n\n",
+                curr->nrestart,
+                output_env_conv_time(oenv, dt), output_env_get_time_unit(oenv).c_str(),
+                output_env_conv_time(oenv, curr->time[curr->nframes-1]),
+                output_env_get_time_unit(oenv).c_str() );
+    }
 
     if (bMol)
     {
@@ -872,7 +1137,8 @@ void do_corr(const char *trx_file, const char *ndx_file, const char *msd_file,
              int nrgrp, t_topology *top, int ePBC,
              gmx_bool bTen, gmx_bool bMW, gmx_bool bRmCOMM,
              int type, real dim_factor, int axis,
-             real dt, real beginfit, real endfit, const gmx_output_env_t *oenv)
+             real dt, real beginfit, real endfit, gmx_bool bFFT, real maxmem,
+             const gmx_output_env_t *oenv)
 {
     t_corr        *msd;
     int           *gnx;   /* the selected groups' sizes */
@@ -910,7 +1176,7 @@ void do_corr(const char *trx_file, const char *ndx_file, const char *msd_file,
 
     msd = init_corr(nrgrp, type, axis, dim_factor,
                     mol_file == nullptr ? 0 : gnx[0], bTen, bMW, dt, top,
-                    beginfit, endfit);
+                    beginfit, endfit, bFFT, maxmem);
 
     nat_trx =
         corr_loop(msd, trx_file, top, ePBC, mol_file ? gnx[0] : 0, gnx, index,
@@ -1067,7 +1333,17 @@ int gmx_msd(int argc, char *argv[])
         "Option [TT]-pdb[tt] writes a [REF].pdb[ref] file with the coordinates of the frame",
         "at time [TT]-tpdb[tt] with in the B-factor field the square root of",
         "the diffusion coefficient of the molecule.",
-        "This option implies option [TT]-mol[tt]."
+        "This option implies option [TT]-mol[tt].[PAR]",
+        "With [TT]-fft[tt] every frame is used as a reference point and",
+        "the MSD is computed from autocorrelations with fast Fourier",
+        "transforms, [TT]-trestart[tt] is then not used. The cost grows as",
+        "N log N with the number of frames N instead of the number of frames",
+        "times the number of reference points. The frames should be equally",
+        "spaced in time. The unwrapped coordinates are kept in memory up",
+        "to [TT]-maxmem[tt] MB, beyond that they are stored in a temporary",
+        "file. The memory that is left is used for processing the",
+        "coordinates in blocks of atoms. This option can not be",
+        "combined with [TT]-mol[tt] or [TT]-ten[tt]."
     };
     static const char *normtype[] = { nullptr, "no", "x", "y", "z", nullptr };
     static const char *axtitle[]  = { nullptr, "no", "x", "y", "z", nullptr };
@@ -1079,6 +1355,8 @@ int gmx_msd(int argc, char *argv[])
     static gmx_bool    bTen       = FALSE;
     static gmx_bool    bMW        = TRUE;
     static gmx_bool    bRmCOMM    = FALSE;
+    static gmx_bool    bFFT       = FALSE;
+    static real        maxmem     = 1024;
     t_pargs            pa[]       = {
         { "-type",    FALSE, etENUM, {normtype},
           "Compute diffusion coefficient in one direction" },
@@ -1099,7 +1377,11 @@ int gmx_msd(int argc, char *argv[])
         { "-beginfit", FALSE, etTIME, {&beginfit},
           "Start time for fitting the MSD (%t), -1 is 10%" },
         { "-endfit", FALSE, etTIME, {&endfit},
-          "End time for fitting the MSD (%t), -1 is 90%" }
+          "End time for fitting the MSD (%t), -1 is 90%" },
+        { "-fft", FALSE, etBOOL, {&bFFT},
+          "Use all frames as reference points, computed with FFTs" },
+        { "-maxmem", FALSE, etREAL, {&maxmem},
+          "Memory (MB) for the coordinates with [TT]-fft[tt]" }
     };
 
     t_filenm           fnm[] = {
@@ -1187,6 +1469,10 @@ int gmx_msd(int argc, char *argv[])
     {
         gmx_fatal(FARGS, "Can only calculate the full tensor for 3D msd");
     }
+    if (bFFT && (mol_file || bTen))
+    {
+        gmx_fatal(FARGS, "Option -fft can not be combined with -mol or -ten");
+    }
 
     bTop = read_tps_conf(tps_file, &top, &ePBC, &xdum, nullptr, box, bMW || bRmCOMM);
     if (mol_file && !bTop)
@@ -1198,7 +1484,7 @@ int gmx_msd(int argc, char *argv[])
 
     do_corr(trx_file, ndx_file, msd_file, mol_file, pdb_file, t_pdb, ngroup,
             &top, ePBC, bTen, bMW, bRmCOMM, type, dim_factor, axis, dt, beginfit, endfit,
-            oenv);
+            bFFT, maxmem, oenv);
 
     view_all(oenv, NFILE, fnm);
 
@@ -50,6 +50,7 @@
 #include "gromacs/gmxana/cmat.h"
 #include "gromacs/gmxana/gmx_ana.h"
 #include "gromacs/gmxana/princ.h"
+#include "gromacs/gmxana/rmsdmatrix.h"
 #include "gromacs/math/do_fit.h"
 #include "gromacs/math/functions.h"
 #include "gromacs/math/utilities.h"
@@ -222,26 +223,25 @@ int gmx_rms(int argc, char *argv[])
           "HIDDENAverage over this distance in the RMSD matrix" }
     };
     int             natoms_trx, natoms_trx2, natoms;
-    int             i, j, k, m, teller, teller2, tel_mat, tel_mat2;
+    int             i, j, k, teller, teller2, tel_mat, tel_mat2;
 #define NFRAME 5000
     int             maxframe = NFRAME, maxframe2 = NFRAME;
     real            t, *w_rls, *w_rms, *w_rls_m = nullptr, *w_rms_m = nullptr;
     gmx_bool        bNorm, bAv, bFreq2, bFile2, bMat, bBond, bDelta, bMirror, bMass;
-    gmx_bool        bFit, bReset;
+    gmx_bool        bFit, bReset, bQCP;
     t_topology      top;
     int             ePBC;
     t_iatom        *iatom = nullptr;
 
     matrix          box = {{0}};
-    rvec           *x, *xp, *xm = nullptr, **mat_x = nullptr, **mat_x2, *mat_x2_j = nullptr, vec1,
-                    vec2;
+    rvec           *x, *xp, *xm = nullptr, **mat_x = nullptr, **mat_x2;
     t_trxstatus    *status;
     char            buf[256], buf2[256];
     int             ncons = 0;
     FILE           *fp;
     real            rlstot = 0, **rls, **rlsm = nullptr, *time, *time2, *rlsnorm = nullptr,
     **rmsd_mat             = nullptr, **bond_mat = nullptr, *axis, *axis2, *del_xaxis,
-    *del_yaxis, rmsd_max, rmsd_min, rmsd_avg, bond_max, bond_min, ang;
+    *del_yaxis, rmsd_max, rmsd_min, rmsd_avg, bond_max, bond_min;
     real            **rmsdav_mat = nullptr, av_tot, weight, weight_tot;
     real            **delta      = nullptr, delta_max, delta_scalex = 0, delta_scaley = 0,
     *delta_tot;
@@ -862,15 +862,9 @@ int gmx_rms(int argc, char *argv[])
             }
         }
 
-        if (bFitAll)
-        {
-            snew(mat_x2_j, natoms);
-        }
         for (i = 0; i < tel_mat; i++)
         {
             axis[i] = time[freq*i];
-            fprintf(stderr, "\r element %5d; time %5.2f  ", i, axis[i]);
-            fflush(stderr);
             if (bMat)
             {
                 snew(rmsd_mat[i], tel_mat2);
@@ -879,27 +873,95 @@ int gmx_rms(int argc, char *argv[])
             {
                 snew(bond_mat[i], tel_mat2);
             }
-            for (j = 0; j < tel_mat2; j++)
+        }
+
+        /* When fit and RMSD use the same atoms with the same weights,
+         * the RMSD after fitting can be computed without rotating.
+         */
+        bQCP = (bMat && !bBond && bFitAll && ewhat == ewRMSD &&
+                ifit == n_ind_m && irms[0] == n_ind_m);
+        for (k = 0; k < n_ind_m && bQCP; k++)
+        {
+            bQCP = (w_rls_m[k] == w_rms_m[k]);
+        }
+        if (bQCP)
+        {
+            t_rmsd_frames *frames, *frames2 = nullptr;
+
+            frames = init_rmsd_frames(tel_mat, mat_x, n_ind_m, w_rls_m, TRUE);
+            if (bFile2)
+            {
+                frames2 = init_rmsd_frames(tel_mat2, mat_x2, n_ind_m, w_rls_m, TRUE);
+            }
+            calc_rmsd_matrix(frames, frames2, TRUE, rmsd_mat);
+            done_rmsd_frames(&frames);
+            if (frames2)
             {
+                done_rmsd_frames(&frames2);
+            }
+        }
+        else
+        {
+#pragma omp parallel
+            {
+                rvec *x2_j = nullptr;
+
                 if (bFitAll)
                 {
-                    for (k = 0; k < n_ind_m; k++)
-                    {
-                        copy_rvec(mat_x2[j][k], mat_x2_j[k]);
-                    }
-                    do_fit(n_ind_m, w_rls_m, mat_x[i], mat_x2_j);
+                    snew(x2_j, n_ind_m);
                 }
-                else
+#pragma omp for schedule(dynamic)
+                for (int i = 0; i < tel_mat; i++)
                 {
-                    mat_x2_j = mat_x2[j];
+                    for (int j = 0; j < tel_mat2; j++)
+                    {
+                        if (!(bMat && (bFile2 || i < j)) && !(bBond && (bFile2 || i <= j)))
+                        {
+                            continue;
+                        }
+                        if (bFitAll)
+                        {
+                            for (int k = 0; k < n_ind_m; k++)
+                            {
+                                copy_rvec(mat_x2[j][k], x2_j[k]);
+                            }
+                            do_fit(n_ind_m, w_rls_m, mat_x[i], x2_j);
+                        }
+                        rvec *mat_x2_j = (bFitAll ? x2_j : mat_x2[j]);
+                        if (bMat && (bFile2 || i < j))
+                        {
+                            rmsd_mat[i][j] =
+                                calc_similar_ind(ewhat != ewRMSD, irms[0], ind_rms_m,
+                                                 w_rms_m, mat_x[i], mat_x2_j);
+                        }
+                        if (bBond && (bFile2 || i <= j))
+                        {
+                            rvec vec1, vec2;
+                            real ang = 0.0;
+
+                            for (int m = 0; m < ibond; m++)
+                            {
+                                rvec_sub(mat_x[i][ind_bond1[m]], mat_x[i][ind_bond2[m]], vec1);
+                                rvec_sub(mat_x2_j[ind_bond1[m]], mat_x2_j[ind_bond2[m]], vec2);
+                                ang += std::acos(cos_angle(vec1, vec2));
+                            }
+                            bond_mat[i][j] = ang*180.0/(M_PI*ibond);
+                        }
+                    }
                 }
+                sfree(x2_j);
+            }
+        }
+
+        /* Fill the lower halves and collect the statistics */
+        for (i = 0; i < tel_mat; i++)
+        {
+            for (j = 0; j < tel_mat2; j++)
+            {
                 if (bMat)
                 {
                     if (bFile2 || (i < j))
                     {
-                        rmsd_mat[i][j] =
-                            calc_similar_ind(ewhat != ewRMSD, irms[0], ind_rms_m,
-                                             w_rms_m, mat_x[i], mat_x2_j);
                         if (rmsd_mat[i][j] > rmsd_max)
                         {
                             rmsd_max = rmsd_mat[i][j];
@@ -919,14 +981,6 @@ int gmx_rms(int argc, char *argv[])
                 {
                     if (bFile2 || (i <= j))
                     {
-                        ang = 0.0;
-                        for (m = 0; m < ibond; m++)
-                        {
-                            rvec_sub(mat_x[i][ind_bond1[m]], mat_x[i][ind_bond2[m]], vec1);
-                            rvec_sub(mat_x2_j[ind_bond1[m]], mat_x2_j[ind_bond2[m]], vec2);
-                            ang += std::acos(cos_angle(vec1, vec2));
-                        }
-                        bond_mat[i][j] = ang*180.0/(M_PI*ibond);
                         if (bond_mat[i][j] > bond_max)
                         {
                             bond_max = bond_mat[i][j];
@@ -1009,9 +1063,11 @@ int gmx_rms(int argc, char *argv[])
                         rmsd_min, rmsd_max);
             }
             sprintf(buf, "%s %s matrix", gn_rms[0], whatname[ewhat]);
-            write_xpm(opt2FILE("-m", NFILE, fnm, "w"), 0, buf, whatlabel[ewhat],
+            fp = opt2FILE("-m", NFILE, fnm, "w");
+            write_xpm(fp, 0, buf, whatlabel[ewhat],
                       output_env_get_time_label(oenv), output_env_get_time_label(oenv), tel_mat, tel_mat2,
                       axis, axis2, rmsd_mat, rmsd_min, rmsd_max, rlo, rhi, &nlevels);
+            gmx_ffclose(fp);
             /* Print the distribution of RMSD values */
             if (opt2bSet("-dist", NFILE, fnm))
             {
@@ -1108,9 +1164,11 @@ int gmx_rms(int argc, char *argv[])
             rlo.r = 1; rlo.g = 1; rlo.b = 1;
             rhi.r = 0; rhi.g = 0; rhi.b = 0;
             sprintf(buf, "%s av. bond angle deviation", gn_rms[0]);
-            write_xpm(opt2FILE("-bm", NFILE, fnm, "w"), 0, buf, "degrees",
+            fp = opt2FILE("-bm", NFILE, fnm, "w");
+            write_xpm(fp, 0, buf, "degrees",
                       output_env_get_time_label(oenv), output_env_get_time_label(oenv), tel_mat, tel_mat2,
                       axis, axis2, bond_mat, bond_min, bond_max, rlo, rhi, &nlevels);
+            gmx_ffclose(fp);
         }
     }
 
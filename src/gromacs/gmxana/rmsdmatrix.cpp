@@ -0,0 +1,607 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+#include "gmxpre.h"
+
+#include "rmsdmatrix.h"
+
+#include <cmath>
+
+#include <cstring>
+
+#include <algorithm>
+#include <vector>
+
+#include "gromacs/math/vec.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
+#include "gromacs/utility/smalloc.h"
+
+#if GMX_SIMD_HAVE_REAL
+static const int c_rmsdSimdWidth = GMX_SIMD_REAL_WIDTH;
+#else
+static const int c_rmsdSimdWidth = 1;
+#endif
+
+/* The RMSD after fitting follows from the difference between sums of
+ * squares and the inner products, which cancel for similar structures.
+ * Therefore we accumulate the inner products in double precision,
+ * using SIMD when single precision can be converted to double SIMD.
+ */
+#if GMX_SIMD_HAVE_REAL && GMX_SIMD_HAVE_DOUBLE && (GMX_DOUBLE || (GMX_SIMD_FLOAT_WIDTH == 2*GMX_SIMD_DOUBLE_WIDTH))
+#define GMX_RMSD_SIMD_INNER_PRODUCT
+#endif
+
+/* Size of the coordinates of a tile of frames, chosen such that
+ * the coordinates of two tiles fit in the L2 cache.
+ */
+static const size_t c_rmsdTileBytes = 128*1024;
+
+#ifdef GMX_RMSD_SIMD_INNER_PRODUCT
+/* Adds the products of one SIMD width of atoms to the inner product sums */
+static inline void gmx_simdcall
+add_inner_product(gmx::SimdDouble ax, gmx::SimdDouble ay, gmx::SimdDouble az,
+                  gmx::SimdDouble bx, gmx::SimdDouble by, gmx::SimdDouble bz,
+                  gmx::SimdDouble sum[DIM*DIM])
+{
+    sum[0] = gmx::fma(ax, bx, sum[0]);
+    sum[1] = gmx::fma(ax, by, sum[1]);
+    sum[2] = gmx::fma(ax, bz, sum[2]);
+    sum[3] = gmx::fma(ay, bx, sum[3]);
+    sum[4] = gmx::fma(ay, by, sum[4]);
+    sum[5] = gmx::fma(ay, bz, sum[5]);
+    sum[6] = gmx::fma(az, bx, sum[6]);
+    sum[7] = gmx::fma(az, by, sum[7]);
+    sum[8] = gmx::fma(az, bz, sum[8]);
+}
+#endif
+
+/* Computes the inner product matrix s = sum_i xa_i xb_i^T */
+static void calc_inner_product(int stride, const real *xa, const real *xb,
+                               double s[DIM][DIM])
+{
+#ifdef GMX_RMSD_SIMD_INNER_PRODUCT
+    gmx::SimdDouble sum[DIM*DIM];
+
+    for (int m = 0; m < DIM*DIM; m++)
+    {
+        sum[m] = gmx::setZero();
+    }
+    for (int i = 0; i < stride; i += GMX_SIMD_REAL_WIDTH)
+    {
+#if GMX_DOUBLE
+        add_inner_product(gmx::load(xa + i), gmx::load(xa + stride + i), gmx::load(xa + 2*stride + i),
+                          gmx::load(xb + i), gmx::load(xb + stride + i), gmx::load(xb + 2*stride + i),
+                          sum);
+#else
+        gmx::SimdDouble a[DIM][2], b[DIM][2];
+
+        for (int d = 0; d < DIM; d++)
+        {
+            gmx::SimdFloat fa = gmx::load(xa + d*stride + i);
+            gmx::SimdFloat fb = gmx::load(xb + d*stride + i);
+
+            gmx::cvtF2DD(fa, &a[d][0], &a[d][1]);
+            gmx::cvtF2DD(fb, &b[d][0], &b[d][1]);
+        }
+        for (int h = 0; h < 2; h++)
+        {
+            add_inner_product(a[XX][h], a[YY][h], a[ZZ][h], b[XX][h], b[YY][h], b[ZZ][h], sum);
+        }
+#endif
+    }
+    for (int d = 0; d < DIM; d++)
+    {
+        for (int e = 0; e < DIM; e++)
+        {
+            s[d][e] = gmx::reduce(sum[d*DIM + e]);
+        }
+    }
+#else
+    for (int d = 0; d < DIM; d++)
+    {
+        for (int e = 0; e < DIM; e++)
+        {
+            double sde = 0;
+
+            for (int i = 0; i < stride; i++)
+            {
+                sde += static_cast<double>(xa[d*stride + i])*xb[e*stride + i];
+            }
+            s[d][e] = sde;
+        }
+    }
+#endif
+}
+
+/* Returns the sum of squares of the coordinates of a frame, computed
+ * in the same way as the trace of the inner product matrix, so the RMSD
+ * of a frame with itself is zero also with rounding errors.
+ */
+static double calc_sum_of_squares(int stride, const real *x)
+{
+    double s[DIM][DIM];
+
+    calc_inner_product(stride, x, x, s);
+
+    return s[XX][XX] + s[YY][YY] + s[ZZ][ZZ];
+}
+
+t_rmsd_frames *new_rmsd_frames(int natoms, const real *w, gmx_bool bCenter)
+{
+    t_rmsd_frames *fr;
+    double         wtot;
+    int            i;
+
+    snew(fr, 1);
+    fr->natoms  = natoms;
+    fr->stride  = ((natoms + c_rmsdSimdWidth - 1)/c_rmsdSimdWidth)*c_rmsdSimdWidth;
+    fr->bCenter = bCenter;
+    snew(fr->w, natoms);
+    wtot = 0;
+    for (i = 0; i < natoms; i++)
+    {
+        wtot += (w ? w[i] : 1);
+    }
+    if (wtot <= 0)
+    {
+        gmx_fatal(FARGS, "The total weight of the atoms for the RMSD calculation is zero");
+    }
+    for (i = 0; i < natoms; i++)
+    {
+        fr->w[i] = (w ? w[i] : 1)/wtot;
+    }
+
+    return fr;
+}
+
+/* Reallocates the frame storage for nalloc frames */
+static void realloc_rmsd_frames(t_rmsd_frames *fr, int nalloc)
+{
+    real *x;
+
+    snew_aligned(x, static_cast<size_t>(nalloc)*DIM*fr->stride,
+                 c_rmsdSimdWidth*sizeof(real));
+    if (fr->nframes > 0)
+    {
+        std::memcpy(x, fr->x, static_cast<size_t>(fr->nframes)*DIM*fr->stride*sizeof(real));
+    }
+    sfree_aligned(fr->x);
+    fr->x      = x;
+    fr->nalloc = nalloc;
+    srenew(fr->g, nalloc);
+}
+
+/* Stores coordinates x as frame f */
+static void store_rmsd_frame(t_rmsd_frames *fr, int f, const rvec x[])
+{
+    dvec  xc = {0, 0, 0};
+    real *xf = fr->x + static_cast<size_t>(f)*DIM*fr->stride;
+
+    if (fr->bCenter)
+    {
+        for (int a = 0; a < fr->natoms; a++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                xc[d] += fr->w[a]*x[a][d];
+            }
+        }
+    }
+    for (int a = 0; a < fr->natoms; a++)
+    {
+        real s = std::sqrt(fr->w[a]);
+
+        for (int d = 0; d < DIM; d++)
+        {
+            xf[d*fr->stride + a] = s*(x[a][d] - xc[d]);
+        }
+    }
+    fr->g[f] = calc_sum_of_squares(fr->stride, xf);
+}
+
+void add_rmsd_frame(t_rmsd_frames *fr, const rvec x[])
+{
+    if (fr->nframes >= fr->nalloc)
+    {
+        realloc_rmsd_frames(fr, over_alloc_large(fr->nframes + 1));
+    }
+    store_rmsd_frame(fr, fr->nframes, x);
+    fr->nframes++;
+}
+
+t_rmsd_frames *init_rmsd_frames(int nframes, rvec *x[], int natoms,
+                                const real *w, gmx_bool bCenter)
+{
+    t_rmsd_frames *fr;
+
+    fr = new_rmsd_frames(natoms, w, bCenter);
+    realloc_rmsd_frames(fr, nframes);
+#pragma omp parallel for schedule(static)
+    for (int f = 0; f < nframes; f++)
+    {
+        store_rmsd_frame(fr, f, x[f]);
+    }
+    fr->nframes = nframes;
+
+    return fr;
+}
+
+void done_rmsd_frames(t_rmsd_frames **fr)
+{
+    sfree_aligned((*fr)->x);
+    sfree((*fr)->g);
+    sfree((*fr)->w);
+    sfree(*fr);
+    *fr = nullptr;
+}
+
+/* Returns the weighted mean square deviation without fitting */
+static real calc_msd_nofit(int stride, const real *xa, const real *xb)
+{
+#if GMX_SIMD_HAVE_REAL
+    gmx::SimdReal sum = gmx::setZero();
+
+    for (int i = 0; i < DIM*stride; i += GMX_SIMD_REAL_WIDTH)
+    {
+        gmx::SimdReal a  = gmx::load(xa + i);
+        gmx::SimdReal b  = gmx::load(xb + i);
+        gmx::SimdReal dx = a - b;
+
+        sum = gmx::fma(dx, dx, sum);
+    }
+    return gmx::reduce(sum);
+#else
+    real sum = 0;
+
+    for (int i = 0; i < DIM*stride; i++)
+    {
+        sum += gmx::square(xa[i] - xb[i]);
+    }
+    return sum;
+#endif
+}
+
+/* Returns the determinant of a 4x4 matrix, expanded in 2x2 minors */
+static double det4(const double m[4][4])
+{
+    double s0 = m[0][0]*m[1][1] - m[1][0]*m[0][1];
+    double s1 = m[0][0]*m[1][2] - m[1][0]*m[0][2];
+    double s2 = m[0][0]*m[1][3] - m[1][0]*m[0][3];
+    double s3 = m[0][1]*m[1][2] - m[1][1]*m[0][2];
+    double s4 = m[0][1]*m[1][3] - m[1][1]*m[0][3];
+    double s5 = m[0][2]*m[1][3] - m[1][2]*m[0][3];
+    double c5 = m[2][2]*m[3][3] - m[3][2]*m[2][3];
+    double c4 = m[2][1]*m[3][3] - m[3][1]*m[2][3];
+    double c3 = m[2][1]*m[3][2] - m[3][1]*m[2][2];
+    double c2 = m[2][0]*m[3][3] - m[3][0]*m[2][3];
+    double c1 = m[2][0]*m[3][2] - m[3][0]*m[2][2];
+    double c0 = m[2][0]*m[3][1] - m[3][0]*m[2][1];
+
+    return s0*c5 - s1*c4 + s2*c3 + s3*c2 - s4*c1 + s5*c0;
+}
+
+/* Returns the weighted mean square deviation after optimal superposition,
+ * given the inner product matrix s and the sums of squares ga and gb.
+ */
+static double calc_msd_qcp(const double s[DIM][DIM], double ga, double gb)
+{
+    const double e0 = 0.5*(ga + gb);
+    double       k[4][4], c0, c1, c2, lambda;
+
+    if (e0 <= 0)
+    {
+        return 0;
+    }
+
+    /* The key matrix, its largest eigenvalue is the maximum over
+     * all rotations R of sum_i xa_i . R xb_i.
+     */
+    k[0][0] =  s[XX][XX] + s[YY][YY] + s[ZZ][ZZ];
+    k[1][1] =  s[XX][XX] - s[YY][YY] - s[ZZ][ZZ];
+    k[2][2] = -s[XX][XX] + s[YY][YY] - s[ZZ][ZZ];
+    k[3][3] = -s[XX][XX] - s[YY][YY] + s[ZZ][ZZ];
+    k[0][1] = k[1][0] = s[YY][ZZ] - s[ZZ][YY];
+    k[0][2] = k[2][0] = s[ZZ][XX] - s[XX][ZZ];
+    k[0][3] = k[3][0] = s[XX][YY] - s[YY][XX];
+    k[1][2] = k[2][1] = s[XX][YY] + s[YY][XX];
+    k[1][3] = k[3][1] = s[ZZ][XX] + s[XX][ZZ];
+    k[2][3] = k[3][2] = s[YY][ZZ] + s[ZZ][YY];
+
+    /* The characteristic polynomial is lambda^4 + c2 lambda^2 + c1 lambda + c0 */
+    c2 = 0;
+    for (int d = 0; d < DIM; d++)
+    {
+        for (int e = 0; e < DIM; e++)
+        {
+            c2 += s[d][e]*s[d][e];
+        }
+    }
+    c2 *= -2;
+    c1  = -8*(s[XX][XX]*(s[YY][YY]*s[ZZ][ZZ] - s[YY][ZZ]*s[ZZ][YY]) -
+              s[XX][YY]*(s[YY][XX]*s[ZZ][ZZ] - s[YY][ZZ]*s[ZZ][XX]) +
+              s[XX][ZZ]*(s[YY][XX]*s[ZZ][YY] - s[YY][YY]*s[ZZ][XX]));
+    c0  = det4(k);
+
+    /* Newton-Raphson from the upper bound e0 converges to the largest root */
+    lambda = e0;
+    for (int iter = 0; iter < 50; iter++)
+    {
+        double l2    = lambda*lambda;
+        double b     = (l2 + c2)*lambda;
+        double a     = b + c1;
+        double denom = 2*l2*lambda + b + a;
+        double delta;
+
+        if (denom == 0)
+        {
+            break;
+        }
+        delta   = (a*lambda + c0)/denom;
+        lambda -= delta;
+        if (std::abs(delta) <= 1e-11*std::abs(lambda))
+        {
+            break;
+        }
+    }
+
+    return std::max(0.0, 2*(e0 - lambda));
+}
+
+/* Returns the RMSD between frame a of fa and frame b of fb */
+static real calc_rmsd_pair(const t_rmsd_frames *fa, int a,
+                           const t_rmsd_frames *fb, int b, gmx_bool bFit)
+{
+    const real *xa = fa->x + static_cast<size_t>(a)*DIM*fa->stride;
+    const real *xb = fb->x + static_cast<size_t>(b)*DIM*fb->stride;
+    double      msd;
+
+    if (bFit)
+    {
+        double s[DIM][DIM];
+
+        calc_inner_product(fa->stride, xa, xb, s);
+        msd = calc_msd_qcp(s, fa->g[a], fb->g[b]);
+    }
+    else
+    {
+        msd = calc_msd_nofit(fa->stride, xa, xb);
+    }
+
+    return std::sqrt(msd);
+}
+
+void calc_rmsd_matrix(const t_rmsd_frames *fa, const t_rmsd_frames *fb,
+                      gmx_bool bFit, real **mat)
+{
+    gmx_bool    bSymmetric = (fb == nullptr);
+    size_t      frameSize;
+    int         tileSize, ntileA, ntileB;
+    gmx_int64_t npair;
+
+    if (bSymmetric)
+    {
+        fb = fa;
+    }
+    GMX_RELEASE_ASSERT(fa->natoms == fb->natoms, "Can only compare frames with equal numbers of atoms");
+
+    frameSize = DIM*fa->stride*sizeof(real);
+    tileSize  = std::max(1, static_cast<int>(c_rmsdTileBytes/frameSize));
+    ntileA    = (fa->nframes + tileSize - 1)/tileSize;
+    ntileB    = (fb->nframes + tileSize - 1)/tileSize;
+    npair     = static_cast<gmx_int64_t>(ntileA)*ntileB;
+
+#pragma omp parallel for schedule(dynamic)
+    for (gmx_int64_t p = 0; p < npair; p++)
+    {
+        int ta = static_cast<int>(p/ntileB);
+        int tb = static_cast<int>(p % ntileB);
+
+        /* For a symmetric matrix we only compute the upper triangle */
+        if (bSymmetric && tb < ta)
+        {
+            continue;
+        }
+        int a1 = std::min(fa->nframes, (ta + 1)*tileSize);
+        int b1 = std::min(fb->nframes, (tb + 1)*tileSize);
+        for (int a = ta*tileSize; a < a1; a++)
+        {
+            int b0 = (bSymmetric ? std::max(tb*tileSize, a + 1) : tb*tileSize);
+
+            for (int b = b0; b < b1; b++)
+            {
+                mat[a][b] = calc_rmsd_pair(fa, a, fb, b, bFit);
+                if (bSymmetric)
+                {
+                    mat[b][a] = mat[a][b];
+                }
+            }
+        }
+    }
+
+    if (bSymmetric)
+    {
+        for (int a = 0; a < fa->nframes; a++)
+        {
+            mat[a][a] = 0;
+        }
+    }
+}
+
+/* Margin for rounding errors in the triangle inequality bounds */
+static const real c_rmsdPruneMargin = 1e-5;
+
+t_rmsd_neighbors *calc_rmsd_neighbors(const t_rmsd_frames *fr, gmx_bool bFit,
+                                      real cutoff, int npivot)
+{
+    t_rmsd_neighbors *nbl;
+    int               n = fr->nframes;
+    int              *pivot, *order;
+    real             *dmin, *pd, *key;
+    int               k, i;
+
+    npivot = std::max(1, std::min(npivot, n));
+    snew(pivot, npivot);
+    snew(dmin, n);
+    snew(pd, static_cast<size_t>(n)*npivot);
+
+    /* Choose the reference frames by farthest point traversal,
+     * starting from the frame farthest from the first frame.
+     */
+#pragma omp parallel for schedule(static)
+    for (int f = 0; f < n; f++)
+    {
+        dmin[f] = calc_rmsd_pair(fr, f, fr, 0, bFit);
+    }
+    for (k = 0; k < npivot; k++)
+    {
+        pivot[k] = static_cast<int>(std::max_element(dmin, dmin + n) - dmin);
+#pragma omp parallel for schedule(static)
+        for (int f = 0; f < n; f++)
+        {
+            real d = calc_rmsd_pair(fr, f, fr, pivot[k], bFit);
+
+            pd[static_cast<size_t>(f)*npivot + k] = d;
+            dmin[f] = (k == 0 ? d : std::min(dmin[f], d));
+        }
+    }
+    sfree(dmin);
+
+    /* Sort the frames on their distance to the first reference frame.
+     * By the triangle inequality, only frames with a distance to each
+     * reference frame that differs less than the cutoff can be neighbors.
+     */
+    snew(order, n);
+    for (i = 0; i < n; i++)
+    {
+        order[i] = i;
+    }
+    std::sort(order, order + n, [pd, npivot](int a, int b)
+              {
+                  return pd[static_cast<size_t>(a)*npivot] < pd[static_cast<size_t>(b)*npivot] ||
+                  (pd[static_cast<size_t>(a)*npivot] == pd[static_cast<size_t>(b)*npivot] && a < b);
+              });
+    /* Copy the bounds in sorted order, for linear memory access */
+    snew(key, static_cast<size_t>(n)*npivot);
+    for (i = 0; i < n; i++)
+    {
+        std::memcpy(key + static_cast<size_t>(i)*npivot,
+                    pd + static_cast<size_t>(order[i])*npivot, npivot*sizeof(real));
+    }
+    sfree(pd);
+
+    const real                     bound    = cutoff + c_rmsdPruneMargin;
+    int                            nthreads = gmx_omp_get_max_threads();
+    std::vector<std::vector<int> > pairs(nthreads);
+
+#pragma omp parallel num_threads(nthreads)
+    {
+        std::vector<int> &tpairs = pairs[gmx_omp_get_thread_num()];
+
+#pragma omp for schedule(dynamic, 64)
+        for (int a = 0; a < n; a++)
+        {
+            const real *ka = key + static_cast<size_t>(a)*npivot;
+
+            for (int b = a + 1; b < n; b++)
+            {
+                const real *kb = key + static_cast<size_t>(b)*npivot;
+
+                if (kb[0] - ka[0] >= bound)
+                {
+                    break;
+                }
+                bool bPruned = false;
+                for (int p = 1; p < npivot && !bPruned; p++)
+                {
+                    bPruned = (std::abs(kb[p] - ka[p]) >= bound);
+                }
+                if (!bPruned &&
+                    calc_rmsd_pair(fr, order[a], fr, order[b], bFit) < cutoff)
+                {
+                    tpairs.push_back(order[a]);
+                    tpairs.push_back(order[b]);
+                }
+            }
+        }
+    }
+    sfree(key);
+    sfree(order);
+    sfree(pivot);
+
+    /* Store the pairs for both frames in compressed row format */
+    snew(nbl, 1);
+    nbl->n = n;
+    snew(nbl->index, n + 1);
+    for (const auto &tpairs : pairs)
+    {
+        for (const int f : tpairs)
+        {
+            nbl->index[f + 1]++;
+        }
+    }
+    for (i = 0; i < n; i++)
+    {
+        nbl->index[i + 1] += nbl->index[i];
+    }
+    snew(nbl->nb, nbl->index[n]);
+    std::vector<gmx_int64_t> fill(nbl->index, nbl->index + n);
+    for (auto &tpairs : pairs)
+    {
+        for (size_t p = 0; p < tpairs.size(); p += 2)
+        {
+            nbl->nb[fill[tpairs[p]]++]     = tpairs[p + 1];
+            nbl->nb[fill[tpairs[p + 1]]++] = tpairs[p];
+        }
+        std::vector<int>().swap(tpairs);
+    }
+    /* Sort the lists, so the result does not depend on the thread count */
+#pragma omp parallel for schedule(dynamic, 256)
+    for (int f = 0; f < n; f++)
+    {
+        std::sort(nbl->nb + nbl->index[f], nbl->nb + nbl->index[f + 1]);
+    }
+
+    return nbl;
+}
+
+void done_rmsd_neighbors(t_rmsd_neighbors **nbl)
+{
+    sfree((*nbl)->index);
+    sfree((*nbl)->nb);
+    sfree(*nbl);
+    *nbl = nullptr;
+}
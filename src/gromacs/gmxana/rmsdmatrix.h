@@ -0,0 +1,113 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+
+#ifndef _rmsdmatrix_h
+#define _rmsdmatrix_h
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/real.h"
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+/* Coordinates of a set of frames, stored for fast computation of
+ * many pairwise RMS deviations.
+ */
+typedef struct {
+    int       nframes;
+    int       nalloc;  /* Number of frames allocated */
+    int       natoms;
+    int       stride;  /* natoms rounded up to the SIMD width */
+    gmx_bool  bCenter; /* Whether frames are centered on the weighted center */
+    real     *w;       /* The weights normalized to a sum of one */
+    real     *x;       /* For each frame blocks of stride x, y and z coordinates,
+                        * scaled by sqrt(w_i/sum w), padded with zeros */
+    double   *g;       /* For each frame the sum of the squared scaled coordinates */
+} t_rmsd_frames;
+
+extern t_rmsd_frames *init_rmsd_frames(int nframes, rvec *x[], int natoms,
+                                       const real *w, gmx_bool bCenter);
+/* Stores the coordinates of natoms atoms of nframes frames x with weights w
+ * (nullptr means unit weights). With bCenter each frame is centered on
+ * its weighted center, as required for fitting.
+ */
+
+extern t_rmsd_frames *new_rmsd_frames(int natoms, const real *w, gmx_bool bCenter);
+/* Returns an empty set of frames, to be filled with add_rmsd_frame */
+
+extern void add_rmsd_frame(t_rmsd_frames *fr, const rvec x[]);
+/* Appends frame x to fr, so trajectories can be stored while reading */
+
+extern void done_rmsd_frames(t_rmsd_frames **fr);
+
+extern void calc_rmsd_matrix(const t_rmsd_frames *fa, const t_rmsd_frames *fb,
+                             gmx_bool bFit, real **mat);
+/* Computes mat[i][j], the RMS deviation between frame i of fa and frame j
+ * of fb, after optimal superposition when bFit is set, in which case
+ * the frames should have been centered. The superposition uses
+ * the quaternion characteristic polynomial (QCP) method of Theobald,
+ * Acta Cryst. A61, 478 (2005), which gives the same result as do_fit
+ * followed by rmsdev with the same weights, without computing the rotation.
+ * When fb is nullptr, the symmetric matrix of fa with itself is computed,
+ * including a zero diagonal.
+ * The work is distributed in tiles of frames over the OpenMP threads.
+ */
+
+/* Neighbor lists of frames in compressed row format */
+typedef struct {
+    int          n;     /* The number of frames */
+    gmx_int64_t *index; /* The neighbors of frame i are nb[index[i]..index[i+1]) */
+    int         *nb;    /* The neighbor frame indices, sorted per frame */
+} t_rmsd_neighbors;
+
+extern t_rmsd_neighbors *calc_rmsd_neighbors(const t_rmsd_frames *fr, gmx_bool bFit,
+                                             real cutoff, int npivot);
+/* Returns for each frame of fr all other frames with an RMS deviation
+ * less than cutoff, without storing the full matrix. The RMSD to npivot
+ * reference frames, picked by farthest point traversal, bounds the RMSD
+ * between two frames from below through the triangle inequality, which
+ * avoids computing most pairs that are far apart.
+ */
+
+extern void done_rmsd_neighbors(t_rmsd_neighbors **nbl);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
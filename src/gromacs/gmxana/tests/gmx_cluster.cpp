@@ -0,0 +1,296 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests that gmx cluster -sparse gives the same clusters as the
+ * clustering on the full RMSD matrix, and that the binary RMSD matrix
+ * written with -omb matches the matrix of gmx rms and reads back with -dmb.
+ */
+#include "gmxpre.h"
+
+#include <cstdio>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/matio.h"
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/fileio/xvgr.h"
+#include "gromacs/gmxana/cmat.h"
+#include "gromacs/gmxana/gmx_ana.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/arraysize.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/smalloc.h"
+#include "gromacs/utility/textreader.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/stdiohelper.h"
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+
+namespace
+{
+
+//! The cluster of each frame, the clusters have 6, 4, 3, 2 and 1 frames.
+const int c_frameCluster[] = { 2, 0, 1, 0, 3, 2, 0, 1, 4, 0, 2, 1, 0, 3, 1, 0 };
+
+/*! \brief
+ * Test fixture that writes a trajectory of the two SPC waters in
+ * spc2.gro with well separated clusters of structures and clusters it.
+ */
+class GmxClusterSparse : public ::testing::Test
+{
+    public:
+        GmxClusterSparse()
+        {
+            const rvec base[] = {
+                { 0.0, 0.0, 0.0 }, { 0.1, 0.0, 0.0 }, { 0.0, 0.1, 0.0 },
+                { 0.5, 0.5, 0.5 }, { 0.6, 0.5, 0.5 }, { 0.5, 0.6, 0.5 }
+            };
+            const int natoms = asize(base);
+            matrix    box    = { { 3, 0, 0 }, { 0, 3, 0 }, { 0, 0, 3 } };
+
+            trajectory_ = fileManager_.getTemporaryFilePath(".xtc");
+            t_fileio *fio = open_xtc(trajectory_.c_str(), "w");
+            for (int frame = 0; frame < asize(c_frameCluster); frame++)
+            {
+                const int cluster = c_frameCluster[frame];
+                rvec      x[natoms];
+                for (int i = 0; i < natoms; i++)
+                {
+                    /* Small deviations within a cluster */
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        x[i][d] = base[i][d] + 0.005*(((frame + 1)*(i + 2)*(d + 3)) % 5 - 2)/2;
+                    }
+                }
+                /* The clusters differ in the position of one atom */
+                x[cluster][XX] += 0.4*(cluster + 1);
+                write_xtc(fio, natoms, frame, frame, box, x, 1000);
+            }
+            close_xtc(fio);
+        }
+
+        /*! \brief
+         * Runs gmx cluster with \p method, returns the cluster id of each frame.
+         *
+         * If \p binaryMatrixOption is set, it is given with \p binaryMatrix
+         * as the value to write or read the binary RMSD matrix.
+         */
+        std::vector<int> runCluster(const char *method, bool bSparse,
+                                    const char *binaryMatrixOption = nullptr,
+                                    const std::string &binaryMatrix = std::string())
+        {
+            gmx::test::CommandLine cmdline;
+            std::string            suffix = std::string(method) + (bSparse ? "-sparse" : "-dense");
+            if (binaryMatrixOption != nullptr)
+            {
+                suffix += binaryMatrixOption;
+            }
+            std::string clid = fileManager_.getTemporaryFilePath(suffix + "-clid.xvg");
+
+            cmdline.append("cluster");
+            cmdline.addOption("-s", gmx::test::TestFileManager::getInputFilePath("spc2.gro"));
+            cmdline.addOption("-f", trajectory_);
+            cmdline.addOption("-method", method);
+            cmdline.addOption("-cutoff", 0.1);
+            cmdline.addOption("-clid", clid);
+            cmdline.addOption("-g", fileManager_.getTemporaryFilePath(suffix + ".log"));
+            cmdline.addOption("-o", fileManager_.getTemporaryFilePath(suffix + ".xpm"));
+            cmdline.addOption("-om", fileManager_.getTemporaryFilePath(suffix + "-raw.xpm"));
+            if (bSparse)
+            {
+                cmdline.append("-sparse");
+            }
+            if (binaryMatrixOption != nullptr)
+            {
+                cmdline.addOption(binaryMatrixOption, binaryMatrix);
+            }
+
+            gmx::test::StdioTestHelper stdioHelper(&fileManager_);
+            stdioHelper.redirectStringToStdin("0\n0\n");
+
+            EXPECT_EQ(0, gmx_cluster(cmdline.argc(), cmdline.argv()));
+
+            double         **data;
+            int              ncol;
+            int              nframes = read_xvg(clid.c_str(), &data, &ncol);
+            std::vector<int> clusterIds;
+            for (int frame = 0; frame < nframes; frame++)
+            {
+                clusterIds.push_back(static_cast<int>(data[1][frame] + 0.5));
+            }
+            for (int col = 0; col < ncol; col++)
+            {
+                sfree(data[col]);
+            }
+            sfree(data);
+
+            return clusterIds;
+        }
+
+        //! Checks that -sparse gives the same cluster ids as the dense \p method.
+        void checkSameClusters(const char *method)
+        {
+            std::vector<int> dense  = runCluster(method, false);
+            std::vector<int> sparse = runCluster(method, true);
+
+            ASSERT_EQ(static_cast<size_t>(asize(c_frameCluster)), dense.size());
+            ASSERT_EQ(dense.size(), sparse.size());
+            for (size_t frame = 0; frame < dense.size(); frame++)
+            {
+                EXPECT_EQ(dense[frame], sparse[frame]) << "frame " << frame;
+                /* The frames of each constructed cluster get the same id */
+                for (size_t other = 0; other < frame; other++)
+                {
+                    EXPECT_EQ(c_frameCluster[frame] == c_frameCluster[other],
+                              sparse[frame] == sparse[other]);
+                }
+            }
+        }
+
+        gmx::test::TestFileManager fileManager_;
+        std::string                trajectory_;
+};
+
+/*! \brief
+ * Test fixture that also computes the RMSD matrix of the trajectory with
+ * gmx rms -m.
+ */
+class GmxClusterBinaryMatrix : public GmxClusterSparse
+{
+    public:
+        /*! \brief
+         * Runs gmx rms -m, returns the matrix written with -bin in \p mat
+         * and that read back from the xpm file in \p xpmMat.
+         */
+        void runRmsMatrix(std::vector<real> *mat, std::vector<real> *xpmMat)
+        {
+            gmx::test::CommandLine cmdline;
+            std::string            xpm = fileManager_.getTemporaryFilePath("rms.xpm");
+            std::string            bin = fileManager_.getTemporaryFilePath("rms.dat");
+            const int              n   = asize(c_frameCluster);
+
+            cmdline.append("rms");
+            cmdline.addOption("-s", gmx::test::TestFileManager::getInputFilePath("spc2.gro"));
+            cmdline.addOption("-f", trajectory_);
+            cmdline.addOption("-o", fileManager_.getTemporaryFilePath("rms.xvg"));
+            cmdline.addOption("-m", xpm);
+            cmdline.addOption("-bin", bin);
+
+            gmx::test::StdioTestHelper stdioHelper(&fileManager_);
+            stdioHelper.redirectStringToStdin("0\n0\n");
+
+            ASSERT_EQ(0, gmx_rms(cmdline.argc(), cmdline.argv()));
+
+            FILE *fp = gmx_ffopen(bin.c_str(), "rb");
+            mat->resize(n*n);
+            ASSERT_EQ(n*n, static_cast<int>(std::fread(mat->data(), sizeof(real), n*n, fp)));
+            gmx_ffclose(fp);
+
+            t_matrix *readmat = nullptr;
+            ASSERT_EQ(1, read_xpm_matrix(xpm.c_str(), &readmat));
+            ASSERT_EQ(n, readmat[0].nx);
+            ASSERT_EQ(n, readmat[0].ny);
+            real    **values = matrix2real(&readmat[0], nullptr);
+            ASSERT_NE(nullptr, values);
+            xpmMat->clear();
+            for (int i = 0; i < n; i++)
+            {
+                xpmMat->insert(xpmMat->end(), values[i], values[i] + n);
+            }
+            done_matrix(n, &values);
+        }
+};
+
+TEST_F(GmxClusterBinaryMatrix, RoundTripMatchesRmsMatrix)
+{
+    const int          n          = asize(c_frameCluster);
+    const std::string  binaryFile = fileManager_.getTemporaryFilePath("rmsd.dat");
+    std::vector<real>  rmsMat;
+    std::vector<real>  xpmMat;
+
+    ASSERT_NO_FATAL_FAILURE(runRmsMatrix(&rmsMat, &xpmMat));
+
+    std::vector<int> clusters = runCluster("gromos", false, "-omb", binaryFile);
+
+    /* The written matrix has the QCP values of gmx rms -bin, and
+     * matches the gmx rms -m xpm within the resolution of its levels.
+     */
+    t_mat     *mat      = read_mat_binary(binaryFile.c_str(), FALSE);
+    const real maxrms   = *std::max_element(rmsMat.begin(), rmsMat.end());
+    const real xpmLevel = maxrms/(80 - 1);
+    ASSERT_EQ(n, mat->nn);
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            if (j != i)
+            {
+                EXPECT_REAL_EQ_TOL(rmsMat[i*n + j], mat->mat[i][j],
+                                   gmx::test::absoluteTolerance(1e-5))
+                << "frames " << i << " and " << j;
+                EXPECT_REAL_EQ_TOL(xpmMat[i*n + j], mat->mat[i][j],
+                                   gmx::test::absoluteTolerance(xpmLevel))
+                << "frames " << i << " and " << j;
+            }
+        }
+    }
+    done_mat(&mat);
+
+    /* Reading the matrix back gives the same clusters and matrix output */
+    std::vector<int> clustersRead = runCluster("gromos", false, "-dmb", binaryFile);
+    EXPECT_EQ(clusters, clustersRead);
+    EXPECT_EQ(gmx::TextReader::readFileToString(
+                      fileManager_.getTemporaryFilePath("gromos-dense-omb.xpm")),
+              gmx::TextReader::readFileToString(
+                      fileManager_.getTemporaryFilePath("gromos-dense-dmb.xpm")));
+}
+
+TEST_F(GmxClusterSparse, GromosGivesSameClustersAsDense)
+{
+    checkSameClusters("gromos");
+}
+
+TEST_F(GmxClusterSparse, LinkageGivesSameClustersAsDense)
+{
+    checkSameClusters("linkage");
+}
+
+} // namespace
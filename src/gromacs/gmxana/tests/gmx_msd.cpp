@@ -0,0 +1,198 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for gmx msd.
+ */
+#include "gmxpre.h"
+
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/xvgr.h"
+#include "gromacs/gmxana/gmx_ana.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/utility/smalloc.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textwriter.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/stdiohelper.h"
+#include "testutils/testasserts.h"
+#include "testutils/testfilemanager.h"
+
+namespace
+{
+
+using gmx::test::CommandLine;
+
+//! Number of atoms in the test trajectory
+const int c_atomCount  = 20;
+//! Number of frames in the test trajectory
+const int c_frameCount = 41;
+
+class GmxMsdTest : public ::testing::Test
+{
+    public:
+        //! Writes a random walk trajectory of c_atomCount atoms in a .gro file
+        GmxMsdTest()
+        {
+            gmx::ThreeFry2x64<64>              rng(123456, gmx::RandomDomain::Other);
+            gmx::UniformRealDistribution<real> dist(-1, 1);
+            std::vector<gmx::RVec>             x(c_atomCount);
+            std::string                        contents;
+            const char                        *atomNames[] = { "OW", "HW1", "HW2" };
+
+            for (int i = 0; i < c_atomCount; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    x[i][d] = 2.5 + dist(rng);
+                }
+            }
+            for (int f = 0; f < c_frameCount; f++)
+            {
+                contents.append(gmx::formatString("Random walk t= %g\n%5d\n", 1.0*f, c_atomCount));
+                for (int i = 0; i < c_atomCount; i++)
+                {
+                    /* Water atom names, so the masses differ and are known */
+                    contents.append(gmx::formatString("%5d%-5s%5s%5d%8.3f%8.3f%8.3f\n",
+                                                      i/3 + 1, "SOL", atomNames[i % 3], i + 1,
+                                                      x[i][XX], x[i][YY], x[i][ZZ]));
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        /* Different step sizes for the dimensions */
+                        x[i][d] += 0.05*(d + 1)*dist(rng);
+                    }
+                }
+                contents.append("   5.00000   5.00000   5.00000\n");
+            }
+            trajectoryFile_ = fileManager_.getTemporaryFilePath("walk.gro");
+            gmx::TextWriter::writeFileFromString(trajectoryFile_, contents);
+        }
+
+        /*! \brief
+         * Runs gmx msd with \p args and returns the MSD columns of the
+         * output, the first of which is time.
+         */
+        std::vector<std::vector<double> > runMsd(const char *name, const CommandLine &args)
+        {
+            const std::string outputFile = fileManager_.getTemporaryFilePath(name);
+            CommandLine       cmdline;
+
+            cmdline.append("msd");
+            cmdline.addOption("-s", trajectoryFile_);
+            cmdline.addOption("-f", trajectoryFile_);
+            cmdline.addOption("-o", outputFile);
+            cmdline.merge(args);
+
+            gmx::test::StdioTestHelper stdioHelper(&fileManager_);
+            stdioHelper.redirectStringToStdin("0\n");
+            EXPECT_EQ(0, gmx_msd(cmdline.argc(), cmdline.argv()));
+
+            double                          **y;
+            int                               ny;
+            int                               nx = read_xvg(outputFile.c_str(), &y, &ny);
+            std::vector<std::vector<double> > data;
+            for (int c = 0; c < ny; c++)
+            {
+                data.emplace_back(y[c], y[c] + nx);
+                sfree(y[c]);
+            }
+            sfree(y);
+
+            return data;
+        }
+
+        //! Checks that the MSD curves in \p data match those in \p reference
+        void checkMsd(const std::vector<std::vector<double> > &reference,
+                      const std::vector<std::vector<double> > &data)
+        {
+            ASSERT_EQ(reference.size(), data.size());
+            ASSERT_EQ(c_frameCount, static_cast<int>(reference[0].size()));
+            for (size_t c = 0; c < reference.size(); c++)
+            {
+                ASSERT_EQ(reference[c].size(), data[c].size());
+                for (size_t m = 0; m < reference[c].size(); m++)
+                {
+                    EXPECT_REAL_EQ_TOL(reference[c][m], data[c][m],
+                                       gmx::test::relativeToleranceAsFloatingPoint(reference[c].back(), 1e-4))
+                    << "column " << c << ", time " << reference[0][m];
+                }
+            }
+        }
+
+        gmx::test::TestFileManager fileManager_;
+        std::string                trajectoryFile_;
+};
+
+TEST_F(GmxMsdTest, FftMatchesAllRestarts)
+{
+    const char *const restartArgs[] = { "msd", "-trestart", "1" };
+    const char *const fftArgs[]     = { "msd", "-fft" };
+    auto              reference     = runMsd("restart.xvg", CommandLine(restartArgs));
+    auto              fft           = runMsd("fft.xvg", CommandLine(fftArgs));
+
+    checkMsd(reference, fft);
+}
+
+TEST_F(GmxMsdTest, FftMatchesAllRestartsForLateralMsd)
+{
+    const char *const restartArgs[] = { "msd", "-trestart", "1", "-lateral", "z" };
+    const char *const fftArgs[]     = { "msd", "-fft", "-lateral", "z" };
+    auto              reference     = runMsd("restart.xvg", CommandLine(restartArgs));
+    auto              fft           = runMsd("fft.xvg", CommandLine(fftArgs));
+
+    checkMsd(reference, fft);
+}
+
+TEST_F(GmxMsdTest, FftMatchesAllRestartsWithTemporaryFile)
+{
+    /* The coordinates of a few frames fit in -maxmem, the rest are
+     * written to a temporary file and processed a few atoms at a time.
+     */
+    const char *const restartArgs[] = { "msd", "-trestart", "1" };
+    const char *const fftArgs[]     = { "msd", "-fft", "-maxmem", "0.005" };
+    auto              reference     = runMsd("restart.xvg", CommandLine(restartArgs));
+    auto              fft           = runMsd("fft.xvg", CommandLine(fftArgs));
+
+    checkMsd(reference, fft);
+}
+
+} // namespace
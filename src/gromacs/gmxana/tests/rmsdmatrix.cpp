@@ -0,0 +1,232 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the pairwise RMSD matrix routines.
+ */
+#include "gmxpre.h"
+
+#include "gromacs/gmxana/rmsdmatrix.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/do_fit.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+class RmsdMatrixTest : public ::testing::Test
+{
+    public:
+        RmsdMatrixTest() : natoms_(23), nframes_(9)
+        {
+            gmx::ThreeFry2x64<64>              rng(123456, gmx::RandomDomain::Other);
+            gmx::UniformRealDistribution<real> dist(-1, 1);
+            std::vector<gmx::RVec>             base(natoms_);
+
+            for (auto &b : base)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    b[d] = dist(rng);
+                }
+            }
+            mass_.resize(natoms_);
+            for (int i = 0; i < natoms_; i++)
+            {
+                mass_[i] = 1 + (i % 4)*3;
+            }
+            /* Rotated and perturbed copies of the same structure */
+            snew(x_, nframes_);
+            for (int f = 0; f < nframes_; f++)
+            {
+                real   a = 2*M_PI*f/nframes_;
+                matrix rot;
+
+                clear_mat(rot);
+                rot[XX][XX] = std::cos(a);
+                rot[XX][YY] = -std::sin(a);
+                rot[YY][XX] = std::sin(a);
+                rot[YY][YY] = std::cos(a);
+                rot[ZZ][ZZ] = 1;
+                snew(x_[f], natoms_);
+                for (int i = 0; i < natoms_; i++)
+                {
+                    mvmul(rot, base[i], x_[f][i]);
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        x_[f][i][d] += 0.1*f*dist(rng) + d;
+                    }
+                }
+            }
+        }
+        ~RmsdMatrixTest()
+        {
+            for (int f = 0; f < nframes_; f++)
+            {
+                sfree(x_[f]);
+            }
+            sfree(x_);
+        }
+
+        //! Returns the reference RMSD computed with do_fit and rmsdev
+        real referenceRmsd(int fa, int fb, bool bFit)
+        {
+            std::vector<gmx::RVec> xa(x_[fa], x_[fa] + natoms_);
+            std::vector<gmx::RVec> xb(x_[fb], x_[fb] + natoms_);
+
+            if (bFit)
+            {
+                reset_x(natoms_, nullptr, natoms_, nullptr, as_rvec_array(xa.data()), mass_.data());
+                reset_x(natoms_, nullptr, natoms_, nullptr, as_rvec_array(xb.data()), mass_.data());
+                do_fit(natoms_, mass_.data(), as_rvec_array(xa.data()), as_rvec_array(xb.data()));
+            }
+            return rmsdev(natoms_, mass_.data(), as_rvec_array(xa.data()), as_rvec_array(xb.data()));
+        }
+
+        void runTest(bool bFit)
+        {
+            t_rmsd_frames *frames = init_rmsd_frames(nframes_, x_, natoms_, mass_.data(), bFit);
+            real         **mat;
+
+            snew(mat, nframes_);
+            for (int f = 0; f < nframes_; f++)
+            {
+                snew(mat[f], nframes_);
+            }
+            calc_rmsd_matrix(frames, nullptr, bFit, mat);
+            for (int fa = 0; fa < nframes_; fa++)
+            {
+                for (int fb = 0; fb < nframes_; fb++)
+                {
+                    EXPECT_REAL_EQ_TOL(referenceRmsd(fa, fb, bFit), mat[fa][fb],
+                                       gmx::test::absoluteTolerance(1e-4));
+                }
+            }
+            /* The same with two distinct sets of frames */
+            t_rmsd_frames *frames2 = init_rmsd_frames(nframes_ - 2, x_ + 2, natoms_, mass_.data(), bFit);
+            calc_rmsd_matrix(frames, frames2, bFit, mat);
+            for (int fa = 0; fa < nframes_; fa++)
+            {
+                for (int fb = 0; fb < nframes_ - 2; fb++)
+                {
+                    EXPECT_REAL_EQ_TOL(referenceRmsd(fa, fb + 2, bFit), mat[fa][fb],
+                                       gmx::test::absoluteTolerance(1e-4));
+                }
+            }
+            done_rmsd_frames(&frames2);
+            done_rmsd_frames(&frames);
+            for (int f = 0; f < nframes_; f++)
+            {
+                sfree(mat[f]);
+            }
+            sfree(mat);
+        }
+
+        void runNeighborTest(bool bFit)
+        {
+            t_rmsd_frames    *frames = new_rmsd_frames(natoms_, mass_.data(), bFit);
+            std::vector<real> rmsd;
+
+            for (int f = 0; f < nframes_; f++)
+            {
+                add_rmsd_frame(frames, x_[f]);
+            }
+            for (int fa = 0; fa < nframes_; fa++)
+            {
+                for (int fb = fa + 1; fb < nframes_; fb++)
+                {
+                    rmsd.push_back(referenceRmsd(fa, fb, bFit));
+                }
+            }
+            /* Use the median RMSD as cutoff, so half of the pairs are neighbors */
+            std::sort(rmsd.begin(), rmsd.end());
+            real              cutoff = 0.5*(rmsd[rmsd.size()/2 - 1] + rmsd[rmsd.size()/2]);
+            t_rmsd_neighbors *nbl    = calc_rmsd_neighbors(frames, bFit, cutoff, 3);
+
+            ASSERT_EQ(nframes_, nbl->n);
+            for (int fa = 0; fa < nframes_; fa++)
+            {
+                std::vector<int> nb(nbl->nb + nbl->index[fa], nbl->nb + nbl->index[fa + 1]);
+
+                for (int fb = 0; fb < nframes_; fb++)
+                {
+                    bool bNeighbor = (fb != fa && referenceRmsd(fa, fb, bFit) < cutoff);
+                    EXPECT_EQ(bNeighbor, std::binary_search(nb.begin(), nb.end(), fb))
+                    << "frames " << fa << " and " << fb;
+                }
+            }
+            done_rmsd_neighbors(&nbl);
+            done_rmsd_frames(&frames);
+        }
+
+        int                natoms_;
+        int                nframes_;
+        std::vector<real>  mass_;
+        rvec             **x_;
+};
+
+TEST_F(RmsdMatrixTest, MatchesDoFit)
+{
+    runTest(true);
+}
+
+TEST_F(RmsdMatrixTest, MatchesRmsdevWithoutFit)
+{
+    runTest(false);
+}
+
+TEST_F(RmsdMatrixTest, NeighborsMatchMatrix)
+{
+    runNeighborTest(true);
+}
+
+TEST_F(RmsdMatrixTest, NeighborsMatchMatrixWithoutFit)
+{
+    runNeighborTest(false);
+}
+
+} // namespace
@@ -113,6 +113,79 @@ static int pbc_rvec_sub(const t_pbc *pbc, const rvec xi, const rvec xj, rvec dx)
     }
 }
 
+#if GMX_SIMD_HAVE_REAL
+
+/*! \brief Returns the number of interactions, excluding padding, in the
+ * SIMD batch starting at index \p i of a list of length \p nbonds */
+static gmx_inline int simd_batch_size(int i, int nbonds, int nfa1)
+{
+    return std::min(GMX_SIMD_REAL_WIDTH, (nbonds - i)/nfa1);
+}
+
+/*! \brief Stores the force components on an atom for add_shift_forces_simd() */
+static gmx_inline void gmx_simdcall
+store_force_simd(real *fbuf, SimdReal fx, SimdReal fy, SimdReal fz)
+{
+    store(fbuf + 0*GMX_SIMD_REAL_WIDTH, fx);
+    store(fbuf + 1*GMX_SIMD_REAL_WIDTH, fy);
+    store(fbuf + 2*GMX_SIMD_REAL_WIDTH, fz);
+}
+
+/*! \brief Adds the shift forces for a batch of interactions computed with SIMD
+ *
+ * \p fbuf contains the forces on the \p nother atoms \p aother of
+ * \p nlane interactions, stored with store_force_simd(). The force on
+ * the reference atom \p aj is minus the sum of these. The shift of each
+ * atom with respect to aj is determined as in the plain-C kernels,
+ * so the virial is the same.
+ */
+static void
+add_shift_forces_simd(int nlane, const int *aj,
+                      int nother, const int * const *aother,
+                      const real *fbuf,
+                      const t_pbc *pbc, const t_graph *g,
+                      const rvec x[], rvec fshift[])
+{
+    if (pbc == nullptr && g == nullptr)
+    {
+        /* All shifts are CENTRAL, so the contributions cancel */
+        return;
+    }
+
+    for (int s = 0; s < nlane; s++)
+    {
+        for (int o = 0; o < nother; o++)
+        {
+            int ao = aother[o][s];
+            int t;
+
+            if (g)
+            {
+                ivec dt;
+                ivec_sub(SHIFT_IVEC(g, ao), SHIFT_IVEC(g, aj[s]), dt);
+                t = IVEC2IS(dt);
+            }
+            else
+            {
+                rvec dx;
+                t = pbc_dx_aiuc(pbc, x[ao], x[aj[s]], dx);
+            }
+            if (t != CENTRAL)
+            {
+                for (int m = 0; m < DIM; m++)
+                {
+                    real fo = fbuf[(o*DIM + m)*GMX_SIMD_REAL_WIDTH + s];
+
+                    fshift[t][m]       += fo;
+                    fshift[CENTRAL][m] -= fo;
+                }
+            }
+        }
+    }
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
 /*! \brief Morse potential bond
  *
  * By Frank Everdij. Three parameters needed:
@@ -419,6 +492,109 @@ real bonds(int nbonds,
     return vtot;
 }
 
+#if GMX_SIMD_HAVE_REAL
+
+/* As bonds, but using SIMD to calculate many bonds at once */
+real
+bonds_simd(int nbonds,
+           const t_iatom forceatoms[], const t_iparams forceparams[],
+           const rvec x[], rvec4 f[], rvec fshift[],
+           const t_pbc *pbc, const t_graph *g)
+{
+    const int             nfa1 = 3;
+    int                   i, iu, s;
+    int                   type;
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    ai[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    aj[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   coeff[2*GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   fbuf[DIM*GMX_SIMD_REAL_WIDTH];
+    const int            *aother[1] = { ai };
+    SimdReal              half_S(0.5);
+    SimdReal              dr2_min_S(GMX_REAL_MIN);
+    SimdReal              xi_S, yi_S, zi_S;
+    SimdReal              xj_S, yj_S, zj_S;
+    SimdReal              dx_S, dy_S, dz_S;
+    SimdReal              k_S, r0_S;
+    SimdReal              dr2_S, rinv_S, ddr_S, fbond_S;
+    SimdReal              vtot_S = setZero();
+    SimdBool              nonzero_S;
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)    pbc_simd[9*GMX_SIMD_REAL_WIDTH];
+
+    set_pbc_simd(pbc, pbc_simd);
+
+    /* nbonds is the number of bonds times nfa1, here we step GMX_SIMD_REAL_WIDTH bonds */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH*nfa1)
+    {
+        /* Collect atoms for GMX_SIMD_REAL_WIDTH bonds.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu+1];
+            aj[s] = forceatoms[iu+2];
+
+            /* At the end fill the arrays with the last atoms and 0 params */
+            if (i + s*nfa1 < nbonds)
+            {
+                coeff[s]                     = forceparams[type].harmonic.krA;
+                coeff[GMX_SIMD_REAL_WIDTH+s] = forceparams[type].harmonic.rA;
+
+                if (iu + nfa1 < nbonds)
+                {
+                    iu += nfa1;
+                }
+            }
+            else
+            {
+                coeff[s]                     = 0;
+                coeff[GMX_SIMD_REAL_WIDTH+s] = 0;
+            }
+        }
+
+        gatherLoadUTranspose<3>(reinterpret_cast<const real *>(x), ai, &xi_S, &yi_S, &zi_S);
+        gatherLoadUTranspose<3>(reinterpret_cast<const real *>(x), aj, &xj_S, &yj_S, &zj_S);
+        dx_S      = xi_S - xj_S;
+        dy_S      = yi_S - yj_S;
+        dz_S      = zi_S - zj_S;
+
+        pbc_correct_dx_simd(&dx_S, &dy_S, &dz_S, pbc_simd);
+
+        k_S       = load(coeff);
+        r0_S      = load(coeff+GMX_SIMD_REAL_WIDTH);
+
+        /* The plain-C code skips bonds of zero length, we mask them */
+        dr2_S     = norm2(dx_S, dy_S, dz_S);
+        nonzero_S = (setZero() < dr2_S);
+        dr2_S     = max(dr2_S, dr2_min_S);
+        rinv_S    = invsqrt(dr2_S);
+        ddr_S     = dr2_S * rinv_S - r0_S;
+
+        fbond_S   = selectByMask(-k_S * ddr_S * rinv_S, nonzero_S);
+
+        dx_S      = fbond_S * dx_S;
+        dy_S      = fbond_S * dy_S;
+        dz_S      = fbond_S * dz_S;
+
+        transposeScatterIncrU<4>(reinterpret_cast<real *>(f), ai, dx_S, dy_S, dz_S);
+        transposeScatterDecrU<4>(reinterpret_cast<real *>(f), aj, dx_S, dy_S, dz_S);
+
+        if (fshift != nullptr)
+        {
+            vtot_S = vtot_S + selectByMask(half_S * k_S * ddr_S * ddr_S, nonzero_S);
+
+            store_force_simd(fbuf, dx_S, dy_S, dz_S);
+            add_shift_forces_simd(simd_batch_size(i, nbonds, nfa1), aj,
+                                  1, aother, fbuf, pbc, g, x, fshift);
+        }
+    }
+
+    return reduce(vtot_S);
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
 real restraint_bonds(int nbonds,
                      const t_iatom forceatoms[], const t_iparams forceparams[],
                      const rvec x[], rvec4 f[], rvec fshift[],
@@ -967,17 +1143,77 @@ real angles(int nbonds,
 
 #if GMX_SIMD_HAVE_REAL
 
-/* As angles, but using SIMD to calculate many angles at once.
- * This routines does not calculate energies and shift forces.
+/* Calculates the forces on the outer atoms i and k of GMX_SIMD_REAL_WIDTH
+ * harmonic angles with PBC corrected distance vectors r_ij and r_kj,
+ * returns the energies. The force on atom j is minus the sum of the two.
  */
-void
-angles_noener_simd(int nbonds,
-                   const t_iatom forceatoms[], const t_iparams forceparams[],
-                   const rvec x[], rvec4 f[],
-                   const t_pbc *pbc, const t_graph gmx_unused *g,
-                   real gmx_unused lambda,
-                   const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-                   int gmx_unused *global_atom_index)
+static gmx_inline SimdReal gmx_simdcall
+harmonic_angle_simd(SimdReal rijx_S, SimdReal rijy_S, SimdReal rijz_S,
+                    SimdReal rkjx_S, SimdReal rkjy_S, SimdReal rkjz_S,
+                    SimdReal k_S, SimdReal theta0_S,
+                    SimdReal *f_ix_S, SimdReal *f_iy_S, SimdReal *f_iz_S,
+                    SimdReal *f_kx_S, SimdReal *f_ky_S, SimdReal *f_kz_S)
+{
+    const SimdReal one_S(1.0);
+    const SimdReal half_S(0.5);
+    const SimdReal min_one_plus_eps_S(-1.0 + 2.0*GMX_REAL_EPS); // Smallest number > -1
+
+    SimdReal       rij_rkj_S;
+    SimdReal       nrij2_S, nrij_1_S;
+    SimdReal       nrkj2_S, nrkj_1_S;
+    SimdReal       cos_S, invsin_S;
+    SimdReal       theta_S, dtheta_S;
+    SimdReal       st_S, sth_S;
+    SimdReal       cik_S, cii_S, ckk_S;
+
+    rij_rkj_S = iprod(rijx_S, rijy_S, rijz_S,
+                      rkjx_S, rkjy_S, rkjz_S);
+
+    nrij2_S   = norm2(rijx_S, rijy_S, rijz_S);
+    nrkj2_S   = norm2(rkjx_S, rkjy_S, rkjz_S);
+
+    nrij_1_S  = invsqrt(nrij2_S);
+    nrkj_1_S  = invsqrt(nrkj2_S);
+
+    cos_S     = rij_rkj_S * nrij_1_S * nrkj_1_S;
+
+    /* To allow for 180 degrees, we take the max of cos and -1 + 1bit,
+     * so we can safely get the 1/sin from 1/sqrt(1 - cos^2).
+     * This also ensures that rounding errors would cause the argument
+     * of simdAcos to be < -1.
+     * Note that we do not take precautions for cos(0)=1, so the outer
+     * atoms in an angle should not be on top of each other.
+     */
+    cos_S     = max(cos_S, min_one_plus_eps_S);
+
+    theta_S   = acos(cos_S);
+
+    invsin_S  = invsqrt( one_S - cos_S * cos_S );
+
+    dtheta_S  = theta0_S - theta_S;
+    st_S      = k_S * dtheta_S * invsin_S;
+    sth_S     = st_S * cos_S;
+
+    cik_S     = st_S  * nrij_1_S * nrkj_1_S;
+    cii_S     = sth_S * nrij_1_S * nrij_1_S;
+    ckk_S     = sth_S * nrkj_1_S * nrkj_1_S;
+
+    *f_ix_S   = fnma(cik_S, rkjx_S, cii_S * rijx_S);
+    *f_iy_S   = fnma(cik_S, rkjy_S, cii_S * rijy_S);
+    *f_iz_S   = fnma(cik_S, rkjz_S, cii_S * rijz_S);
+    *f_kx_S   = fnma(cik_S, rijx_S, ckk_S * rkjx_S);
+    *f_ky_S   = fnma(cik_S, rijy_S, ckk_S * rkjy_S);
+    *f_kz_S   = fnma(cik_S, rijz_S, ckk_S * rkjz_S);
+
+    return half_S * k_S * dtheta_S * dtheta_S;
+}
+
+/* As angles, but using SIMD to calculate many angles at once */
+real
+angles_simd(int nbonds,
+            const t_iatom forceatoms[], const t_iparams forceparams[],
+            const rvec x[], rvec4 f[], rvec fshift[],
+            const t_pbc *pbc, const t_graph *g)
 {
     const int            nfa1 = 4;
     int                  i, iu, s;
@@ -986,6 +1222,8 @@ angles_noener_simd(int nbonds,
     GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    aj[GMX_SIMD_REAL_WIDTH];
     GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    ak[GMX_SIMD_REAL_WIDTH];
     GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   coeff[2*GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   fbuf[2*DIM*GMX_SIMD_REAL_WIDTH];
+    const int           *aother[2] = { ai, ak };
     SimdReal             deg2rad_S(DEG2RAD);
     SimdReal             xi_S, yi_S, zi_S;
     SimdReal             xj_S, yj_S, zj_S;
@@ -993,18 +1231,10 @@ angles_noener_simd(int nbonds,
     SimdReal             k_S, theta0_S;
     SimdReal             rijx_S, rijy_S, rijz_S;
     SimdReal             rkjx_S, rkjy_S, rkjz_S;
-    SimdReal             one_S(1.0);
-    SimdReal             min_one_plus_eps_S(-1.0 + 2.0*GMX_REAL_EPS); // Smallest number > -1
-
-    SimdReal             rij_rkj_S;
-    SimdReal             nrij2_S, nrij_1_S;
-    SimdReal             nrkj2_S, nrkj_1_S;
-    SimdReal             cos_S, invsin_S;
-    SimdReal             theta_S;
-    SimdReal             st_S, sth_S;
-    SimdReal             cik_S, cii_S, ckk_S;
     SimdReal             f_ix_S, f_iy_S, f_iz_S;
     SimdReal             f_kx_S, f_ky_S, f_kz_S;
+    SimdReal             v_S;
+    SimdReal             vtot_S = setZero();
     GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)    pbc_simd[9*GMX_SIMD_REAL_WIDTH];
 
     set_pbc_simd(pbc, pbc_simd);
@@ -1058,54 +1288,28 @@ angles_noener_simd(int nbonds,
         pbc_correct_dx_simd(&rijx_S, &rijy_S, &rijz_S, pbc_simd);
         pbc_correct_dx_simd(&rkjx_S, &rkjy_S, &rkjz_S, pbc_simd);
 
-        rij_rkj_S = iprod(rijx_S, rijy_S, rijz_S,
-                          rkjx_S, rkjy_S, rkjz_S);
-
-        nrij2_S   = norm2(rijx_S, rijy_S, rijz_S);
-        nrkj2_S   = norm2(rkjx_S, rkjy_S, rkjz_S);
-
-        nrij_1_S  = invsqrt(nrij2_S);
-        nrkj_1_S  = invsqrt(nrkj2_S);
-
-        cos_S     = rij_rkj_S * nrij_1_S * nrkj_1_S;
-
-        /* To allow for 180 degrees, we take the max of cos and -1 + 1bit,
-         * so we can safely get the 1/sin from 1/sqrt(1 - cos^2).
-         * This also ensures that rounding errors would cause the argument
-         * of simdAcos to be < -1.
-         * Note that we do not take precautions for cos(0)=1, so the outer
-         * atoms in an angle should not be on top of each other.
-         */
-        cos_S     = max(cos_S, min_one_plus_eps_S);
-
-        theta_S   = acos(cos_S);
-
-        invsin_S  = invsqrt( one_S - cos_S * cos_S );
-
-        st_S      = k_S * (theta0_S - theta_S) * invsin_S;
-        sth_S     = st_S * cos_S;
-
-        cik_S     = st_S  * nrij_1_S * nrkj_1_S;
-        cii_S     = sth_S * nrij_1_S * nrij_1_S;
-        ckk_S     = sth_S * nrkj_1_S * nrkj_1_S;
-
-        f_ix_S    = cii_S * rijx_S;
-        f_ix_S    = fnma(cik_S, rkjx_S, f_ix_S);
-        f_iy_S    = cii_S * rijy_S;
-        f_iy_S    = fnma(cik_S, rkjy_S, f_iy_S);
-        f_iz_S    = cii_S * rijz_S;
-        f_iz_S    = fnma(cik_S, rkjz_S, f_iz_S);
-        f_kx_S    = ckk_S * rkjx_S;
-        f_kx_S    = fnma(cik_S, rijx_S, f_kx_S);
-        f_ky_S    = ckk_S * rkjy_S;
-        f_ky_S    = fnma(cik_S, rijy_S, f_ky_S);
-        f_kz_S    = ckk_S * rkjz_S;
-        f_kz_S    = fnma(cik_S, rijz_S, f_kz_S);
+        v_S = harmonic_angle_simd(rijx_S, rijy_S, rijz_S,
+                                  rkjx_S, rkjy_S, rkjz_S,
+                                  k_S, theta0_S,
+                                  &f_ix_S, &f_iy_S, &f_iz_S,
+                                  &f_kx_S, &f_ky_S, &f_kz_S);
 
         transposeScatterIncrU<4>(reinterpret_cast<real *>(f), ai, f_ix_S, f_iy_S, f_iz_S);
         transposeScatterDecrU<4>(reinterpret_cast<real *>(f), aj, f_ix_S + f_kx_S, f_iy_S + f_ky_S, f_iz_S + f_kz_S);
         transposeScatterIncrU<4>(reinterpret_cast<real *>(f), ak, f_kx_S, f_ky_S, f_kz_S);
+
+        if (fshift != nullptr)
+        {
+            vtot_S = vtot_S + v_S;
+
+            store_force_simd(fbuf, f_ix_S, f_iy_S, f_iz_S);
+            store_force_simd(fbuf + DIM*GMX_SIMD_REAL_WIDTH, f_kx_S, f_ky_S, f_kz_S);
+            add_shift_forces_simd(simd_batch_size(i, nbonds, nfa1), aj,
+                                  2, aother, fbuf, pbc, g, x, fshift);
+        }
     }
+
+    return reduce(vtot_S);
 }
 
 #endif // GMX_SIMD_HAVE_REAL
@@ -1295,6 +1499,145 @@ real urey_bradley(int nbonds,
     return vtot;
 }
 
+#if GMX_SIMD_HAVE_REAL
+
+/* As urey_bradley, but using SIMD to calculate many angles at once */
+real
+urey_bradley_simd(int nbonds,
+                  const t_iatom forceatoms[], const t_iparams forceparams[],
+                  const rvec x[], rvec4 f[], rvec fshift[],
+                  const t_pbc *pbc, const t_graph *g)
+{
+    const int            nfa1 = 4;
+    int                  i, iu, s;
+    int                  type;
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    ai[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    aj[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    ak[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   coeff[4*GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   fbuf[2*DIM*GMX_SIMD_REAL_WIDTH];
+    const int           *aother[2] = { ai, ak };
+    SimdReal             deg2rad_S(DEG2RAD);
+    SimdReal             half_S(0.5);
+    SimdReal             dr2_min_S(GMX_REAL_MIN);
+    SimdReal             xi_S, yi_S, zi_S;
+    SimdReal             xj_S, yj_S, zj_S;
+    SimdReal             xk_S, yk_S, zk_S;
+    SimdReal             kth_S, theta0_S, kUB_S, r13_S;
+    SimdReal             rijx_S, rijy_S, rijz_S;
+    SimdReal             rkjx_S, rkjy_S, rkjz_S;
+    SimdReal             rikx_S, riky_S, rikz_S;
+    SimdReal             f_ix_S, f_iy_S, f_iz_S;
+    SimdReal             f_kx_S, f_ky_S, f_kz_S;
+    SimdReal             dr2_S, rinv_S, ddr_S, fbond_S;
+    SimdReal             v_S;
+    SimdReal             vtot_S = setZero();
+    SimdBool             nonzero_S;
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)    pbc_simd[9*GMX_SIMD_REAL_WIDTH];
+
+    set_pbc_simd(pbc, pbc_simd);
+
+    /* nbonds is the number of angles times nfa1, here we step GMX_SIMD_REAL_WIDTH angles */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH*nfa1)
+    {
+        /* Collect atoms for GMX_SIMD_REAL_WIDTH angles.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu+1];
+            aj[s] = forceatoms[iu+2];
+            ak[s] = forceatoms[iu+3];
+
+            /* At the end fill the arrays with the last atoms and 0 params */
+            if (i + s*nfa1 < nbonds)
+            {
+                coeff[0*GMX_SIMD_REAL_WIDTH+s] = forceparams[type].u_b.kthetaA;
+                coeff[1*GMX_SIMD_REAL_WIDTH+s] = forceparams[type].u_b.thetaA;
+                coeff[2*GMX_SIMD_REAL_WIDTH+s] = forceparams[type].u_b.kUBA;
+                coeff[3*GMX_SIMD_REAL_WIDTH+s] = forceparams[type].u_b.r13A;
+
+                if (iu + nfa1 < nbonds)
+                {
+                    iu += nfa1;
+                }
+            }
+            else
+            {
+                coeff[0*GMX_SIMD_REAL_WIDTH+s] = 0;
+                coeff[1*GMX_SIMD_REAL_WIDTH+s] = 0;
+                coeff[2*GMX_SIMD_REAL_WIDTH+s] = 0;
+                coeff[3*GMX_SIMD_REAL_WIDTH+s] = 0;
+            }
+        }
+
+        gatherLoadUTranspose<3>(reinterpret_cast<const real *>(x), ai, &xi_S, &yi_S, &zi_S);
+        gatherLoadUTranspose<3>(reinterpret_cast<const real *>(x), aj, &xj_S, &yj_S, &zj_S);
+        gatherLoadUTranspose<3>(reinterpret_cast<const real *>(x), ak, &xk_S, &yk_S, &zk_S);
+        rijx_S = xi_S - xj_S;
+        rijy_S = yi_S - yj_S;
+        rijz_S = zi_S - zj_S;
+        rkjx_S = xk_S - xj_S;
+        rkjy_S = yk_S - yj_S;
+        rkjz_S = zk_S - zj_S;
+
+        kth_S     = load(coeff + 0*GMX_SIMD_REAL_WIDTH);
+        theta0_S  = load(coeff + 1*GMX_SIMD_REAL_WIDTH) * deg2rad_S;
+        kUB_S     = load(coeff + 2*GMX_SIMD_REAL_WIDTH);
+        r13_S     = load(coeff + 3*GMX_SIMD_REAL_WIDTH);
+
+        pbc_correct_dx_simd(&rijx_S, &rijy_S, &rijz_S, pbc_simd);
+        pbc_correct_dx_simd(&rkjx_S, &rkjy_S, &rkjz_S, pbc_simd);
+
+        v_S = harmonic_angle_simd(rijx_S, rijy_S, rijz_S,
+                                  rkjx_S, rkjy_S, rkjz_S,
+                                  kth_S, theta0_S,
+                                  &f_ix_S, &f_iy_S, &f_iz_S,
+                                  &f_kx_S, &f_ky_S, &f_kz_S);
+
+        /* The Urey-Bradley bond between atoms i and k. We derive the
+         * distance vector from the PBC corrected vectors of the angle.
+         * As in the plain-C code, bonds of zero length do not contribute.
+         */
+        rikx_S    = rijx_S - rkjx_S;
+        riky_S    = rijy_S - rkjy_S;
+        rikz_S    = rijz_S - rkjz_S;
+        dr2_S     = norm2(rikx_S, riky_S, rikz_S);
+        nonzero_S = (setZero() < dr2_S);
+        dr2_S     = max(dr2_S, dr2_min_S);
+        rinv_S    = invsqrt(dr2_S);
+        ddr_S     = dr2_S * rinv_S - r13_S;
+        fbond_S   = selectByMask(kUB_S * ddr_S * rinv_S, nonzero_S);
+
+        f_ix_S    = fnma(fbond_S, rikx_S, f_ix_S);
+        f_iy_S    = fnma(fbond_S, riky_S, f_iy_S);
+        f_iz_S    = fnma(fbond_S, rikz_S, f_iz_S);
+        f_kx_S    = fma(fbond_S, rikx_S, f_kx_S);
+        f_ky_S    = fma(fbond_S, riky_S, f_ky_S);
+        f_kz_S    = fma(fbond_S, rikz_S, f_kz_S);
+
+        transposeScatterIncrU<4>(reinterpret_cast<real *>(f), ai, f_ix_S, f_iy_S, f_iz_S);
+        transposeScatterDecrU<4>(reinterpret_cast<real *>(f), aj, f_ix_S + f_kx_S, f_iy_S + f_ky_S, f_iz_S + f_kz_S);
+        transposeScatterIncrU<4>(reinterpret_cast<real *>(f), ak, f_kx_S, f_ky_S, f_kz_S);
+
+        if (fshift != nullptr)
+        {
+            vtot_S = vtot_S + v_S + selectByMask(half_S * kUB_S * ddr_S * ddr_S, nonzero_S);
+
+            store_force_simd(fbuf, f_ix_S, f_iy_S, f_iz_S);
+            store_force_simd(fbuf + DIM*GMX_SIMD_REAL_WIDTH, f_kx_S, f_ky_S, f_kz_S);
+            add_shift_forces_simd(simd_batch_size(i, nbonds, nfa1), aj,
+                                  2, aother, fbuf, pbc, g, x, fshift);
+        }
+    }
+
+    return reduce(vtot_S);
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
 real quartic_angles(int nbonds,
                     const t_iatom forceatoms[], const t_iparams forceparams[],
                     const rvec x[], rvec4 f[], rvec fshift[],
@@ -1635,13 +1978,16 @@ do_dih_fup_noshiftf(int i, int j, int k, int l, real ddphi,
 }
 
 #if GMX_SIMD_HAVE_REAL
-/* As do_dih_fup_noshiftf above, but with SIMD and pre-calculated pre-factors */
+/* As do_dih_fup_noshiftf above, but with SIMD and pre-calculated pre-factors.
+ * When fbuf is not NULL, the forces on atoms i, k and l are stored
+ * in fbuf for add_shift_forces_simd().
+ */
 static gmx_inline void gmx_simdcall
-do_dih_fup_noshiftf_simd(const int *ai, const int *aj, const int *ak, const int *al,
-                         SimdReal p, SimdReal q,
-                         SimdReal f_i_x,  SimdReal f_i_y,  SimdReal f_i_z,
-                         SimdReal mf_l_x, SimdReal mf_l_y, SimdReal mf_l_z,
-                         rvec4 f[])
+do_dih_fup_simd(const int *ai, const int *aj, const int *ak, const int *al,
+                SimdReal p, SimdReal q,
+                SimdReal f_i_x,  SimdReal f_i_y,  SimdReal f_i_z,
+                SimdReal mf_l_x, SimdReal mf_l_y, SimdReal mf_l_z,
+                rvec4 f[], real *fbuf)
 {
     SimdReal sx    = p * f_i_x + q * mf_l_x;
     SimdReal sy    = p * f_i_y + q * mf_l_y;
@@ -1656,6 +2002,13 @@ do_dih_fup_noshiftf_simd(const int *ai, const int *aj, const int *ak, const int
     transposeScatterDecrU<4>(reinterpret_cast<real *>(f), aj, f_j_x, f_j_y, f_j_z);
     transposeScatterIncrU<4>(reinterpret_cast<real *>(f), ak, f_k_x, f_k_y, f_k_z);
     transposeScatterDecrU<4>(reinterpret_cast<real *>(f), al, mf_l_x, mf_l_y, mf_l_z);
+
+    if (fbuf != nullptr)
+    {
+        store_force_simd(fbuf + 0*DIM*GMX_SIMD_REAL_WIDTH, f_i_x, f_i_y, f_i_z);
+        store_force_simd(fbuf + 1*DIM*GMX_SIMD_REAL_WIDTH, f_k_x, f_k_y, f_k_z);
+        store_force_simd(fbuf + 2*DIM*GMX_SIMD_REAL_WIDTH, -mf_l_x, -mf_l_y, -mf_l_z);
+    }
 }
 #endif // GMX_SIMD_HAVE_REAL
 
@@ -1844,15 +2197,12 @@ pdihs_noener(int nbonds,
 
 #if GMX_SIMD_HAVE_REAL
 
-/* As pdihs_noner above, but using SIMD to calculate many dihedrals at once */
-void
-pdihs_noener_simd(int nbonds,
-                  const t_iatom forceatoms[], const t_iparams forceparams[],
-                  const rvec x[], rvec4 f[],
-                  const t_pbc *pbc, const t_graph gmx_unused *g,
-                  real gmx_unused lambda,
-                  const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-                  int gmx_unused *global_atom_index)
+/* As pdihs above, but using SIMD to calculate many dihedrals at once */
+real
+pdihs_simd(int nbonds,
+           const t_iatom forceatoms[], const t_iparams forceparams[],
+           const rvec x[], rvec4 f[], rvec fshift[],
+           const t_pbc *pbc, const t_graph *g)
 {
     const int             nfa1 = 5;
     int                   i, iu, s;
@@ -1862,8 +2212,11 @@ pdihs_noener_simd(int nbonds,
     GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    ak[GMX_SIMD_REAL_WIDTH];
     GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    al[GMX_SIMD_REAL_WIDTH];
     GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)  buf[3*GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)  fbuf[3*DIM*GMX_SIMD_REAL_WIDTH];
+    const int            *aother[3] = { ai, ak, al };
     real                 *cp, *phi0, *mult;
     SimdReal              deg2rad_S(DEG2RAD);
+    SimdReal              one_S(1.0);
     SimdReal              p_S, q_S;
     SimdReal              phi0_S, phi_S;
     SimdReal              mx_S, my_S, mz_S;
@@ -1873,6 +2226,7 @@ pdihs_noener_simd(int nbonds,
     SimdReal              sin_S, cos_S;
     SimdReal              mddphi_S;
     SimdReal              sf_i_S, msf_l_S;
+    SimdReal              vtot_S = setZero();
     GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)    pbc_simd[9*GMX_SIMD_REAL_WIDTH];
 
     /* Extract aligned pointer for parameters and variables */
@@ -1948,26 +2302,32 @@ pdihs_noener_simd(int nbonds,
         ny_S     = msf_l_S * ny_S;
         nz_S     = msf_l_S * nz_S;
 
-        do_dih_fup_noshiftf_simd(ai, aj, ak, al,
-                                 p_S, q_S,
-                                 mx_S, my_S, mz_S,
-                                 nx_S, ny_S, nz_S,
-                                 f);
+        do_dih_fup_simd(ai, aj, ak, al,
+                        p_S, q_S,
+                        mx_S, my_S, mz_S,
+                        nx_S, ny_S, nz_S,
+                        f, fshift != nullptr ? fbuf : nullptr);
+
+        if (fshift != nullptr)
+        {
+            vtot_S = fma(cp_S, one_S + cos_S, vtot_S);
+
+            add_shift_forces_simd(simd_batch_size(i, nbonds, nfa1), aj,
+                                  3, aother, fbuf, pbc, g, x, fshift);
+        }
     }
+
+    return reduce(vtot_S);
 }
 
-/* This is mostly a copy of pdihs_noener_simd above, but with using
+/* This is mostly a copy of pdihs_simd above, but with using
  * the RB potential instead of a harmonic potential.
- * This function can replace rbdihs() when no energy and virial are needed.
  */
-void
-rbdihs_noener_simd(int nbonds,
-                   const t_iatom forceatoms[], const t_iparams forceparams[],
-                   const rvec x[], rvec4 f[],
-                   const t_pbc *pbc, const t_graph gmx_unused *g,
-                   real gmx_unused lambda,
-                   const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-                   int gmx_unused *global_atom_index)
+real
+rbdihs_simd(int nbonds,
+            const t_iatom forceatoms[], const t_iparams forceparams[],
+            const rvec x[], rvec4 f[], rvec fshift[],
+            const t_pbc *pbc, const t_graph *g)
 {
     const int             nfa1 = 5;
     int                   i, iu, s, j;
@@ -1977,6 +2337,8 @@ rbdihs_noener_simd(int nbonds,
     GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    ak[GMX_SIMD_REAL_WIDTH];
     GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    al[GMX_SIMD_REAL_WIDTH];
     GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) parm[NR_RBDIHS*GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH) fbuf[3*DIM*GMX_SIMD_REAL_WIDTH];
+    const int            *aother[3] = { ai, ak, al };
 
     SimdReal              p_S, q_S;
     SimdReal              phi_S;
@@ -1987,6 +2349,8 @@ rbdihs_noener_simd(int nbonds,
     SimdReal              parm_S, c_S;
     SimdReal              sin_S, cos_S;
     SimdReal              sf_i_S, msf_l_S;
+    SimdReal              v_S;
+    SimdReal              vtot_S = setZero();
     GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)    pbc_simd[9*GMX_SIMD_REAL_WIDTH];
 
     SimdReal              pi_S(M_PI);
@@ -2009,13 +2373,13 @@ rbdihs_noener_simd(int nbonds,
             ak[s] = forceatoms[iu+3];
             al[s] = forceatoms[iu+4];
 
-            /* At the end fill the arrays with the last atoms and 0 params */
+            /* At the end fill the arrays with the last atoms and 0 params.
+             * The first parameter is a constant which only affects
+             * the energies, not the forces.
+             */
             if (i + s*nfa1 < nbonds)
             {
-                /* We don't need the first parameter, since that's a constant
-                 * which only affects the energies, not the forces.
-                 */
-                for (j = 1; j < NR_RBDIHS; j++)
+                for (j = 0; j < NR_RBDIHS; j++)
                 {
                     parm[j*GMX_SIMD_REAL_WIDTH + s] =
                         forceparams[type].rbdihs.rbcA[j];
@@ -2028,7 +2392,7 @@ rbdihs_noener_simd(int nbonds,
             }
             else
             {
-                for (j = 1; j < NR_RBDIHS; j++)
+                for (j = 0; j < NR_RBDIHS; j++)
                 {
                     parm[j*GMX_SIMD_REAL_WIDTH + s] = 0;
                 }
@@ -2049,6 +2413,7 @@ rbdihs_noener_simd(int nbonds,
 
         sincos(phi_S, &sin_S, &cos_S);
 
+        v_S       = load(parm);
         ddphi_S   = setZero();
         c_S       = one_S;
         cosfac_S  = one_S;
@@ -2058,6 +2423,7 @@ rbdihs_noener_simd(int nbonds,
             ddphi_S  = fma(c_S * parm_S, cosfac_S, ddphi_S);
             cosfac_S = cosfac_S * cos_S;
             c_S      = c_S + one_S;
+            v_S      = fma(parm_S, cosfac_S, v_S);
         }
 
         /* Note that here we do not use the minus sign which is present
@@ -2078,12 +2444,22 @@ rbdihs_noener_simd(int nbonds,
         ny_S     = msf_l_S * ny_S;
         nz_S     = msf_l_S * nz_S;
 
-        do_dih_fup_noshiftf_simd(ai, aj, ak, al,
-                                 p_S, q_S,
-                                 mx_S, my_S, mz_S,
-                                 nx_S, ny_S, nz_S,
-                                 f);
+        do_dih_fup_simd(ai, aj, ak, al,
+                        p_S, q_S,
+                        mx_S, my_S, mz_S,
+                        nx_S, ny_S, nz_S,
+                        f, fshift != nullptr ? fbuf : nullptr);
+
+        if (fshift != nullptr)
+        {
+            vtot_S = vtot_S + v_S;
+
+            add_shift_forces_simd(simd_batch_size(i, nbonds, nfa1), aj,
+                                  3, aother, fbuf, pbc, g, x, fshift);
+        }
     }
+
+    return reduce(vtot_S);
 }
 
 #endif // GMX_SIMD_HAVE_REAL
@@ -2160,6 +2536,124 @@ real idihs(int nbonds,
     return vtot;
 }
 
+#if GMX_SIMD_HAVE_REAL
+
+/* As idihs above, but using SIMD to calculate many dihedrals at once */
+real
+idihs_simd(int nbonds,
+           const t_iatom forceatoms[], const t_iparams forceparams[],
+           const rvec x[], rvec4 f[], rvec fshift[],
+           const t_pbc *pbc, const t_graph *g)
+{
+    const int             nfa1 = 5;
+    int                   i, iu, s;
+    int                   type;
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    ai[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    aj[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    ak[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    al[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)  coeff[2*GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)  fbuf[3*DIM*GMX_SIMD_REAL_WIDTH];
+    const int            *aother[3] = { ai, ak, al };
+    SimdReal              deg2rad_S(DEG2RAD);
+    SimdReal              half_S(0.5);
+    SimdReal              two_pi_S(2*M_PI);
+    SimdReal              inv_two_pi_S(1/(2*M_PI));
+    SimdReal              p_S, q_S;
+    SimdReal              phi_S, phi0_S, dp_S, k_S;
+    SimdReal              mx_S, my_S, mz_S;
+    SimdReal              nx_S, ny_S, nz_S;
+    SimdReal              nrkj_m2_S, nrkj_n2_S;
+    SimdReal              mddphi_S;
+    SimdReal              sf_i_S, msf_l_S;
+    SimdReal              vtot_S = setZero();
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)    pbc_simd[9*GMX_SIMD_REAL_WIDTH];
+
+    set_pbc_simd(pbc, pbc_simd);
+
+    /* nbonds is the number of dihedrals times nfa1, here we step GMX_SIMD_REAL_WIDTH dihs */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH*nfa1)
+    {
+        /* Collect atoms quadruplets for GMX_SIMD_REAL_WIDTH dihedrals.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            type  = forceatoms[iu];
+            ai[s] = forceatoms[iu+1];
+            aj[s] = forceatoms[iu+2];
+            ak[s] = forceatoms[iu+3];
+            al[s] = forceatoms[iu+4];
+
+            /* At the end fill the arrays with the last atoms and 0 params */
+            if (i + s*nfa1 < nbonds)
+            {
+                coeff[s]                     = forceparams[type].harmonic.krA;
+                coeff[GMX_SIMD_REAL_WIDTH+s] = forceparams[type].harmonic.rA;
+
+                if (iu + nfa1 < nbonds)
+                {
+                    iu += nfa1;
+                }
+            }
+            else
+            {
+                coeff[s]                     = 0;
+                coeff[GMX_SIMD_REAL_WIDTH+s] = 0;
+            }
+        }
+
+        /* Caclulate GMX_SIMD_REAL_WIDTH dihedral angles at once */
+        dih_angle_simd(x, ai, aj, ak, al, pbc_simd,
+                       &phi_S,
+                       &mx_S, &my_S, &mz_S,
+                       &nx_S, &ny_S, &nz_S,
+                       &nrkj_m2_S,
+                       &nrkj_n2_S,
+                       &p_S, &q_S);
+
+        k_S      = load(coeff);
+        phi0_S   = load(coeff + GMX_SIMD_REAL_WIDTH) * deg2rad_S;
+
+        /* As make_dp_periodic(), put phi-phi0 in the range (-pi,pi) */
+        dp_S     = phi_S - phi0_S;
+        dp_S     = fnma(two_pi_S, round(dp_S * inv_two_pi_S), dp_S);
+
+        mddphi_S = -k_S * dp_S;
+        sf_i_S   = mddphi_S * nrkj_m2_S;
+        msf_l_S  = mddphi_S * nrkj_n2_S;
+
+        /* After this m?_S will contain f[i] */
+        mx_S     = sf_i_S * mx_S;
+        my_S     = sf_i_S * my_S;
+        mz_S     = sf_i_S * mz_S;
+
+        /* After this m?_S will contain -f[l] */
+        nx_S     = msf_l_S * nx_S;
+        ny_S     = msf_l_S * ny_S;
+        nz_S     = msf_l_S * nz_S;
+
+        do_dih_fup_simd(ai, aj, ak, al,
+                        p_S, q_S,
+                        mx_S, my_S, mz_S,
+                        nx_S, ny_S, nz_S,
+                        f, fshift != nullptr ? fbuf : nullptr);
+
+        if (fshift != nullptr)
+        {
+            vtot_S = fma(half_S * k_S, dp_S * dp_S, vtot_S);
+
+            add_shift_forces_simd(simd_batch_size(i, nbonds, nfa1), aj,
+                                  3, aother, fbuf, pbc, g, x, fshift);
+        }
+    }
+
+    return reduce(vtot_S);
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
 static real low_angres(int nbonds,
                        const t_iatom forceatoms[], const t_iparams forceparams[],
                        const rvec x[], rvec4 f[], rvec fshift[],
@@ -3244,7 +3738,7 @@ cmap_dihs(int nbonds,
         rvec_inc(fshift[t21], f1_k);
         rvec_inc(fshift[t31], f1_l);
 
-        rvec_inc(fshift[t21], f2_i);
+        rvec_inc(fshift[t12], f2_i);
         rvec_inc(fshift[CENTRAL], f2_j);
         rvec_inc(fshift[t22], f2_k);
         rvec_inc(fshift[t32], f2_l);
@@ -3252,6 +3746,242 @@ cmap_dihs(int nbonds,
     return vtot;
 }
 
+#if GMX_SIMD_HAVE_REAL
+
+/* As cmap_dihs above, but using SIMD to calculate many CMAP terms at once.
+ * The dihedral angles, the bicubic interpolation and the force update
+ * use SIMD, the grid lookup is done per interaction.
+ */
+real
+cmap_dihs_simd(int nbonds,
+               const t_iatom forceatoms[], const t_iparams forceparams[],
+               const gmx_cmap_t *cmap_grid,
+               const rvec x[], rvec4 f[], rvec fshift[],
+               const t_pbc *pbc, const t_graph *g)
+{
+    const int             nfa1 = 6;
+    int                   i, iu, s, k, idx;
+    int                   type;
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    ai[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    aj[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    ak[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    al[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(int, GMX_SIMD_REAL_WIDTH)    am[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   xphi1[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   xphi2[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   tt[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   tu[GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   tx[16*GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   fbuf1[3*DIM*GMX_SIMD_REAL_WIDTH];
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)   fbuf2[3*DIM*GMX_SIMD_REAL_WIDTH];
+    const int            *aother1[3] = { ai, ak, al };
+    const int            *aother2[3] = { aj, al, am };
+    const int             grid_spacing = cmap_grid->grid_spacing;
+    /* Grid spacing in radians and in degrees */
+    const real            dx_rad = 2*M_PI/grid_spacing;
+    const real            dx_deg = 360.0/grid_spacing;
+    SimdReal              pi_S(M_PI);
+    SimdReal              two_S(2.0);
+    SimdReal              three_S(3.0);
+    SimdReal              fac_S(RAD2DEG/dx_deg);
+    SimdReal              phi1_S, p1_S, q1_S;
+    SimdReal              m1x_S, m1y_S, m1z_S;
+    SimdReal              n1x_S, n1y_S, n1z_S;
+    SimdReal              nrkj_m2_1_S, nrkj_n2_1_S;
+    SimdReal              phi2_S, p2_S, q2_S;
+    SimdReal              m2x_S, m2y_S, m2z_S;
+    SimdReal              n2x_S, n2y_S, n2z_S;
+    SimdReal              nrkj_m2_2_S, nrkj_n2_2_S;
+    SimdReal              tx_S[16], tc_S[16];
+    SimdReal              tt_S, tu_S;
+    SimdReal              e_S, df1_S, df2_S;
+    SimdReal              vtot_S = setZero();
+    GMX_ALIGNED(real, GMX_SIMD_REAL_WIDTH)    pbc_simd[9*GMX_SIMD_REAL_WIDTH];
+
+    set_pbc_simd(pbc, pbc_simd);
+
+    /* nbonds is the number of CMAP terms times nfa1, here we step GMX_SIMD_REAL_WIDTH terms */
+    for (i = 0; (i < nbonds); i += GMX_SIMD_REAL_WIDTH*nfa1)
+    {
+        /* Collect the atoms for GMX_SIMD_REAL_WIDTH CMAP terms.
+         * iu indexes into forceatoms, we should not let iu go beyond nbonds.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            ai[s] = forceatoms[iu+1];
+            aj[s] = forceatoms[iu+2];
+            ak[s] = forceatoms[iu+3];
+            al[s] = forceatoms[iu+4];
+            am[s] = forceatoms[iu+5];
+
+            if (i + s*nfa1 < nbonds && iu + nfa1 < nbonds)
+            {
+                iu += nfa1;
+            }
+        }
+
+        /* The two torsions, phi1 over atoms i-l and phi2 over atoms j-m */
+        dih_angle_simd(x, ai, aj, ak, al, pbc_simd,
+                       &phi1_S,
+                       &m1x_S, &m1y_S, &m1z_S,
+                       &n1x_S, &n1y_S, &n1z_S,
+                       &nrkj_m2_1_S, &nrkj_n2_1_S,
+                       &p1_S, &q1_S);
+        dih_angle_simd(x, aj, ak, al, am, pbc_simd,
+                       &phi2_S,
+                       &m2x_S, &m2y_S, &m2z_S,
+                       &n2x_S, &n2y_S, &n2z_S,
+                       &nrkj_m2_2_S, &nrkj_n2_2_S,
+                       &p2_S, &q2_S);
+
+        store(xphi1, phi1_S + pi_S);
+        store(xphi2, phi2_S + pi_S);
+
+        /* Look up the grid values for each term, as in cmap_dihs().
+         * The padding terms get zero values and thus no energy and force.
+         */
+        iu = i;
+        for (s = 0; s < GMX_SIMD_REAL_WIDTH; s++)
+        {
+            if (i + s*nfa1 >= nbonds)
+            {
+                for (k = 0; k < 16; k++)
+                {
+                    tx[k*GMX_SIMD_REAL_WIDTH + s] = 0;
+                }
+                tt[s] = 0;
+                tu[s] = 0;
+                continue;
+            }
+
+            type = forceatoms[iu];
+            iu  += nfa1;
+
+            const real *cmapd = cmap_grid->cmapdata[forceparams[type].cmap.cmapA].cmap;
+
+            /* Range mangling */
+            for (real *xphi : { &xphi1[s], &xphi2[s] })
+            {
+                if (*xphi < 0)
+                {
+                    *xphi += 2*M_PI;
+                }
+                else if (*xphi >= 2*M_PI)
+                {
+                    *xphi -= 2*M_PI;
+                }
+            }
+
+            int iphi1, ip1m1, ip1p1, ip1p2;
+            int iphi2, ip2m1, ip2p1, ip2p2;
+
+            iphi1 = static_cast<int>(xphi1[s]/dx_rad);
+            iphi2 = static_cast<int>(xphi2[s]/dx_rad);
+
+            iphi1 = cmap_setup_grid_index(iphi1, grid_spacing, &ip1m1, &ip1p1, &ip1p2);
+            iphi2 = cmap_setup_grid_index(iphi2, grid_spacing, &ip2m1, &ip2p1, &ip2p2);
+
+            const int pos[4] = {
+                iphi1*grid_spacing + iphi2,
+                ip1p1*grid_spacing + iphi2,
+                ip1p1*grid_spacing + ip2p1,
+                iphi1*grid_spacing + ip2p1
+            };
+
+            for (k = 0; k < 4; k++)
+            {
+                tx[(k +  0)*GMX_SIMD_REAL_WIDTH + s] = cmapd[pos[k]*4];
+                tx[(k +  4)*GMX_SIMD_REAL_WIDTH + s] = cmapd[pos[k]*4 + 1]*dx_deg;
+                tx[(k +  8)*GMX_SIMD_REAL_WIDTH + s] = cmapd[pos[k]*4 + 2]*dx_deg;
+                tx[(k + 12)*GMX_SIMD_REAL_WIDTH + s] = cmapd[pos[k]*4 + 3]*dx_deg*dx_deg;
+            }
+
+            tt[s] = (xphi1[s]*RAD2DEG - iphi1*dx_deg)/dx_deg;
+            tu[s] = (xphi2[s]*RAD2DEG - iphi2*dx_deg)/dx_deg;
+        }
+
+        /* The bicubic interpolation coefficients */
+        for (k = 0; k < 16; k++)
+        {
+            tx_S[k] = load(tx + k*GMX_SIMD_REAL_WIDTH);
+        }
+        for (idx = 0; idx < 16; idx++)
+        {
+            tc_S[idx] = setZero();
+            for (k = 0; k < 16; k++)
+            {
+                const int c = cmap_coeff_matrix[k*16 + idx];
+                if (c != 0)
+                {
+                    tc_S[idx] = fma(SimdReal(c), tx_S[k], tc_S[idx]);
+                }
+            }
+        }
+
+        tt_S  = load(tt);
+        tu_S  = load(tu);
+
+        e_S   = setZero();
+        df1_S = setZero();
+        df2_S = setZero();
+        for (k = 3; k >= 0; k--)
+        {
+            e_S   = fma(tt_S, e_S,
+                        fma(fma(fma(tc_S[k*4+3], tu_S, tc_S[k*4+2]), tu_S, tc_S[k*4+1]), tu_S, tc_S[k*4]));
+            df1_S = fma(tu_S, df1_S,
+                        fma(fma(three_S*tc_S[k+12], tt_S, two_S*tc_S[k+8]), tt_S, tc_S[k+4]));
+            df2_S = fma(tt_S, df2_S,
+                        fma(fma(three_S*tc_S[k*4+3], tu_S, two_S*tc_S[k*4+2]), tu_S, tc_S[k*4+1]));
+        }
+
+        /* The CMAP force on each torsion is that of a dihedral potential
+         * with dV/dphi equal to the derivative of the interpolant.
+         */
+        df1_S = -df1_S * fac_S;
+        df2_S = -df2_S * fac_S;
+
+        /* After this m?_S will contain f[i] and n?_S -f[l] */
+        m1x_S = df1_S * nrkj_m2_1_S * m1x_S;
+        m1y_S = df1_S * nrkj_m2_1_S * m1y_S;
+        m1z_S = df1_S * nrkj_m2_1_S * m1z_S;
+        n1x_S = df1_S * nrkj_n2_1_S * n1x_S;
+        n1y_S = df1_S * nrkj_n2_1_S * n1y_S;
+        n1z_S = df1_S * nrkj_n2_1_S * n1z_S;
+        m2x_S = df2_S * nrkj_m2_2_S * m2x_S;
+        m2y_S = df2_S * nrkj_m2_2_S * m2y_S;
+        m2z_S = df2_S * nrkj_m2_2_S * m2z_S;
+        n2x_S = df2_S * nrkj_n2_2_S * n2x_S;
+        n2y_S = df2_S * nrkj_n2_2_S * n2y_S;
+        n2z_S = df2_S * nrkj_n2_2_S * n2z_S;
+
+        do_dih_fup_simd(ai, aj, ak, al,
+                        p1_S, q1_S,
+                        m1x_S, m1y_S, m1z_S,
+                        n1x_S, n1y_S, n1z_S,
+                        f, fshift != nullptr ? fbuf1 : nullptr);
+        do_dih_fup_simd(aj, ak, al, am,
+                        p2_S, q2_S,
+                        m2x_S, m2y_S, m2z_S,
+                        n2x_S, n2y_S, n2z_S,
+                        f, fshift != nullptr ? fbuf2 : nullptr);
+
+        if (fshift != nullptr)
+        {
+            vtot_S = vtot_S + e_S;
+
+            add_shift_forces_simd(simd_batch_size(i, nbonds, nfa1), aj,
+                                  3, aother1, fbuf1, pbc, g, x, fshift);
+            add_shift_forces_simd(simd_batch_size(i, nbonds, nfa1), ak,
+                                  3, aother2, fbuf2, pbc, g, x, fshift);
+        }
+    }
+
+    return reduce(vtot_S);
+}
+
+#endif // GMX_SIMD_HAVE_REAL
+
 
 //! \cond
 /***********************************************************
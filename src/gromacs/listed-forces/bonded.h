@@ -124,40 +124,30 @@ void
 
 /* TODO these declarations should be internal to the module */
 
-/* As angles(), but using SIMD to calculate many angles at once.
- * This routines does not calculate energies and shift forces.
+/*! \brief Type of the SIMD bonded kernels
+ *
+ * These calculate the same interactions as the plain-C function with
+ * the same name without _simd, but using SIMD to calculate many
+ * interactions at once. Only the A-state parameters are used, so they
+ * should only be called for interactions that are not perturbed.
+ * When \p fshift is NULL, energies and shift forces are not calculated
+ * and zero is returned.
  */
-void
-    angles_noener_simd(int nbonds,
-                       const t_iatom forceatoms[], const t_iparams forceparams[],
-                       const rvec x[], rvec4 f[],
-                       const struct t_pbc *pbc,
-                       const struct t_graph gmx_unused *g,
-                       real gmx_unused lambda,
-                       const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-                       int gmx_unused *global_atom_index);
-
-/* As pdihs_noener(), but using SIMD to calculate many dihedrals at once. */
-void
-    pdihs_noener_simd(int nbonds,
-                      const t_iatom forceatoms[], const t_iparams forceparams[],
-                      const rvec x[], rvec4 f[],
-                      const struct t_pbc *pbc,
-                      const struct t_graph gmx_unused *g,
-                      real gmx_unused lambda,
-                      const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-                      int gmx_unused *global_atom_index);
-
-/* As rbdihs(), when not needing energy or shift force, using SIMD to calculate many dihedrals at once. */
-void
-    rbdihs_noener_simd(int nbonds,
-                       const t_iatom forceatoms[], const t_iparams forceparams[],
-                       const rvec x[], rvec4 f[],
-                       const struct t_pbc *pbc,
-                       const struct t_graph gmx_unused *g,
-                       real gmx_unused lambda,
-                       const t_mdatoms gmx_unused *md, t_fcdata gmx_unused *fcd,
-                       int gmx_unused *global_atom_index);
+typedef real t_ifunc_simd (int nbonds,
+                           const t_iatom forceatoms[], const t_iparams forceparams[],
+                           const rvec x[], rvec4 f[], rvec fshift[],
+                           const struct t_pbc *pbc, const struct t_graph *g);
+
+t_ifunc_simd bonds_simd, angles_simd, urey_bradley_simd;
+t_ifunc_simd pdihs_simd, idihs_simd, rbdihs_simd;
+
+/* As cmap_dihs(), but using SIMD, see t_ifunc_simd */
+real
+    cmap_dihs_simd(int nbonds,
+                   const t_iatom forceatoms[], const t_iparams forceparams[],
+                   const gmx_cmap_t *cmap_grid,
+                   const rvec x[], rvec4 f[], rvec fshift[],
+                   const struct t_pbc *pbc, const struct t_graph *g);
 
 //! \endcond
 
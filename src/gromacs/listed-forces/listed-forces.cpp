@@ -257,6 +257,56 @@ reduce_thread_output(int n, rvec *f, rvec *fshift,
     }
 }
 
+#if GMX_SIMD_HAVE_REAL
+/*! \brief Returns the SIMD kernel for \p ftype, or NULL when there is none
+ *
+ * CMAP has a SIMD kernel as well, but with a different signature.
+ */
+static t_ifunc_simd *simd_bonded_kernel(int ftype)
+{
+    switch (ftype)
+    {
+        case F_BONDS:
+        case F_HARMONIC:
+            return bonds_simd;
+        case F_ANGLES:
+            return angles_simd;
+        case F_UREY_BRADLEY:
+            return urey_bradley_simd;
+        case F_PDIHS:
+        case F_PIDIHS:
+            return pdihs_simd;
+        case F_IDIHS:
+            return idihs_simd;
+        case F_RBDIHS:
+            return rbdihs_simd;
+        default:
+            return nullptr;
+    }
+}
+
+/*! \brief Returns the number of iatoms entries, starting at \p nb0 and of
+ * length \p nbn, that can be computed by the SIMD kernels
+ *
+ * The SIMD kernels do not support free-energy perturbation. The
+ * perturbed interactions are sorted to the end of the list, the
+ * non-perturbed ones before them do not depend on lambda.
+ */
+static int simd_bonded_range(const t_idef *idef, int ftype, const t_forcerec *fr,
+                             int nb0, int nbn)
+{
+    if (fr->efep == efepNO)
+    {
+        return nbn;
+    }
+    if (idef->ilsort != ilsortFE_SORTED)
+    {
+        return 0;
+    }
+    return std::min(std::max(idef->il[ftype].nr_nonperturbed - nb0, 0), nbn);
+}
+#endif
+
 /*! \brief Calculate one element of the list of bonded interactions
     for this thread */
 real
@@ -299,68 +349,63 @@ calc_one_bond(int thread,
 
     if (!isPairInteraction(ftype))
     {
+#if GMX_SIMD_HAVE_REAL
+        /* The part of our range that the SIMD kernels can compute */
+        int           nbSimd     = (bUseSIMD ? simd_bonded_range(idef, ftype, fr, nb0, nbn) : 0);
+        t_ifunc_simd *simdKernel = (bUseSIMD ? simd_bonded_kernel(ftype) : nullptr);
+        /* Without energies we do not need shift forces */
+        rvec         *fshiftSimd = (bCalcEnerVir ? fshift : nullptr);
+#endif
+
         if (ftype == F_CMAP)
         {
             /* TODO The execution time for CMAP dihedrals might be
                nice to account to its own subtimer, but first
                wallcycle needs to be extended to support calling from
                multiple threads. */
-            v = cmap_dihs(nbn, iatoms+nb0,
-                          idef->iparams, &idef->cmap_grid,
-                          x, f, fshift,
-                          pbc, g, lambda[efptFTYPE], &(dvdl[efptFTYPE]),
-                          md, fcd, global_atom_index);
-        }
 #if GMX_SIMD_HAVE_REAL
-        else if (ftype == F_ANGLES && bUseSIMD &&
-                 !bCalcEnerVir && fr->efep == efepNO)
-        {
-            /* No energies, shift forces, dvdl */
-            angles_noener_simd(nbn, idef->il[ftype].iatoms+nb0,
-                               idef->iparams,
-                               x, f,
-                               pbc, g, lambda[efptFTYPE], md, fcd,
-                               global_atom_index);
-            v = 0;
-        }
-#endif
-        else if (ftype == F_PDIHS &&
-                 !bCalcEnerVir && fr->efep == efepNO)
-        {
-            /* No energies, shift forces, dvdl */
-#if GMX_SIMD_HAVE_REAL
-            if (bUseSIMD)
+            if (nbSimd > 0)
             {
-                pdihs_noener_simd(nbn, idef->il[ftype].iatoms+nb0,
-                                  idef->iparams,
-                                  x, f,
-                                  pbc, g, lambda[efptFTYPE], md, fcd,
-                                  global_atom_index);
+                v = cmap_dihs_simd(nbSimd, iatoms+nb0,
+                                   idef->iparams, &idef->cmap_grid,
+                                   x, f, fshiftSimd, pbc, g);
+                nb0 += nbSimd;
+                nbn -= nbSimd;
             }
-            else
 #endif
+            v += cmap_dihs(nbn, iatoms+nb0,
+                           idef->iparams, &idef->cmap_grid,
+                           x, f, fshift,
+                           pbc, g, lambda[efptFTYPE], &(dvdl[efptFTYPE]),
+                           md, fcd, global_atom_index);
+        }
+#if GMX_SIMD_HAVE_REAL
+        else if (simdKernel != nullptr)
+        {
+            v = simdKernel(nbSimd, iatoms+nb0, idef->iparams,
+                           x, f, fshiftSimd, pbc, g);
+            if (nbSimd < nbn)
             {
-                pdihs_noener(nbn, idef->il[ftype].iatoms+nb0,
-                             idef->iparams,
-                             x, f,
-                             pbc, g, lambda[efptFTYPE], md, fcd,
-                             global_atom_index);
+                /* The perturbed interactions */
+                v += interaction_function[ftype].ifunc(nbn - nbSimd, iatoms+nb0+nbSimd,
+                                                       idef->iparams,
+                                                       x, f, fshift,
+                                                       pbc, g, lambda[efptFTYPE], &(dvdl[efptFTYPE]),
+                                                       md, fcd, global_atom_index);
             }
-            v = 0;
         }
-#if GMX_SIMD_HAVE_REAL
-        else if (ftype == F_RBDIHS && bUseSIMD &&
+#endif
+        else if (ftype == F_PDIHS &&
                  !bCalcEnerVir && fr->efep == efepNO)
         {
             /* No energies, shift forces, dvdl */
-            rbdihs_noener_simd(nbn, idef->il[ftype].iatoms+nb0,
-                               idef->iparams,
-                               (const rvec*)x, f,
-                               pbc, g, lambda[efptFTYPE], md, fcd,
-                               global_atom_index);
+            pdihs_noener(nbn, idef->il[ftype].iatoms+nb0,
+                         idef->iparams,
+                         x, f,
+                         pbc, g, lambda[efptFTYPE], md, fcd,
+                         global_atom_index);
             v = 0;
         }
-#endif
         else if (ftype == F_ORIRES)
         {
             if (thread == 0)
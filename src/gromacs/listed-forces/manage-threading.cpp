@@ -52,6 +52,8 @@
 #include <stdlib.h>
 
 #include <algorithm>
+#include <numeric>
+#include <vector>
 
 #include "gromacs/listed-forces/listed-forces.h"
 #include "gromacs/mdlib/gmx_omp_nthreads.h"
@@ -69,8 +71,89 @@ typedef struct {
     int      ftype; /**< the function type index */
     t_ilist *il;    /**< pointer to t_ilist entry corresponding to ftype */
     int      nat;   /**< nr of atoms involved in a single ftype interaction */
+    int      cost;  /**< relative cost of computing a single interaction */
 } ilist_data_t;
 
+/*! \brief Returns a rough estimate of the relative cost of computing
+ * a single interaction of type \p ftype
+ *
+ * The unit is the cost of one atom of a simple bond. Types that
+ * are not listed are assumed to have a cost proportional to their
+ * number of atoms, which is what was used for all types before.
+ */
+static int bonded_cost_weight(int ftype)
+{
+    switch (ftype)
+    {
+        case F_UREY_BRADLEY:
+            /* An angle plus a bond */
+            return 5;
+        case F_PDIHS:
+        case F_PIDIHS:
+        case F_ANGRES:
+        case F_ANGRESZ:
+            /* Trigonometric functions of the dihedral angle */
+            return 8;
+        case F_IDIHS:
+        case F_RBDIHS:
+        case F_FOURDIHS:
+            return 6;
+        case F_CMAP:
+            /* Two dihedrals and a bicubic spline interpolation */
+            return 30;
+        default:
+            return NRAL(ftype);
+    }
+}
+
+/*! \brief Sorts the interactions in range \p start to \p end of \p il
+ * on their first atom index
+ *
+ * The division by locality assumes that the interactions of each
+ * type are ordered by their first atom. This holds for interactions
+ * generated by the domain decomposition from scratch, but not when
+ * the local topology is updated incrementally or for some topologies
+ * without DD. The sort is stable, so the order of interactions with
+ * the same first atom is preserved. Nothing is done when the range
+ * is already sorted, which is the common case.
+ */
+static void sort_ilist_by_first_atom(t_ilist          *il,
+                                     int               nral,
+                                     int               start,
+                                     int               end,
+                                     std::vector<int> *order,
+                                     std::vector<int> *buffer)
+{
+    const int  stride  = 1 + nral;
+    t_iatom   *iatoms  = il->iatoms;
+    bool       bSorted = true;
+    for (int i = start + stride; i < end && bSorted; i += stride)
+    {
+        bSorted = (iatoms[i + 1] >= iatoms[i + 1 - stride]);
+    }
+    if (bSorted)
+    {
+        return;
+    }
+
+    const int n = (end - start)/stride;
+    order->resize(n);
+    std::iota(order->begin(), order->end(), 0);
+    std::stable_sort(order->begin(), order->end(),
+                     [iatoms, start, stride](int a, int b)
+                     {
+                         return iatoms[start + a*stride + 1] < iatoms[start + b*stride + 1];
+                     });
+    buffer->resize(end - start);
+    for (int e = 0; e < n; e++)
+    {
+        std::copy(iatoms + start + (*order)[e]*stride,
+                  iatoms + start + ((*order)[e] + 1)*stride,
+                  buffer->begin() + e*stride);
+    }
+    std::copy(buffer->begin(), buffer->end(), iatoms + start);
+}
+
 /*! \brief Divides listed interactions over threads
  *
  * This routine attempts to divide all interactions of the ntype bondeds
@@ -83,18 +166,18 @@ static void divide_bondeds_by_locality(int                 ntype,
                                        int                 nthread,
                                        t_idef             *idef)
 {
-    int nat_tot, nat_sum;
+    int cost_tot, cost_sum;
     int ind[F_NRE];    /* index into the ild[].il->iatoms */
     int at_ind[F_NRE]; /* index of the first atom of the interaction at ind */
     int f, t;
 
     assert(ntype <= F_NRE);
 
-    nat_tot = 0;
+    cost_tot = 0;
     for (f = 0; f < ntype; f++)
     {
-        /* Sum #bondeds*#atoms_per_bond over all bonded types */
-        nat_tot  += ild[f].il->nr/(ild[f].nat + 1)*ild[f].nat;
+        /* Sum #bondeds*cost_per_bond over all bonded types */
+        cost_tot += ild[f].il->nr/(ild[f].nat + 1)*ild[f].cost;
         /* The start bound for thread 0 is 0 for all interactions */
         ind[f]    = 0;
         /* Initialize the next atom index array */
@@ -102,7 +185,7 @@ static void divide_bondeds_by_locality(int                 ntype,
         at_ind[f] = ild[f].il->iatoms[1];
     }
 
-    nat_sum = 0;
+    cost_sum = 0;
     /* Loop over the end bounds of the nthread threads to determine
      * which interactions threads 0 to nthread shall calculate.
      *
@@ -116,18 +199,16 @@ static void divide_bondeds_by_locality(int                 ntype,
      */
     for (t = 1; t <= nthread; t++)
     {
-        int nat_thread;
-
-        /* Here we assume that the computational cost is proportional
-         * to the number of atoms in the interaction. This is a rough
-         * measure, but roughly correct. Usually there are very few
-         * interactions anyhow and there are distributed relatively
-         * uniformly. Proper and RB dihedrals are often distributed
-         * non-uniformly, but their cost is roughly equal.
+        int cost_thread;
+
+        /* We balance the estimated cost of the interactions, see
+         * bonded_cost_weight(). This is a rough measure, but it avoids
+         * the threads that get the dihedrals or CMAP terms of a protein
+         * ending up with much more work than those that get bonds.
          */
-        nat_thread = (nat_tot*t)/nthread;
+        cost_thread = (cost_tot*t)/nthread;
 
-        while (nat_sum < nat_thread)
+        while (cost_sum < cost_thread)
         {
             /* To divide bonds based on atom order, we compare
              * the index of the first atom in the bonded interaction.
@@ -157,7 +238,7 @@ static void divide_bondeds_by_locality(int                 ntype,
              * index f_min) to thread t-1 by increasing ind.
              */
             ind[f_min] += ild[f_min].nat + 1;
-            nat_sum    += ild[f_min].nat;
+            cost_sum   += ild[f_min].cost;
 
             /* Update the first unassigned atom index for this type */
             if (ind[f_min] < ild[f_min].il->nr)
@@ -193,9 +274,10 @@ static void divide_bondeds_over_threads(t_idef *idef,
                                         int     max_nthread_uniform,
                                         bool   *haveBondeds)
 {
-    ilist_data_t ild[F_NRE];
-    int          ntype;
-    int          f;
+    ilist_data_t     ild[F_NRE];
+    int              ntype;
+    int              f;
+    std::vector<int> sortOrder, sortBuffer;
 
     assert(nthread > 0);
 
@@ -272,6 +354,26 @@ static void divide_bondeds_over_threads(t_idef *idef,
             ild[ntype].ftype = f;
             ild[ntype].il    = &idef->il[f];
             ild[ntype].nat   = nat;
+            ild[ntype].cost  = bonded_cost_weight(f);
+
+            /* Ensure the interactions are ordered by atom index, so each
+             * thread gets a compact atom range. With free-energy sorting
+             * the perturbed interactions should stay at the end.
+             * Orientation restraint data is stored in list order.
+             */
+            t_ilist *il = &idef->il[f];
+            if (f != F_ORIRES && idef->ilsort == ilsortFE_SORTED)
+            {
+                sort_ilist_by_first_atom(il, nat, 0, il->nr_nonperturbed,
+                                         &sortOrder, &sortBuffer);
+                sort_ilist_by_first_atom(il, nat, il->nr_nonperturbed, il->nr,
+                                         &sortOrder, &sortBuffer);
+            }
+            else if (f != F_ORIRES)
+            {
+                sort_ilist_by_first_atom(il, nat, 0, il->nr,
+                                         &sortOrder, &sortBuffer);
+            }
 
             /* The first index for the thread division is always 0 */
             idef->il_thread_division[f*(nthread + 1)] = 0;
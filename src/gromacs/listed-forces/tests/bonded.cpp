@@ -46,12 +46,15 @@
 #include <cmath>
 
 #include <memory>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include "gromacs/math/units.h"
 #include "gromacs/pbcutil/ishift.h"
 #include "gromacs/pbcutil/pbc.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/topology/idef.h"
 
 #include "testutils/refdata.h"
 #include "testutils/testasserts.h"
@@ -274,6 +277,352 @@ TEST_F (BondedTest, IfuncProperDihedralsPbcXyz)
     testIfunc(F_PDIHS, iatoms, &iparams, epbcXYZ);
 }
 
+/*! \brief Fills a CMAP grid with a smooth periodic surface
+ *
+ * The values and derivatives are analytical, so the grid is
+ * consistent for the bicubic interpolation.
+ */
+void fillCmapGrid(int gridSpacing, std::vector<real> *grid)
+{
+    grid->resize(4*gridSpacing*gridSpacing);
+    for (int i = 0; i < gridSpacing; i++)
+    {
+        for (int j = 0; j < gridSpacing; j++)
+        {
+            real phi = 2*M_PI*i/gridSpacing;
+            real psi = 2*M_PI*j/gridSpacing;
+            real *v  = &(*grid)[4*(i*gridSpacing + j)];
+            v[0]     = 3*std::cos(phi) + 2*std::sin(psi) + std::cos(phi + psi);
+            v[1]     = -3*std::sin(phi) - std::sin(phi + psi);
+            v[2]     = 2*std::cos(psi) - std::sin(phi + psi);
+            v[3]     = -std::cos(phi + psi);
+        }
+    }
+}
+
+/*! \brief Checks that CMAP shift forces compensate for periodic images
+ *
+ * Each atom in turn is moved by a box vector. The forces do not change,
+ * and the shift forces should then change such that the sum of x f over
+ * the atoms and of the shift vectors times the shift forces, which gives
+ * the virial, stays the same.
+ */
+TEST (CmapTest, ShiftForcesCompensateForPeriodicImages)
+{
+    const int            natoms      = 5;
+    const int            gridSpacing = 24;
+    std::vector<real>    grid;
+    fillCmapGrid(gridSpacing, &grid);
+    gmx_cmapdata_t cmapdata;
+    cmapdata.cmap = grid.data();
+    gmx_cmap_t     cmapGrid;
+    cmapGrid.ngrid        = 1;
+    cmapGrid.grid_spacing = gridSpacing;
+    cmapGrid.cmapdata     = &cmapdata;
+
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 2, 3, 4 };
+    t_iparams            iparams;
+    iparams.cmap.cmapA = iparams.cmap.cmapB = 0;
+
+    matrix box;
+    clear_mat(box);
+    box[XX][XX] = box[YY][YY] = box[ZZ][ZZ] = 1.5;
+    t_pbc  pbc;
+    set_pbc(&pbc, epbcXYZ, box);
+    rvec   shiftVec[SHIFTS];
+    calc_shifts(box, shiftVec);
+
+    const rvec x0[natoms] = {
+        { 0.60, 0.70, 0.50 }, { 0.70, 0.65, 0.60 }, { 0.80, 0.75, 0.65 },
+        { 0.85, 0.80, 0.78 }, { 0.95, 0.90, 0.80 }
+    };
+    matrix virRef;
+    for (int moved = -1; moved < natoms; moved++)
+    {
+        rvec x[natoms];
+        for (int i = 0; i < natoms; i++)
+        {
+            copy_rvec(x0[i], x[i]);
+        }
+        if (moved >= 0)
+        {
+            rvec_inc(x[moved], box[XX]);
+            rvec_dec(x[moved], box[ZZ]);
+        }
+        rvec4 f[natoms];
+        for (int i = 0; i < natoms; i++)
+        {
+            for (int j = 0; j < 4; j++)
+            {
+                f[i][j] = 0;
+            }
+        }
+        rvec fshift[N_IVEC];
+        clear_rvecs(N_IVEC, fshift);
+        real dvdlambda  = 0;
+        int  ddgatindex = 0;
+        cmap_dihs(iatoms.size(), iatoms.data(), &iparams, &cmapGrid,
+                  x, f, fshift, &pbc, nullptr,
+                  0, &dvdlambda, nullptr, nullptr, &ddgatindex);
+
+        matrix vir;
+        clear_mat(vir);
+        for (int d = 0; d < DIM; d++)
+        {
+            for (int e = 0; e < DIM; e++)
+            {
+                for (int i = 0; i < natoms; i++)
+                {
+                    vir[d][e] += f[i][d]*x[i][e];
+                }
+                for (int i = 0; i < SHIFTS; i++)
+                {
+                    vir[d][e] += fshift[i][d]*shiftVec[i][e];
+                }
+            }
+        }
+        if (moved < 0)
+        {
+            copy_mat(vir, virRef);
+            continue;
+        }
+        test::FloatingPointTolerance tolerance(test::relativeToleranceAsFloatingPoint(100.0, 5e-5));
+        for (int d = 0; d < DIM; d++)
+        {
+            for (int e = 0; e < DIM; e++)
+            {
+                EXPECT_REAL_EQ_TOL(virRef[d][e], vir[d][e], tolerance)
+                << "moved atom " << moved << " virial " << d << " " << e;
+            }
+        }
+    }
+}
+
+#if GMX_SIMD_HAVE_REAL
+
+/*! \brief Compares the SIMD bonded kernels with the plain-C ones
+ *
+ * Uses the same coordinates as BondedTest, but no reference data.
+ */
+class BondedSimdTest : public ::testing::Test
+{
+    protected:
+        rvec   x[NATOMS];
+        matrix box;
+        BondedSimdTest()
+        {
+            clear_rvecs(NATOMS, x);
+            x[1][2] = 1;
+            x[2][1] = x[2][2] = 1;
+            x[3][0] = x[3][1] = x[3][2] = 1;
+
+            clear_mat(box);
+            box[0][0] = box[1][1] = box[2][2] = 1.5;
+        }
+
+        /*! \brief Checks a SIMD kernel against the plain-C ifunc
+         *
+         * The interactions in \p iatoms are repeated such that several
+         * full and one partial SIMD batch are computed. Energies, forces
+         * and shift forces should agree, and without shift forces the
+         * SIMD kernel should still give the same forces.
+         */
+        void testSimdKernel(int                         ftype,
+                            t_ifunc_simd               *simdKernel,
+                            const std::vector<t_iatom> &iatoms,
+                            const t_iparams             iparams[],
+                            int                         epbc)
+        {
+            std::vector<t_iatom> repeated;
+            for (int r = 0; r < 2*GMX_SIMD_REAL_WIDTH + 1; r++)
+            {
+                repeated.insert(repeated.end(), iatoms.begin(), iatoms.end());
+            }
+            t_pbc pbc;
+            set_pbc(&pbc, epbc, box);
+
+            rvec4 fRef[NATOMS], fSimd[NATOMS], fNoShift[NATOMS];
+            rvec  fshiftRef[N_IVEC], fshiftSimd[N_IVEC];
+            clearForces(fRef, fshiftRef);
+            clearForces(fSimd, fshiftSimd);
+            clearForces(fNoShift, nullptr);
+            real  dvdlambda  = 0;
+            int   ddgatindex = 0;
+            real  energyRef  = interaction_function[ftype].ifunc(repeated.size(), repeated.data(),
+                                                                 iparams, x, fRef, fshiftRef,
+                                                                 &pbc, nullptr, 0, &dvdlambda,
+                                                                 nullptr, nullptr, &ddgatindex);
+            real  energySimd = simdKernel(repeated.size(), repeated.data(),
+                                          iparams, x, fSimd, fshiftSimd, &pbc, nullptr);
+            real  energyNone = simdKernel(repeated.size(), repeated.data(),
+                                          iparams, x, fNoShift, nullptr, &pbc, nullptr);
+            EXPECT_EQ(0, energyNone);
+            checkSimdResults(energyRef, energySimd, fRef, fSimd, fshiftRef, fshiftSimd);
+            checkSimdResults(0, 0, fRef, fNoShift, nullptr, nullptr);
+        }
+
+        //! Clears forces and, when not NULL, shift forces
+        static void clearForces(rvec4 f[], rvec fshift[])
+        {
+            for (int i = 0; i < NATOMS; i++)
+            {
+                for (int j = 0; j < 4; j++)
+                {
+                    f[i][j] = 0;
+                }
+            }
+            if (fshift != nullptr)
+            {
+                clear_rvecs(N_IVEC, fshift);
+            }
+        }
+
+        /*! \brief Checks that two sets of energies and forces agree
+         *
+         * The shift forces can be distributed differently over the shift
+         * vectors, so we compare their contribution to the virial.
+         */
+        void checkSimdResults(real energyRef, real energy,
+                              rvec4 fRef[], rvec4 f[],
+                              rvec fshiftRef[], rvec fshift[])
+        {
+            test::FloatingPointTolerance tolerance(test::relativeToleranceAsFloatingPoint(100.0, 1e-5));
+            EXPECT_REAL_EQ_TOL(energyRef, energy, tolerance);
+            for (int i = 0; i < NATOMS; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    EXPECT_REAL_EQ_TOL(fRef[i][d], f[i][d], tolerance) << "atom " << i << " dim " << d;
+                }
+            }
+            if (fshift != nullptr)
+            {
+                rvec shiftVec[SHIFTS];
+                calc_shifts(box, shiftVec);
+                for (int d = 0; d < DIM; d++)
+                {
+                    for (int e = 0; e < DIM; e++)
+                    {
+                        real virRef = 0, vir = 0;
+                        for (int i = 0; i < SHIFTS; i++)
+                        {
+                            virRef += fshiftRef[i][d]*shiftVec[i][e];
+                            vir    += fshift[i][d]*shiftVec[i][e];
+                        }
+                        EXPECT_REAL_EQ_TOL(virRef, vir, tolerance) << "virial " << d << " " << e;
+                    }
+                }
+            }
+        }
+};
+
+TEST_F (BondedSimdTest, BondsMatchPlainC)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 0, 1, 2, 0, 2, 3 };
+    t_iparams            iparams;
+    iparams.harmonic.rA  = iparams.harmonic.rB  = 0.8;
+    iparams.harmonic.krA = iparams.harmonic.krB = 50;
+    testSimdKernel(F_BONDS, bonds_simd, iatoms, &iparams, epbcNONE);
+    testSimdKernel(F_BONDS, bonds_simd, iatoms, &iparams, epbcXYZ);
+}
+
+TEST_F (BondedSimdTest, AnglesMatchPlainC)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 2, 0, 1, 2, 3 };
+    t_iparams            iparams;
+    iparams.harmonic.rA  = iparams.harmonic.rB  = 100;
+    iparams.harmonic.krA = iparams.harmonic.krB = 50;
+    testSimdKernel(F_ANGLES, angles_simd, iatoms, &iparams, epbcNONE);
+    testSimdKernel(F_ANGLES, angles_simd, iatoms, &iparams, epbcXYZ);
+}
+
+TEST_F (BondedSimdTest, UreyBradleyMatchesPlainC)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 2, 0, 1, 2, 3 };
+    t_iparams            iparams;
+    iparams.u_b.thetaA  = iparams.u_b.thetaB  = 100;
+    iparams.u_b.kthetaA = iparams.u_b.kthetaB = 50;
+    iparams.u_b.r13A    = iparams.u_b.r13B    = 1.2;
+    iparams.u_b.kUBA    = iparams.u_b.kUBB    = 30;
+    testSimdKernel(F_UREY_BRADLEY, urey_bradley_simd, iatoms, &iparams, epbcNONE);
+    testSimdKernel(F_UREY_BRADLEY, urey_bradley_simd, iatoms, &iparams, epbcXYZ);
+}
+
+TEST_F (BondedSimdTest, ProperDihedralsMatchPlainC)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 2, 3, 1, 3, 2, 1, 0 };
+    t_iparams            iparams[2];
+    iparams[0].pdihs.phiA = iparams[0].pdihs.phiB = -100;
+    iparams[0].pdihs.cpA  = iparams[0].pdihs.cpB  = 10;
+    iparams[0].pdihs.mult = 1;
+    iparams[1].pdihs.phiA = iparams[1].pdihs.phiB = 30;
+    iparams[1].pdihs.cpA  = iparams[1].pdihs.cpB  = 5;
+    iparams[1].pdihs.mult = 3;
+    testSimdKernel(F_PDIHS, pdihs_simd, iatoms, iparams, epbcNONE);
+    testSimdKernel(F_PDIHS, pdihs_simd, iatoms, iparams, epbcXYZ);
+}
+
+TEST_F (BondedSimdTest, ImproperDihedralsMatchPlainC)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 2, 3 };
+    t_iparams            iparams;
+    iparams.harmonic.rA  = iparams.harmonic.rB  = 170;
+    iparams.harmonic.krA = iparams.harmonic.krB = 40;
+    testSimdKernel(F_IDIHS, idihs_simd, iatoms, &iparams, epbcNONE);
+    testSimdKernel(F_IDIHS, idihs_simd, iatoms, &iparams, epbcXYZ);
+}
+
+TEST_F (BondedSimdTest, RyckaertBellemansMatchesPlainC)
+{
+    std::vector<t_iatom> iatoms = { 0, 0, 1, 2, 3 };
+    t_iparams            iparams;
+    for (int i = 0; i < NR_RBDIHS; i++)
+    {
+        iparams.rbdihs.rbcA[i] = iparams.rbdihs.rbcB[i] = 1 + i;
+    }
+    testSimdKernel(F_RBDIHS, rbdihs_simd, iatoms, &iparams, epbcNONE);
+    testSimdKernel(F_RBDIHS, rbdihs_simd, iatoms, &iparams, epbcXYZ);
+}
+
+TEST_F (BondedSimdTest, CmapMatchesPlainC)
+{
+    const int            gridSpacing = 24;
+    std::vector<real>    grid;
+    fillCmapGrid(gridSpacing, &grid);
+    gmx_cmapdata_t cmapdata;
+    cmapdata.cmap = grid.data();
+    gmx_cmap_t     cmapGrid;
+    cmapGrid.ngrid        = 1;
+    cmapGrid.grid_spacing = gridSpacing;
+    cmapGrid.cmapdata     = &cmapdata;
+
+    std::vector<t_iatom> single = { 0, 0, 1, 2, 3, 0 };
+    std::vector<t_iatom> iatoms;
+    for (int r = 0; r < 2*GMX_SIMD_REAL_WIDTH + 1; r++)
+    {
+        iatoms.insert(iatoms.end(), single.begin(), single.end());
+    }
+    t_iparams iparams;
+    iparams.cmap.cmapA = iparams.cmap.cmapB = 0;
+    t_pbc     pbc;
+    set_pbc(&pbc, epbcXYZ, box);
+
+    rvec4 fRef[NATOMS], fSimd[NATOMS];
+    rvec  fshiftRef[N_IVEC], fshiftSimd[N_IVEC];
+    clearForces(fRef, fshiftRef);
+    clearForces(fSimd, fshiftSimd);
+    real  dvdlambda  = 0;
+    int   ddgatindex = 0;
+    real  energyRef  = cmap_dihs(iatoms.size(), iatoms.data(), &iparams, &cmapGrid,
+                                 x, fRef, fshiftRef, &pbc, nullptr,
+                                 0, &dvdlambda, nullptr, nullptr, &ddgatindex);
+    real  energySimd = cmap_dihs_simd(iatoms.size(), iatoms.data(), &iparams, &cmapGrid,
+                                      x, fSimd, fshiftSimd, &pbc, nullptr);
+    checkSimdResults(energyRef, energySimd, fRef, fSimd, fshiftRef, fshiftSimd);
+}
+
+#endif
+
 }
 
 }
@@ -2060,6 +2060,11 @@ static void init_nb_verlet(FILE                *fp,
     nbv->nbs             = nullptr;
     nbv->min_ci_balanced = 0;
 
+    /* Dynamic pruning is set up by the caller, when supported */
+    nbv->useDynamicPruning = false;
+    nbv->rlistInner        = 0;
+    nbv->nstlistPrune      = 0;
+
     nbv->ngrp = (DOMAINDECOMP(cr) ? 2 : 1);
     for (i = 0; i < nbv->ngrp; i++)
     {
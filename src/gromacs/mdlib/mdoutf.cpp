@@ -36,6 +36,13 @@
 
 #include "mdoutf.h"
 
+#include <cstdlib>
+#include <cstring>
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/domdec/domdec.h"
 #include "gromacs/domdec/domdec_struct.h"
@@ -48,22 +55,147 @@
 #include "gromacs/math/vec.h"
 #include "gromacs/mdlib/mdrun.h"
 #include "gromacs/mdlib/trajectory_writing.h"
+#include "gromacs/mdlib/xtcwriterthread.h"
+#include "gromacs/mdrunutility/threadaffinity.h"
 #include "gromacs/mdtypes/commrec.h"
 #include "gromacs/mdtypes/imdoutputprovider.h"
 #include "gromacs/mdtypes/inputrec.h"
 #include "gromacs/mdtypes/md_enums.h"
 #include "gromacs/mdtypes/state.h"
 #include "gromacs/timing/wallcycle.h"
+#include "gromacs/utility/cstringutil.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/pleasecite.h"
 #include "gromacs/utility/smalloc.h"
 
+namespace
+{
+
+/*! \internal \brief
+ * Writes checkpoints in a separate thread.
+ *
+ * The state is serialized in memory by the caller, this thread computes
+ * the output file checksums, writes and syncs the checkpoint file and
+ * renames it. Only one checkpoint can be in flight, writeCheckpoint()
+ * waits for the previous one to be finished.
+ * Like gmx::XtcWriterThread, the thread unpins itself.
+ */
+class CheckpointWriterThread
+{
+    public:
+        //! Starts the writer thread.
+        CheckpointWriterThread();
+        //! Writes the pending checkpoint and stops the thread.
+        ~CheckpointWriterThread();
+
+        //! Queues \p snapshot for writing and takes ownership of it.
+        void writeCheckpoint(t_checkpoint_snapshot *snapshot);
+        //! Waits until the queued checkpoint has been written.
+        void flush();
+
+    private:
+        //! Main function of the writer thread.
+        void run();
+        //! Stops with a fatal error if writing a checkpoint failed, releases \p lock before stopping.
+        void checkWriteError(std::unique_lock<std::mutex> *lock);
+
+        //! The queued checkpoint, nullptr when there is none.
+        t_checkpoint_snapshot   *snapshot_;
+        bool                     bStop_;
+        bool                     bWriteError_;
+        char                     errorMessage_[STRLEN];
+        std::mutex               mutex_;
+        //! Signals the writer that a checkpoint was queued or that it should stop.
+        std::condition_variable  snapshotQueued_;
+        //! Signals writeCheckpoint() and flush() that the checkpoint was written.
+        std::condition_variable  snapshotWritten_;
+        std::thread              thread_;
+};
+
+CheckpointWriterThread::CheckpointWriterThread()
+    : snapshot_(nullptr), bStop_(false), bWriteError_(false)
+{
+    errorMessage_[0] = '\0';
+    thread_          = std::thread([this] { run(); });
+}
+
+CheckpointWriterThread::~CheckpointWriterThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bStop_ = true;
+    }
+    snapshotQueued_.notify_one();
+    thread_.join();
+}
+
+void CheckpointWriterThread::writeCheckpoint(t_checkpoint_snapshot *snapshot)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    snapshotWritten_.wait(lock, [this] { return snapshot_ == nullptr; });
+    checkWriteError(&lock);
+    snapshot_ = snapshot;
+    lock.unlock();
+    snapshotQueued_.notify_one();
+}
+
+void CheckpointWriterThread::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    snapshotWritten_.wait(lock, [this] { return snapshot_ == nullptr; });
+    checkWriteError(&lock);
+}
+
+void CheckpointWriterThread::checkWriteError(std::unique_lock<std::mutex> *lock)
+{
+    if (bWriteError_)
+    {
+        char errorMessage[STRLEN];
+
+        std::strcpy(errorMessage, errorMessage_);
+        lock->unlock();
+        gmx_file(errorMessage);
+    }
+}
+
+void CheckpointWriterThread::run()
+{
+    gmx_unpin_current_thread();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        snapshotQueued_.wait(lock, [this] { return snapshot_ != nullptr || bStop_; });
+        if (snapshot_ == nullptr)
+        {
+            break;
+        }
+        t_checkpoint_snapshot *snapshot = snapshot_;
+        lock.unlock();
+        char                   errorMessage[STRLEN];
+        bool                   bOK = (write_checkpoint_snapshot(snapshot, errorMessage) == 0);
+        lock.lock();
+        if (!bOK && !bWriteError_)
+        {
+            bWriteError_ = true;
+            std::strcpy(errorMessage_, errorMessage);
+        }
+        snapshot_ = nullptr;
+        snapshotWritten_.notify_all();
+    }
+}
+
+} // namespace
+
 struct gmx_mdoutf {
     t_fileio               *fp_trn;
     t_fileio               *fp_xtc;
+    gmx::XtcWriterThread   *xtcWriter; /* writes fp_xtc asynchronously, can be NULL */
+    CheckpointWriterThread *cptWriter; /* writes checkpoints asynchronously, can be NULL */
     tng_trajectory_t        tng;
     tng_trajectory_t        tng_low_prec;
     int                     x_compression_precision; /* only used by XTC output */
+    gmx_bool                bCollectCompressedX;     /* collect compressed coordinates with DD */
     ener_file_t             fp_ene;
     const char             *fn_cpt;
     gmx_bool                bKeepAndNumCPT;
@@ -81,6 +213,16 @@ struct gmx_mdoutf {
 };
 
 
+gmx_bool mdoutf_use_async_checkpoint()
+{
+#ifndef GMX_FAHCORE
+    return (checkpoint_snapshot_supported() &&
+            getenv("GMX_NO_ASYNC_CHECKPOINT") == nullptr);
+#else
+    return FALSE;
+#endif
+}
+
 gmx_mdoutf_t init_mdoutf(FILE *fplog, int nfile, const t_filenm fnm[],
                          int mdrun_flags, const t_commrec *cr,
                          gmx::IMDOutputProvider *outputProvider,
@@ -97,6 +239,8 @@ gmx_mdoutf_t init_mdoutf(FILE *fplog, int nfile, const t_filenm fnm[],
     of->fp_trn       = nullptr;
     of->fp_ene       = nullptr;
     of->fp_xtc       = nullptr;
+    of->xtcWriter    = nullptr;
+    of->cptWriter    = nullptr;
     of->tng          = nullptr;
     of->tng_low_prec = nullptr;
     of->fp_dhdl      = nullptr;
@@ -106,6 +250,7 @@ gmx_mdoutf_t init_mdoutf(FILE *fplog, int nfile, const t_filenm fnm[],
     of->elamstats               = ir->expandedvals->elamstats;
     of->simulation_part         = ir->simulation_part;
     of->x_compression_precision = static_cast<int>(ir->x_compression_precision);
+    of->bCollectCompressedX     = (getenv("GMX_DD_COLLECT_COMPRESSED_X") != nullptr);
     of->wcycle                  = wcycle;
     of->f_global                = nullptr;
     of->outputProvider          = outputProvider;
@@ -214,6 +359,21 @@ gmx_mdoutf_t init_mdoutf(FILE *fplog, int nfile, const t_filenm fnm[],
             }
         }
 
+        /* Compress the XTC frames in a separate thread to not stall
+           the MD loop at every output step */
+        if (of->fp_xtc && getenv("GMX_NO_ASYNC_XTC") == nullptr)
+        {
+            of->xtcWriter = new gmx::XtcWriterThread(of->fp_xtc, of->natoms_x_compressed,
+                                                of->x_compression_precision);
+        }
+
+        /* Write checkpoints in a separate thread, so the simulation only
+           waits for the state to be copied and not for the file system */
+        if (mdoutf_use_async_checkpoint())
+        {
+            of->cptWriter = new CheckpointWriterThread();
+        }
+
         if (ir->nstfout && DOMAINDECOMP(cr))
         {
             snew(of->f_global, top_global->natoms);
@@ -262,7 +422,16 @@ void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
         }
         else
         {
-            if (mdof_flags & (MDOF_X | MDOF_X_COMPRESSED))
+            if (!(mdof_flags & MDOF_X) && (mdof_flags & MDOF_X_COMPRESSED) &&
+                of->bCollectCompressedX)
+            {
+                /* Only the compressed output group is needed, at output
+                   precision, so we can let each rank compress its part */
+                dd_collect_compressed_x(cr->dd, state_local, &top_global->groups,
+                                        of->x_compression_precision,
+                                        as_rvec_array(state_global->x.data()));
+            }
+            else if (mdof_flags & (MDOF_X | MDOF_X_COMPRESSED))
             {
                 dd_collect_vec(cr->dd, state_local, &state_local->x,
                                &state_global->x);
@@ -293,14 +462,38 @@ void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
         {
             fflush_tng(of->tng);
             fflush_tng(of->tng_low_prec);
+            /* The checkpoint stores the XTC file size and checksum,
+               so all earlier frames need to be in the file */
+            if (of->xtcWriter)
+            {
+                of->xtcWriter->flush();
+            }
             ivec one_ivec = { 1, 1, 1 };
-            write_checkpoint(of->fn_cpt, of->bKeepAndNumCPT,
-                             fplog, cr,
-                             DOMAINDECOMP(cr) ? cr->dd->nc : one_ivec,
-                             DOMAINDECOMP(cr) ? cr->dd->nnodes : cr->nnodes,
-                             of->eIntegrator, of->simulation_part,
-                             of->bExpanded, of->elamstats, step, t,
-                             state_global, observablesHistory);
+            if (of->cptWriter)
+            {
+                /* The previous checkpoint has to be finished before we
+                   take the output file offsets for the next one */
+                of->cptWriter->flush();
+                t_checkpoint_snapshot *snapshot =
+                    make_checkpoint_snapshot(of->fn_cpt, of->bKeepAndNumCPT,
+                                             fplog, cr,
+                                             DOMAINDECOMP(cr) ? cr->dd->nc : one_ivec,
+                                             DOMAINDECOMP(cr) ? cr->dd->nnodes : cr->nnodes,
+                                             of->eIntegrator, of->simulation_part,
+                                             of->bExpanded, of->elamstats, step, t,
+                                             state_global, observablesHistory);
+                of->cptWriter->writeCheckpoint(snapshot);
+            }
+            else
+            {
+                write_checkpoint(of->fn_cpt, of->bKeepAndNumCPT,
+                                 fplog, cr,
+                                 DOMAINDECOMP(cr) ? cr->dd->nc : one_ivec,
+                                 DOMAINDECOMP(cr) ? cr->dd->nnodes : cr->nnodes,
+                                 of->eIntegrator, of->simulation_part,
+                                 of->bExpanded, of->elamstats, step, t,
+                                 state_global, observablesHistory);
+            }
         }
 
         if (mdof_flags & (MDOF_X | MDOF_V | MDOF_F))
@@ -365,8 +558,12 @@ void mdoutf_write_to_trajectory_files(FILE *fplog, t_commrec *cr,
                     }
                 }
             }
-            if (write_xtc(of->fp_xtc, of->natoms_x_compressed, step, t,
-                          state_local->box, xxtc, of->x_compression_precision) == 0)
+            if (of->xtcWriter)
+            {
+                of->xtcWriter->writeFrame(step, t, state_local->box, xxtc);
+            }
+            else if (write_xtc(of->fp_xtc, of->natoms_x_compressed, step, t,
+                               state_local->box, xxtc, of->x_compression_precision) == 0)
             {
                 gmx_fatal(FARGS, "XTC error - maybe you are out of disk space?");
             }
@@ -401,10 +598,22 @@ void mdoutf_tng_close(gmx_mdoutf_t of)
 
 void done_mdoutf(gmx_mdoutf_t of)
 {
+    /* The last checkpoint syncs the output files, so it has to be
+       finished before they are closed */
+    if (of->cptWriter)
+    {
+        of->cptWriter->flush();
+        delete of->cptWriter;
+    }
     if (of->fp_ene != nullptr)
     {
         close_enx(of->fp_ene);
     }
+    if (of->xtcWriter)
+    {
+        of->xtcWriter->flush();
+        delete of->xtcWriter;
+    }
     if (of->fp_xtc)
     {
         close_xtc(of->fp_xtc);
@@ -58,6 +58,13 @@ class IMDOutputProvider;
 
 typedef struct gmx_mdoutf *gmx_mdoutf_t;
 
+/*! \brief Returns whether mdrun writes checkpoints in a separate thread
+ *
+ * This is the case when checkpoint snapshots are supported on this
+ * platform, unless the environment variable GMX_NO_ASYNC_CHECKPOINT is set.
+ */
+gmx_bool mdoutf_use_async_checkpoint();
+
 /*! \brief Allocate and initialize object to manager trajectory writing output
  *
  * Returns a pointer to a data structure with all output file pointers
@@ -53,6 +53,7 @@
 #include <ctime>
 
 #include <algorithm>
+#include <limits>
 #include <vector>
 
 #include "gromacs/commandline/filenm.h"
@@ -2845,13 +2846,51 @@ double do_nm(FILE *fplog, t_commrec *cr, const gmx::MDLogger &mdlog,
      *
      ************************************************************/
 
+    /* Only degrees of freedom that are not frozen are displaced, the rows
+     * and columns of frozen degrees of freedom are left zero. This can be
+     * used to compute the Hessian of a subsystem embedded in a fixed
+     * environment.
+     */
+    std::vector<int> dofIndex;
+    std::vector<int> dofFrozen(sz, 0);
+    for (size_t aid = 0; aid < atom_index.size(); aid++)
+    {
+        size_t atom = atom_index[aid];
+        int    gf   = (mdatoms->cFREEZE ? mdatoms->cFREEZE[atom] : 0);
+        for (int d = 0; d < DIM; d++)
+        {
+            if (inputrec->opts.nFreeze[gf][d])
+            {
+                dofFrozen[aid*DIM + d] = 1;
+            }
+            else
+            {
+                dofIndex.push_back(aid*DIM + d);
+            }
+        }
+    }
+    int numDofs = dofIndex.size();
+    if (numDofs < static_cast<int>(sz))
+    {
+        GMX_LOG(mdlog.warning).appendTextFormatted(
+                "%d of the %d degrees of freedom are frozen, the Hessian will only be computed for the other %d",
+                static_cast<int>(sz) - numDofs, static_cast<int>(sz), numDofs);
+    }
+    if (nnodes > 1)
+    {
+        GMX_LOG(mdlog.info).appendTextFormatted(
+                "Distributing the displacements of %d degrees of freedom over %d ranks",
+                numDofs, nnodes);
+    }
+
     /* Steps are divided one by one over the nodes */
     bool bNS = true;
-    for (unsigned int aid = cr->nodeid; aid < atom_index.size(); aid += nnodes)
+    for (int dof0 = 0; dof0 < numDofs; dof0 += nnodes)
     {
-        size_t atom = atom_index[aid];
-        for (size_t d = 0; d < DIM; d++)
+        if (dof0 + cr->nodeid < numDofs)
         {
+            size_t      atom        = atom_index[dofIndex[dof0 + cr->nodeid]/DIM];
+            int         d           = dofIndex[dof0 + cr->nodeid] % DIM;
             gmx_bool    bBornRadii  = FALSE;
             gmx_int64_t step        = 0;
             int         force_flags = GMX_FORCE_STATECHANGED | GMX_FORCE_ALLFORCES;
@@ -2915,8 +2954,15 @@ double do_nm(FILE *fplog, t_commrec *cr, const gmx::MDLogger &mdlog,
             {
                 for (size_t k = 0; (k < DIM); k++)
                 {
-                    dfdx[j][k] =
-                        -(state_work.f[atom_index[j]][k] - fneg[j][k])/(2*der_range);
+                    if (dofFrozen[j*DIM + k])
+                    {
+                        dfdx[j][k] = 0;
+                    }
+                    else
+                    {
+                        dfdx[j][k] =
+                            -(state_work.f[atom_index[j]][k] - fneg[j][k])/(2*der_range);
+                    }
                 }
             }
 
@@ -2928,56 +2974,56 @@ double do_nm(FILE *fplog, t_commrec *cr, const gmx::MDLogger &mdlog,
                          cr->nodeid, cr->mpi_comm_mygroup);
 #endif
             }
-            else
+        }
+
+        if (bIsMaster)
+        {
+            for (node = 0; (node < nnodes && dof0 + node < numDofs); node++)
             {
-                for (node = 0; (node < nnodes && atom+node < atom_index.size()); node++)
+                if (node > 0)
                 {
-                    if (node > 0)
-                    {
 #if GMX_MPI
-                        MPI_Status stat;
-                        MPI_Recv(dfdx[0], atom_index.size()*DIM, mpi_type, node, node,
-                                 cr->mpi_comm_mygroup, &stat);
+                    MPI_Status stat;
+                    MPI_Recv(dfdx[0], atom_index.size()*DIM, mpi_type, node, node,
+                             cr->mpi_comm_mygroup, &stat);
 #undef mpi_type
 #endif
-                    }
+                }
 
-                    row = (atom + node)*DIM + d;
+                row = dofIndex[dof0 + node];
 
-                    for (size_t j = 0; j < atom_index.size(); j++)
+                for (size_t j = 0; j < atom_index.size(); j++)
+                {
+                    for (size_t k = 0; k < DIM; k++)
                     {
-                        for (size_t k = 0; k < DIM; k++)
-                        {
-                            col = j*DIM + k;
+                        col = j*DIM + k;
 
-                            if (bSparse)
-                            {
-                                if (col >= row && dfdx[j][k] != 0.0)
-                                {
-                                    gmx_sparsematrix_increment_value(sparse_matrix,
-                                                                     row, col, dfdx[j][k]);
-                                }
-                            }
-                            else
+                        if (bSparse)
+                        {
+                            if (col >= row && dfdx[j][k] != 0.0)
                             {
-                                full_matrix[row*sz+col] = dfdx[j][k];
+                                gmx_sparsematrix_increment_value(sparse_matrix,
+                                                                 row, col, dfdx[j][k]);
                             }
                         }
+                        else
+                        {
+                            full_matrix[row*sz+col] = dfdx[j][k];
+                        }
                     }
                 }
             }
+        }
 
-            if (bVerbose && fplog)
-            {
-                fflush(fplog);
-            }
+        if (bVerbose && fplog)
+        {
+            fflush(fplog);
         }
         /* write progress */
         if (bIsMaster && bVerbose)
         {
             fprintf(stderr, "\rFinished step %d out of %d",
-                    static_cast<int>(std::min(atom+nnodes, atom_index.size())),
-                    static_cast<int>(atom_index.size()));
+                    std::min(dof0 + nnodes, numDofs), numDofs);
             fflush(stderr);
         }
     }
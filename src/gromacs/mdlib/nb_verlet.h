@@ -175,6 +175,9 @@ typedef struct nonbonded_verlet_t {
     gmx_nbnxn_gpu_t         *gpu_nbv;         /**< pointer to GPU nb verlet data     */
     int                      min_ci_balanced; /**< pair list balancing parameter
                                                    used for the 8x8x8 GPU kernels    */
+    bool                     useDynamicPruning; /**< true when the CPU pair lists are pruned dynamically */
+    real                     rlistInner;        /**< cut-off of the dynamically pruned (inner) list      */
+    int                      nstlistPrune;      /**< the number of steps between dynamic pruning         */
 } nonbonded_verlet_t;
 
 /*! \brief Getter for bUseGPU */
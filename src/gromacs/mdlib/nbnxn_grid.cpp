@@ -45,6 +45,7 @@
 #include <cmath>
 
 #include <algorithm>
+#include <vector>
 
 #include "gromacs/domdec/domdec_struct.h"
 #include "gromacs/math/utilities.h"
@@ -623,16 +624,48 @@ static void calc_bounding_box_xxxx_simd4(int na, const float *x,
     bb[5*STRIDE_PBB] = bb_work_aligned->upper[BB_Z];
 }
 
+/* Packed coordinates, bb order xyz0, for clusters of at most 4 atoms
+ * starting at a SIMD4 aligned position.
+ */
+template <int packSize>
+static void calc_bounding_box_x_xN_simd4(int na, const float *x, nbnxn_bb_t *bb)
+{
+    // TODO: During SIMDv2 transition only some archs use namespace (remove when done)
+    using namespace gmx;
+
+    GMX_ASSERT(na >= 1 && na <= GMX_SIMD4_WIDTH, "The cluster size should fit in SIMD4");
+
+    /* Transpose the x, y and z packs into xyz0 quadruplets per atom */
+    Simd4Float xyz_S[GMX_SIMD4_WIDTH];
+    xyz_S[0] = load4(x + XX*packSize);
+    xyz_S[1] = load4(x + YY*packSize);
+    xyz_S[2] = load4(x + ZZ*packSize);
+    xyz_S[3] = simd4SetZeroF();
+    transpose(&xyz_S[0], &xyz_S[1], &xyz_S[2], &xyz_S[3]);
+
+    Simd4Float bb_0_S = xyz_S[0];
+    Simd4Float bb_1_S = xyz_S[0];
+    for (int i = 1; i < na; i++)
+    {
+        bb_0_S = min(bb_0_S, xyz_S[i]);
+        bb_1_S = max(bb_1_S, xyz_S[i]);
+    }
+
+    store4(&bb->lower[0], bb_0_S);
+    store4(&bb->upper[0], bb_1_S);
+}
+
 #endif /* NBNXN_SEARCH_SIMD4_FLOAT_X_BB */
 
 
-/* Combines pairs of consecutive bounding boxes */
-static void combine_bounding_box_pairs(nbnxn_grid_t *grid, const nbnxn_bb_t *bb)
+/* Combines pairs of consecutive bounding boxes in columns cxy_start to cxy_end */
+static void combine_bounding_box_pairs(nbnxn_grid_t *grid, const nbnxn_bb_t *bb,
+                                       int cxy_start, int cxy_end)
 {
     // TODO: During SIMDv2 transition only some archs use namespace (remove when done)
     using namespace gmx;
 
-    for (int i = 0; i < grid->ncx*grid->ncy; i++)
+    for (int i = cxy_start; i < cxy_end; i++)
     {
         /* Starting bb in a column is expected to be 2-aligned */
         int sc2 = grid->cxy_ind[i]>>1;
@@ -896,7 +929,11 @@ static void fill_cell(const nbnxn_search_t nbs,
         else
 #endif
         {
+#if NBNXN_SEARCH_SIMD4_FLOAT_X_BB
+            calc_bounding_box_x_xN_simd4<c_packX4>(na, nbat->x + atom_to_x_index<c_packX4>(a0), bb_ptr);
+#else
             calc_bounding_box_x_x4(na, nbat->x + atom_to_x_index<c_packX4>(a0), bb_ptr);
+#endif
         }
     }
     else if (nbat->XFormat == nbatX8)
@@ -905,7 +942,11 @@ static void fill_cell(const nbnxn_search_t nbs,
         offset = (a0 - grid->cell0*grid->na_sc) >> grid->na_c_2log;
         bb_ptr = grid->bb + offset;
 
+#if NBNXN_SEARCH_SIMD4_FLOAT_X_BB
+        calc_bounding_box_x_xN_simd4<c_packX8>(na, nbat->x + atom_to_x_index<c_packX8>(a0), bb_ptr);
+#else
         calc_bounding_box_x_x8(na, nbat->x +  atom_to_x_index<c_packX8>(a0), bb_ptr);
+#endif
     }
 #if NBNXN_BBXXXX
     else if (!grid->bSimple)
@@ -945,8 +986,17 @@ static void fill_cell(const nbnxn_search_t nbs,
         /* Store the bounding boxes as xyz.xyz. */
         bb_ptr = grid->bb+((a0-grid->cell0*grid->na_sc)>>grid->na_c_2log);
 
-        calc_bounding_box(na, nbat->xstride, nbat->x+a0*nbat->xstride,
-                          bb_ptr);
+#if NBNXN_SEARCH_SIMD4_FLOAT_X_BB
+        if (nbat->XFormat == nbatXYZQ)
+        {
+            calc_bounding_box_simd4(na, nbat->x+a0*nbat->xstride, bb_ptr);
+        }
+        else
+#endif
+        {
+            calc_bounding_box(na, nbat->xstride, nbat->x+a0*nbat->xstride,
+                              bb_ptr);
+        }
 
         if (gmx_debug_at)
         {
@@ -1243,12 +1293,17 @@ static void calc_cell_indices(const nbnxn_search_t nbs,
                               nbnxn_atomdata_t *nbat)
 {
     int   n0, n1;
-    int   cx, cy, cxy, ncz_max, ncz;
+    int   cx, cy, ncz_max;
     int   nthread;
-    int   cxy_na_i;
 
     nthread = gmx_omp_nthreads_get(emntPairsearch);
 
+    /* The number of columns, plus one for particles moved during DD */
+    const int ncxy = grid->ncx*grid->ncy + 1;
+    /* The sum and maximum of the cell counts per block of columns */
+    std::vector<int> blockNcz(nthread);
+    std::vector<int> blockNczMax(nthread);
+
 #pragma omp parallel for num_threads(nthread) schedule(static)
     for (int thread = 0; thread < nthread; thread++)
     {
@@ -1260,34 +1315,75 @@ static void calc_cell_indices(const nbnxn_search_t nbs,
         GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
     }
 
-    /* Make the cell index as a function of x and y */
-    ncz_max          = 0;
-    ncz              = 0;
-    grid->cxy_ind[0] = 0;
-    for (int i = 0; i < grid->ncx*grid->ncy+1; i++)
+    /* Make the cell index as a function of x and y.
+     * Each thread handles a block of columns: it converts the per-thread
+     * atom counts to per-thread atom offsets within each column and counts
+     * the cells. After a prefix sum over the block cell counts, the threads
+     * set the column cell indices.
+     */
+#pragma omp parallel for num_threads(nthread) schedule(static)
+    for (int thread = 0; thread < nthread; thread++)
     {
-        /* We set ncz_max at the beginning of the loop iso at the end
-         * to skip i=grid->ncx*grid->ncy which are moved particles
-         * that do not need to be ordered on the grid.
-         */
-        if (ncz > ncz_max)
+        // No C++ code that can throw is called, so no try/catch is needed
+        int cxy0   = (thread*ncxy)/nthread;
+        int cxy1   = ((thread + 1)*ncxy)/nthread;
+        int nczSum = 0;
+        int nczMax = 0;
+        for (int cxy = cxy0; cxy < cxy1; cxy++)
         {
-            ncz_max = ncz;
+            int na = 0;
+            for (int t = 0; t < nthread; t++)
+            {
+                int na_t                  = nbs->work[t].cxy_na[cxy];
+                nbs->work[t].cxy_na[cxy]  = na;
+                na                       += na_t;
+            }
+            grid->cxy_na[cxy] = na;
+
+            int ncz = (na + grid->na_sc - 1)/grid->na_sc;
+            if (nbat->XFormat == nbatX8)
+            {
+                /* Make the number of cell a multiple of 2 */
+                ncz = (ncz + 1) & ~1;
+            }
+            /* Temporarily store the cell count */
+            grid->cxy_ind[cxy + 1] = ncz;
+            nczSum                += ncz;
+            /* Skip the last column with moved particles,
+             * which do not need to be ordered on the grid.
+             */
+            if (cxy < ncxy - 1)
+            {
+                nczMax = std::max(nczMax, ncz);
+            }
         }
-        cxy_na_i = nbs->work[0].cxy_na[i];
-        for (int thread = 1; thread < nthread; thread++)
+        blockNcz[thread]    = nczSum;
+        blockNczMax[thread] = nczMax;
+    }
+
+    ncz_max = 0;
+    for (int thread = 0; thread < nthread; thread++)
+    {
+        ncz_max = std::max(ncz_max, blockNczMax[thread]);
+    }
+
+    grid->cxy_ind[0] = 0;
+#pragma omp parallel for num_threads(nthread) schedule(static)
+    for (int thread = 0; thread < nthread; thread++)
+    {
+        // No C++ code that can throw is called, so no try/catch is needed
+        int cxy0 = (thread*ncxy)/nthread;
+        int cxy1 = ((thread + 1)*ncxy)/nthread;
+        int ind  = 0;
+        for (int t = 0; t < thread; t++)
         {
-            cxy_na_i += nbs->work[thread].cxy_na[i];
+            ind += blockNcz[t];
         }
-        ncz = (cxy_na_i + grid->na_sc - 1)/grid->na_sc;
-        if (nbat->XFormat == nbatX8)
+        for (int cxy = cxy0; cxy < cxy1; cxy++)
         {
-            /* Make the number of cell a multiple of 2 */
-            ncz = (ncz + 1) & ~1;
+            ind                   += grid->cxy_ind[cxy + 1];
+            grid->cxy_ind[cxy + 1] = ind;
         }
-        grid->cxy_ind[i+1] = grid->cxy_ind[i] + ncz;
-        /* Clear cxy_na, so we can reuse the array below */
-        grid->cxy_na[i] = 0;
     }
     grid->nc = grid->cxy_ind[grid->ncx*grid->ncy] - grid->cxy_ind[0];
 
@@ -1333,12 +1429,23 @@ static void calc_cell_indices(const nbnxn_search_t nbs,
 
     /* Now we know the dimensions we can fill the grid.
      * This is the first, unsorted fill. We sort the columns after this.
+     * Each thread fills the atoms it assigned to columns above, starting
+     * at its offset within each column, which gives the same atom order
+     * as a serial fill.
      */
-    for (int i = a0; i < a1; i++)
+#pragma omp parallel for num_threads(nthread) schedule(static)
+    for (int thread = 0; thread < nthread; thread++)
     {
-        /* At this point nbs->cell contains the local grid x,y indices */
-        cxy = nbs->cell[i];
-        nbs->a[(grid->cell0 + grid->cxy_ind[cxy])*grid->na_sc + grid->cxy_na[cxy]++] = i;
+        // No C++ code that can throw is called, so no try/catch is needed
+        int *cxy_offset = nbs->work[thread].cxy_na;
+        int  i0         = a0 + static_cast<int>((thread+0)*(a1 - a0))/nthread;
+        int  i1         = a0 + static_cast<int>((thread+1)*(a1 - a0))/nthread;
+        for (int i = i0; i < i1; i++)
+        {
+            /* At this point nbs->cell contains the local grid x,y indices */
+            int cxy = nbs->cell[i];
+            nbs->a[(grid->cell0 + grid->cxy_ind[cxy])*grid->na_sc + cxy_offset[cxy]++] = i;
+        }
     }
 
     if (dd_zone == 0)
@@ -1361,29 +1468,30 @@ static void calc_cell_indices(const nbnxn_search_t nbs,
     {
         try
         {
+            int cxy0 = ((thread+0)*grid->ncx*grid->ncy)/nthread;
+            int cxy1 = ((thread+1)*grid->ncx*grid->ncy)/nthread;
             if (grid->bSimple)
             {
                 sort_columns_simple(nbs, dd_zone, grid, a0, a1, atinfo, x, nbat,
-                                    ((thread+0)*grid->ncx*grid->ncy)/nthread,
-                                    ((thread+1)*grid->ncx*grid->ncy)/nthread,
+                                    cxy0, cxy1,
                                     nbs->work[thread].sort_work);
+
+                if (nbat->XFormat == nbatX8)
+                {
+                    /* The bounding boxes of these columns are set now */
+                    combine_bounding_box_pairs(grid, grid->bb, cxy0, cxy1);
+                }
             }
             else
             {
                 sort_columns_supersub(nbs, dd_zone, grid, a0, a1, atinfo, x, nbat,
-                                      ((thread+0)*grid->ncx*grid->ncy)/nthread,
-                                      ((thread+1)*grid->ncx*grid->ncy)/nthread,
+                                      cxy0, cxy1,
                                       nbs->work[thread].sort_work);
             }
         }
         GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
     }
 
-    if (grid->bSimple && nbat->XFormat == nbatX8)
-    {
-        combine_bounding_box_pairs(grid, grid->bb);
-    }
-
     if (!grid->bSimple)
     {
         grid->nsubc_tot = 0;
@@ -1666,7 +1774,7 @@ void nbnxn_grid_add_simple(nbnxn_search_t    nbs,
 
     if (grid->bSimple && nbat->XFormat == nbatX8)
     {
-        combine_bounding_box_pairs(grid, grid->bb_simple);
+        combine_bounding_box_pairs(grid, grid->bb_simple, 0, grid->ncx*grid->ncy);
     }
 }
 
@@ -0,0 +1,183 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+
+/*! \internal \file
+ *
+ * \brief
+ * Implements the CPU pair-list pruning kernel for dynamic pruning.
+ */
+
+#include "gmxpre.h"
+
+#include "nbnxn_kernel_prune.h"
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdlib/nb_verlet.h"
+#include "gromacs/mdlib/nbnxn_consts.h"
+#include "gromacs/mdlib/nbnxn_internal.h"
+#include "gromacs/mdlib/nbnxn_pairlist.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/real.h"
+
+/*! \brief Returns coordinate \p d of atom \p a in the nbat coordinate layout */
+template <int xFormat>
+static inline real nbatCoordinate(const real *x, int xstride, int a, int d)
+{
+    switch (xFormat)
+    {
+        case nbatX4:
+            return x[atom_to_x_index<c_packX4>(a) + d*c_packX4];
+        case nbatX8:
+            return x[atom_to_x_index<c_packX8>(a) + d*c_packX8];
+        default:
+            return x[a*xstride + d];
+    }
+}
+
+/*! \brief Prunes the outer list of \p nbl into the inner list
+ *
+ * A cluster pair is kept when the minimum distance between
+ * its atom pairs is less than sqrt(\p rlist2).
+ * Filler particles are placed far away, so they never cause pairs to be kept.
+ */
+template <int xFormat>
+static void prune_list(nbnxn_pairlist_t       *nbl,
+                       const nbnxn_atomdata_t *nbat,
+                       real                    rlist2)
+{
+    const real *x       = nbat->x;
+    const int   xstride = nbat->xstride;
+    const int   na_ci   = nbl->na_ci;
+    const int   na_cj   = nbl->na_cj;
+
+    GMX_ASSERT(na_ci == NBNXN_CPU_CLUSTER_I_SIZE, "Dynamic pruning only supports CPU i-cluster sizes");
+
+    int         nci = 0;
+    int         ncj = 0;
+    for (int i = 0; i < nbl->nciOuter; i++)
+    {
+        const nbnxn_ci_t *ciOuter = &nbl->ciOuter[i];
+        const real       *shift   = nbat->shift_vec[ciOuter->shift & NBNXN_CI_SHIFT];
+
+        /* Load the shifted i-cluster coordinates */
+        real              xi[NBNXN_CPU_CLUSTER_I_SIZE*DIM];
+        for (int ia = 0; ia < na_ci; ia++)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                xi[ia*DIM + d] = nbatCoordinate<xFormat>(x, xstride, ciOuter->ci*na_ci + ia, d) + shift[d];
+            }
+        }
+
+        nbnxn_ci_t *ciInner   = &nbl->ci[nci];
+        *ciInner              = *ciOuter;
+        ciInner->cj_ind_start = ncj;
+        for (int cjind = ciOuter->cj_ind_start; cjind < ciOuter->cj_ind_end; cjind++)
+        {
+            const int cj        = nbl->cjOuter[cjind].cj;
+            bool      isInRange = false;
+            for (int ja = 0; ja < na_cj && !isInRange; ja++)
+            {
+                const int  aj = cj*na_cj + ja;
+                const real xj = nbatCoordinate<xFormat>(x, xstride, aj, XX);
+                const real yj = nbatCoordinate<xFormat>(x, xstride, aj, YY);
+                const real zj = nbatCoordinate<xFormat>(x, xstride, aj, ZZ);
+                for (int ia = 0; ia < na_ci; ia++)
+                {
+                    const real dx = xi[ia*DIM + XX] - xj;
+                    const real dy = xi[ia*DIM + YY] - yj;
+                    const real dz = xi[ia*DIM + ZZ] - zj;
+                    if (dx*dx + dy*dy + dz*dz < rlist2)
+                    {
+                        isInRange = true;
+                        break;
+                    }
+                }
+            }
+            if (isInRange)
+            {
+                /* Copy the entry, this keeps the exclusion masks
+                 * and the ordering by exclusions that the kernels use.
+                 */
+                nbl->cj[ncj++] = nbl->cjOuter[cjind];
+            }
+        }
+        ciInner->cj_ind_end = ncj;
+
+        /* Only keep i-entries that still have j-clusters */
+        if (ciInner->cj_ind_end > ciInner->cj_ind_start)
+        {
+            nci++;
+        }
+    }
+
+    nbl->nci      = nci;
+    nbl->ncj      = ncj;
+    nbl->ncjInUse = ncj;
+}
+
+void
+nbnxn_kernel_cpu_prune(nonbonded_verlet_group_t *nbvg,
+                       real                      rlistInner)
+{
+    const nbnxn_atomdata_t *nbat   = nbvg->nbat;
+    nbnxn_pairlist_t      **nbl    = nbvg->nbl_lists.nbl;
+    const int               nnbl   = nbvg->nbl_lists.nnbl;
+    const real              rlist2 = rlistInner*rlistInner;
+
+    GMX_ASSERT(nbvg->nbl_lists.bSimple, "Dynamic pruning is only supported with simple pair lists");
+
+    // cppcheck-suppress unreadVariable
+    int gmx_unused nthreads = gmx_omp_nthreads_get(emntNonbonded);
+#pragma omp parallel for schedule(static) num_threads(nthreads)
+    for (int nb = 0; nb < nnbl; nb++)
+    {
+        // The pruning does not call C++ code that can throw,
+        // so no need for a try/catch pair in this OpenMP region.
+        switch (nbat->XFormat)
+        {
+            case nbatX4:
+                prune_list<nbatX4>(nbl[nb], nbat, rlist2);
+                break;
+            case nbatX8:
+                prune_list<nbatX8>(nbl[nb], nbat, rlist2);
+                break;
+            default:
+                prune_list<nbatXYZQ>(nbl[nb], nbat, rlist2);
+                break;
+        }
+    }
+}
@@ -0,0 +1,68 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+
+/*! \libinternal \file
+ *
+ * \brief
+ * Declares the CPU pair-list pruning kernel for dynamic pruning.
+ */
+
+#ifndef _nbnxn_kernel_prune_h
+#define _nbnxn_kernel_prune_h
+
+#include "gromacs/utility/real.h"
+
+struct nonbonded_verlet_group_t;
+
+/*! \brief Prunes the outer pair lists of a group to the inner list cut-off.
+ *
+ * For each of the simple cluster pair lists in \p nbvg, the cluster pairs
+ * in the outer list (the list produced by the search, stored in ciOuter
+ * and cjOuter) that have at least one atom pair within \p rlistInner
+ * are copied to the inner list (ci and cj), which is used by the kernels.
+ * The order of the pairs and the exclusion masks are preserved.
+ * Only the coordinates of the pairs are checked, so this is much cheaper
+ * than a pair search and can be done at intervals much shorter than nstlist.
+ *
+ * OpenMP parallelization is performed within this function.
+ *
+ * \param[in,out] nbvg        The group (local/non-local) to prune the lists for
+ * \param[in]     rlistInner  The pruning cut-off
+ */
+void
+nbnxn_kernel_cpu_prune(nonbonded_verlet_group_t *nbvg,
+                       real                      rlistInner);
+
+#endif
@@ -824,6 +824,14 @@ static void nbnxn_init_pairlist(nbnxn_pairlist_t *nbl,
     nbl->ncjInUse    = 0;
     nbl->cj          = nullptr;
     nbl->cj_nalloc   = 0;
+
+    nbl->nciOuter       = 0;
+    nbl->ciOuter        = nullptr;
+    nbl->ciOuter_nalloc = 0;
+    nbl->ncjOuter       = 0;
+    nbl->cjOuter        = nullptr;
+    nbl->cjOuter_nalloc = 0;
+
     nbl->ncj4        = 0;
     /* We need one element extra in sj, so alloc initially with 1 */
     nbl->cj4_nalloc  = 0;
@@ -879,8 +887,9 @@ void nbnxn_init_pairlist_set(nbnxn_pairlist_set_t *nbl_list,
                              nbnxn_alloc_t *alloc,
                              nbnxn_free_t  *free)
 {
-    nbl_list->bSimple   = bSimple;
-    nbl_list->bCombined = bCombined;
+    nbl_list->bSimple               = bSimple;
+    nbl_list->bCombined             = bCombined;
+    nbl_list->outerListCreationStep = 0;
 
     nbl_list->nnbl = gmx_omp_nthreads_get(emntNonbonded);
 
@@ -4385,3 +4394,35 @@ void nbnxn_make_pairlist(const nbnxn_search_t  nbs,
         }
     }
 }
+
+void nbnxn_prepare_lists_for_dynamic_pruning(nbnxn_pairlist_set_t *nbl_list)
+{
+    GMX_RELEASE_ASSERT(nbl_list->bSimple, "Dynamic pruning is only supported with simple pair lists");
+
+    for (int th = 0; th < nbl_list->nnbl; th++)
+    {
+        nbnxn_pairlist_t *nbl = nbl_list->nbl[th];
+
+        /* Move the search output to the outer list, swapping the buffers
+         * so we reuse the allocation of the previous outer list.
+         */
+        std::swap(nbl->ci, nbl->ciOuter);
+        std::swap(nbl->ci_nalloc, nbl->ciOuter_nalloc);
+        std::swap(nbl->cj, nbl->cjOuter);
+        std::swap(nbl->cj_nalloc, nbl->cjOuter_nalloc);
+        nbl->nciOuter = nbl->nci;
+        nbl->ncjOuter = nbl->ncj;
+
+        /* The inner list is filled by pruning, it can not grow
+         * beyond the size of the outer list.
+         */
+        nbl->nci      = 0;
+        nbl->ncj      = 0;
+        nbl->ncjInUse = 0;
+        if (nbl->nciOuter > nbl->ci_nalloc)
+        {
+            nb_realloc_ci(nbl, nbl->nciOuter);
+        }
+        check_cell_list_space_simple(nbl, nbl->ncjOuter);
+    }
+}
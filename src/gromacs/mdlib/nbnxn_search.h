@@ -83,4 +83,12 @@ void nbnxn_make_pairlist(const nbnxn_search_t  nbs,
                          int                   nb_kernel_type,
                          t_nrnb               *nrnb);
 
+/* Prepares the simple pair lists in nbl_list for dynamic pruning.
+ * The lists just produced by nbnxn_make_pairlist are moved to the outer
+ * lists and the (inner) lists used by the kernels are emptied.
+ * The inner lists should be filled by pruning the outer lists
+ * before they are used.
+ */
+void nbnxn_prepare_lists_for_dynamic_pruning(nbnxn_pairlist_set_t *nbl_list);
+
 #endif
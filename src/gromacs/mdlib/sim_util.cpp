@@ -112,6 +112,7 @@
 
 #include "nbnxn_gpu.h"
 #include "nbnxn_kernels/nbnxn_kernel_cpu.h"
+#include "nbnxn_kernels/nbnxn_kernel_prune.h"
 
 void print_time(FILE                     *out,
                 gmx_walltime_accounting_t walltime_accounting,
@@ -410,6 +411,7 @@ static void do_nb_verlet(t_forcerec *fr,
                          gmx_enerdata_t *enerd,
                          int flags, int ilocality,
                          int clearF,
+                         gmx_int64_t step,
                          t_nrnb *nrnb,
                          gmx_wallcycle_t wcycle)
 {
@@ -439,6 +441,17 @@ static void do_nb_verlet(t_forcerec *fr,
 
     bUsingGpuKernels = (nbvg->kernel_type == nbnxnk8x8x8_GPU);
 
+    if (fr->nbv->useDynamicPruning &&
+        (step - nbvg->nbl_lists.outerListCreationStep) % fr->nbv->nstlistPrune == 0)
+    {
+        /* Prune the outer list, made at the last search step,
+         * to the inner list using the current coordinates.
+         */
+        wallcycle_sub_start(wcycle, ewcsNONBONDED_PRUNING);
+        nbnxn_kernel_cpu_prune(nbvg, fr->nbv->rlistInner);
+        wallcycle_sub_stop(wcycle, ewcsNONBONDED_PRUNING);
+    }
+
     if (!bUsingGpuKernels)
     {
         wallcycle_sub_start(wcycle, ewcsNONBONDED);
@@ -914,6 +927,11 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
                             eintLocal,
                             nbv->grp[eintLocal].kernel_type,
                             nrnb);
+        if (nbv->useDynamicPruning)
+        {
+            nbnxn_prepare_lists_for_dynamic_pruning(&nbv->grp[eintLocal].nbl_lists);
+            nbv->grp[eintLocal].nbl_lists.outerListCreationStep = step;
+        }
         wallcycle_sub_stop(wcycle, ewcsNBS_SEARCH_LOCAL);
 
         if (bUseGPU)
@@ -945,7 +963,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
         wallcycle_start(wcycle, ewcLAUNCH_GPU_NB);
         /* launch local nonbonded F on GPU */
         do_nb_verlet(fr, ic, enerd, flags, eintLocal, enbvClearFNo,
-                     nrnb, wcycle);
+                     step, nrnb, wcycle);
         wallcycle_stop(wcycle, ewcLAUNCH_GPU_NB);
     }
 
@@ -989,6 +1007,11 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
                                 eintNonlocal,
                                 nbv->grp[eintNonlocal].kernel_type,
                                 nrnb);
+            if (nbv->useDynamicPruning)
+            {
+                nbnxn_prepare_lists_for_dynamic_pruning(&nbv->grp[eintNonlocal].nbl_lists);
+                nbv->grp[eintNonlocal].nbl_lists.outerListCreationStep = step;
+            }
 
             wallcycle_sub_stop(wcycle, ewcsNBS_SEARCH_NONLOCAL);
 
@@ -1001,6 +1024,15 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
             }
             wallcycle_stop(wcycle, ewcNS);
         }
+        else if (!bUseOrEmulGPU)
+        {
+            /* With CPU non-bondeds we overlap the first halo communication
+             * pulse with the local non-bonded work, see below.
+             */
+            wallcycle_start(wcycle, ewcMOVEX);
+            dd_move_x_start(cr->dd, box, x);
+            wallcycle_stop(wcycle, ewcMOVEX);
+        }
         else
         {
             wallcycle_start(wcycle, ewcMOVEX);
@@ -1020,7 +1052,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
             wallcycle_start(wcycle, ewcLAUNCH_GPU_NB);
             /* launch non-local nonbonded F on GPU */
             do_nb_verlet(fr, ic, enerd, flags, eintNonlocal, enbvClearFNo,
-                         nrnb, wcycle);
+                         step, nrnb, wcycle);
             wallcycle_stop(wcycle, ewcLAUNCH_GPU_NB);
         }
     }
@@ -1145,7 +1177,38 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
     {
         /* Maybe we should move this into do_force_lowlevel */
         do_nb_verlet(fr, ic, enerd, flags, eintLocal, enbvClearFYes,
-                     nrnb, wcycle);
+                     step, nrnb, wcycle);
+
+        if (DOMAINDECOMP(cr) && !bNS)
+        {
+            /* Complete the halo communication started before
+             * the local non-bonded work. Waiting for the neighbors
+             * should not count as load, so we close the balancing
+             * region around the wait.
+             */
+            wallcycle_stop(wcycle, ewcFORCE);
+            const bool bBalanceRegion =
+                (ddCloseBalanceRegion == DdCloseBalanceRegionAfterForceComputation::yes);
+            if (bBalanceRegion)
+            {
+                ddCloseBalanceRegionCpu(cr->dd);
+            }
+            wallcycle_start_nocount(wcycle, ewcMOVEX);
+            dd_move_x_finish(cr->dd, box, x);
+            wallcycle_stop(wcycle, ewcMOVEX);
+            if (bBalanceRegion)
+            {
+                ddOpenBalanceRegionCpu(cr->dd, DdAllowBalanceRegionReopen::no);
+            }
+
+            wallcycle_start(wcycle, ewcNB_XF_BUF_OPS);
+            wallcycle_sub_start(wcycle, ewcsNB_X_BUF_OPS);
+            nbnxn_atomdata_copy_x_to_nbat_x(nbv->nbs, eatNonlocal, FALSE, x,
+                                            nbv->grp[eintNonlocal].nbat);
+            wallcycle_sub_stop(wcycle, ewcsNB_X_BUF_OPS);
+            wallcycle_stop(wcycle, ewcNB_XF_BUF_OPS);
+            wallcycle_start_nocount(wcycle, ewcFORCE);
+        }
     }
 
     if (fr->efep != efepNO)
@@ -1179,7 +1242,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
         {
             do_nb_verlet(fr, ic, enerd, flags, eintNonlocal,
                          bDiffKernels ? enbvClearFYes : enbvClearFNo,
-                         nrnb, wcycle);
+                         step, nrnb, wcycle);
         }
 
         if (!bUseOrEmulGPU)
@@ -1253,7 +1316,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
             {
                 wallcycle_start_nocount(wcycle, ewcFORCE);
                 do_nb_verlet(fr, ic, enerd, flags, eintNonlocal, enbvClearFYes,
-                             nrnb, wcycle);
+                             step, nrnb, wcycle);
                 wallcycle_stop(wcycle, ewcFORCE);
             }
             wallcycle_start(wcycle, ewcNB_XF_BUF_OPS);
@@ -1333,7 +1396,7 @@ void do_force_cutsVERLET(FILE *fplog, t_commrec *cr,
             wallcycle_start_nocount(wcycle, ewcFORCE);
             do_nb_verlet(fr, ic, enerd, flags, eintLocal,
                          DOMAINDECOMP(cr) ? enbvClearFNo : enbvClearFYes,
-                         nrnb, wcycle);
+                         step, nrnb, wcycle);
             wallcycle_stop(wcycle, ewcFORCE);
         }
         wallcycle_start(wcycle, ewcNB_XF_BUF_OPS);
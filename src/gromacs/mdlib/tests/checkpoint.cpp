@@ -0,0 +1,253 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for writing checkpoints from a separate thread with
+ * make_checkpoint_snapshot() and write_checkpoint_snapshot()
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include "gromacs/fileio/checkpoint.h"
+
+#include "config.h"
+
+#include <cstdio>
+#include <cstdlib>
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/mdoutf.h"
+#include "gromacs/mdtypes/commrec.h"
+#include "gromacs/mdtypes/edsamhistory.h"
+#include "gromacs/mdtypes/energyhistory.h"
+#include "gromacs/mdtypes/md_enums.h"
+#include "gromacs/mdtypes/observableshistory.h"
+#include "gromacs/mdtypes/state.h"
+#include "gromacs/mdtypes/swaphistory.h"
+#include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/futil.h"
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/smalloc.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace
+{
+
+//! Sets or unsets GMX_NO_ASYNC_CHECKPOINT.
+void setNoAsyncCheckpoint(bool set)
+{
+#if GMX_NATIVE_WINDOWS
+    _putenv_s("GMX_NO_ASYNC_CHECKPOINT", set ? "1" : "");
+#else
+    if (set)
+    {
+        GMX_RELEASE_ASSERT(setenv("GMX_NO_ASYNC_CHECKPOINT", "1", 1) == 0,
+                           "Could not set GMX_NO_ASYNC_CHECKPOINT");
+    }
+    else
+    {
+        unsetenv("GMX_NO_ASYNC_CHECKPOINT");
+    }
+#endif
+}
+
+//! Returns the contents of file \p filename.
+std::vector<unsigned char> readFile(const std::string &filename)
+{
+    std::vector<unsigned char> data;
+    FILE                      *fp = gmx_ffopen(filename.c_str(), "rb");
+    unsigned char              buf[4096];
+    size_t                     n;
+    while ((n = std::fread(buf, 1, sizeof(buf), fp)) > 0)
+    {
+        data.insert(data.end(), buf, buf + n);
+    }
+    gmx_ffclose(fp);
+    return data;
+}
+
+/*! \brief Returns the byte range of the generation time string in
+ * the checkpoint header in \p data.
+ *
+ * The header starts with the magic number, followed by the XDR strings
+ * for the version, build time, build user, build host, generating
+ * program and generation time. An XDR string is stored as its length
+ * followed by the characters padded to a multiple of four bytes.
+ */
+std::pair<size_t, size_t> generationTimeRange(const std::vector<unsigned char> &data)
+{
+    size_t offset = 4;
+    for (int i = 0; i < 6; i++)
+    {
+        GMX_RELEASE_ASSERT(offset + 4 <= data.size(), "Checkpoint header is truncated");
+        size_t length = ((static_cast<size_t>(data[offset]) << 24) |
+                         (static_cast<size_t>(data[offset + 1]) << 16) |
+                         (static_cast<size_t>(data[offset + 2]) << 8) |
+                         static_cast<size_t>(data[offset + 3]));
+        size_t end    = offset + 4 + (length + 3)/4*4;
+        if (i == 5)
+        {
+            return std::make_pair(offset, end);
+        }
+        offset = end;
+    }
+    return std::make_pair(offset, offset);
+}
+
+/*! \brief
+ * Test fixture that writes checkpoints of a small state, with an
+ * XTC file open to have an output file listed in the checkpoint.
+ */
+class CheckpointSnapshotTest : public ::testing::Test
+{
+    public:
+        CheckpointSnapshotTest() : step_(1000), time_(2.0)
+        {
+            snew(cr_, 1);
+            cr_->nnodes = 1;
+
+            state_.flags = (1<<estX) | (1<<estV) | (1<<estBOX);
+            state_change_natoms(&state_, c_atomCount);
+            for (int i = 0; i < c_atomCount; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    state_.x[i][d] = 0.1*i + 0.3*d;
+                    state_.v[i][d] = 0.05*i - 0.2*d;
+                }
+            }
+            clear_mat(state_.box);
+            state_.box[XX][XX] = state_.box[YY][YY] = state_.box[ZZ][ZZ] = 3;
+
+            std::string xtcFilename = fileManager_.getTemporaryFilePath(".xtc");
+            /* Open for reading as well, as mdrun does, so the checkpoint
+               stores the checksum of the file */
+            xtc_ = open_xtc(xtcFilename.c_str(), "w+");
+            write_xtc(xtc_, c_atomCount, step_, time_, state_.box,
+                      as_rvec_array(state_.x.data()), 1000);
+        }
+        ~CheckpointSnapshotTest()
+        {
+            close_xtc(xtc_);
+            sfree(cr_);
+        }
+
+        //! Writes a checkpoint to \p filename with write_checkpoint().
+        void writeSync(const std::string &filename)
+        {
+            ivec one = { 1, 1, 1 };
+            write_checkpoint(filename.c_str(), FALSE, nullptr, cr_, one, 1,
+                             eiMD, 1, FALSE, 0, step_, time_,
+                             &state_, &observablesHistory_);
+        }
+
+        //! Writes a checkpoint to \p filename through a snapshot, returns the return code.
+        int writeAsync(const std::string &filename, char *errorMessage)
+        {
+            ivec                   one      = { 1, 1, 1 };
+            t_checkpoint_snapshot *snapshot =
+                make_checkpoint_snapshot(filename.c_str(), FALSE, nullptr, cr_, one, 1,
+                                         eiMD, 1, FALSE, 0, step_, time_,
+                                         &state_, &observablesHistory_);
+            /* Change the state, as the simulation would while the snapshot is written */
+            state_.x[0][XX] += 1;
+            int rc = write_checkpoint_snapshot(snapshot, errorMessage);
+            state_.x[0][XX] -= 1;
+            return rc;
+        }
+
+        //! The number of atoms in the state.
+        static const int           c_atomCount = 11;
+        gmx::test::TestFileManager fileManager_;
+        t_commrec                 *cr_;
+        t_state                    state_;
+        ObservablesHistory         observablesHistory_;
+        t_fileio                  *xtc_;
+        gmx_int64_t                step_;
+        double                     time_;
+};
+
+TEST_F(CheckpointSnapshotTest, SnapshotWritesSameFileAsWriteCheckpoint)
+{
+    if (!checkpoint_snapshot_supported())
+    {
+        return;
+    }
+    std::string syncFilename  = fileManager_.getTemporaryFilePath("sync.cpt");
+    std::string asyncFilename = fileManager_.getTemporaryFilePath("async.cpt");
+    char        errorMessage[STRLEN];
+
+    writeSync(syncFilename);
+    ASSERT_EQ(0, writeAsync(asyncFilename, errorMessage)) << errorMessage;
+
+    std::vector<unsigned char> syncData  = readFile(syncFilename);
+    std::vector<unsigned char> asyncData = readFile(asyncFilename);
+    ASSERT_EQ(syncData.size(), asyncData.size());
+
+    /* The generation time can differ when the clock ticks between
+       the two writes, all other bytes should be identical */
+    std::pair<size_t, size_t> timeRange = generationTimeRange(syncData);
+    EXPECT_EQ(timeRange, generationTimeRange(asyncData));
+    for (size_t i = 0; i < syncData.size(); i++)
+    {
+        if (i < timeRange.first || i >= timeRange.second)
+        {
+            ASSERT_EQ(syncData[i], asyncData[i]) << "Checkpoint files differ at byte " << i;
+        }
+    }
+}
+
+TEST(AsyncCheckpointTest, HonoursNoAsyncCheckpointEnvironmentVariable)
+{
+    setNoAsyncCheckpoint(true);
+    EXPECT_FALSE(mdoutf_use_async_checkpoint());
+    setNoAsyncCheckpoint(false);
+#ifndef GMX_FAHCORE
+    EXPECT_EQ(checkpoint_snapshot_supported(), mdoutf_use_async_checkpoint());
+#else
+    EXPECT_FALSE(mdoutf_use_async_checkpoint());
+#endif
+}
+
+} // namespace
@@ -0,0 +1,242 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the CPU pair-list pruning kernel
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
+#include "gromacs/mdlib/nb_verlet.h"
+#include "gromacs/mdlib/nbnxn_consts.h"
+#include "gromacs/mdlib/nbnxn_kernels/nbnxn_kernel_prune.h"
+#include "gromacs/mdlib/nbnxn_pairlist.h"
+#include "gromacs/pbcutil/ishift.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+//! The number of atoms in an i- and j-cluster
+const int  c_clusterSize = NBNXN_CPU_CLUSTER_I_SIZE;
+//! The number of clusters
+const int  c_numClusters = 24;
+//! The coordinate stride of the nbatXYZQ format
+const int  c_xStride     = 4;
+//! The shift vector index used for half of the i-clusters
+const int  c_shiftIndex  = CENTRAL + 1;
+//! The inner list cut-off to prune to
+const real c_rlistInner  = 0.8;
+
+/*! \brief Checks that pruning keeps exactly the cluster pairs within rlistInner
+ *
+ * An outer list of all cluster pairs is set up for random clusters.
+ * The expected inner list is computed with the same shifted coordinates,
+ * pair distances close to the cut-off are avoided, so rounding does
+ * not affect the result.
+ */
+class PruneKernelTest : public ::testing::Test
+{
+    protected:
+        PruneKernelTest() : nbat_(), nbl_(), nbvg_()
+        {
+            gmx_omp_nthreads_set(emntNonbonded, 1);
+
+            gmx::ThreeFry2x64<64>              rng(123456, gmx::RandomDomain::Other);
+            gmx::UniformRealDistribution<real> dist(0, 1);
+
+            x_.resize(c_numClusters*c_clusterSize*c_xStride);
+            for (int c = 0; c < c_numClusters; c++)
+            {
+                rvec center;
+                for (int d = 0; d < DIM; d++)
+                {
+                    center[d] = 3*dist(rng);
+                }
+                for (int a = c*c_clusterSize; a < (c + 1)*c_clusterSize; a++)
+                {
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        x_[a*c_xStride + d] = center[d] + 0.3*(dist(rng) - 0.5);
+                    }
+                    x_[a*c_xStride + DIM] = 0;
+                }
+            }
+            clear_rvecs(SHIFTS, shiftVec_);
+            shiftVec_[c_shiftIndex][XX] = 1.0;
+            shiftVec_[c_shiftIndex][ZZ] = -0.5;
+
+            nbat_.XFormat   = nbatXYZQ;
+            nbat_.xstride   = c_xStride;
+            nbat_.x         = x_.data();
+            nbat_.shift_vec = shiftVec_;
+
+            /* The outer list contains all pairs, with a shift and flags
+             * on every other i-cluster and unique exclusion masks.
+             */
+            for (int ci = 0; ci < c_numClusters; ci++)
+            {
+                nbnxn_ci_t entry;
+                entry.ci           = ci;
+                entry.shift        = (ci % 2 == 0 ? CENTRAL : c_shiftIndex | NBNXN_CI_DO_LJ(0));
+                entry.cj_ind_start = cjOuter_.size();
+                for (int cj = 0; cj < c_numClusters; cj++)
+                {
+                    nbnxn_cj_t cjEntry;
+                    cjEntry.cj   = cj;
+                    cjEntry.excl = ci*c_numClusters + cj;
+                    cjOuter_.push_back(cjEntry);
+                }
+                entry.cj_ind_end = cjOuter_.size();
+                ciOuter_.push_back(entry);
+            }
+            ciInner_.resize(ciOuter_.size());
+            cjInner_.resize(cjOuter_.size());
+
+            nbl_.bSimple  = TRUE;
+            nbl_.na_ci    = c_clusterSize;
+            nbl_.na_cj    = c_clusterSize;
+            nbl_.nciOuter = ciOuter_.size();
+            nbl_.ciOuter  = ciOuter_.data();
+            nbl_.ncjOuter = cjOuter_.size();
+            nbl_.cjOuter  = cjOuter_.data();
+            nbl_.ci       = ciInner_.data();
+            nbl_.cj       = cjInner_.data();
+            nblPtr_       = &nbl_;
+
+            nbvg_.nbl_lists.nnbl    = 1;
+            nbvg_.nbl_lists.nbl     = &nblPtr_;
+            nbvg_.nbl_lists.bSimple = TRUE;
+            nbvg_.nbat              = &nbat_;
+        }
+
+        //! Returns whether the cluster pair of \p ci, with shift index \p shift, and \p cj is in range
+        bool clusterPairIsInRange(int ci, int shift, int cj) const
+        {
+            bool isInRange = false;
+            for (int ia = ci*c_clusterSize; ia < (ci + 1)*c_clusterSize; ia++)
+            {
+                for (int ja = cj*c_clusterSize; ja < (cj + 1)*c_clusterSize; ja++)
+                {
+                    rvec dx;
+                    for (int d = 0; d < DIM; d++)
+                    {
+                        dx[d] = (x_[ia*c_xStride + d] + shiftVec_[shift][d]) - x_[ja*c_xStride + d];
+                    }
+                    real r = std::sqrt(norm2(dx));
+                    /* Ensure that the test is not sensitive to rounding */
+                    EXPECT_GT(std::abs(r - c_rlistInner), 1e-4*c_rlistInner) << "Atom pair too close to the cut-off, change the random seed";
+                    if (r < c_rlistInner)
+                    {
+                        isInRange = true;
+                    }
+                }
+            }
+            return isInRange;
+        }
+
+        std::vector<real>         x_;
+        rvec                      shiftVec_[SHIFTS];
+        nbnxn_atomdata_t          nbat_;
+        std::vector<nbnxn_ci_t>   ciOuter_;
+        std::vector<nbnxn_cj_t>   cjOuter_;
+        std::vector<nbnxn_ci_t>   ciInner_;
+        std::vector<nbnxn_cj_t>   cjInner_;
+        nbnxn_pairlist_t          nbl_;
+        nbnxn_pairlist_t         *nblPtr_;
+        nonbonded_verlet_group_t  nbvg_;
+};
+
+TEST_F(PruneKernelTest, KeepsExactlyThePairsWithinTheInnerCutoff)
+{
+    nbnxn_kernel_cpu_prune(&nbvg_, c_rlistInner);
+
+    /* Construct the expected inner list, which keeps the order of the outer list */
+    std::vector<nbnxn_ci_t> ciExpected;
+    std::vector<nbnxn_cj_t> cjExpected;
+    for (const nbnxn_ci_t &ciOuter : ciOuter_)
+    {
+        nbnxn_ci_t entry   = ciOuter;
+        entry.cj_ind_start = cjExpected.size();
+        for (int cjind = ciOuter.cj_ind_start; cjind < ciOuter.cj_ind_end; cjind++)
+        {
+            if (clusterPairIsInRange(ciOuter.ci, ciOuter.shift & NBNXN_CI_SHIFT, cjOuter_[cjind].cj))
+            {
+                cjExpected.push_back(cjOuter_[cjind]);
+            }
+        }
+        entry.cj_ind_end = cjExpected.size();
+        if (entry.cj_ind_end > entry.cj_ind_start)
+        {
+            ciExpected.push_back(entry);
+        }
+    }
+    /* Check that the test prunes some, but not all pairs */
+    ASSERT_LT(0U, cjExpected.size());
+    ASSERT_GT(cjOuter_.size(), cjExpected.size());
+
+    ASSERT_EQ(static_cast<int>(ciExpected.size()), nbl_.nci);
+    ASSERT_EQ(static_cast<int>(cjExpected.size()), nbl_.ncj);
+    EXPECT_EQ(nbl_.ncj, nbl_.ncjInUse);
+    for (size_t i = 0; i < ciExpected.size(); i++)
+    {
+        SCOPED_TRACE(gmx::formatString("i-entry %d", static_cast<int>(i)));
+        EXPECT_EQ(ciExpected[i].ci, nbl_.ci[i].ci);
+        EXPECT_EQ(ciExpected[i].shift, nbl_.ci[i].shift);
+        EXPECT_EQ(ciExpected[i].cj_ind_start, nbl_.ci[i].cj_ind_start);
+        EXPECT_EQ(ciExpected[i].cj_ind_end, nbl_.ci[i].cj_ind_end);
+    }
+    for (size_t j = 0; j < cjExpected.size(); j++)
+    {
+        SCOPED_TRACE(gmx::formatString("j-entry %d", static_cast<int>(j)));
+        EXPECT_EQ(cjExpected[j].cj, nbl_.cj[j].cj);
+        EXPECT_EQ(cjExpected[j].excl, nbl_.cj[j].excl);
+    }
+}
+
+} // namespace
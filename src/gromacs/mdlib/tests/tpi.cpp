@@ -0,0 +1,293 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the batched test particle insertion energy kernel
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include <cmath>
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/math/vec.h"
+#include "gromacs/mdlib/tpi_grid.h"
+#include "gromacs/mdtypes/interaction_const.h"
+#include "gromacs/mdtypes/mdatom.h"
+#include "gromacs/random/threefry.h"
+#include "gromacs/random/uniformrealdistribution.h"
+#include "gromacs/utility/stringutil.h"
+
+#include "testutils/testasserts.h"
+
+namespace
+{
+
+//! The number of LJ atom types
+const int c_numTypes        = 2;
+//! The number of energy groups
+const int c_numEnergyGroups = 2;
+//! The number of atoms in the inserted molecule
+const int c_numInsertAtoms  = 2;
+//! The cut-off distance
+const real c_cutoff         = 1.0;
+//! The minimum distance between atoms, avoids huge repulsion energies
+const real c_minDistance    = 0.3;
+
+/*! \brief Compares the grid insertion energy with a direct summation
+ *
+ * The direct summation loops over all pairs with minimum image, which
+ * is the reference that do_force gives with exact pair cut-offs.
+ */
+class TpiInsertionEnergyTest : public ::testing::Test
+{
+    protected:
+        TpiInsertionEnergyTest() : ic_(), md_(), rng_(123456, gmx::RandomDomain::Other), dist_(0, 1)
+        {
+            /* Potential-shifted LJ and reaction-field with eps_rf=infinity */
+            ic_.rvdw                  = c_cutoff;
+            ic_.rcoulomb              = c_cutoff;
+            ic_.repulsion_shift.cpot  = -std::pow(c_cutoff, -12);
+            ic_.dispersion_shift.cpot = -std::pow(c_cutoff, -6);
+            ic_.epsfac                = 138.935;
+            ic_.k_rf                  = 0.5/(c_cutoff*c_cutoff*c_cutoff);
+            ic_.c_rf                  = 1/c_cutoff + ic_.k_rf*c_cutoff*c_cutoff;
+
+            /* nbfp contains 6*C6 and 12*C12 */
+            const real c6[c_numTypes]  = { 2.6e-3, 1.2e-3 };
+            const real c12[c_numTypes] = { 2.6e-6, 0.9e-6 };
+            for (int i = 0; i < c_numTypes; i++)
+            {
+                for (int j = 0; j < c_numTypes; j++)
+                {
+                    nbfp_.push_back(6*std::sqrt(c6[i]*c6[j]));
+                    nbfp_.push_back(12*std::sqrt(c12[i]*c12[j]));
+                }
+            }
+        }
+
+        //! Returns whether \p x is at least c_minDistance away from the first \p n atoms in x_
+        bool isFarFromAtoms(const rvec x, int n) const
+        {
+            for (int j = 0; j < n; j++)
+            {
+                rvec dx;
+                rvec_sub(x, x_[j], dx);
+                putInMinimumImage(dx);
+                if (norm2(dx) < c_minDistance*c_minDistance)
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        //! Puts \p dx in the minimum image, valid for the rectangular box_
+        void putInMinimumImage(rvec dx) const
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                dx[d] -= box_[d][d]*std::floor(dx[d]/box_[d][d] + 0.5);
+            }
+        }
+
+        //! Sets \p x to a random position with coordinates between \p lower and \p upper times the box
+        void randomPosition(real lower, real upper, rvec x)
+        {
+            for (int d = 0; d < DIM; d++)
+            {
+                x[d] = (lower + (upper - lower)*dist_(rng_))*box_[d][d];
+            }
+        }
+
+        /*! \brief Sets up \p numEnvironmentAtoms atoms in a box with diagonal \p boxDiagonal
+         *
+         * Every third atom is put outside the box by a periodic shift.
+         */
+        void setUpSystem(const rvec boxDiagonal, int numEnvironmentAtoms)
+        {
+            clear_mat(box_);
+            for (int d = 0; d < DIM; d++)
+            {
+                box_[d][d] = boxDiagonal[d];
+            }
+
+            numEnvironmentAtoms_ = numEnvironmentAtoms;
+            int numAtoms         = numEnvironmentAtoms_ + c_numInsertAtoms;
+            x_.resize(numAtoms);
+            typeA_.resize(numAtoms);
+            chargeA_.resize(numAtoms);
+            cENER_.resize(numAtoms);
+            for (int i = 0; i < numAtoms; i++)
+            {
+                typeA_[i]   = i % c_numTypes;
+                chargeA_[i] = (i % 2 == 0 ? 0.4 : -0.4);
+                cENER_[i]   = (i/3) % c_numEnergyGroups;
+            }
+            for (int i = 0; i < numEnvironmentAtoms_; i++)
+            {
+                do
+                {
+                    randomPosition(0, 1, x_[i]);
+                }
+                while (!isFarFromAtoms(x_[i], i));
+                if (i % 3 == 0)
+                {
+                    int d = (i/3) % DIM;
+                    x_[i][d] += ((i/3) % 2 == 0 ? 1 : -1)*box_[d][d];
+                }
+            }
+
+            md_.nr      = numAtoms;
+            md_.typeA   = typeA_.data();
+            md_.chargeA = chargeA_.data();
+            md_.cENER   = cENER_.data();
+        }
+
+        //! Puts a molecule at a random position, which can be outside the box
+        void insertRandomMolecule()
+        {
+            const int a0 = numEnvironmentAtoms_;
+            do
+            {
+                randomPosition(-0.5, 1.5, x_[a0]);
+                rvec_add(x_[a0], gmx::RVec(0.1, 0.05, -0.05), x_[a0 + 1]);
+            }
+            while (!isFarFromAtoms(x_[a0], a0) || !isFarFromAtoms(x_[a0 + 1], a0));
+        }
+
+        //! Returns the energy of the inserted molecule, summed over all pairs
+        double referenceEnergy(double *vdwGrp, double *coulGrp) const
+        {
+            const int a0 = numEnvironmentAtoms_;
+            double    vtot = 0;
+            for (int g = 0; g < c_numEnergyGroups; g++)
+            {
+                vdwGrp[g]  = 0;
+                coulGrp[g] = 0;
+            }
+            for (int a = a0; a < a0 + c_numInsertAtoms; a++)
+            {
+                for (int j = 0; j < a0; j++)
+                {
+                    rvec dx;
+                    rvec_sub(x_[a], x_[j], dx);
+                    putInMinimumImage(dx);
+                    double r2 = norm2(dx);
+                    if (r2 < c_cutoff*c_cutoff)
+                    {
+                        double rinv6 = 1/(r2*r2*r2);
+                        double c6    = nbfp_[2*(typeA_[a]*c_numTypes + typeA_[j])];
+                        double c12   = nbfp_[2*(typeA_[a]*c_numTypes + typeA_[j]) + 1];
+                        double vvdw  = c12*(rinv6*rinv6 + ic_.repulsion_shift.cpot)/12
+                            - c6*(rinv6 + ic_.dispersion_shift.cpot)/6;
+                        double vcoul = ic_.epsfac*chargeA_[a]*chargeA_[j]*
+                            (1/std::sqrt(r2) + ic_.k_rf*r2 - ic_.c_rf);
+                        vdwGrp[cENER_[j]]  += vvdw;
+                        coulGrp[cENER_[j]] += vcoul;
+                        vtot               += vvdw + vcoul;
+                    }
+                }
+            }
+            return vtot;
+        }
+
+        //! Checks the grid energies of \p numInsertions random insertions with the reference
+        void checkInsertions(int numInsertions)
+        {
+            tpi_grid_t grid;
+            tpi_grid_put_atoms(&grid, box_, c_cutoff, numEnvironmentAtoms_,
+                               as_rvec_array(x_.data()), &md_);
+
+            gmx::test::FloatingPointTolerance tolerance(
+                    gmx::test::relativeToleranceAsFloatingPoint(100.0, 1e-5));
+            for (int n = 0; n < numInsertions; n++)
+            {
+                insertRandomMolecule();
+
+                const int a0 = numEnvironmentAtoms_;
+                real      vdwGrp[c_numEnergyGroups], coulGrp[c_numEnergyGroups];
+                double    vdwRef[c_numEnergyGroups], coulRef[c_numEnergyGroups];
+                real      energy =
+                    tpi_insertion_energy(&grid, box_, &ic_, nbfp_.data(), c_numTypes, &md_,
+                                         a0, a0 + c_numInsertAtoms, TRUE,
+                                         as_rvec_array(x_.data()) + a0,
+                                         c_numEnergyGroups, vdwGrp, coulGrp);
+                double    energyRef = referenceEnergy(vdwRef, coulRef);
+
+                SCOPED_TRACE(gmx::formatString("insertion %d", n));
+                EXPECT_REAL_EQ_TOL(energyRef, energy, tolerance);
+                for (int g = 0; g < c_numEnergyGroups; g++)
+                {
+                    EXPECT_REAL_EQ_TOL(vdwRef[g], vdwGrp[g], tolerance);
+                    EXPECT_REAL_EQ_TOL(coulRef[g], coulGrp[g], tolerance);
+                }
+            }
+        }
+
+        interaction_const_t                 ic_;
+        t_mdatoms                           md_;
+        gmx::ThreeFry2x64<64>               rng_;
+        gmx::UniformRealDistribution<real>  dist_;
+        std::vector<real>                   nbfp_;
+        matrix                              box_;
+        int                                 numEnvironmentAtoms_;
+        std::vector<gmx::RVec>              x_;
+        std::vector<int>                    typeA_;
+        std::vector<real>                   chargeA_;
+        std::vector<unsigned short>         cENER_;
+};
+
+TEST_F(TpiInsertionEnergyTest, MatchesDirectSumWithNeighborCells)
+{
+    /* At least 3 cells along each dimension */
+    const rvec boxDiagonal = { 3.1, 3.3, 3.6 };
+    setUpSystem(boxDiagonal, 150);
+    checkInsertions(50);
+}
+
+TEST_F(TpiInsertionEnergyTest, MatchesDirectSumWithMinimumImage)
+{
+    /* Less than 3 cells along y, which uses minimum image */
+    const rvec boxDiagonal = { 3.2, 2.3, 4.1 };
+    setUpSystem(boxDiagonal, 150);
+    checkInsertions(50);
+}
+
+} // namespace
@@ -0,0 +1,161 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for gmx::XtcWriterThread.
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include "gromacs/mdlib/xtcwriterthread.h"
+
+#include <cstdio>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/gmxfio.h"
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/utility/futil.h"
+
+#include "testutils/testfilemanager.h"
+
+namespace
+{
+
+//! Returns the contents of binary file \p filename.
+std::string readBinaryFile(const std::string &filename)
+{
+    std::string contents;
+    FILE       *fp = gmx_ffopen(filename.c_str(), "rb");
+    char        buf[4096];
+    size_t      n;
+    while ((n = std::fread(buf, 1, sizeof(buf), fp)) > 0)
+    {
+        contents.append(buf, n);
+    }
+    gmx_ffclose(fp);
+    return contents;
+}
+
+/*! \brief
+ * Test fixture that writes the same XTC frames with write_xtc()
+ * and with gmx::XtcWriterThread.
+ */
+class XtcWriterThreadTest : public ::testing::Test
+{
+    public:
+        XtcWriterThreadTest() : x_(c_atomCount)
+        {
+            syncFilename_  = fileManager_.getTemporaryFilePath("sync.xtc");
+            asyncFilename_ = fileManager_.getTemporaryFilePath("async.xtc");
+            clear_mat(box_);
+        }
+
+        //! Sets the box and coordinates for frame \p frame.
+        void setFrame(int frame)
+        {
+            box_[XX][XX] = 3 + 0.01*frame;
+            box_[YY][YY] = 4;
+            box_[ZZ][ZZ] = 5 - 0.01*frame;
+            for (int i = 0; i < c_atomCount; i++)
+            {
+                for (int d = 0; d < DIM; d++)
+                {
+                    x_[i][d] = 0.1*i + 0.3*d + 0.0123*frame*(i % 7);
+                }
+            }
+        }
+
+        //! Writes frames \p begin to \p end to both files.
+        void writeFrames(t_fileio *syncFio, gmx::XtcWriterThread *writer,
+                         int begin, int end)
+        {
+            for (int frame = begin; frame < end; frame++)
+            {
+                setFrame(frame);
+                ASSERT_NE(0, write_xtc(syncFio, c_atomCount, 10*frame, 0.02*frame,
+                                       box_, as_rvec_array(x_.data()), c_precision));
+                writer->writeFrame(10*frame, 0.02*frame, box_, as_rvec_array(x_.data()));
+                /* The writer should have copied the frame */
+                setFrame(-1);
+            }
+        }
+
+        //! The number of atoms in a frame.
+        static const int           c_atomCount = 123;
+        //! The XTC precision.
+        static constexpr real      c_precision = 1000;
+        gmx::test::TestFileManager fileManager_;
+        std::string                syncFilename_;
+        std::string                asyncFilename_;
+        matrix                     box_;
+        std::vector<gmx::RVec>     x_;
+};
+
+TEST_F(XtcWriterThreadTest, WritesSameFileAsWriteXtc)
+{
+    t_fileio                             *syncFio  = open_xtc(syncFilename_.c_str(), "w");
+    t_fileio                             *asyncFio = open_xtc(asyncFilename_.c_str(), "w");
+    std::unique_ptr<gmx::XtcWriterThread> writer(new gmx::XtcWriterThread(asyncFio, c_atomCount, c_precision));
+
+    /* Write more frames than the writer buffers,
+     * then flush, as mdrun does before writing a checkpoint.
+     */
+    writeFrames(syncFio, writer.get(), 0, 5);
+    writer->flush();
+    gmx_fio_flush(syncFio);
+    gmx_fio_flush(asyncFio);
+    std::string syncContents  = readBinaryFile(syncFilename_);
+    std::string asyncContents = readBinaryFile(asyncFilename_);
+    EXPECT_FALSE(syncContents.empty());
+    EXPECT_TRUE(syncContents == asyncContents) << "XTC files differ after flush";
+
+    /* Closing, as mdrun does at the end, should write the pending frames */
+    writeFrames(syncFio, writer.get(), 5, 8);
+    writer.reset();
+    close_xtc(syncFio);
+    close_xtc(asyncFio);
+    syncContents  = readBinaryFile(syncFilename_);
+    asyncContents = readBinaryFile(asyncFilename_);
+    EXPECT_TRUE(syncContents == asyncContents) << "XTC files differ after closing";
+}
+
+} // namespace
@@ -51,6 +51,7 @@
 #include <ctime>
 
 #include <algorithm>
+#include <vector>
 
 #include "gromacs/commandline/filenm.h"
 #include "gromacs/domdec/domdec.h"
@@ -66,12 +67,14 @@
 #include "gromacs/math/vec.h"
 #include "gromacs/mdlib/constr.h"
 #include "gromacs/mdlib/force.h"
+#include "gromacs/mdlib/gmx_omp_nthreads.h"
 #include "gromacs/mdlib/mdatoms.h"
 #include "gromacs/mdlib/mdebin.h"
 #include "gromacs/mdlib/mdrun.h"
 #include "gromacs/mdlib/ns.h"
 #include "gromacs/mdlib/sim_util.h"
 #include "gromacs/mdlib/tgroup.h"
+#include "gromacs/mdlib/tpi_grid.h"
 #include "gromacs/mdlib/update.h"
 #include "gromacs/mdlib/vsite.h"
 #include "gromacs/mdtypes/commrec.h"
@@ -87,6 +90,7 @@
 #include "gromacs/topology/mtop_util.h"
 #include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/utility/cstringutil.h"
+#include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/fatalerror.h"
 #include "gromacs/utility/gmxassert.h"
 #include "gromacs/utility/smalloc.h"
@@ -123,6 +127,69 @@ static void realloc_bins(double **bin, int *nbin, int nbin_new)
     }
 }
 
+//! The number of insertions for which the energies are computed at once
+static const int c_tpiBatchSize = 1024;
+
+/*! \brief Returns why batched insertions are not supported, NULL when they are
+ *
+ * The batched insertion kernel computes plain LJ and reaction-field
+ * interactions. Intra-molecular interactions of the inserted molecule
+ * are not computed, so all its intra-molecular pairs should be excluded.
+ */
+static const char *tpi_batch_unsupported_reason(const t_inputrec *ir,
+                                                const t_forcerec *fr,
+                                                const t_blocka   *excls,
+                                                int a_tp0, int a_tp1,
+                                                gmx_bool bCharge)
+{
+    if (ir->efep != efepNO)
+    {
+        return "free-energy perturbation is not supported";
+    }
+    if (fr->bBHAM || ir->vdwtype != evdwCUT ||
+        !(ir->vdw_modifier == eintmodNONE ||
+          ir->vdw_modifier == eintmodPOTSHIFT ||
+          ir->vdw_modifier == eintmodEXACTCUTOFF))
+    {
+        return "only plain or potential-shifted Lennard-Jones interactions are supported";
+    }
+    if (bCharge && !(EEL_RF(fr->eeltype) && fr->eeltype != eelRF_NEC_UNSUPPORTED))
+    {
+        return "only reaction-field electrostatics is supported for molecules with charges";
+    }
+    for (int i = a_tp0; i < a_tp1; i++)
+    {
+        int nexcl = 0;
+        for (int j = excls->index[i]; j < excls->index[i + 1]; j++)
+        {
+            if (excls->a[j] >= a_tp0 && excls->a[j] < a_tp1)
+            {
+                nexcl++;
+            }
+        }
+        if (nexcl != a_tp1 - a_tp0)
+        {
+            return "all intra-molecular pairs of the inserted molecule should be excluded";
+        }
+    }
+
+    return nullptr;
+}
+
+//! Returns the next insertion step for this rank after \p step
+static gmx_int64_t tpi_next_step(gmx_int64_t step, gmx_int64_t stepblocksize,
+                                 const t_commrec *cr)
+{
+    step++;
+    if ((step/stepblocksize) % cr->nnodes != cr->nodeid)
+    {
+        /* Skip all steps assigned to the other MPI ranks */
+        step += (cr->nnodes - 1)*stepblocksize;
+    }
+
+    return step;
+}
+
 namespace gmx
 {
 
@@ -197,6 +264,15 @@ double do_tpi(FILE *fplog, t_commrec *cr, const gmx::MDLogger gmx_unused &mdlog,
     real             prescorr, enercorr, dvdlcorr;
     gmx_bool         bEnergyOutOfBounds;
     const char      *tpid_leg[2] = {"direct", "reweighted"};
+    gmx_bool         bBatch, bBatchFrame, bNotedTriclinic = FALSE;
+    int              nbatch, b, nthreads;
+    gmx_int64_t      insertStep;
+    const real      *xtp;
+    tpi_grid_t       grid;
+    real             enercorrBatch = 0, rfExclBatch = 0;
+    std::vector<gmx::RVec>   batchX, batchXtp;
+    std::vector<gmx_int64_t> batchStep;
+    std::vector<real>        batchEpot, batchVdw, batchCoul;
 
     GMX_UNUSED_VALUE(outputProvider);
 
@@ -378,6 +454,32 @@ double do_tpi(FILE *fplog, t_commrec *cr, const gmx::MDLogger gmx_unused &mdlog,
         }
     }
 
+    /* An environment variable can be set to compute the energies of
+     * many insertions at once, using a grid of the frozen environment
+     * instead of calling do_force for each insertion.
+     */
+    bBatch   = (getenv("GMX_TPI_BATCH") != nullptr);
+    nthreads = gmx_omp_nthreads_get(emntDefault);
+    if (bBatch)
+    {
+        const char *reason = tpi_batch_unsupported_reason(inputrec, fr, &top->excls,
+                                                          a_tp0, a_tp1, bCharge);
+        if (reason != nullptr)
+        {
+            if (fplog)
+            {
+                fprintf(fplog, "\nNOTE: GMX_TPI_BATCH is set, but batched insertion can not be used: %s\n", reason);
+            }
+            bBatch = FALSE;
+        }
+        else if (fplog)
+        {
+            fprintf(fplog, "\nWill compute the energies of batches of %d insertions using %d OpenMP thread%s\n"
+                    "Note that batched insertion uses exact atom-pair cut-off distances\n",
+                    c_tpiBatchSize, nthreads, nthreads > 1 ? "s" : "");
+        }
+    }
+
     ngid   = groups->grps[egcENER].nr;
     gid_tp = GET_CGINFO_GID(fr->cginfo[cg_tp]);
     nener  = 1 + ngid;
@@ -499,6 +601,16 @@ double do_tpi(FILE *fplog, t_commrec *cr, const gmx::MDLogger gmx_unused &mdlog,
             gmx_fatal(FARGS, "Unknown integrator %s", ei_names[inputrec->eI]);
     }
 
+    if (bBatch)
+    {
+        batchX.resize(c_tpiBatchSize*(a_tp1 - a_tp0));
+        batchXtp.resize(c_tpiBatchSize);
+        batchStep.resize(c_tpiBatchSize);
+        batchEpot.resize(c_tpiBatchSize);
+        batchVdw.resize(c_tpiBatchSize*ngid);
+        batchCoul.resize(c_tpiBatchSize*ngid);
+    }
+
     while (bNotLastFrame)
     {
         frame_step      = rerun_fr.step;
@@ -535,6 +647,32 @@ double do_tpi(FILE *fplog, t_commrec *cr, const gmx::MDLogger gmx_unused &mdlog,
         bStateChanged = TRUE;
         bNS           = TRUE;
 
+        /* The grid only supports rectangular boxes, for triclinic frames
+         * we fall back to do_force.
+         */
+        bBatchFrame = (bBatch && !TRICLINIC(state_global->box));
+        if (bBatch && !bBatchFrame && !bNotedTriclinic)
+        {
+            if (fplog)
+            {
+                fprintf(fplog, "\nNOTE: Frame %d has a triclinic box, batched insertion is not used for frames with triclinic boxes\n", frame);
+            }
+            bNotedTriclinic = TRUE;
+        }
+        if (bBatchFrame)
+        {
+            /* Put the environment, which is frozen during this frame, on a grid */
+            tpi_grid_put_atoms(&grid, state_global->box,
+                               std::max(fr->ic->rvdw, fr->ic->rcoulomb),
+                               a_tp0, as_rvec_array(state_global->x.data()),
+                               mdatoms);
+
+            /* The dispersion correction only depends on the box */
+            calc_dispcorr(inputrec, fr, state_global->box,
+                          lambda, pres, vir, &prescorr, &enercorrBatch, &dvdlcorr);
+        }
+        nbatch = 0;
+
         step = cr->nodeid*stepblocksize;
         while (step < nsteps)
         {
@@ -648,159 +786,247 @@ double do_tpi(FILE *fplog, t_commrec *cr, const gmx::MDLogger gmx_unused &mdlog,
                 }
             }
 
-            /* Clear some matrix variables  */
-            clear_mat(force_vir);
-            clear_mat(shake_vir);
-            clear_mat(vir);
-            clear_mat(pres);
-
-            /* Set the charge group center of mass of the test particle */
-            copy_rvec(x_init, fr->cg_cm[top->cgs.nr-1]);
-
-            /* Calc energy (no forces) on new positions.
-             * Since we only need the intermolecular energy
-             * and the RF exclusion terms of the inserted molecule occur
-             * within a single charge group we can pass NULL for the graph.
-             * This also avoids shifts that would move charge groups
-             * out of the box. */
-            /* Make do_force do a single node force calculation */
-            cr->nnodes = 1;
-            do_force(fplog, cr, inputrec,
-                     step, nrnb, wcycle, top, &top_global->groups,
-                     state_global->box, &state_global->x, &state_global->hist,
-                     &f, force_vir, mdatoms, enerd, fcd,
-                     state_global->lambda,
-                     nullptr, fr, nullptr, mu_tot, t, nullptr, FALSE,
-                     GMX_FORCE_NONBONDED | GMX_FORCE_ENERGY |
-                     (bNS ? GMX_FORCE_DYNAMICBOX | GMX_FORCE_NS : 0) |
-                     (bStateChanged ? GMX_FORCE_STATECHANGED : 0),
-                     DdOpenBalanceRegionBeforeForceComputation::no,
-                     DdCloseBalanceRegionAfterForceComputation::no);
-            cr->nnodes    = nnodes;
-            bStateChanged = FALSE;
-            bNS           = FALSE;
-
-            /* Calculate long range corrections to pressure and energy */
-            calc_dispcorr(inputrec, fr, state_global->box,
-                          lambda, pres, vir, &prescorr, &enercorr, &dvdlcorr);
-            /* figure out how to rearrange the next 4 lines MRS 8/4/2009 */
-            enerd->term[F_DISPCORR]  = enercorr;
-            enerd->term[F_EPOT]     += enercorr;
-            enerd->term[F_PRES]     += prescorr;
-            enerd->term[F_DVDL_VDW] += dvdlcorr;
-
-            epot               = enerd->term[F_EPOT];
-            bEnergyOutOfBounds = FALSE;
-
-            /* If the compiler doesn't optimize this check away
-             * we catch the NAN energies.
-             * The epot>GMX_REAL_MAX check catches inf values,
-             * which should nicely result in embU=0 through the exp below,
-             * but it does not hurt to check anyhow.
-             */
-            /* Non-bonded Interaction usually diverge at r=0.
-             * With tabulated interaction functions the first few entries
-             * should be capped in a consistent fashion between
-             * repulsion, dispersion and Coulomb to avoid accidental
-             * negative values in the total energy.
-             * The table generation code in tables.c does this.
-             * With user tbales the user should take care of this.
-             */
-            if (epot != epot || epot > GMX_REAL_MAX)
+            if (bBatchFrame)
             {
-                bEnergyOutOfBounds = TRUE;
-            }
-            if (bEnergyOutOfBounds)
-            {
-                if (debug)
+                /* Store this insertion, we compute the energies of
+                 * a whole batch of insertions at once.
+                 */
+                for (i = a_tp0; i < a_tp1; i++)
+                {
+                    copy_rvec(state_global->x[i], batchX[nbatch*(a_tp1 - a_tp0) + i - a_tp0]);
+                }
+                copy_rvec(x_tp, batchXtp[nbatch]);
+                batchStep[nbatch] = step;
+                nbatch++;
+
+                step = tpi_next_step(step, stepblocksize, cr);
+                if (nbatch < c_tpiBatchSize && step < nsteps)
                 {
-                    fprintf(debug, "\n  time %.3f, step %d: non-finite energy %f, using exp(-bU)=0\n", t, (int)step, epot);
+                    continue;
+                }
+
+                if (bRFExcl)
+                {
+                    /* The RF exclusion correction does not depend on
+                     * the orientation, use the last insertion.
+                     */
+                    rvec  fshift_rf[SHIFTS];
+                    t_pbc pbc;
+
+                    set_pbc(&pbc, epbcXYZ, state_global->box);
+                    rfExclBatch = RF_excl_correction(fr, nullptr, mdatoms, &top->excls,
+                                                     as_rvec_array(state_global->x.data()),
+                                                     as_rvec_array(f.data()), fshift_rf,
+                                                     &pbc, lambda, &dvdlcorr);
+                }
+
+                /* The insertions are independent, so the energies do not
+                 * depend on the number of threads.
+                 */
+#pragma omp parallel for num_threads(nthreads) schedule(static)
+                for (int bt = 0; bt < nbatch; bt++)
+                {
+                    try
+                    {
+                        batchEpot[bt] =
+                            tpi_insertion_energy(&grid, state_global->box, fr->ic,
+                                                 fr->nbfp, fr->ntype, mdatoms,
+                                                 a_tp0, a_tp1, bCharge,
+                                                 as_rvec_array(batchX.data()) + bt*(a_tp1 - a_tp0),
+                                                 ngid,
+                                                 batchVdw.data() + bt*ngid,
+                                                 batchCoul.data() + bt*ngid)
+                            + enercorrBatch + rfExclBatch;
+                    }
+                    GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
                 }
-                embU = 0;
             }
             else
             {
-                embU      = exp(-beta*epot);
-                sum_embU += embU;
-                /* Determine the weighted energy contributions of each energy group */
-                e                = 0;
-                sum_UgembU[e++] += epot*embU;
-                if (fr->bBHAM)
+                /* Clear some matrix variables  */
+                clear_mat(force_vir);
+                clear_mat(shake_vir);
+                clear_mat(vir);
+                clear_mat(pres);
+
+                /* Set the charge group center of mass of the test particle */
+                copy_rvec(x_init, fr->cg_cm[top->cgs.nr-1]);
+
+                /* Calc energy (no forces) on new positions.
+                 * Since we only need the intermolecular energy
+                 * and the RF exclusion terms of the inserted molecule occur
+                 * within a single charge group we can pass NULL for the graph.
+                 * This also avoids shifts that would move charge groups
+                 * out of the box. */
+                /* Make do_force do a single node force calculation */
+                cr->nnodes = 1;
+                do_force(fplog, cr, inputrec,
+                         step, nrnb, wcycle, top, &top_global->groups,
+                         state_global->box, &state_global->x, &state_global->hist,
+                         &f, force_vir, mdatoms, enerd, fcd,
+                         state_global->lambda,
+                         nullptr, fr, nullptr, mu_tot, t, nullptr, FALSE,
+                         GMX_FORCE_NONBONDED | GMX_FORCE_ENERGY |
+                         (bNS ? GMX_FORCE_DYNAMICBOX | GMX_FORCE_NS : 0) |
+                         (bStateChanged ? GMX_FORCE_STATECHANGED : 0),
+                         DdOpenBalanceRegionBeforeForceComputation::no,
+                         DdCloseBalanceRegionAfterForceComputation::no);
+                cr->nnodes    = nnodes;
+                bStateChanged = FALSE;
+                bNS           = FALSE;
+
+                /* Calculate long range corrections to pressure and energy */
+                calc_dispcorr(inputrec, fr, state_global->box,
+                              lambda, pres, vir, &prescorr, &enercorr, &dvdlcorr);
+                /* figure out how to rearrange the next 4 lines MRS 8/4/2009 */
+                enerd->term[F_DISPCORR]  = enercorr;
+                enerd->term[F_EPOT]     += enercorr;
+                enerd->term[F_PRES]     += prescorr;
+                enerd->term[F_DVDL_VDW] += dvdlcorr;
+                nbatch = 1;
+            }
+
+            for (b = 0; b < nbatch; b++)
+            {
+                if (bBatchFrame)
                 {
+                    /* Put the energies of this insertion in enerd, as do_force does */
+                    insertStep              = batchStep[b];
+                    xtp                     = batchXtp[b].as_vec();
+                    enerd->term[F_EPOT]     = batchEpot[b];
+                    enerd->term[F_DISPCORR] = enercorrBatch;
+                    enerd->term[F_RF_EXCL]  = rfExclBatch;
                     for (i = 0; i < ngid; i++)
                     {
-                        sum_UgembU[e++] +=
-                            enerd->grpp.ener[egBHAMSR][GID(i, gid_tp, ngid)]*embU;
+                        enerd->grpp.ener[egLJSR][GID(i, gid_tp, ngid)]   = batchVdw[b*ngid + i];
+                        enerd->grpp.ener[egCOULSR][GID(i, gid_tp, ngid)] = batchCoul[b*ngid + i];
                     }
                 }
                 else
                 {
-                    for (i = 0; i < ngid; i++)
-                    {
-                        sum_UgembU[e++] +=
-                            enerd->grpp.ener[egLJSR][GID(i, gid_tp, ngid)]*embU;
-                    }
+                    insertStep = step;
+                    xtp        = x_tp;
                 }
-                if (bDispCorr)
+
+                epot               = enerd->term[F_EPOT];
+                bEnergyOutOfBounds = FALSE;
+
+                /* If the compiler doesn't optimize this check away
+                 * we catch the NAN energies.
+                 * The epot>GMX_REAL_MAX check catches inf values,
+                 * which should nicely result in embU=0 through the exp below,
+                 * but it does not hurt to check anyhow.
+                 */
+                /* Non-bonded Interaction usually diverge at r=0.
+                 * With tabulated interaction functions the first few entries
+                 * should be capped in a consistent fashion between
+                 * repulsion, dispersion and Coulomb to avoid accidental
+                 * negative values in the total energy.
+                 * The table generation code in tables.c does this.
+                 * With user tbales the user should take care of this.
+                 */
+                if (epot != epot || epot > GMX_REAL_MAX)
                 {
-                    sum_UgembU[e++] += enerd->term[F_DISPCORR]*embU;
+                    bEnergyOutOfBounds = TRUE;
                 }
-                if (bCharge)
+                if (bEnergyOutOfBounds)
                 {
-                    for (i = 0; i < ngid; i++)
+                    if (debug)
                     {
-                        sum_UgembU[e++] += enerd->grpp.ener[egCOULSR][GID(i, gid_tp, ngid)] * embU;
+                        fprintf(debug, "\n  time %.3f, step %d: non-finite energy %f, using exp(-bU)=0\n", t, (int)insertStep, epot);
                     }
-                    if (bRFExcl)
+                    embU = 0;
+                }
+                else
+                {
+                    embU      = exp(-beta*epot);
+                    sum_embU += embU;
+                    /* Determine the weighted energy contributions of each energy group */
+                    e                = 0;
+                    sum_UgembU[e++] += epot*embU;
+                    if (fr->bBHAM)
                     {
-                        sum_UgembU[e++] += enerd->term[F_RF_EXCL]*embU;
+                        for (i = 0; i < ngid; i++)
+                        {
+                            sum_UgembU[e++] +=
+                                enerd->grpp.ener[egBHAMSR][GID(i, gid_tp, ngid)]*embU;
+                        }
                     }
-                    if (EEL_FULL(fr->eeltype))
+                    else
                     {
-                        sum_UgembU[e++] += enerd->term[F_COUL_RECIP]*embU;
+                        for (i = 0; i < ngid; i++)
+                        {
+                            sum_UgembU[e++] +=
+                                enerd->grpp.ener[egLJSR][GID(i, gid_tp, ngid)]*embU;
+                        }
+                    }
+                    if (bDispCorr)
+                    {
+                        sum_UgembU[e++] += enerd->term[F_DISPCORR]*embU;
+                    }
+                    if (bCharge)
+                    {
+                        for (i = 0; i < ngid; i++)
+                        {
+                            sum_UgembU[e++] += enerd->grpp.ener[egCOULSR][GID(i, gid_tp, ngid)] * embU;
+                        }
+                        if (bRFExcl)
+                        {
+                            sum_UgembU[e++] += enerd->term[F_RF_EXCL]*embU;
+                        }
+                        if (EEL_FULL(fr->eeltype))
+                        {
+                            sum_UgembU[e++] += enerd->term[F_COUL_RECIP]*embU;
+                        }
                     }
                 }
-            }
 
-            if (embU == 0 || beta*epot > bU_bin_limit)
-            {
-                bin[0]++;
-            }
-            else
-            {
-                i = (int)((bU_logV_bin_limit
-                           - (beta*epot - logV + refvolshift))*invbinw
-                          + 0.5);
-                if (i < 0)
+                if (embU == 0 || beta*epot > bU_bin_limit)
                 {
-                    i = 0;
+                    bin[0]++;
                 }
-                if (i >= nbin)
+                else
                 {
-                    realloc_bins(&bin, &nbin, i+10);
+                    i = (int)((bU_logV_bin_limit
+                               - (beta*epot - logV + refvolshift))*invbinw
+                              + 0.5);
+                    if (i < 0)
+                    {
+                        i = 0;
+                    }
+                    if (i >= nbin)
+                    {
+                        realloc_bins(&bin, &nbin, i+10);
+                    }
+                    bin[i]++;
                 }
-                bin[i]++;
-            }
 
-            if (debug)
-            {
-                fprintf(debug, "TPI %7d %12.5e %12.5f %12.5f %12.5f\n",
-                        (int)step, epot, x_tp[XX], x_tp[YY], x_tp[ZZ]);
-            }
+                if (debug)
+                {
+                    fprintf(debug, "TPI %7d %12.5e %12.5f %12.5f %12.5f\n",
+                            (int)insertStep, epot, xtp[XX], xtp[YY], xtp[ZZ]);
+                }
 
-            if (dump_pdb && epot <= dump_ener)
-            {
-                sprintf(str, "t%g_step%d.pdb", t, (int)step);
-                sprintf(str2, "t: %f step %d ener: %f", t, (int)step, epot);
-                write_sto_conf_mtop(str, str2, top_global, as_rvec_array(state_global->x.data()), as_rvec_array(state_global->v.data()),
-                                    inputrec->ePBC, state_global->box);
+                if (dump_pdb && epot <= dump_ener)
+                {
+                    if (bBatchFrame)
+                    {
+                        for (i = a_tp0; i < a_tp1; i++)
+                        {
+                            copy_rvec(batchX[b*(a_tp1 - a_tp0) + i - a_tp0], state_global->x[i]);
+                        }
+                    }
+                    sprintf(str, "t%g_step%d.pdb", t, (int)insertStep);
+                    sprintf(str2, "t: %f step %d ener: %f", t, (int)insertStep, epot);
+                    write_sto_conf_mtop(str, str2, top_global, as_rvec_array(state_global->x.data()), as_rvec_array(state_global->v.data()),
+                                        inputrec->ePBC, state_global->box);
+                }
             }
+            nbatch = 0;
 
-            step++;
-            if ((step/stepblocksize) % cr->nnodes != cr->nodeid)
+            if (!bBatchFrame)
             {
-                /* Skip all steps assigned to the other MPI ranks */
-                step += (cr->nnodes - 1)*stepblocksize;
+                step = tpi_next_step(step, stepblocksize, cr);
             }
         }
 
@@ -0,0 +1,227 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief Defines the environment grid and energy kernel for batched
+ * test particle insertion
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include "tpi_grid.h"
+
+#include <cmath>
+
+#include <algorithm>
+
+#include "gromacs/math/functions.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdtypes/interaction_const.h"
+#include "gromacs/mdtypes/mdatom.h"
+
+//! Sets the grid cell indices \p c for position \p x, which can be outside the box
+static void tpi_grid_cell_coords(const tpi_grid_t *grid, const rvec x, ivec c)
+{
+    for (int d = 0; d < DIM; d++)
+    {
+        real s = x[d]*grid->invBox[d];
+
+        s   -= std::floor(s);
+        c[d] = std::min(static_cast<int>(s*grid->ncell[d]), grid->ncell[d] - 1);
+    }
+}
+
+void tpi_grid_put_atoms(tpi_grid_t *grid, const matrix box, real rc,
+                        int natoms, const rvec x[], const t_mdatoms *md)
+{
+    int ncellTot = 1;
+    for (int d = 0; d < DIM; d++)
+    {
+        grid->ncell[d]  = std::max(1, static_cast<int>(box[d][d]/rc));
+        grid->invBox[d] = 1/box[d][d];
+        ncellTot       *= grid->ncell[d];
+    }
+
+    grid->cellIndex.assign(ncellTot + 1, 0);
+    grid->cell.resize(natoms);
+    for (int i = 0; i < natoms; i++)
+    {
+        ivec c;
+
+        tpi_grid_cell_coords(grid, x[i], c);
+        grid->cell[i] = (c[XX]*grid->ncell[YY] + c[YY])*grid->ncell[ZZ] + c[ZZ];
+        grid->cellIndex[grid->cell[i] + 1]++;
+    }
+    for (int c = 0; c < ncellTot; c++)
+    {
+        grid->cellIndex[c + 1] += grid->cellIndex[c];
+    }
+
+    grid->x.resize(natoms);
+    grid->type.resize(natoms);
+    grid->q.resize(natoms);
+    grid->egid.resize(natoms);
+    /* Use the cell starts as fill counters, this shifts them one cell down */
+    for (int i = 0; i < natoms; i++)
+    {
+        int a = grid->cellIndex[grid->cell[i]]++;
+
+        /* The neighbor cell shifts in tpi_insertion_energy assume
+         * that the stored coordinates are in the unit cell.
+         */
+        for (int d = 0; d < DIM; d++)
+        {
+            grid->x[a][d] = x[i][d] - box[d][d]*std::floor(x[i][d]*grid->invBox[d]);
+        }
+        grid->type[a] = md->typeA[i];
+        grid->q[a]    = md->chargeA[i];
+        grid->egid[a] = (md->cENER ? md->cENER[i] : 0);
+    }
+    for (int c = ncellTot; c > 0; c--)
+    {
+        grid->cellIndex[c] = grid->cellIndex[c - 1];
+    }
+    grid->cellIndex[0] = 0;
+}
+
+real tpi_insertion_energy(const tpi_grid_t *grid, const matrix box,
+                          const interaction_const_t *ic,
+                          const real *nbfp, int ntype,
+                          const t_mdatoms *md,
+                          int a_tp0, int a_tp1, gmx_bool bCharge,
+                          const rvec x_tp[],
+                          int ngid, real *vdwGrp, real *coulGrp)
+{
+    const real rvdw2     = ic->rvdw*ic->rvdw;
+    const real rcoul2    = ic->rcoulomb*ic->rcoulomb;
+    const real repShift  = ic->repulsion_shift.cpot;
+    const real dispShift = ic->dispersion_shift.cpot;
+    real       vtot;
+
+    for (int g = 0; g < ngid; g++)
+    {
+        vdwGrp[g]  = 0;
+        coulGrp[g] = 0;
+    }
+
+    for (int a = a_tp0; a < a_tp1; a++)
+    {
+        const real *xa        = x_tp[a - a_tp0];
+        const real *nbfp_a    = nbfp + 2*ntype*md->typeA[a];
+        const real  qa        = ic->epsfac*md->chargeA[a];
+        gmx_bool    bMinImage = FALSE;
+        rvec        xin, xs;
+        ivec        ca, c0, c1;
+
+        tpi_grid_cell_coords(grid, xa, ca);
+        for (int d = 0; d < DIM; d++)
+        {
+            /* Put the atom in the box, so we know the periodic shift
+             * of each neighbor cell. With less than 3 cells along
+             * a dimension we visit each cell once and use minimum image.
+             */
+            xin[d] = xa[d] - box[d][d]*std::floor(xa[d]*grid->invBox[d]);
+            if (grid->ncell[d] >= 3)
+            {
+                c0[d] = ca[d] - 1;
+                c1[d] = ca[d] + 1;
+            }
+            else
+            {
+                c0[d]     = 0;
+                c1[d]     = grid->ncell[d] - 1;
+                bMinImage = TRUE;
+            }
+        }
+
+        for (int cx = c0[XX]; cx <= c1[XX]; cx++)
+        {
+            int ix  = (cx + grid->ncell[XX]) % grid->ncell[XX];
+            xs[XX]  = xin[XX] - ((cx - ix)/grid->ncell[XX])*box[XX][XX];
+            for (int cy = c0[YY]; cy <= c1[YY]; cy++)
+            {
+                int iy  = (cy + grid->ncell[YY]) % grid->ncell[YY];
+                xs[YY]  = xin[YY] - ((cy - iy)/grid->ncell[YY])*box[YY][YY];
+                for (int cz = c0[ZZ]; cz <= c1[ZZ]; cz++)
+                {
+                    int iz   = (cz + grid->ncell[ZZ]) % grid->ncell[ZZ];
+                    int cell = (ix*grid->ncell[YY] + iy)*grid->ncell[ZZ] + iz;
+                    xs[ZZ]   = xin[ZZ] - ((cz - iz)/grid->ncell[ZZ])*box[ZZ][ZZ];
+
+                    for (int j = grid->cellIndex[cell]; j < grid->cellIndex[cell + 1]; j++)
+                    {
+                        rvec dx;
+                        real r2;
+
+                        rvec_sub(xs, grid->x[j], dx);
+                        if (bMinImage)
+                        {
+                            for (int d = 0; d < DIM; d++)
+                            {
+                                dx[d] -= box[d][d]*std::floor(dx[d]*grid->invBox[d] + 0.5);
+                            }
+                        }
+                        r2 = norm2(dx);
+
+                        if (r2 < rvdw2)
+                        {
+                            real rinv6 = 1/(r2*r2*r2);
+                            real c6    = nbfp_a[2*grid->type[j]];
+                            real c12   = nbfp_a[2*grid->type[j] + 1];
+
+                            /* nbfp contains 6*C6 and 12*C12 */
+                            vdwGrp[grid->egid[j]] += c12*(rinv6*rinv6 + repShift)*(1.0/12.0)
+                                - c6*(rinv6 + dispShift)*(1.0/6.0);
+                        }
+                        if (bCharge && r2 < rcoul2)
+                        {
+                            coulGrp[grid->egid[j]] += qa*grid->q[j]*
+                                (gmx::invsqrt(r2) + ic->k_rf*r2 - ic->c_rf);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    vtot = 0;
+    for (int g = 0; g < ngid; g++)
+    {
+        vtot += vdwGrp[g] + coulGrp[g];
+    }
+
+    return vtot;
+}
@@ -0,0 +1,98 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ *
+ * \brief Declares the environment grid and energy kernel for batched
+ * test particle insertion
+ *
+ * \ingroup module_mdlib
+ */
+#ifndef GMX_MDLIB_TPI_GRID_H
+#define GMX_MDLIB_TPI_GRID_H
+
+#include <vector>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/real.h"
+
+struct interaction_const_t;
+struct t_mdatoms;
+
+/*! \internal \brief Cell grid of the frozen environment for batched insertions
+ *
+ * All atoms except for those of the molecule to insert are sorted
+ * on a grid with cells of at least the cut-off size, so an inserted
+ * atom only interacts with atoms in the 27 cells around its own cell.
+ */
+struct tpi_grid_t
+{
+    ivec                   ncell;     //!< The number of cells along each dimension
+    rvec                   invBox;    //!< The inverse box diagonal elements
+    std::vector<int>       cellIndex; //!< Index of the first atom in each cell, size #cells + 1
+    std::vector<int>       cell;      //!< Work array with the cell of each atom
+    std::vector<gmx::RVec> x;         //!< Coordinates put in the unit cell, sorted on cell
+    std::vector<int>       type;      //!< VdW types sorted on cell
+    std::vector<real>      q;         //!< Charges sorted on cell
+    std::vector<int>       egid;      //!< Energy group indices sorted on cell
+};
+
+/*! \brief Puts the \p natoms environment atoms on the grid
+ *
+ * \p box should be rectangular, \p rc is the maximum cut-off distance.
+ * The atoms can be outside the box, they are put in the unit cell.
+ */
+void tpi_grid_put_atoms(tpi_grid_t *grid, const matrix box, real rc,
+                        int natoms, const rvec x[], const t_mdatoms *md);
+
+/*! \brief Returns the non-bonded energy of one inserted molecule with the environment
+ *
+ * \p x_tp contains the coordinates of atoms \p a_tp0 to \p a_tp1,
+ * which can be outside the box. \p nbfp and \p ntype are the LJ
+ * parameter matrix and the number of atom types, as in t_forcerec.
+ * The VdW and Coulomb energies per energy group of the environment
+ * are returned in \p vdwGrp and \p coulGrp, both of size \p ngid.
+ * Note that, unlike the group scheme kernels, exact atom-pair cut-offs
+ * are used.
+ */
+real tpi_insertion_energy(const tpi_grid_t *grid, const matrix box,
+                          const interaction_const_t *ic,
+                          const real *nbfp, int ntype,
+                          const t_mdatoms *md,
+                          int a_tp0, int a_tp1, gmx_bool bCharge,
+                          const rvec x_tp[],
+                          int ngid, real *vdwGrp, real *coulGrp);
+
+#endif // GMX_MDLIB_TPI_GRID_H
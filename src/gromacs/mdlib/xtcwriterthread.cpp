@@ -0,0 +1,147 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Implements gmx::XtcWriterThread.
+ *
+ * \ingroup module_mdlib
+ */
+#include "gmxpre.h"
+
+#include "xtcwriterthread.h"
+
+#include "gromacs/fileio/xtcio.h"
+#include "gromacs/math/vec.h"
+#include "gromacs/mdrunutility/threadaffinity.h"
+#include "gromacs/utility/fatalerror.h"
+#include "gromacs/utility/gmxassert.h"
+
+namespace gmx
+{
+
+XtcWriterThread::XtcWriterThread(t_fileio *fio, int natoms, real precision)
+    : fio_(fio), precision_(precision), first_(0), count_(0),
+      bStop_(false), bWriteError_(false)
+{
+    for (Frame &frame : frames_)
+    {
+        frame.x.resize(natoms);
+    }
+    thread_ = std::thread([this] { run(); });
+}
+
+XtcWriterThread::~XtcWriterThread()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        bStop_ = true;
+    }
+    frameQueued_.notify_one();
+    thread_.join();
+}
+
+void XtcWriterThread::writeFrame(gmx_int64_t step, real time,
+                                 const matrix box, const rvec *x)
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    frameWritten_.wait(lock, [this] { return count_ < c_frameBufferCount; });
+    checkWriteError(&lock);
+    /* The writer thread only accesses queued frames, so this buffer
+       can be filled without holding the lock */
+    Frame &frame = frames_[(first_ + count_) % c_frameBufferCount];
+    lock.unlock();
+    frame.step = step;
+    frame.time = time;
+    copy_mat(box, frame.box);
+    for (size_t i = 0; i < frame.x.size(); i++)
+    {
+        copy_rvec(x[i], frame.x[i]);
+    }
+    lock.lock();
+    ++count_;
+    lock.unlock();
+    frameQueued_.notify_one();
+}
+
+void XtcWriterThread::flush()
+{
+    std::unique_lock<std::mutex> lock(mutex_);
+    frameWritten_.wait(lock, [this] { return count_ == 0; });
+    checkWriteError(&lock);
+}
+
+void XtcWriterThread::checkWriteError(std::unique_lock<std::mutex> *lock)
+{
+    GMX_RELEASE_ASSERT(lock->owns_lock() && lock->mutex() == &mutex_,
+                       "The write error flag should only be read with the mutex held");
+    if (bWriteError_)
+    {
+        lock->unlock();
+        gmx_fatal(FARGS, "XTC error - maybe you are out of disk space?");
+    }
+}
+
+void XtcWriterThread::run()
+{
+    gmx_unpin_current_thread();
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    while (true)
+    {
+        frameQueued_.wait(lock, [this] { return count_ > 0 || bStop_; });
+        if (count_ == 0)
+        {
+            break;
+        }
+        Frame &frame = frames_[first_];
+        /* After a failed write we only drain the queue */
+        bool   bSkip = bWriteError_;
+        lock.unlock();
+        bool   bOK   = (bSkip ||
+                        write_xtc(fio_, static_cast<int>(frame.x.size()),
+                                  frame.step, frame.time, frame.box,
+                                  as_rvec_array(frame.x.data()), precision_) != 0);
+        lock.lock();
+        if (!bOK)
+        {
+            bWriteError_ = true;
+        }
+        first_ = (first_ + 1) % c_frameBufferCount;
+        --count_;
+        frameWritten_.notify_all();
+    }
+}
+
+} // namespace gmx
@@ -0,0 +1,127 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \libinternal \file
+ * \brief
+ * Declares gmx::XtcWriterThread for asynchronous XTC output.
+ *
+ * \inlibraryapi
+ * \ingroup module_mdlib
+ */
+#ifndef GMX_MDLIB_XTCWRITERTHREAD_H
+#define GMX_MDLIB_XTCWRITERTHREAD_H
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/basedefinitions.h"
+#include "gromacs/utility/real.h"
+
+struct t_fileio;
+
+namespace gmx
+{
+
+/*! \libinternal \brief
+ * Compresses and writes XTC frames in a separate thread.
+ *
+ * writeFrame() copies the coordinates into one of a fixed number of
+ * frame buffers and returns, so the MD loop can continue while the
+ * frame is compressed. When all buffers are in use, writeFrame() waits
+ * for the oldest frame to be written, which limits the memory use and
+ * the number of frames that can be lost on a crash.
+ *
+ * The thread is started from init_mdoutf(), after mdrun has pinned its
+ * threads, and would thus share the core of the master thread. It
+ * unpins itself instead, since it mainly waits for frames and I/O,
+ * see gmx_unpin_current_thread().
+ */
+class XtcWriterThread
+{
+    public:
+        //! Starts the writer thread for \p fio, which is not closed by this class.
+        XtcWriterThread(t_fileio *fio, int natoms, real precision);
+        //! Writes all pending frames and stops the thread.
+        ~XtcWriterThread();
+
+        //! Queues a frame for writing, waits if all buffers are in use.
+        void writeFrame(gmx_int64_t step, real time, const matrix box, const rvec *x);
+        //! Waits until all queued frames have been written.
+        void flush();
+
+    private:
+        //! Copy of the data for one output frame.
+        struct Frame
+        {
+            gmx_int64_t             step;
+            real                    time;
+            matrix                  box;
+            std::vector<RVec>       x;
+        };
+
+        //! Main function of the writer thread.
+        void run();
+        /*! \brief Stops with a fatal error if writing a frame failed.
+         *
+         * \p lock must hold mutex_. It is released before stopping,
+         * so the writer thread can still finish.
+         */
+        void checkWriteError(std::unique_lock<std::mutex> *lock);
+
+        //! Number of frames that can be waiting to be written.
+        static const int         c_frameBufferCount = 2;
+
+        t_fileio                *fio_;
+        real                     precision_;
+        Frame                    frames_[c_frameBufferCount];
+        //! Index of the oldest queued frame.
+        int                      first_;
+        //! Number of queued frames, including the one being written.
+        int                      count_;
+        bool                     bStop_;
+        bool                     bWriteError_;
+        std::mutex               mutex_;
+        //! Signals the writer that a frame was queued or that it should stop.
+        std::condition_variable  frameQueued_;
+        //! Signals writeFrame() and flush() that a frame was written.
+        std::condition_variable  frameWritten_;
+        std::thread              thread_;
+};
+
+} // namespace gmx
+
+#endif
@@ -42,6 +42,9 @@
 #include <cstdio>
 #include <cstring>
 
+#include <atomic>
+#include <mutex>
+
 #if HAVE_SCHED_AFFINITY
 #  include <sched.h>
 #  include <sys/syscall.h>
@@ -87,6 +90,28 @@ class DefaultThreadAffinityAccess : public gmx::IThreadAffinityAccess
 //! Global instance of DefaultThreadAffinityAccess
 DefaultThreadAffinityAccess g_defaultAffinityAccess;
 
+#if HAVE_SCHED_AFFINITY
+//! The affinity mask of the process before mdrun pinned its threads
+cpu_set_t         g_processAffinityMask;
+//! Whether g_processAffinityMask has been stored
+std::atomic<bool> g_bProcessAffinityMaskStored(false);
+//! Ensures g_processAffinityMask is stored only once with multiple ranks
+std::once_flag    g_processAffinityMaskOnce;
+
+//! Stores the affinity mask of the calling, not yet pinned, thread
+void storeProcessAffinityMask()
+{
+    std::call_once(g_processAffinityMaskOnce, []
+                   {
+                       CPU_ZERO(&g_processAffinityMask);
+                       if (sched_getaffinity(0, sizeof(cpu_set_t), &g_processAffinityMask) == 0)
+                       {
+                           g_bProcessAffinityMaskStored = true;
+                       }
+                   });
+}
+#endif
+
 } // namespace
 
 gmx::IThreadAffinityAccess::~IThreadAffinityAccess()
@@ -432,6 +457,13 @@ gmx_set_thread_affinity(const gmx::MDLogger         &mdlog,
                                      offset, &core_pinning_stride, &localityOrder);
     const gmx::sfree_guard  localityOrderGuard(localityOrder);
 
+#if HAVE_SCHED_AFFINITY
+    if (affinityAccess == &g_defaultAffinityAccess)
+    {
+        storeProcessAffinityMask();
+    }
+#endif
+
     bool                    allAffinitiesSet;
     if (validLayout)
     {
@@ -452,6 +484,17 @@ gmx_set_thread_affinity(const gmx::MDLogger         &mdlog,
     }
 }
 
+void gmx_unpin_current_thread()
+{
+#if HAVE_SCHED_AFFINITY
+    if (g_bProcessAffinityMaskStored)
+    {
+        /* Failure only affects performance, so we ignore it */
+        sched_setaffinity(0, sizeof(cpu_set_t), &g_processAffinityMask);
+    }
+#endif
+}
+
 /* Check the process affinity mask and if it is found to be non-zero,
  * will honor it and disable mdrun internal affinity setting.
  * Note that this will only work on Linux as we use a GNU feature.
@@ -79,6 +79,18 @@ gmx_set_thread_affinity(const gmx::MDLogger         &mdlog,
                         int                          nthread_local,
                         gmx::IThreadAffinityAccess  *affinityAccess);
 
+/*! \brief
+ * Resets the affinity of the calling thread to that of the process
+ * before gmx_set_thread_affinity() pinned the threads.
+ *
+ * Threads that are started after pinning inherit the core of the thread
+ * that started them. Helper threads, e.g. for asynchronous output, should
+ * call this so they do not compete with that thread for its core.
+ * Does nothing when mdrun did not set thread affinities.
+ */
+void
+gmx_unpin_current_thread();
+
 /*! \brief
  * Checks the process affinity mask and if it is found to be non-zero,
  * will honor it and disable mdrun internal affinity setting.
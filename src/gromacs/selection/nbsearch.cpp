@@ -38,6 +38,14 @@
  *
  * High-level overview of the algorithm is at \ref page_analysisnbsearch.
  *
+ * Reference positions are stored on the grid sorted by cell, in clusters
+ * of SIMD width with coordinates in separate x, y and z blocks, so that
+ * distances to a test position are computed for a whole cluster at once,
+ * similar to the cluster setup of the nbnxn pair search.
+ * Cells are padded to whole clusters with positions far outside the cutoff.
+ * The grid is built with a counting sort that is parallelized with OpenMP
+ * for large numbers of reference positions.
+ *
  * \todo
  * The grid implementation could still be optimized in several different ways:
  *   - A better heuristic for selecting the grid size or falling back to a
@@ -63,10 +71,13 @@
 #include "gromacs/math/vec.h"
 #include "gromacs/pbcutil/pbc.h"
 #include "gromacs/selection/position.h"
+#include "gromacs/simd/simd.h"
 #include "gromacs/topology/block.h"
+#include "gromacs/utility/alignedallocator.h"
 #include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/gmxomp.h"
 #include "gromacs/utility/mutex.h"
 #include "gromacs/utility/stringutil.h"
 
@@ -76,6 +87,18 @@ namespace gmx
 namespace
 {
 
+#if GMX_SIMD_HAVE_REAL
+//! Number of reference positions in a grid cluster.
+const int  c_clusterSize          = GMX_SIMD_REAL_WIDTH;
+#else
+//! Number of reference positions in a grid cluster.
+const int  c_clusterSize          = 1;
+#endif
+//! Coordinate of the padding positions in grid clusters.
+const real c_paddingCoordinate    = 1e10;
+//! Minimum number of reference positions per thread for building the grid.
+const int  c_minPositionsPerThread = 10000;
+
 /*! \brief
  * Computes the bounding box for a set of positions.
  *
@@ -121,7 +144,6 @@ class AnalysisNeighborhoodSearchImpl
         typedef AnalysisNeighborhoodPairSearch::ImplPointer
             PairSearchImplPointer;
         typedef std::vector<PairSearchImplPointer> PairSearchList;
-        typedef std::vector<std::vector<int> > CellList;
 
         explicit AnalysisNeighborhoodSearchImpl(real cutoff);
         ~AnalysisNeighborhoodSearchImpl();
@@ -189,16 +211,34 @@ class AnalysisNeighborhoodSearchImpl
          */
         int getGridCellIndex(const ivec cell) const;
         /*! \brief
-         * Adds an index into a grid cell.
+         * Calculates the linear index of the grid cell for a point.
          *
-         * \param[in]  cell Fractional cell coordinates into which \p i should
-         *     be added.
-         * \param[in]  i    Index to add.
+         * \param[in]  cell Fractional cell coordinates of the point.
+         * \returns    Linear index of the cell that contains \p cell.
          *
          * \p cell should satisfy the conditions that \p mapPointToGridCell()
-         * produces.
+         * produces.  Points outside non-periodic dimensions are put into the
+         * edge cells.
+         */
+        int getPointCellIndex(const rvec cell) const;
+        /*! \brief
+         * Puts the reference positions on the grid.
+         *
+         * \param[in] positions  Reference positions.
+         *
+         * Maps the positions into the unit cell, sorts them on grid cell
+         * and stores the coordinates in clusters.  Positions keep their
+         * original order within each cell.
+         */
+        void fillGrid(const AnalysisNeighborhoodPositions &positions);
+        /*! \brief
+         * Computes squared distances between a point and a grid cluster.
+         *
+         * \param[in]  slot  First slot of the cluster in the cell arrays.
+         * \param[in]  x     Position to compute the distances to.
+         * \param[out] r2    Squared distances for the c_clusterSize positions.
          */
-        void addToGridCell(const rvec cell, int i);
+        void computeClusterDistances(int slot, const rvec x, real *r2) const;
         /*! \brief
          * Initializes a cell pair loop for a dimension.
          *
@@ -310,8 +350,16 @@ class AnalysisNeighborhoodSearchImpl
         real                    cellShiftYX_;
         //! Number of cells along each dimension.
         ivec                    ncelldim_;
-        //! Data structure to hold the grid cell contents.
-        CellList                cells_;
+        //! First slot of each grid cell in the cluster arrays, and the total.
+        std::vector<int>        cellStart_;
+        //! Reference position index for each slot, -1 for padding.
+        std::vector<int>        cellRefIndex_;
+        //! Coordinates for each cluster, as c_clusterSize x, y and z values.
+        std::vector<real, AlignedAllocator<real> > cellX_;
+        //! Grid cell index of each reference position.
+        std::vector<int>        refCell_;
+        //! Position counts and then write offsets per thread for each cell.
+        std::vector<int>        threadCellCount_;
 
         Mutex                   createPairSearchMutex_;
         PairSearchList          pairSearchList_;
@@ -347,6 +395,8 @@ class AnalysisNeighborhoodPairSearchImpl
         bool searchNext(Action action);
         //! Initializes a pair representing the pair found by searchNext().
         void initFoundPair(AnalysisNeighborhoodPair *pair) const;
+        //! Finds up to \p maxCount next pairs, returns the number found.
+        int findNextPairs(AnalysisNeighborhoodPair *pairs, int maxCount);
         //! Advances to the next test position, skipping any remaining pairs.
         void nextTestPosition();
 
@@ -390,6 +440,10 @@ class AnalysisNeighborhoodPairSearchImpl
         ivec                                    cellBound_;
         //! Stores the index within the current cell during pair loops.
         int                                     prevcai_;
+        //! Index within the current cell of the cluster in \p clusterR2_, -1 if none.
+        int                                     clusterStart_;
+        //! Squared distances from the test position to the current cluster.
+        real                                    clusterR2_[c_clusterSize];
 
         GMX_DISALLOW_COPY_AND_ASSIGN(AnalysisNeighborhoodPairSearchImpl);
 };
@@ -529,17 +583,7 @@ bool AnalysisNeighborhoodSearchImpl::initGridCells(
     {
         return false;
     }
-    // Never decrease the size of the cell vector to avoid reallocating
-    // memory for the nested vectors.  The actual size of the vector is not
-    // used outside this function.
-    if (cells_.size() < static_cast<size_t>(totalCellCount))
-    {
-        cells_.resize(totalCellCount);
-    }
-    for (int ci = 0; ci < totalCellCount; ++ci)
-    {
-        cells_[ci].clear();
-    }
+    cellStart_.resize(totalCellCount + 1);
     return true;
 }
 
@@ -685,7 +729,7 @@ int AnalysisNeighborhoodSearchImpl::getGridCellIndex(const ivec cell) const
            + cell[ZZ] * ncelldim_[XX] * ncelldim_[YY];
 }
 
-void AnalysisNeighborhoodSearchImpl::addToGridCell(const rvec cell, int i)
+int AnalysisNeighborhoodSearchImpl::getPointCellIndex(const rvec cell) const
 {
     ivec icell;
     for (int dd = 0; dd < DIM; ++dd)
@@ -705,8 +749,114 @@ void AnalysisNeighborhoodSearchImpl::addToGridCell(const rvec cell, int i)
         }
         icell[dd] = cellIndex;
     }
-    const int ci = getGridCellIndex(icell);
-    cells_[ci].push_back(i);
+    return getGridCellIndex(icell);
+}
+
+void AnalysisNeighborhoodSearchImpl::fillGrid(
+        const AnalysisNeighborhoodPositions &positions)
+{
+    const int cellCount = static_cast<int>(cellStart_.size()) - 1;
+    const int nthreads  = std::max(1, std::min(gmx_omp_get_max_threads(),
+                                               nref_/c_minPositionsPerThread));
+
+    xrefAlloc_.resize(nref_);
+    xref_ = as_rvec_array(xrefAlloc_.data());
+    refCell_.resize(nref_);
+    threadCellCount_.resize(static_cast<size_t>(nthreads)*cellCount);
+
+    // Counting sort on the cell index: each thread maps and counts a
+    // contiguous range of positions, the per-thread counts give stable
+    // write offsets, after which each thread stores its own positions.
+#pragma omp parallel num_threads(nthreads)
+    {
+        try
+        {
+            const int thread = gmx_omp_get_thread_num();
+            const int i0     = static_cast<int>((static_cast<gmx_int64_t>(nref_)*thread)/nthreads);
+            const int i1     = static_cast<int>((static_cast<gmx_int64_t>(nref_)*(thread + 1))/nthreads);
+            int      *count  = threadCellCount_.data() + static_cast<size_t>(thread)*cellCount;
+
+            std::fill(count, count + cellCount, 0);
+            for (int i = i0; i < i1; ++i)
+            {
+                const int ii = (refIndices_ != nullptr) ? refIndices_[i] : i;
+                rvec      refcell;
+                mapPointToGridCell(positions.x_[ii], refcell, xrefAlloc_[i]);
+                refCell_[i] = getPointCellIndex(refcell);
+                ++count[refCell_[i]];
+            }
+#pragma omp barrier
+#pragma omp single
+            {
+                int slot = 0;
+                for (int ci = 0; ci < cellCount; ++ci)
+                {
+                    cellStart_[ci] = slot;
+                    for (int t = 0; t < nthreads; ++t)
+                    {
+                        int &threadCount = threadCellCount_[static_cast<size_t>(t)*cellCount + ci];
+                        const int n      = threadCount;
+                        threadCount      = slot;
+                        slot            += n;
+                    }
+                    slot = ((slot + c_clusterSize - 1)/c_clusterSize)*c_clusterSize;
+                }
+                cellStart_[cellCount] = slot;
+                cellRefIndex_.resize(slot);
+                cellX_.resize(static_cast<size_t>(slot)*DIM);
+            }
+            // Initialize all slots as padding, before storing the positions.
+#pragma omp for schedule(static)
+            for (int slot = 0; slot < cellStart_[cellCount]; ++slot)
+            {
+                real *cluster = cellX_.data() + (slot/c_clusterSize)*DIM*c_clusterSize;
+                cellRefIndex_[slot] = -1;
+                for (int dd = 0; dd < DIM; ++dd)
+                {
+                    cluster[dd*c_clusterSize + slot % c_clusterSize] = c_paddingCoordinate;
+                }
+            }
+            for (int i = i0; i < i1; ++i)
+            {
+                const int slot    = count[refCell_[i]]++;
+                real     *cluster = cellX_.data() + (slot/c_clusterSize)*DIM*c_clusterSize;
+                cellRefIndex_[slot] = i;
+                for (int dd = 0; dd < DIM; ++dd)
+                {
+                    cluster[dd*c_clusterSize + slot % c_clusterSize] = xrefAlloc_[i][dd];
+                }
+            }
+        }
+        GMX_CATCH_ALL_AND_EXIT_WITH_FATAL_ERROR;
+    }
+}
+
+void AnalysisNeighborhoodSearchImpl::computeClusterDistances(
+        int slot, const rvec x, real *r2) const
+{
+    GMX_ASSERT(slot % c_clusterSize == 0, "Clusters should start at whole slots");
+    const real *cluster = cellX_.data() + (slot/c_clusterSize)*DIM*c_clusterSize;
+#if GMX_SIMD_HAVE_REAL
+    const SimdReal cx = load(cluster);
+    const SimdReal cy = load(cluster + c_clusterSize);
+    const SimdReal dx = cx - SimdReal(x[XX]);
+    const SimdReal dy = cy - SimdReal(x[YY]);
+    SimdReal       d2 = dx*dx;
+    d2 = fma(dy, dy, d2);
+    if (!bXY_)
+    {
+        const SimdReal cz = load(cluster + 2*c_clusterSize);
+        const SimdReal dz = cz - SimdReal(x[ZZ]);
+        d2 = fma(dz, dz, d2);
+    }
+    storeU(r2, d2);
+#else
+    rvec dx;
+    dx[XX] = cluster[XX] - x[XX];
+    dx[YY] = cluster[YY] - x[YY];
+    dx[ZZ] = cluster[ZZ] - x[ZZ];
+    r2[0]  = bXY_ ? dx[XX]*dx[XX] + dx[YY]*dx[YY] : norm2(dx);
+#endif
 }
 
 void AnalysisNeighborhoodSearchImpl::initCellRange(
@@ -909,16 +1059,7 @@ void AnalysisNeighborhoodSearchImpl::init(
     refIndices_ = positions.indices_;
     if (bGrid_)
     {
-        xrefAlloc_.resize(nref_);
-        xref_ = as_rvec_array(xrefAlloc_.data());
-
-        for (int i = 0; i < nref_; ++i)
-        {
-            const int ii = (refIndices_ != nullptr) ? refIndices_[i] : i;
-            rvec      refcell;
-            mapPointToGridCell(positions.x_[ii], refcell, xrefAlloc_[i]);
-            addToGridCell(refcell, i);
-        }
+        fillGrid(positions);
     }
     else if (refIndices_ != nullptr)
     {
@@ -986,8 +1127,9 @@ void AnalysisNeighborhoodPairSearchImpl::reset(int testIndex)
     previ_     = -1;
     prevr2_    = 0.0;
     clear_rvec(prevdx_);
-    exclind_   = 0;
-    prevcai_   = -1;
+    exclind_      = 0;
+    prevcai_      = -1;
+    clusterStart_ = -1;
 }
 
 void AnalysisNeighborhoodPairSearchImpl::nextTestPosition()
@@ -1052,37 +1194,45 @@ bool AnalysisNeighborhoodPairSearchImpl::searchNext(Action action)
 
             do
             {
-                rvec      shift;
-                const int ci       = search_.shiftCell(currCell_, shift);
-                const int cellSize = static_cast<int>(search_.cells_[ci].size());
+                rvec      shift, xshifted;
+                const int ci        = search_.shiftCell(currCell_, shift);
+                const int cellStart = search_.cellStart_[ci];
+                const int cellSize  = search_.cellStart_[ci + 1] - cellStart;
+                // The test position in the frame of the (shifted) cell.
+                rvec_add(xtest_, shift, xshifted);
                 for (; cai < cellSize; ++cai)
                 {
-                    const int i = search_.cells_[ci][cai];
+                    const int clusterStart = cai - cai % c_clusterSize;
+                    if (clusterStart != clusterStart_)
+                    {
+                        search_.computeClusterDistances(cellStart + clusterStart,
+                                                        xshifted, clusterR2_);
+                        clusterStart_ = clusterStart;
+                    }
+                    const real r2 = clusterR2_[cai - clusterStart];
+                    if (r2 > search_.cutoff2_)
+                    {
+                        continue;
+                    }
+                    const int i = search_.cellRefIndex_[cellStart + cai];
                     if (isExcluded(i))
                     {
                         continue;
                     }
-                    rvec       dx;
-                    rvec_sub(search_.xref_[i], xtest_, dx);
-                    rvec_sub(dx, shift, dx);
-                    const real r2
-                        = search_.bXY_
-                            ? dx[XX]*dx[XX] + dx[YY]*dx[YY]
-                            : norm2(dx);
-                    if (r2 <= search_.cutoff2_)
+                    rvec dx;
+                    rvec_sub(search_.xref_[i], xshifted, dx);
+                    if (action(i, r2, dx))
                     {
-                        if (action(i, r2, dx))
-                        {
-                            prevcai_ = cai;
-                            previ_   = i;
-                            prevr2_  = r2;
-                            copy_rvec(dx, prevdx_);
-                            return true;
-                        }
+                        prevcai_ = cai;
+                        previ_   = i;
+                        prevr2_  = r2;
+                        copy_rvec(dx, prevdx_);
+                        return true;
                     }
                 }
-                exclind_ = 0;
-                cai      = 0;
+                exclind_      = 0;
+                cai           = 0;
+                clusterStart_ = -1;
             }
             while (search_.nextCell(testcell_, currCell_, cellBound_));
         }
@@ -1137,6 +1287,23 @@ void AnalysisNeighborhoodPairSearchImpl::initFoundPair(
     }
 }
 
+int AnalysisNeighborhoodPairSearchImpl::findNextPairs(
+        AnalysisNeighborhoodPair *pairs, int maxCount)
+{
+    int count = 0;
+    if (maxCount > 0)
+    {
+        // Stops the search when the block is full, the search then continues
+        // from the last stored pair on the next call.
+        (void)searchNext([this, pairs, maxCount, &count](int i, real r2, const rvec dx)
+                         {
+                             pairs[count++] = AnalysisNeighborhoodPair(i, testIndex_, r2, dx);
+                             return count == maxCount;
+                         });
+    }
+    return count;
+}
+
 }   // namespace internal
 
 namespace
@@ -1405,6 +1572,11 @@ bool AnalysisNeighborhoodPairSearch::findNextPair(AnalysisNeighborhoodPair *pair
     return bFound;
 }
 
+int AnalysisNeighborhoodPairSearch::findNextPairs(ArrayRef<AnalysisNeighborhoodPair> pairs)
+{
+    return impl_->findNextPairs(pairs.data(), static_cast<int>(pairs.size()));
+}
+
 void AnalysisNeighborhoodPairSearch::skipRemainingPairsForTestPosition()
 {
     impl_->nextTestPosition();
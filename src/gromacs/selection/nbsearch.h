@@ -579,6 +579,31 @@ class AnalysisNeighborhoodPairSearch
          * \see AnalysisNeighborhoodSearch::startPairSearch()
          */
         bool findNextPair(AnalysisNeighborhoodPair *pair);
+        /*! \brief
+         * Finds the next block of pairs within the cutoff.
+         *
+         * \param[out] pairs  Array to store the found pairs in.
+         * \returns    Number of pairs stored in \p pairs, which is less than
+         *     its size only when there are no more pairs.
+         *
+         * Returns the same pairs in the same order as repeated calls to
+         * findNextPair() would, but avoids the per-pair call overhead.
+         * Calls to findNextPair() and findNextPairs() can be mixed, and
+         * skipRemainingPairsForTestPosition() applies to the test position
+         * of the last pair returned.
+         * \code
+           std::vector<gmx::AnalysisNeighborhoodPair> pairs(256);
+           int                                        count;
+           while ((count = pairSearch.findNextPairs(pairs)) > 0)
+           {
+               for (int i = 0; i < count; ++i)
+               {
+                   // <do something with pairs[i]>
+               }
+           }
+         * \endcode
+         */
+        int findNextPairs(ArrayRef<AnalysisNeighborhoodPair> pairs);
         /*! \brief
          * Skip remaining pairs for a test position in the search.
          *
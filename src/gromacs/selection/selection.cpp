@@ -43,6 +43,9 @@
 
 #include "selection.h"
 
+#include <cstring>
+
+#include <algorithm>
 #include <string>
 
 #include "gromacs/selection/nbsearch.h"
@@ -51,6 +54,7 @@
 #include "gromacs/topology/topology.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/stringutil.h"
 #include "gromacs/utility/textwriter.h"
 
@@ -121,6 +125,30 @@ SelectionData::SelectionData(SelectionTreeElement *elem,
 }
 
 
+SelectionData::SelectionData(const SelectionData *source)
+    : name_(source->name_), selectionText_(source->selectionText_),
+      flags_(source->flags_), rootElement_(source->rootElement_),
+      coveredFractionType_(source->coveredFractionType_),
+      coveredFraction_(source->coveredFraction_),
+      averageCoveredFraction_(source->averageCoveredFraction_),
+      bDynamic_(source->bDynamic_),
+      bDynamicCoveredFraction_(source->bDynamicCoveredFraction_)
+{
+    // The maximal group and the original ids do not change during
+    // evaluation, so they are only copied here.
+    const gmx_ana_indexmap_t &src  = source->rawPositions_.m;
+    gmx_ana_indexmap_t       &dest = rawPositions_.m;
+    gmx_ana_pos_reserve(&rawPositions_, src.b.nr, src.b.nra);
+    dest.type  = src.type;
+    dest.b.nr  = src.b.nr;
+    dest.b.nra = src.b.nra;
+    std::copy(src.orgid, src.orgid + src.b.nr, dest.orgid);
+    std::copy(src.b.index, src.b.index + src.b.nr + 1, dest.b.index);
+    std::copy(src.b.a, src.b.a + src.b.nra, dest.b.a);
+    copyFrameValues(*source);
+}
+
+
 SelectionData::~SelectionData()
 {
 }
@@ -265,6 +293,47 @@ SelectionData::restoreOriginalPositions(const gmx_mtop_t *top)
     }
 }
 
+
+void
+SelectionData::copyFrameValues(const SelectionData &source)
+{
+    const gmx_ana_pos_t &src  = source.rawPositions_;
+    gmx_ana_pos_t       &dest = rawPositions_;
+    const int            count = src.count();
+    gmx_ana_pos_reserve(&dest, count, dest.m.b.nra);
+    std::memcpy(dest.x, src.x, count*sizeof(*dest.x));
+    if (src.v != nullptr)
+    {
+        gmx_ana_pos_reserve_velocities(&dest);
+        std::memcpy(dest.v, src.v, count*sizeof(*dest.v));
+    }
+    if (src.f != nullptr)
+    {
+        gmx_ana_pos_reserve_forces(&dest);
+        std::memcpy(dest.f, src.f, count*sizeof(*dest.f));
+    }
+    // The atom array in the source may point directly to the evaluated
+    // group, so an own copy is always kept here.
+    const gmx_ana_indexmap_t &srcMap  = src.m;
+    gmx_ana_indexmap_t       &destMap = dest.m;
+    if (destMap.mapb.nalloc_a < srcMap.mapb.nra)
+    {
+        srenew(destMap.mapb.a, srcMap.mapb.nra);
+        destMap.mapb.nalloc_a = srcMap.mapb.nra;
+    }
+    destMap.mapb.nr  = srcMap.mapb.nr;
+    destMap.mapb.nra = srcMap.mapb.nra;
+    std::copy(srcMap.mapb.a, srcMap.mapb.a + srcMap.mapb.nra, destMap.mapb.a);
+    std::copy(srcMap.mapb.index, srcMap.mapb.index + count + 1, destMap.mapb.index);
+    std::copy(srcMap.refid, srcMap.refid + count, destMap.refid);
+    std::copy(srcMap.mapid, srcMap.mapid + count, destMap.mapid);
+    destMap.bStatic = srcMap.bStatic;
+
+    posMass_         = source.posMass_;
+    posCharge_       = source.posCharge_;
+    coveredFraction_ = source.coveredFraction_;
+}
+
 }   // namespace internal
 
 /********************************************************************
@@ -93,6 +93,18 @@ class SelectionData
          * \throws    std::bad_alloc if out of memory.
          */
         SelectionData(SelectionTreeElement *elem, const char *selstr);
+        /*! \brief
+         * Creates a copy that holds the evaluated values of another selection.
+         *
+         * \param[in] source Selection to copy.
+         * \throws    std::bad_alloc if out of memory.
+         *
+         * The copy shares the evaluation tree with \p source, and should only
+         * be used for accessing the values copied with copyFrameValues().
+         * This makes it possible to keep values for several frames available
+         * at the same time for processing them in parallel.
+         */
+        explicit SelectionData(const SelectionData *source);
         ~SelectionData();
 
         //! Returns the name for this selection.
@@ -186,6 +198,17 @@ class SelectionData
          * Called by SelectionEvaluator::evaluateFinal().
          */
         void restoreOriginalPositions(const gmx_mtop_t *top);
+        /*! \brief
+         * Copies the values for the current frame from another selection.
+         *
+         * \param[in] source Selection to copy the values from.
+         * \throws    std::bad_alloc if out of memory.
+         *
+         * \p source should be the selection that was used to construct this
+         * object.  The copied values do not refer to memory in \p source,
+         * so \p source can be evaluated for another frame afterwards.
+         */
+        void copyFrameValues(const SelectionData &source);
 
     private:
         //! Name of the selection.
@@ -943,4 +943,67 @@ SelectionCollection::printXvgrInfo(FILE *out) const
     std::fprintf(out, "#\n");
 }
 
+
+/********************************************************************
+ * SelectionFrameCopy
+ */
+
+/*! \internal \brief
+ * Private implementation class for SelectionFrameCopy.
+ *
+ * \ingroup module_selection
+ */
+class SelectionFrameCopy::Impl
+{
+    public:
+        //! Shorthand for a list of selection copies.
+        typedef std::vector<std::unique_ptr<internal::SelectionData> >
+            SelectionCopyList;
+
+        //! Selections in the source collection.
+        std::vector<internal::SelectionData *> originals_;
+        //! Copies of \a originals_, in the same order.
+        SelectionCopyList                      copies_;
+};
+
+SelectionFrameCopy::SelectionFrameCopy(const SelectionCollection &selections)
+    : impl_(new Impl)
+{
+    const SelectionDataList &sel = selections.impl_->sc_.sel;
+    impl_->originals_.reserve(sel.size());
+    impl_->copies_.reserve(sel.size());
+    for (const auto &data : sel)
+    {
+        impl_->originals_.push_back(data.get());
+        impl_->copies_.emplace_back(new internal::SelectionData(data.get()));
+    }
+}
+
+SelectionFrameCopy::~SelectionFrameCopy()
+{
+}
+
+void
+SelectionFrameCopy::copyFrameValues()
+{
+    for (size_t i = 0; i < impl_->copies_.size(); ++i)
+    {
+        impl_->copies_[i]->copyFrameValues(*impl_->originals_[i]);
+    }
+}
+
+Selection
+SelectionFrameCopy::selection(const Selection &selection) const
+{
+    for (size_t i = 0; i < impl_->originals_.size(); ++i)
+    {
+        if (Selection(impl_->originals_[i]) == selection)
+        {
+            return Selection(impl_->copies_[i].get());
+        }
+    }
+    GMX_RELEASE_ASSERT(false, "Selection not found in the collection");
+    return selection;
+}
+
 } // namespace gmx
@@ -62,6 +62,7 @@ namespace gmx
 class IOptionsContainer;
 class SelectionCompiler;
 class SelectionEvaluator;
+class SelectionFrameCopy;
 class TextInputStream;
 class TextOutputStream;
 struct SelectionTopologyProperties;
@@ -424,6 +425,59 @@ class SelectionCollection
          * Needed for the evaluator to freely modify the collection.
          */
         friend class SelectionEvaluator;
+        /*! \brief
+         * Needed for accessing all selections in the collection.
+         */
+        friend class SelectionFrameCopy;
+};
+
+/*! \libinternal \brief
+ * Keeps a copy of the evaluated values of all selections in a collection.
+ *
+ * The copy keeps the values for one frame available while the collection
+ * is evaluated for later frames.  This makes it possible to process several
+ * frames in parallel while evaluating the selections serially: after
+ * SelectionCollection::evaluate(), copyFrameValues() stores the values, and
+ * selection() can then be used to access the copied values for a selection
+ * from the collection.
+ *
+ * The object should be created after the collection has been compiled, and
+ * must not outlive the collection.
+ *
+ * \inlibraryapi
+ * \ingroup module_selection
+ */
+class SelectionFrameCopy
+{
+    public:
+        /*! \brief
+         * Creates copies of all selections in a collection.
+         *
+         * \param[in] selections  Compiled collection to copy.
+         * \throws    std::bad_alloc if out of memory.
+         */
+        explicit SelectionFrameCopy(const SelectionCollection &selections);
+        ~SelectionFrameCopy();
+
+        /*! \brief
+         * Copies the current values of all selections in the collection.
+         *
+         * \throws    std::bad_alloc if out of memory.
+         */
+        void copyFrameValues();
+        /*! \brief
+         * Returns the copy that corresponds to a selection in the collection.
+         *
+         * \param[in] selection  Selection from the collection.
+         *
+         * Does not throw.
+         */
+        Selection selection(const Selection &selection) const;
+
+    private:
+        class Impl;
+
+        PrivateImplPointer<Impl> impl_;
 };
 
 } // namespace gmx
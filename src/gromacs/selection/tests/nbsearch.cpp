@@ -51,6 +51,7 @@
 #include <cmath>
 
 #include <algorithm>
+#include <chrono>
 #include <limits>
 #include <numeric>
 #include <vector>
@@ -417,6 +418,8 @@ class NeighborhoodSearchTest : public ::testing::Test
                               const NeighborhoodSearchTestData &data);
         void testPairSearch(gmx::AnalysisNeighborhoodSearch  *search,
                             const NeighborhoodSearchTestData &data);
+        void testPairSearchBatched(gmx::AnalysisNeighborhoodSearch  *search,
+                                   const NeighborhoodSearchTestData &data);
         void testPairSearchIndexed(gmx::AnalysisNeighborhood        *nb,
                                    const NeighborhoodSearchTestData &data,
                                    gmx_uint64_t                      seed);
@@ -522,6 +525,38 @@ void NeighborhoodSearchTest::testPairSearch(
                        gmx::EmptyArrayRef(), gmx::EmptyArrayRef());
 }
 
+void NeighborhoodSearchTest::testPairSearchBatched(
+        gmx::AnalysisNeighborhoodSearch  *search,
+        const NeighborhoodSearchTestData &data)
+{
+    std::vector<gmx::AnalysisNeighborhoodPair> refPairs;
+    gmx::AnalysisNeighborhoodPair              pair;
+    gmx::AnalysisNeighborhoodPairSearch        pairSearch
+        = search->startPairSearch(data.testPositions());
+    while (pairSearch.findNextPair(&pair))
+    {
+        refPairs.push_back(pair);
+    }
+    ASSERT_FALSE(refPairs.empty()) << "Test data did not contain any pairs";
+
+    // Use a block size that does not divide the number of pairs per cell.
+    std::vector<gmx::AnalysisNeighborhoodPair> pairs(7);
+    size_t                                     found = 0;
+    int                                        count;
+    pairSearch = search->startPairSearch(data.testPositions());
+    while ((count = pairSearch.findNextPairs(pairs)) > 0)
+    {
+        ASSERT_LE(found + count, refPairs.size()) << "Too many pairs returned";
+        for (int i = 0; i < count; ++i, ++found)
+        {
+            EXPECT_EQ(refPairs[found].refIndex(), pairs[i].refIndex());
+            EXPECT_EQ(refPairs[found].testIndex(), pairs[i].testIndex());
+            EXPECT_EQ(refPairs[found].distance2(), pairs[i].distance2());
+        }
+    }
+    EXPECT_EQ(refPairs.size(), found);
+}
+
 void NeighborhoodSearchTest::testPairSearchIndexed(
         gmx::AnalysisNeighborhood        *nb,
         const NeighborhoodSearchTestData &data,
@@ -801,6 +836,31 @@ class RandomBoxXYFullPBCData
         NeighborhoodSearchTestData data_;
 };
 
+class RandomBoxLargeFullPBCData
+{
+    public:
+        static const NeighborhoodSearchTestData &get()
+        {
+            static RandomBoxLargeFullPBCData singleton;
+            return singleton.data_;
+        }
+
+        RandomBoxLargeFullPBCData() : data_(12345, 0.5)
+        {
+            data_.box_[XX][XX] = 10.0;
+            data_.box_[YY][YY] = 5.0;
+            data_.box_[ZZ][ZZ] = 7.0;
+            // Enough positions for building the grid with several threads.
+            data_.generateRandomRefPositions(30000);
+            data_.generateRandomTestPositions(100);
+            set_pbc(&data_.pbc_, epbcXYZ, data_.box_);
+            data_.computeReferences(&data_.pbc_);
+        }
+
+    private:
+        NeighborhoodSearchTestData data_;
+};
+
 class RandomTriclinicFullPBCData
 {
     public:
@@ -900,6 +960,7 @@ TEST_F(NeighborhoodSearchTest, SimpleSearch)
     testMinimumDistance(&search, data);
     testNearestPoint(&search, data);
     testPairSearch(&search, data);
+    testPairSearchBatched(&search, data);
 
     search.reset();
     testPairSearchIndexed(&nb_, data, 123);
@@ -936,11 +997,31 @@ TEST_F(NeighborhoodSearchTest, GridSearchBox)
     testMinimumDistance(&search, data);
     testNearestPoint(&search, data);
     testPairSearch(&search, data);
+    testPairSearchBatched(&search, data);
 
     search.reset();
     testPairSearchIndexed(&nb_, data, 456);
 }
 
+TEST_F(NeighborhoodSearchTest, GridSearchLargeBox)
+{
+    const NeighborhoodSearchTestData &data = RandomBoxLargeFullPBCData::get();
+
+    nb_.setCutoff(data.cutoff_);
+    nb_.setMode(gmx::AnalysisNeighborhood::eSearchMode_Grid);
+    gmx::AnalysisNeighborhoodSearch search =
+        nb_.initSearch(&data.pbc_, data.refPositions());
+    ASSERT_EQ(gmx::AnalysisNeighborhood::eSearchMode_Grid, search.mode());
+
+    testIsWithin(&search, data);
+    testMinimumDistance(&search, data);
+    testPairSearch(&search, data);
+    testPairSearchBatched(&search, data);
+
+    search.reset();
+    testPairSearchIndexed(&nb_, data, 789);
+}
+
 TEST_F(NeighborhoodSearchTest, GridSearchTriclinic)
 {
     const NeighborhoodSearchTestData &data = RandomTriclinicFullPBCData::get();
@@ -952,6 +1033,7 @@ TEST_F(NeighborhoodSearchTest, GridSearchTriclinic)
     ASSERT_EQ(gmx::AnalysisNeighborhood::eSearchMode_Grid, search.mode());
 
     testPairSearch(&search, data);
+    testPairSearchBatched(&search, data);
 }
 
 TEST_F(NeighborhoodSearchTest, GridSearch2DPBC)
@@ -998,6 +1080,7 @@ TEST_F(NeighborhoodSearchTest, GridSearchXYBox)
     testMinimumDistance(&search, data);
     testNearestPoint(&search, data);
     testPairSearch(&search, data);
+    testPairSearchBatched(&search, data);
 }
 
 TEST_F(NeighborhoodSearchTest, HandlesConcurrentSearches)
@@ -1137,4 +1220,66 @@ TEST_F(NeighborhoodSearchTest, GridSearchExclusions)
                        helper.exclusions(), gmx::EmptyArrayRef(), gmx::EmptyArrayRef());
 }
 
+/*! \brief
+ * Benchmarks grid searching with one million positions.
+ *
+ * Disabled by default, run with
+ * `selection-test --gtest_also_run_disabled_tests --gtest_filter=*Benchmark*`.
+ * Searches all pairs within 0.5 nm among one million positions at
+ * the density of water molecules and reports the time for building
+ * the grid and for the searches with single and batched pairs.
+ */
+TEST_F(NeighborhoodSearchTest, DISABLED_BenchmarkMillionPositions)
+{
+    typedef std::chrono::steady_clock clock;
+
+    const int                  count = 1000000;
+    NeighborhoodSearchTestData data(12345, 0.5);
+    const real                 boxSize = std::cbrt(count/33.4);
+    data.box_[XX][XX] = boxSize;
+    data.box_[YY][YY] = boxSize;
+    data.box_[ZZ][ZZ] = boxSize;
+    data.generateRandomRefPositions(count);
+    set_pbc(&data.pbc_, epbcXYZ, data.box_);
+
+    nb_.setCutoff(data.cutoff_);
+    nb_.setMode(gmx::AnalysisNeighborhood::eSearchMode_Grid);
+    const clock::time_point         start = clock::now();
+    gmx::AnalysisNeighborhoodSearch search =
+        nb_.initSearch(&data.pbc_, data.refPositions());
+    const clock::time_point         gridDone = clock::now();
+    ASSERT_EQ(gmx::AnalysisNeighborhood::eSearchMode_Grid, search.mode());
+
+    gmx::AnalysisNeighborhoodPairSearch pairSearch
+        = search.startPairSearch(data.refPositions());
+    gmx::AnalysisNeighborhoodPair       pair;
+    gmx_int64_t                         pairCount = 0;
+    while (pairSearch.findNextPair(&pair))
+    {
+        ++pairCount;
+    }
+    const clock::time_point                    singleDone = clock::now();
+
+    std::vector<gmx::AnalysisNeighborhoodPair> pairs(1024);
+    gmx_int64_t                                batchedCount = 0;
+    int                                        n;
+    pairSearch = search.startPairSearch(data.refPositions());
+    while ((n = pairSearch.findNextPairs(pairs)) > 0)
+    {
+        batchedCount += n;
+    }
+    const clock::time_point batchedDone = clock::now();
+    EXPECT_EQ(pairCount, batchedCount);
+
+    typedef std::chrono::duration<double> seconds;
+    std::printf("%d positions, %ld pairs\n"
+                "Grid build:          %8.3f s\n"
+                "Pair search:         %8.3f s\n"
+                "Batched pair search: %8.3f s\n",
+                count, static_cast<long>(pairCount),
+                seconds(gridDone - start).count(),
+                seconds(singleDone - gridDone).count(),
+                seconds(batchedDone - singleDone).count());
+}
+
 } // namespace
@@ -43,8 +43,11 @@
 
 #include "gromacs/selection/selectioncollection.h"
 
+#include <vector>
+
 #include <gtest/gtest.h>
 
+#include "gromacs/math/vectypes.h"
 #include "gromacs/options/basicoptions.h"
 #include "gromacs/options/ioptionscontainer.h"
 #include "gromacs/selection/indexutil.h"
@@ -472,6 +475,92 @@ TEST_F(SelectionCollectionTest, HandlesForceRequestForCenterOfGeometry)
     EXPECT_TRUE(sel_[0].hasForces());
 }
 
+/*! \brief
+ * Evaluated values of a selection, stored independently of the selection.
+ */
+struct SelectionValues
+{
+    //! Initializes the values from an evaluated selection.
+    explicit SelectionValues(const gmx::Selection &sel)
+        : atoms(sel.atomIndices().begin(), sel.atomIndices().end())
+    {
+        for (int i = 0; i < sel.posCount(); ++i)
+        {
+            const gmx::SelectionPosition pos = sel.position(i);
+            refIds.push_back(pos.refId());
+            mappedIds.push_back(pos.mappedId());
+            x.push_back(gmx::RVec(pos.x()));
+        }
+    }
+
+    //! Checks that \p sel has the stored values.
+    void check(const gmx::Selection &sel) const
+    {
+        EXPECT_EQ(atoms, std::vector<int>(sel.atomIndices().begin(),
+                                          sel.atomIndices().end()));
+        ASSERT_EQ(static_cast<int>(x.size()), sel.posCount());
+        for (int i = 0; i < sel.posCount(); ++i)
+        {
+            const gmx::SelectionPosition pos = sel.position(i);
+            EXPECT_EQ(refIds[i], pos.refId());
+            EXPECT_EQ(mappedIds[i], pos.mappedId());
+            for (int d = 0; d < DIM; ++d)
+            {
+                EXPECT_EQ(x[i][d], pos.x()[d]);
+            }
+        }
+    }
+
+    //! Selected atoms.
+    std::vector<int>       atoms;
+    //! Reference ids of the positions.
+    std::vector<int>       refIds;
+    //! Mapped ids of the positions.
+    std::vector<int>       mappedIds;
+    //! Coordinates of the positions.
+    std::vector<gmx::RVec> x;
+};
+
+TEST_F(SelectionCollectionTest, FrameCopiesKeepValuesOfDynamicSelections)
+{
+    ASSERT_NO_THROW_GMX(sel_ = sc_.parseFromString(
+                                    "x < 2.5;"
+                                    "res_cog of resnr 1 to 4 and y > 1.5;"
+                                    "name CB and within 1.2 of resnr 1"));
+    ASSERT_NO_FATAL_FAILURE(loadTopology("simple.gro"));
+    ASSERT_NO_THROW_GMX(sc_.compile());
+    ASSERT_EQ(3U, sel_.size());
+    t_trxframe                  *frame = topManager_.frame();
+
+    gmx::SelectionFrameCopy      frame1(sc_);
+    gmx::SelectionFrameCopy      frame2(sc_);
+    std::vector<SelectionValues> values1;
+    ASSERT_NO_THROW_GMX(sc_.evaluate(frame, nullptr));
+    ASSERT_NO_THROW_GMX(frame1.copyFrameValues());
+    for (const auto &sel : sel_)
+    {
+        values1.emplace_back(sel);
+    }
+
+    // Move the atoms such that each selection selects a different set.
+    for (int i = 0; i < frame->natoms; ++i)
+    {
+        frame->x[i][XX] += 0.7;
+        frame->x[i][YY] -= 0.3 * (i % 3);
+    }
+    ASSERT_NO_THROW_GMX(sc_.evaluate(frame, nullptr));
+    ASSERT_NO_THROW_GMX(frame2.copyFrameValues());
+
+    for (size_t i = 0; i < sel_.size(); ++i)
+    {
+        SCOPED_TRACE(gmx::formatString("Selection '%s'", sel_[i].selectionText()));
+        const SelectionValues values2(sel_[i]);
+        EXPECT_NE(values1[i].atoms, values2.atoms);
+        values1[i].check(frame1.selection(sel_[i]));
+        values2.check(frame2.selection(sel_[i]));
+    }
+}
+
 TEST_F(SelectionCollectionTest, ParsesSelectionsFromFile)
 {
     ASSERT_NO_THROW_GMX(sel_ = sc_.parseFromFile(
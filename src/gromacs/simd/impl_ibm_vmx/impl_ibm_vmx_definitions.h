@@ -79,6 +79,8 @@
 #define GMX_SIMD_HAVE_GATHER_LOADU_BYSIMDINT_TRANSPOSE_DOUBLE  0
 #define GMX_SIMD_HAVE_HSIMD_UTIL_FLOAT          0  // No need for half-simd, width is 4
 #define GMX_SIMD_HAVE_HSIMD_UTIL_DOUBLE         0
+#define GMX_SIMD_HAVE_4NSIMD_UTIL_FLOAT         0
+#define GMX_SIMD_HAVE_4NSIMD_UTIL_DOUBLE        0
 
 #define GMX_SIMD4_HAVE_FLOAT                    1
 #define GMX_SIMD4_HAVE_DOUBLE                   0
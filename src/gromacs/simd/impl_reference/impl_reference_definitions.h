@@ -193,6 +193,12 @@ namespace gmx
 //! \brief 1 if double half-register load/store/reduce utils present, otherwise 0
 #define GMX_SIMD_HAVE_HSIMD_UTIL_DOUBLE                          1
 
+//! \brief 1 if float 4N-register load/store utils present, otherwise 0
+#define GMX_SIMD_HAVE_4NSIMD_UTIL_FLOAT                          (GMX_SIMD_FLOAT_WIDTH % 4 == 0)
+
+//! \brief 1 if double 4N-register load/store utils present, otherwise 0
+#define GMX_SIMD_HAVE_4NSIMD_UTIL_DOUBLE                         (GMX_SIMD_DOUBLE_WIDTH % 4 == 0)
+
 #ifdef GMX_SIMD_REF_FLOAT_WIDTH
 #    define GMX_SIMD_FLOAT_WIDTH                                 GMX_SIMD_REF_FLOAT_WIDTH
 #else
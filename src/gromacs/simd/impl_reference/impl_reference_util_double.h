@@ -905,6 +905,110 @@ reduceIncr4ReturnSumHsimd(double *           m,
     return sum[0] + sum[1] + sum[2] + sum[3];
 }
 
+
+/*! \}
+ *
+ * \name Higher-level SIMD utilities accessing groups of 4 doubles in SIMD registers.
+ *
+ * These functions are optional. They are useful for SIMD implementations
+ * with a width of 8 or larger that is a multiple of 4, where it would be
+ * inefficient to only use 4 elements of a register for algorithms that
+ * naturally work on groups of 4 elements, such as PME spline spreading
+ * and gathering with interpolation order 4. The register is treated as
+ * N = GMX_SIMD_DOUBLE_WIDTH/4 consecutive groups of 4 elements.
+ *
+ * These routines are available when \ref GMX_SIMD_HAVE_4NSIMD_UTIL_DOUBLE is 1.
+ *
+ * \{
+ */
+
+/*! \brief Load 4 consecutive doubles and duplicate them N times.
+ *
+ * \param m Pointer to memory aligned to 4 doubles.
+ *
+ * \return SIMD variable with the 4 values from m repeated in each
+ *         group of 4 elements.
+ *
+ * Available if \ref GMX_SIMD_HAVE_4NSIMD_UTIL_DOUBLE is 1.
+ */
+static inline SimdDouble gmx_simdcall
+load4DuplicateN(const double *  m)
+{
+    SimdDouble        a;
+
+    // Make sure the memory pointer is aligned to 4 elements
+    assert(std::size_t(m) % (4*sizeof(double)) == 0);
+
+    for (std::size_t i = 0; i < a.simdInternal_.size(); i++)
+    {
+        a.simdInternal_[i] = m[i % 4];
+    }
+    return a;
+}
+
+/*! \brief Load N doubles and duplicate each of them 4 times.
+ *
+ * \param m Pointer to N consecutive doubles, no alignment requirement.
+ *
+ * \return SIMD variable where group i of 4 elements is set to m[i].
+ *
+ * Available if \ref GMX_SIMD_HAVE_4NSIMD_UTIL_DOUBLE is 1.
+ */
+static inline SimdDouble gmx_simdcall
+loadUNDuplicate4(const double *  m)
+{
+    SimdDouble        a;
+
+    for (std::size_t i = 0; i < a.simdInternal_.size(); i++)
+    {
+        a.simdInternal_[i] = m[i / 4];
+    }
+    return a;
+}
+
+/*! \brief Load N groups of 4 doubles from unaligned memory with a stride.
+ *
+ * \param m      Pointer to the first group, no alignment requirement.
+ * \param offset Offset in elements between the start of consecutive groups.
+ *
+ * \return SIMD variable where group i of 4 elements is loaded from
+ *         m + i*offset.
+ *
+ * Available if \ref GMX_SIMD_HAVE_4NSIMD_UTIL_DOUBLE is 1.
+ */
+static inline SimdDouble gmx_simdcall
+loadU4NOffset(const double *  m,
+              int             offset)
+{
+    SimdDouble        a;
+
+    for (std::size_t i = 0; i < a.simdInternal_.size(); i++)
+    {
+        a.simdInternal_[i] = m[(i / 4)*offset + i % 4];
+    }
+    return a;
+}
+
+/*! \brief Store N groups of 4 doubles to unaligned memory with a stride.
+ *
+ * \param m      Pointer to the first group, no alignment requirement.
+ * \param offset Offset in elements between the start of consecutive groups.
+ * \param a      SIMD variable to store; group i of 4 elements is stored
+ *               to m + i*offset.
+ *
+ * Available if \ref GMX_SIMD_HAVE_4NSIMD_UTIL_DOUBLE is 1.
+ */
+static inline void gmx_simdcall
+storeU4NOffset(double *       m,
+               int            offset,
+               SimdDouble     a)
+{
+    for (std::size_t i = 0; i < a.simdInternal_.size(); i++)
+    {
+        m[(i / 4)*offset + i % 4] = a.simdInternal_[i];
+    }
+}
+
 /*! \} */
 
 /*! \} */
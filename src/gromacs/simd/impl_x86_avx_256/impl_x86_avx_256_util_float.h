@@ -690,6 +690,41 @@ reduceIncr4ReturnSumHsimd(float *     m,
     return *reinterpret_cast<float *>(&t0);
 }
 
+
+/*************************************
+ * 4N-simd-width utility functions   *
+ *************************************/
+static inline SimdFloat gmx_simdcall
+load4DuplicateN(const float * m)
+{
+    assert(std::size_t(m) % 16 == 0);
+
+    return {
+               _mm256_broadcast_ps(reinterpret_cast<const __m128 *>(m))
+    };
+}
+
+static inline SimdFloat gmx_simdcall
+loadUNDuplicate4(const float * m)
+{
+    return load1DualHsimd(m);
+}
+
+static inline SimdFloat gmx_simdcall
+loadU4NOffset(const float * m, int offset)
+{
+    return {
+               _mm256_insertf128_ps(_mm256_castps128_ps256(_mm_loadu_ps(m)), _mm_loadu_ps(m+offset), 0x1)
+    };
+}
+
+static inline void gmx_simdcall
+storeU4NOffset(float * m, int offset, SimdFloat a)
+{
+    _mm_storeu_ps(m, _mm256_castps256_ps128(a.simdInternal_));
+    _mm_storeu_ps(m+offset, _mm256_extractf128_ps(a.simdInternal_, 0x1));
+}
+
 }      // namespace gmx
 
 #endif // GMX_SIMD_IMPL_X86_AVX_256_UTIL_FLOAT_H
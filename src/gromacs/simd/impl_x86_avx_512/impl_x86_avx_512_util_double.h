@@ -435,6 +435,45 @@ reduceIncr4ReturnSumHsimd(double *     m,
     return _mm_cvtsd_f64(_mm256_castpd256_pd128(t2));
 }
 
+
+/*************************************
+ * 4N-simd-width utility functions   *
+ *************************************/
+static inline SimdDouble gmx_simdcall
+load4DuplicateN(const double * m)
+{
+    assert(std::size_t(m) % 32 == 0);
+
+    return {
+               _mm512_broadcast_f64x4(_mm256_load_pd(m))
+    };
+}
+
+static inline SimdDouble gmx_simdcall
+loadUNDuplicate4(const double * m)
+{
+    return {
+               _mm512_insertf64x4(_mm512_castpd256_pd512(_mm256_set1_pd(m[0])),
+                                  _mm256_set1_pd(m[1]), 1)
+    };
+}
+
+static inline SimdDouble gmx_simdcall
+loadU4NOffset(const double * m, int offset)
+{
+    return {
+               _mm512_insertf64x4(_mm512_castpd256_pd512(_mm256_loadu_pd(m)),
+                                  _mm256_loadu_pd(m+offset), 1)
+    };
+}
+
+static inline void gmx_simdcall
+storeU4NOffset(double * m, int offset, SimdDouble a)
+{
+    _mm256_storeu_pd(m, _mm512_castpd512_pd256(a.simdInternal_));
+    _mm256_storeu_pd(m+offset, _mm512_extractf64x4_pd(a.simdInternal_, 1));
+}
+
 }      // namespace gmx
 
 #endif // GMX_SIMD_IMPL_X86_AVX_512_UTIL_DOUBLE_H
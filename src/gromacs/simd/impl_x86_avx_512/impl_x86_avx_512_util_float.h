@@ -478,6 +478,53 @@ reduceIncr4ReturnSumHsimd(float *     m,
     return _mm_cvtss_f32(t3);
 }
 
+
+/*************************************
+ * 4N-simd-width utility functions   *
+ *************************************/
+static inline SimdFloat gmx_simdcall
+load4DuplicateN(const float * m)
+{
+    assert(std::size_t(m) % 16 == 0);
+
+    return {
+               _mm512_broadcast_f32x4(_mm_load_ps(m))
+    };
+}
+
+static inline SimdFloat gmx_simdcall
+loadUNDuplicate4(const float * m)
+{
+    return {
+               _mm512_permutexvar_ps(_mm512_set_epi32(3, 3, 3, 3, 2, 2, 2, 2, 1, 1, 1, 1, 0, 0, 0, 0),
+                                     _mm512_castps128_ps512(_mm_loadu_ps(m)))
+    };
+}
+
+static inline SimdFloat gmx_simdcall
+loadU4NOffset(const float * m, int offset)
+{
+    __m512 t0;
+
+    t0 = _mm512_castps128_ps512(_mm_loadu_ps(m));
+    t0 = _mm512_insertf32x4(t0, _mm_loadu_ps(m+offset), 1);
+    t0 = _mm512_insertf32x4(t0, _mm_loadu_ps(m+2*offset), 2);
+    t0 = _mm512_insertf32x4(t0, _mm_loadu_ps(m+3*offset), 3);
+
+    return {
+               t0
+    };
+}
+
+static inline void gmx_simdcall
+storeU4NOffset(float * m, int offset, SimdFloat a)
+{
+    _mm_storeu_ps(m, _mm512_castps512_ps128(a.simdInternal_));
+    _mm_storeu_ps(m+offset, _mm512_extractf32x4_ps(a.simdInternal_, 1));
+    _mm_storeu_ps(m+2*offset, _mm512_extractf32x4_ps(a.simdInternal_, 2));
+    _mm_storeu_ps(m+3*offset, _mm512_extractf32x4_ps(a.simdInternal_, 3));
+}
+
 }      // namespace gmx
 
 #endif // GMX_SIMD_IMPL_X86_AVX_512_UTIL_FLOAT_H
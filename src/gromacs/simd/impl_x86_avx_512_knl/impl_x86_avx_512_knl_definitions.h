@@ -73,6 +73,8 @@
 #define GMX_SIMD_HAVE_GATHER_LOADU_BYSIMDINT_TRANSPOSE_DOUBLE   1
 #define GMX_SIMD_HAVE_HSIMD_UTIL_FLOAT             1
 #define GMX_SIMD_HAVE_HSIMD_UTIL_DOUBLE            1
+#define GMX_SIMD_HAVE_4NSIMD_UTIL_FLOAT            1
+#define GMX_SIMD_HAVE_4NSIMD_UTIL_DOUBLE           1
 
 #define GMX_SIMD4_HAVE_FLOAT                       1
 #define GMX_SIMD4_HAVE_DOUBLE                      1
@@ -146,6 +146,7 @@
 #    define GMX_SIMD_HAVE_INT32_ARITHMETICS                        GMX_SIMD_HAVE_DINT32_ARITHMETICS
 #    define GMX_SIMD_HAVE_GATHER_LOADU_BYSIMDINT_TRANSPOSE_REAL    GMX_SIMD_HAVE_GATHER_LOADU_BYSIMDINT_TRANSPOSE_DOUBLE
 #    define GMX_SIMD_HAVE_HSIMD_UTIL_REAL                          GMX_SIMD_HAVE_HSIMD_UTIL_DOUBLE
+#    define GMX_SIMD_HAVE_4NSIMD_UTIL_REAL                         GMX_SIMD_HAVE_4NSIMD_UTIL_DOUBLE
 #    define GMX_SIMD4_HAVE_REAL                                    GMX_SIMD4_HAVE_DOUBLE
 #else // GMX_DOUBLE
 
@@ -196,6 +197,13 @@
  */
 #    define GMX_SIMD_HAVE_HSIMD_UTIL_REAL    GMX_SIMD_HAVE_HSIMD_UTIL_FLOAT
 
+/*! \brief 1 if real 4N-register load/store utils present, otherwise 0
+ *
+ *  \ref GMX_SIMD_HAVE_4NSIMD_UTIL_DOUBLE if GMX_DOUBLE is 1, otherwise
+ *  \ref GMX_SIMD_HAVE_4NSIMD_UTIL_FLOAT.
+ */
+#    define GMX_SIMD_HAVE_4NSIMD_UTIL_REAL   GMX_SIMD_HAVE_4NSIMD_UTIL_FLOAT
+
 /*! \brief 1 if Simd4Real is available, otherwise 0.
  *
  *  \ref GMX_SIMD4_HAVE_DOUBLE if GMX_DOUBLE is 1, otherwise \ref GMX_SIMD4_HAVE_FLOAT.
@@ -911,6 +911,91 @@ TEST_F(SimdFloatingpointUtilTest, reduceIncr4SumHsimd)
 
 #endif      // GMX_SIMD_HAVE_HSIMD_UTIL_REAL
 
+#if GMX_SIMD_HAVE_4NSIMD_UTIL_REAL
+
+TEST_F(SimdFloatingpointUtilTest, load4DuplicateN)
+{
+    SimdReal        v0, v1;
+    int             i;
+
+    // Repeat the first four values of val0_ in all groups of four
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        val1_[i] = val0_[i % 4];
+    }
+
+    v0 = load(val1_);
+    v1 = load4DuplicateN(val0_);
+
+    GMX_EXPECT_SIMD_REAL_EQ(v0, v1);
+}
+
+TEST_F(SimdFloatingpointUtilTest, loadUNDuplicate4)
+{
+    SimdReal        v0, v1;
+    int             i;
+
+    // Set group i of four elements to val0_[i]
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        val1_[i] = val0_[i / 4];
+    }
+
+    v0 = load(val1_);
+    v1 = loadUNDuplicate4(val0_);
+
+    GMX_EXPECT_SIMD_REAL_EQ(v0, v1);
+}
+
+TEST_F(SimdFloatingpointUtilTest, loadU4NOffset)
+{
+    SimdReal        v0, v1;
+    int             i;
+    // Use an odd offset and an unaligned start to test unaligned access
+    const int       offset = 5;
+    real          * p      = mem0_ + 1;
+
+    for (std::size_t j = 0; j < s_workMemSize_; j++)
+    {
+        mem0_[j] = j;
+    }
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        val1_[i] = p[(i / 4)*offset + i % 4];
+    }
+
+    v0 = load(val1_);
+    v1 = loadU4NOffset(p, offset);
+
+    GMX_EXPECT_SIMD_REAL_EQ(v0, v1);
+}
+
+TEST_F(SimdFloatingpointUtilTest, storeU4NOffset)
+{
+    SimdReal        v0;
+    int             i;
+    const int       offset = 5;
+    real          * p      = mem0_ + 1;
+
+    for (std::size_t j = 0; j < s_workMemSize_; j++)
+    {
+        mem0_[j] = -1;
+    }
+
+    v0 = load(val2_);
+    storeU4NOffset(p, offset, v0);
+
+    for (i = 0; i < GMX_SIMD_REAL_WIDTH; i++)
+    {
+        EXPECT_EQ(val2_[i], p[(i / 4)*offset + i % 4]);
+        // The element following each group should not be touched
+        EXPECT_EQ(-1, p[(i / 4)*offset + 4]);
+    }
+    EXPECT_EQ(-1, mem0_[0]);
+}
+
+#endif      // GMX_SIMD_HAVE_4NSIMD_UTIL_REAL
+
 #endif      // GMX_SIMD_HAVE_REAL
 
 /*! \} */
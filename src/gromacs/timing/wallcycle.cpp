@@ -108,7 +108,8 @@ static const char *wcn[ewcNR] =
     "PME wait for PP", "Wait + Recv. PME F", "Wait GPU nonlocal", "Wait GPU local", "NB X/F buffer ops.",
     "Vsite spread", "COM pull force",
     "Write traj.", "Update", "Constraints", "Comm. energies",
-    "Enforced rotation", "Add rot. forces", "Position swapping", "IMD", "Test"
+    "Enforced rotation", "Add rot. forces", "Position swapping", "IMD",
+    "Replica exchange", "Test"
 };
 
 static const char *wcsn[ewcsNR] =
@@ -121,6 +122,7 @@ static const char *wcsn[ewcsNR] =
     "Restraints F",
     "Listed buffer ops.",
     "Nonbonded F",
+    "Nonbonded pruning",
     "Ewald F correction",
     "NB X buffer ops.",
     "NB F buffer ops.",
@@ -55,7 +55,7 @@ enum {
     ewcPMEWAITCOMM, ewcPP_PMEWAITRECVF, ewcWAIT_GPU_NB_NL, ewcWAIT_GPU_NB_L, ewcNB_XF_BUF_OPS,
     ewcVSITESPREAD, ewcPULLPOT,
     ewcTRAJ, ewcUPDATE, ewcCONSTR, ewcMoveE, ewcROT, ewcROTadd, ewcSWAP, ewcIMD,
-    ewcTEST, ewcNR
+    ewcREPLEX, ewcTEST, ewcNR
 };
 
 
@@ -69,6 +69,7 @@ enum {
     ewcsRESTRAINTS,
     ewcsLISTED_BUF_OPS,
     ewcsNONBONDED,
+    ewcsNONBONDED_PRUNING,
     ewcsEWALD_CORRECTION,
     ewcsNB_X_BUF_OPS,
     ewcsNB_F_BUF_OPS,
@@ -0,0 +1,103 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests for the topology utility functions in mtop_util.h.
+ *
+ * \ingroup module_topology
+ */
+#include "gmxpre.h"
+
+#include "gromacs/topology/mtop_util.h"
+
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/topology/atoms.h"
+#include "gromacs/topology/topology.h"
+#include "gromacs/utility/smalloc.h"
+
+namespace gmx
+{
+namespace
+{
+
+/*! \brief Sets up a molecule type with the given particle types
+ *
+ * All particles are put in a single residue.
+ */
+void initMoleculeType(gmx_moltype_t *moltype, const std::vector<int> &ptypes)
+{
+    init_t_atoms(&moltype->atoms, ptypes.size(), FALSE);
+    snew(moltype->atoms.resinfo, 1);
+    moltype->atoms.nres = 1;
+    for (size_t i = 0; i < ptypes.size(); i++)
+    {
+        moltype->atoms.atom[i].ptype  = ptypes[i];
+        moltype->atoms.atom[i].resind = 0;
+    }
+}
+
+TEST(MtopTest, AtomIndexCoversAllMoleculesInBlocks)
+{
+    gmx_mtop_t *mtop;
+    snew(mtop, 1);
+    init_mtop(mtop);
+    // A three-site molecule with a virtual site, and a single atom.
+    mtop->nmoltype = 2;
+    snew(mtop->moltype, mtop->nmoltype);
+    initMoleculeType(&mtop->moltype[0], { eptAtom, eptVSite, eptAtom });
+    initMoleculeType(&mtop->moltype[1], { eptAtom });
+    mtop->nmolblock = 3;
+    snew(mtop->molblock, mtop->nmolblock);
+    mtop->molblock[0].type = 0;
+    mtop->molblock[0].nmol = 3;
+    mtop->molblock[1].type = 1;
+    mtop->molblock[1].nmol = 2;
+    mtop->molblock[2].type = 0;
+    mtop->molblock[2].nmol = 1;
+    mtop->natoms           = 3*3 + 2*1 + 1*3;
+    gmx_mtop_finalize(mtop);
+
+    std::vector<size_t> expected = { 0, 2, 3, 5, 6, 8, 9, 10, 11, 13 };
+    EXPECT_EQ(expected, get_atom_index(mtop));
+
+    done_mtop(mtop);
+    sfree(mtop);
+}
+
+}  // namespace
+}  // namespace gmx
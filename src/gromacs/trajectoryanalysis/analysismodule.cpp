@@ -44,10 +44,13 @@
 #include "analysismodule.h"
 
 #include <map>
+#include <memory>
 #include <utility>
 
 #include "gromacs/analysisdata/analysisdata.h"
+#include "gromacs/analysisdata/paralleloptions.h"
 #include "gromacs/selection/selection.h"
+#include "gromacs/selection/selectioncollection.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/gmxassert.h"
 
@@ -111,6 +114,12 @@ class TrajectoryAnalysisModuleData::Impl
         HandleContainer            handles_;
         //! Stores thread-local selections.
         const SelectionCollection &selections_;
+        /*! \brief
+         * Copies of the selection values for parallel analysis.
+         *
+         * Null if the data object is used for serial analysis.
+         */
+        std::unique_ptr<SelectionFrameCopy> selectionCopy_;
 };
 
 TrajectoryAnalysisModuleData::Impl::Impl(
@@ -130,6 +139,10 @@ TrajectoryAnalysisModuleData::Impl::Impl(
         }
         handles_.insert(std::make_pair(i->second, handle));
     }
+    if (opt.parallelizationFactor() > 1)
+    {
+        selectionCopy_.reset(new SelectionFrameCopy(selections));
+    }
 }
 
 bool TrajectoryAnalysisModuleData::Impl::isInitialized(
@@ -193,7 +206,10 @@ TrajectoryAnalysisModuleData::dataHandle(const AnalysisData &data)
 
 Selection TrajectoryAnalysisModuleData::parallelSelection(const Selection &selection)
 {
-    // TODO: Implement properly.
+    if (impl_->selectionCopy_ != nullptr)
+    {
+        return impl_->selectionCopy_->selection(selection);
+    }
     return selection;
 }
 
@@ -213,6 +229,15 @@ TrajectoryAnalysisModuleData::parallelSelections(const SelectionList &selections
 }
 
 
+void TrajectoryAnalysisModuleData::copySelectionFrameValues()
+{
+    if (impl_->selectionCopy_ != nullptr)
+    {
+        impl_->selectionCopy_->copyFrameValues();
+    }
+}
+
+
 /********************************************************************
  * TrajectoryAnalysisModuleDataBasic
  */
@@ -141,6 +141,20 @@ class TrajectoryAnalysisModuleData
          */
         SelectionList parallelSelections(const SelectionList &selections);
 
+        /*! \brief
+         * Stores the current values of the selections for this frame.
+         *
+         * \throws std::bad_alloc if out of memory.
+         *
+         * When several frames are analyzed in parallel, the runner evaluates
+         * the selections serially and calls this method to store the values
+         * for the frame that will be processed using this object.
+         * parallelSelection() then returns selections with the stored
+         * values.
+         * Does nothing if the data object was created for serial analysis.
+         */
+        void copySelectionFrameValues();
+
     protected:
         /*! \brief
          * Initializes thread-local storage for data handles and selections.
@@ -121,6 +121,19 @@ class TrajectoryAnalysisSettings
              * \see setRmPBC()
              */
             efNoUserRmPBC    = 1<<5,
+            /*! \brief
+             * Allows analyzing multiple frames in parallel.
+             *
+             * If this flag is specified, the module declares that
+             * TrajectoryAnalysisModule::analyzeFrame() can be called
+             * concurrently for different frames, each with its own
+             * TrajectoryAnalysisModuleData object, and an option is
+             * provided for the user to set the number of threads.
+             * The flag can be cleared in
+             * TrajectoryAnalysisModule::optionsFinished() if the user input
+             * makes parallel analysis impossible.
+             */
+            efParallelFrames = 1<<6,
         };
 
         //! Initializes default settings.
@@ -43,9 +43,13 @@
 
 #include "cmdlinerunner.h"
 
+#include <exception>
+#include <vector>
+
 #include "gromacs/analysisdata/paralleloptions.h"
 #include "gromacs/commandline/cmdlinemodulemanager.h"
 #include "gromacs/commandline/cmdlineoptionsmodule.h"
+#include "gromacs/math/vectypes.h"
 #include "gromacs/options/ioptionscontainer.h"
 #include "gromacs/options/timeunitmanager.h"
 #include "gromacs/pbcutil/pbc.h"
@@ -66,6 +70,74 @@ namespace gmx
 namespace
 {
 
+/********************************************************************
+ * ParallelFrame
+ */
+
+/*! \internal \brief
+ * Storage for a frame that is analyzed concurrently with other frames.
+ *
+ * Keeps a copy of the coordinates and the PBC information for the frame,
+ * and the thread-local module data that holds the selection values.
+ */
+class ParallelFrame
+{
+    public:
+        ParallelFrame() : index_(-1), ppbc_(nullptr)
+        {
+        }
+
+        /*! \brief
+         * Copies a frame read from the trajectory.
+         *
+         * Pointers to arrays that are not modified between frames
+         * (atoms and index) are shared with \p source.
+         */
+        void copyFrame(int index, const t_trxframe &source, const t_pbc *pbc)
+        {
+            index_ = index;
+            frame_ = source;
+            copyVector(source.natoms, source.bX ? source.x : nullptr, &x_, &frame_.x);
+            copyVector(source.natoms, source.bV ? source.v : nullptr, &v_, &frame_.v);
+            copyVector(source.natoms, source.bF ? source.f : nullptr, &f_, &frame_.f);
+            ppbc_ = nullptr;
+            if (pbc != nullptr)
+            {
+                pbc_  = *pbc;
+                ppbc_ = &pbc_;
+            }
+            pdata_->copySelectionFrameValues();
+        }
+
+        //! Index of the frame.
+        int                                 index_;
+        //! Frame with pointers to the copied coordinates.
+        t_trxframe                          frame_;
+        //! PBC information for the frame, or `nullptr` if not used.
+        t_pbc                              *ppbc_;
+        //! Thread-local data for the analysis module.
+        TrajectoryAnalysisModuleDataPointer pdata_;
+
+    private:
+        //! Copies an array from the source frame into \p storage.
+        static void copyVector(int natoms, const rvec *source,
+                               std::vector<RVec> *storage, rvec **dest)
+        {
+            if (source == nullptr)
+            {
+                *dest = nullptr;
+                return;
+            }
+            storage->assign(source, source + natoms);
+            *dest = as_rvec_array(storage->data());
+        }
+
+        std::vector<RVec>                   x_;
+        std::vector<RVec>                   v_;
+        std::vector<RVec>                   f_;
+        t_pbc                               pbc_;
+};
+
 /********************************************************************
  * RunnerModule
  */
@@ -84,6 +156,25 @@ class RunnerModule : public ICommandLineOptionsModule
         virtual void optionsFinished();
         virtual int run();
 
+        /*! \brief
+         * Analyzes all frames serially.
+         *
+         * \returns Number of frames analyzed.
+         */
+        int analyzeFrames();
+        /*! \brief
+         * Analyzes the frames with \p threadCount frames in flight.
+         *
+         * \returns Number of frames analyzed.
+         *
+         * Reading the frames and evaluating the selections is done serially,
+         * after which the frames in a batch are passed to
+         * TrajectoryAnalysisModule::analyzeFrame() in parallel.
+         * TrajectoryAnalysisModule::finishFrameSerial() is called in order
+         * after each batch.
+         */
+        int analyzeFramesInParallel(int threadCount);
+
         TrajectoryAnalysisModulePointer module_;
         TrajectoryAnalysisSettings      settings_;
         TrajectoryAnalysisRunnerCommon  common_;
@@ -127,6 +218,41 @@ int RunnerModule::run()
     common_.initFrameIndexGroup();
     module_->initAfterFirstFrame(settings_, common_.frame());
 
+    int threadCount = common_.threadCount();
+    if (threadCount > 1
+        && !settings_.hasFlag(TrajectoryAnalysisSettings::efParallelFrames))
+    {
+        fprintf(stderr, "NOTE: The selected options do not support parallel "
+                "analysis; analyzing frames serially.\n");
+        threadCount = 1;
+    }
+    const int nframes = (threadCount > 1
+                         ? analyzeFramesInParallel(threadCount)
+                         : analyzeFrames());
+
+    if (common_.hasTrajectory())
+    {
+        fprintf(stderr, "Analyzed %d frames, last time %.3f\n",
+                nframes, common_.frame().time);
+    }
+    else
+    {
+        fprintf(stderr, "Analyzed topology coordinates\n");
+    }
+
+    // Restore the maximal groups for dynamic selections.
+    selections_.evaluateFinal(nframes);
+
+    module_->finishAnalysis(nframes);
+    module_->writeOutput();
+
+    return 0;
+}
+
+int RunnerModule::analyzeFrames()
+{
+    const TopologyInformation &topology = common_.topologyInformation();
+
     t_pbc  pbc;
     t_pbc *ppbc = settings_.hasPBC() ? &pbc : nullptr;
 
@@ -156,24 +282,79 @@ int RunnerModule::run()
         pdata->finish();
     }
     pdata.reset();
+    return nframes;
+}
 
-    if (common_.hasTrajectory())
+int RunnerModule::analyzeFramesInParallel(int threadCount)
+{
+    const TopologyInformation  &topology = common_.topologyInformation();
+
+    t_pbc                       pbc;
+    t_pbc                      *ppbc = settings_.hasPBC() ? &pbc : nullptr;
+
+    AnalysisDataParallelOptions dataOptions(threadCount);
+    std::vector<ParallelFrame>  frames(threadCount);
+    for (ParallelFrame &frame : frames)
     {
-        fprintf(stderr, "Analyzed %d frames, last time %.3f\n",
-                nframes, common_.frame().time);
+        frame.pdata_ = module_->startFrames(dataOptions, selections_);
     }
-    else
+    std::vector<std::exception_ptr> exceptions(threadCount);
+
+    int                             nframes = 0;
+    bool                            bMore   = true;
+    while (bMore)
     {
-        fprintf(stderr, "Analyzed topology coordinates\n");
-    }
+        int frameCount = 0;
+        while (bMore && frameCount < threadCount)
+        {
+            common_.initFrame();
+            t_trxframe &frame = common_.frame();
+            if (ppbc != nullptr)
+            {
+                set_pbc(ppbc, topology.ePBC(), frame.box);
+            }
 
-    // Restore the maximal groups for dynamic selections.
-    selections_.evaluateFinal(nframes);
+            selections_.evaluate(&frame, ppbc);
+            frames[frameCount].copyFrame(nframes + frameCount, frame, ppbc);
+            ++frameCount;
+            bMore = common_.readNextFrame();
+        }
 
-    module_->finishAnalysis(nframes);
-    module_->writeOutput();
+#pragma omp parallel for num_threads(threadCount) schedule(static, 1)
+        for (int i = 0; i < frameCount; ++i)
+        {
+            try
+            {
+                ParallelFrame &frame = frames[i];
+                module_->analyzeFrame(frame.index_, frame.frame_, frame.ppbc_,
+                                      frame.pdata_.get());
+            }
+            catch (...)
+            {
+                exceptions[i] = std::current_exception();
+            }
+        }
+        for (int i = 0; i < frameCount; ++i)
+        {
+            if (exceptions[i])
+            {
+                std::rethrow_exception(exceptions[i]);
+            }
+        }
 
-    return 0;
+        for (int i = 0; i < frameCount; ++i)
+        {
+            module_->finishFrameSerial(nframes + i);
+        }
+        nframes += frameCount;
+    }
+    for (ParallelFrame &frame : frames)
+    {
+        module_->finishFrames(frame.pdata_.get());
+        frame.pdata_->finish();
+        frame.pdata_.reset();
+    }
+    return nframes;
 }
 
 }   // namespace
@@ -184,6 +184,8 @@ Distance::initOptions(IOptionsContainer *options, TrajectoryAnalysisSettings *se
                            .description("Width of full distribution as fraction of [TT]-len[tt]"));
     options->addOption(DoubleOption("binw").store(&binWidth_)
                            .description("Bin width for histogramming"));
+
+    settings->setFlag(TrajectoryAnalysisSettings::efParallelFrames);
 }
 
 
@@ -235,6 +235,8 @@ PairDistance::initOptions(IOptionsContainer *options, TrajectoryAnalysisSettings
                            .description("Reference positions to calculate distances from"));
     options->addOption(SelectionOption("sel").storeVector(&sel_).required().multiValue()
                            .description("Positions to calculate distances for"));
+
+    settings->setFlag(TrajectoryAnalysisSettings::efParallelFrames);
 }
 
 //! Helper function to initialize the grouping for a selection.
@@ -59,6 +59,7 @@
 #include "gromacs/math/functions.h"
 #include "gromacs/math/utilities.h"
 #include "gromacs/math/vec.h"
+#include "gromacs/math/vectypes.h"
 #include "gromacs/options/basicoptions.h"
 #include "gromacs/options/filenameoption.h"
 #include "gromacs/options/ioptionscontainer.h"
@@ -66,10 +67,14 @@
 #include "gromacs/selection/nbsearch.h"
 #include "gromacs/selection/selection.h"
 #include "gromacs/selection/selectionoption.h"
+#include "gromacs/simd/simd.h"
+#include "gromacs/simd/simd_math.h"
 #include "gromacs/topology/topology.h"
 #include "gromacs/trajectory/trajectoryframe.h"
 #include "gromacs/trajectoryanalysis/analysismodule.h"
 #include "gromacs/trajectoryanalysis/analysissettings.h"
+#include "gromacs/utility/alignedallocator.h"
+#include "gromacs/utility/arrayref.h"
 #include "gromacs/utility/exceptions.h"
 #include "gromacs/utility/stringutil.h"
 
@@ -107,6 +112,74 @@ enum SurfaceType
 };
 //! String values corresponding to SurfaceType.
 const char *const c_SurfaceEnum[] = { "no", "mol", "res" };
+//! Number of pairs retrieved from the neighborhood search at a time.
+const int         c_pairBlockSize = 256;
+
+/*! \brief
+ * Returns the histogram bin for a distance, binCount if beyond the last bin.
+ */
+int findPairBin(real r2, real invBinWidth, int binCount)
+{
+    return std::min(static_cast<int>(std::sqrt(r2) * invBinWidth), binCount);
+}
+
+/*! \brief
+ * Computes histogram bins for a block of squared pair distances.
+ *
+ * \param[in]  r2          Squared distances, aligned for SIMD loads.
+ * \param[in]  count       Number of distances in \p r2.
+ * \param[in]  cut2        Squared distance at and below which pairs are ignored.
+ * \param[in]  invBinWidth Inverse of the bin width.
+ * \param[in]  binCount    Number of bins.
+ * \param[in]  binEdge2    Smallest squared distance in each bin (see
+ *     Rdf::binEdge2_).
+ * \param[out] bin         Bin index for each distance, aligned for SIMD stores.
+ *
+ * Ignored pairs and pairs beyond the last bin get index \p binCount, such
+ * that they can be accumulated into an extra overflow bin without branches.
+ * The result is the same as from findPairBin(): the SIMD square root is not
+ * correctly rounded, so distances close to a bin edge are moved to the
+ * correct bin based on \p binEdge2.
+ * With SIMD, \p r2 and \p bin are accessed up to \p count rounded up to
+ * the SIMD width.
+ */
+void computePairBins(const real *r2, int count, real cut2, real invBinWidth,
+                     int binCount, const real *binEdge2, int *bin)
+{
+#if GMX_SIMD_HAVE_REAL
+    const SimdReal cut2S(cut2);
+    const SimdReal invBinWidthS(invBinWidth);
+    const SimdReal overflowS(static_cast<real>(binCount));
+    for (int i = 0; i < count; i += GMX_SIMD_REAL_WIDTH)
+    {
+        const SimdReal r2S  = load(r2 + i);
+        SimdReal       binS = min(sqrt(r2S) * invBinWidthS, overflowS);
+        binS = blend(overflowS, binS, cut2S < r2S);
+        store(bin + i, cvttR2I(binS));
+    }
+    for (int i = 0; i < count; ++i)
+    {
+        if (r2[i] <= cut2)
+        {
+            continue;
+        }
+        if (r2[i] < binEdge2[bin[i]])
+        {
+            --bin[i];
+        }
+        else if (r2[i] >= binEdge2[bin[i] + 1])
+        {
+            ++bin[i];
+        }
+    }
+#else
+    GMX_UNUSED_VALUE(binEdge2);
+    for (int i = 0; i < count; ++i)
+    {
+        bin[i] = (r2[i] > cut2) ? findPairBin(r2[i], invBinWidth, binCount) : binCount;
+    }
+#endif
+}
 
 /*! \brief
  * Implements `gmx rdf` trajectory analysis module.
@@ -134,40 +207,52 @@ class Rdf : public TrajectoryAnalysisModule
         virtual void writeOutput();
 
     private:
+        //! Returns the index in `refSel_` of the reference for selection \p g.
+        size_t refIndex(size_t g) const
+        {
+            return refSel_.size() == 1 ? 0 : g;
+        }
+
         std::string                               fnRdf_;
         std::string                               fnCumulative_;
         SurfaceType                               surface_;
         AnalysisDataPlotSettings                  plotSettings_;
 
         /*! \brief
-         * Reference selection to compute RDFs around.
+         * Reference selections to compute RDFs around.
+         *
+         * Either a single selection that is used for all of `sel_`, or one
+         * selection for each selection in `sel_`.
          *
          * With -surf, Selection::originalIds() and Selection::mappedIds()
          * store the index of the surface group to which that position belongs.
          * The RDF is computed by finding the nearest position from each
          * surface group for each position, and then binning those distances.
          */
-        Selection                                 refSel_;
+        SelectionList                             refSel_;
         /*! \brief
          * Selections to compute RDFs for.
          */
         SelectionList                             sel_;
 
         /*! \brief
-         * Raw pairwise distance data from which the RDF is computed.
+         * Binned pairwise distance data from which the RDF is computed.
          *
-         * There is a data set for each selection in `sel_`, with a single
-         * column.  Each point set will contain a single pairwise distance
-         * that contributes to the RDF.
+         * There is a data set for each selection in `sel_`, with two
+         * columns.  Each point set contains the center of a histogram bin
+         * and the number of pairs in that bin for the frame.
+         * The pairs are binned in the frame-local data, so that the
+         * analysis data framework only sees one point set per nonempty bin
+         * instead of one per pair.
          */
         AnalysisData                              pairDist_;
         /*! \brief
          * Normalization factors for each frame.
          *
-         * The first column contains the number of positions in `refSel_` for
-         * that frame (with surface RDF, the number of groups).  There are
-         * `sel_.size()` more columns, each containing the number density of
-         * positions for one selection.
+         * The first `refSel_.size()` columns contain the number of positions
+         * in each reference selection for that frame (with surface RDF, the
+         * number of groups).  There are `sel_.size()` more columns, each
+         * containing the number density of positions for one selection.
          */
         AnalysisData                              normFactors_;
         /*! \brief
@@ -175,9 +260,9 @@ class Rdf : public TrajectoryAnalysisModule
          *
          * The per-frame histograms are raw pair counts in each bin;
          * the averager is normalized by the average number of reference
-         * positions (average of the first column of `normFactors_`).
+         * positions (average of the corresponding column of `normFactors_`).
          */
-        AnalysisDataSimpleHistogramModulePointer  pairCounts_;
+        AnalysisDataWeightedHistogramModulePointer pairCounts_;
         /*! \brief
          * Average normalization factors.
          */
@@ -197,19 +282,29 @@ class Rdf : public TrajectoryAnalysisModule
         // Pre-computed values for faster access during analysis.
         real                                      cut2_;
         real                                      rmax2_;
-        int                                       surfaceGroupCount_;
+        real                                      invBinWidth_;
+        int                                       binCount_;
+        /*! \brief
+         * Smallest squared distance that findPairBin() puts into each bin.
+         *
+         * Has `binCount_ + 2` entries: the last bin is followed by the
+         * threshold for the overflow bin and by the largest real value.
+         */
+        std::vector<real>                         binEdge2_;
+        //! Number of surface groups in each of `refSel_` with -surf.
+        std::vector<int>                          surfaceGroupCount_;
 
         // Copy and assign disallowed by base.
 };
 
 Rdf::Rdf()
     : surface_(SurfaceType_None),
-      pairCounts_(new AnalysisDataSimpleHistogramModule()),
+      pairCounts_(new AnalysisDataWeightedHistogramModule()),
       normAve_(new AnalysisDataAverageModule()),
       binwidth_(0.002), cutoff_(0.0), rmax_(0.0),
       normalization_(Normalization_Rdf), bNormalizationSet_(false), bXY_(false),
       bExclusions_(false),
-      cut2_(0.0), rmax2_(0.0), surfaceGroupCount_(0)
+      cut2_(0.0), rmax2_(0.0), invBinWidth_(0.0), binCount_(0)
 {
     pairDist_.setMultipoint(true);
     pairDist_.addModule(pairCounts_);
@@ -234,6 +329,11 @@ Rdf::initOptions(IOptionsContainer *options, TrajectoryAnalysisSettings *setting
         "[IT]z[it]-axis, i.e., only in the [IT]x[it]-[IT]y[it] plane, use",
         "[TT]-xy[tt].",
         "",
+        "To compute RDFs around several reference sets in a single pass over",
+        "the trajectory, provide as many selections to [TT]-ref[tt] as to",
+        "[TT]-sel[tt]: the RDF for each selection in [TT]-sel[tt] is then",
+        "computed with respect to the corresponding selection in [TT]-ref[tt].",
+        "",
         "To set the bin width and maximum distance to use in the RDF, use",
         "[TT]-bin[tt] and [TT]-rmax[tt], respectively. The latter can be",
         "used to limit the computational cost if the RDF is not of interest",
@@ -302,11 +402,14 @@ Rdf::initOptions(IOptionsContainer *options, TrajectoryAnalysisSettings *setting
                            .store(&surface_)
                            .description("RDF with respect to the surface of the reference"));
 
-    options->addOption(SelectionOption("ref").store(&refSel_).required()
-                           .description("Reference selection for RDF computation"));
+    options->addOption(SelectionOption("ref").storeVector(&refSel_)
+                           .required().multiValue()
+                           .description("Reference selection(s) for RDF computation"));
     options->addOption(SelectionOption("sel").storeVector(&sel_)
                            .required().multiValue()
                            .description("Selections to compute RDFs for from the reference"));
+
+    settings->setFlag(TrajectoryAnalysisSettings::efParallelFrames);
 }
 
 void
@@ -343,29 +446,39 @@ Rdf::initAnalysis(const TrajectoryAnalysisSettings &settings,
     pairDist_.setDataSetCount(sel_.size());
     for (size_t i = 0; i < sel_.size(); ++i)
     {
-        pairDist_.setColumnCount(i, 1);
+        pairDist_.setColumnCount(i, 2);
     }
     plotSettings_ = settings.plotSettings();
     nb_.setXYMode(bXY_);
 
-    normFactors_.setColumnCount(0, sel_.size() + 1);
+    if (refSel_.size() != 1 && refSel_.size() != sel_.size())
+    {
+        GMX_THROW(InconsistentInputError("-ref should specify either a single selection or one selection for each selection in -sel"));
+    }
+    normFactors_.setColumnCount(0, refSel_.size() + sel_.size());
 
     const bool bSurface = (surface_ != SurfaceType_None);
     if (bSurface)
     {
-        if (!refSel_.hasOnlyAtoms())
+        const e_index_t type = (surface_ == SurfaceType_Molecule ? INDEX_MOL : INDEX_RES);
+        for (size_t r = 0; r < refSel_.size(); ++r)
         {
-            GMX_THROW(InconsistentInputError("-surf only works with -ref that consists of atoms"));
+            if (!refSel_[r].hasOnlyAtoms())
+            {
+                GMX_THROW(InconsistentInputError("-surf only works with -ref that consists of atoms"));
+            }
+            surfaceGroupCount_.push_back(refSel_[r].initOriginalIdsToGroup(top.mtop(), type));
         }
-        const e_index_t type = (surface_ == SurfaceType_Molecule ? INDEX_MOL : INDEX_RES);
-        surfaceGroupCount_ = refSel_.initOriginalIdsToGroup(top.mtop(), type);
     }
 
     if (bExclusions_)
     {
-        if (!refSel_.hasOnlyAtoms() || !refSel_.hasSortedAtomIndices())
+        for (size_t r = 0; r < refSel_.size(); ++r)
         {
-            GMX_THROW(InconsistentInputError("-excl only works with a -ref selection that consist of atoms in ascending (sorted) order"));
+            if (!refSel_[r].hasOnlyAtoms() || !refSel_[r].hasSortedAtomIndices())
+            {
+                GMX_THROW(InconsistentInputError("-excl only works with a -ref selection that consist of atoms in ascending (sorted) order"));
+            }
         }
         for (size_t i = 0; i < sel_.size(); ++i)
         {
@@ -415,10 +528,31 @@ Rdf::initAfterFirstFrame(const TrajectoryAnalysisSettings &settings,
     // We use the double amount of bins, so we can correctly
     // write the rdf and rdf_cn output at i*binwidth values.
     pairCounts_->init(histogramFromRange(0.0, rmax_).binWidth(binwidth_ / 2.0));
+    invBinWidth_ = 1.0 / pairCounts_->settings().binWidth();
+    binCount_    = pairCounts_->settings().binCount();
+    binEdge2_.resize(binCount_ + 2);
+    binEdge2_[0] = 0.0;
+    for (int bin = 1; bin <= binCount_; ++bin)
+    {
+        real r2 = gmx::square(bin / invBinWidth_);
+        while (r2 > 0 && findPairBin(r2, invBinWidth_, binCount_) >= bin)
+        {
+            r2 = std::nextafter(r2, static_cast<real>(0.0));
+        }
+        while (findPairBin(r2, invBinWidth_, binCount_) < bin)
+        {
+            r2 = std::nextafter(r2, std::numeric_limits<real>::max());
+        }
+        binEdge2_[bin] = r2;
+    }
+    binEdge2_[binCount_ + 1] = std::numeric_limits<real>::max();
 }
 
 /*! \brief
  * Temporary memory for use within a single-frame calculation.
+ *
+ * With parallel frames, each thread has its own instance, so the pair counts
+ * are accumulated into per-thread histograms without synchronization.
  */
 class RdfModuleData : public TrajectoryAnalysisModuleData
 {
@@ -435,6 +569,9 @@ class RdfModuleData : public TrajectoryAnalysisModuleData
             : TrajectoryAnalysisModuleData(module, opt, selections)
         {
             surfaceDist2_.resize(surfaceGroupCount);
+            pairs_.resize(c_pairBlockSize);
+            pairDist2_.resize(c_pairBlockSize);
+            pairBin_.resize(c_pairBlockSize);
         }
 
         virtual void finish() { finishDataHandles(); }
@@ -450,15 +587,37 @@ class RdfModuleData : public TrajectoryAnalysisModuleData
          * to find the minimum distance to each surface group, and then compute
          * the RDF from these numbers.
          */
-        std::vector<real> surfaceDist2_;
+        std::vector<real>                          surfaceDist2_;
+        /*! \brief
+         * Pair counts for the current frame.
+         *
+         * One histogram for each selection, each with an extra overflow bin
+         * at the end for pairs that do not contribute to the RDF.
+         */
+        std::vector<int>                           pairCounts_;
+        //! Positions of all selections that share a reference selection.
+        std::vector<RVec>                          testX_;
+        //! Atom indices for \p testX_ for use with exclusions.
+        std::vector<int>                           testExclusionIds_;
+        //! Offset of the histogram in \p pairCounts_ for each of \p testX_.
+        std::vector<int>                           testHistogramOffset_;
+        //! Block of pairs from the neighborhood search.
+        std::vector<AnalysisNeighborhoodPair>      pairs_;
+        //! Squared distances for \p pairs_.
+        std::vector<real, AlignedAllocator<real> > pairDist2_;
+        //! Histogram bins for \p pairs_.
+        std::vector<int, AlignedAllocator<int> >   pairBin_;
 };
 
 TrajectoryAnalysisModuleDataPointer Rdf::startFrames(
         const AnalysisDataParallelOptions &opt,
         const SelectionCollection         &selections)
 {
+    const int maxSurfaceGroupCount
+        = surfaceGroupCount_.empty()
+            ? 0 : *std::max_element(surfaceGroupCount_.begin(), surfaceGroupCount_.end());
     return TrajectoryAnalysisModuleDataPointer(
-            new RdfModuleData(this, opt, selections, surfaceGroupCount_));
+            new RdfModuleData(this, opt, selections, maxSurfaceGroupCount));
 }
 
 void
@@ -467,10 +626,10 @@ Rdf::analyzeFrame(int frnr, const t_trxframe &fr, t_pbc *pbc,
 {
     AnalysisDataHandle   dh        = pdata->dataHandle(pairDist_);
     AnalysisDataHandle   nh        = pdata->dataHandle(normFactors_);
-    const Selection     &refSel    = pdata->parallelSelection(refSel_);
+    const SelectionList &refSel    = pdata->parallelSelections(refSel_);
     const SelectionList &sel       = pdata->parallelSelections(sel_);
     RdfModuleData       &frameData = *static_cast<RdfModuleData *>(pdata);
-    const bool           bSurface  = !frameData.surfaceDist2_.empty();
+    const bool           bSurface  = (surface_ != SurfaceType_None);
 
     matrix               boxForVolume;
     copy_mat(fr.box, boxForVolume);
@@ -484,75 +643,86 @@ Rdf::analyzeFrame(int frnr, const t_trxframe &fr, t_pbc *pbc,
 
     nh.startFrame(frnr, fr.time);
     // Compute the normalization factor for the number of reference positions.
-    if (bSurface)
+    for (size_t r = 0; r < refSel.size(); ++r)
     {
-        if (refSel.isDynamic())
+        if (bSurface)
         {
-            // Count the number of distinct groups.
-            // This assumes that each group is continuous, which is currently
-            // the case.
-            int count  = 0;
-            int prevId = -1;
-            for (int i = 0; i < refSel.posCount(); ++i)
+            if (refSel[r].isDynamic())
             {
-                const int id = refSel.position(i).mappedId();
-                if (id != prevId)
+                // Count the number of distinct groups.
+                // This assumes that each group is continuous, which is currently
+                // the case.
+                int count  = 0;
+                int prevId = -1;
+                for (int i = 0; i < refSel[r].posCount(); ++i)
                 {
-                    ++count;
-                    prevId = id;
+                    const int id = refSel[r].position(i).mappedId();
+                    if (id != prevId)
+                    {
+                        ++count;
+                        prevId = id;
+                    }
                 }
+                nh.setPoint(r, count);
+            }
+            else
+            {
+                nh.setPoint(r, surfaceGroupCount_[r]);
             }
-            nh.setPoint(0, count);
         }
         else
         {
-            nh.setPoint(0, surfaceGroupCount_);
+            nh.setPoint(r, refSel[r].posCount());
         }
     }
-    else
-    {
-        nh.setPoint(0, refSel.posCount());
-    }
 
-    dh.startFrame(frnr, fr.time);
-    AnalysisNeighborhoodSearch    nbsearch = nb_.initSearch(pbc, refSel);
-    for (size_t g = 0; g < sel.size(); ++g)
+    // Each selection has its own histogram with an extra overflow bin.
+    const int          histogramSize = binCount_ + 1;
+    std::vector<int>  &pairCounts    = frameData.pairCounts_;
+    pairCounts.assign(sel.size() * histogramSize, 0);
+    for (size_t r = 0; r < refSel.size(); ++r)
     {
-        dh.selectDataSet(g);
-
+        AnalysisNeighborhoodSearch nbsearch = nb_.initSearch(pbc, refSel[r]);
         if (bSurface)
         {
             // Special loop for surface calculation, where a separate neighbor
             // search is done for each position in the selection, and the
             // nearest position from each surface group is tracked.
             std::vector<real> &surfaceDist2 = frameData.surfaceDist2_;
-            for (int i = 0; i < sel[g].posCount(); ++i)
+            for (size_t g = 0; g < sel.size(); ++g)
             {
-                std::fill(surfaceDist2.begin(), surfaceDist2.end(),
-                          std::numeric_limits<real>::max());
-                AnalysisNeighborhoodPairSearch pairSearch =
-                    nbsearch.startPairSearch(sel[g].position(i));
-                AnalysisNeighborhoodPair       pair;
-                while (pairSearch.findNextPair(&pair))
+                if (refIndex(g) != r)
                 {
-                    const real r2    = pair.distance2();
-                    const int  refId = refSel.position(pair.refIndex()).mappedId();
-                    if (r2 < surfaceDist2[refId])
-                    {
-                        surfaceDist2[refId] = r2;
-                    }
+                    continue;
                 }
-                // Accumulate the RDF from the distances to the surface.
-                for (size_t i = 0; i < surfaceDist2.size(); ++i)
+                int *counts = &pairCounts[g * histogramSize];
+                for (int i = 0; i < sel[g].posCount(); ++i)
                 {
-                    const real r2 = surfaceDist2[i];
-                    // Here, we need to check for rmax, since the value might
-                    // be above the cutoff if no points were close to some
-                    // surface positions.
-                    if (r2 > cut2_ && r2 <= rmax2_)
+                    std::fill(surfaceDist2.begin(), surfaceDist2.end(),
+                              std::numeric_limits<real>::max());
+                    AnalysisNeighborhoodPairSearch pairSearch =
+                        nbsearch.startPairSearch(sel[g].position(i));
+                    AnalysisNeighborhoodPair       pair;
+                    while (pairSearch.findNextPair(&pair))
                     {
-                        dh.setPoint(0, std::sqrt(r2));
-                        dh.finishPointSet();
+                        const real r2    = pair.distance2();
+                        const int  refId = refSel[r].position(pair.refIndex()).mappedId();
+                        if (r2 < surfaceDist2[refId])
+                        {
+                            surfaceDist2[refId] = r2;
+                        }
+                    }
+                    // Accumulate the RDF from the distances to the surface.
+                    for (int s = 0; s < surfaceGroupCount_[r]; ++s)
+                    {
+                        const real r2 = surfaceDist2[s];
+                        // Here, we need to check for rmax, since the value might
+                        // be above the cutoff if no points were close to some
+                        // surface positions.
+                        if (r2 > cut2_ && r2 <= rmax2_)
+                        {
+                            ++counts[findPairBin(r2, invBinWidth_, binCount_)];
+                        }
                     }
                 }
             }
@@ -560,24 +730,73 @@ Rdf::analyzeFrame(int frnr, const t_trxframe &fr, t_pbc *pbc,
         else
         {
             // Standard neighborhood search over all pairs within the cutoff
-            // for the -surf no case.
-            AnalysisNeighborhoodPairSearch pairSearch = nbsearch.startPairSearch(sel[g]);
-            AnalysisNeighborhoodPair       pair;
-            while (pairSearch.findNextPair(&pair))
+            // for the -surf no case.  All selections that use this reference
+            // are searched together, and the histogram for each pair is found
+            // from the index of the test position.
+            std::vector<RVec> &testX        = frameData.testX_;
+            std::vector<int>  &exclusionIds = frameData.testExclusionIds_;
+            std::vector<int>  &offset       = frameData.testHistogramOffset_;
+            testX.clear();
+            exclusionIds.clear();
+            offset.clear();
+            for (size_t g = 0; g < sel.size(); ++g)
             {
-                const real r2 = pair.distance2();
-                if (r2 > cut2_)
+                if (refIndex(g) != r)
+                {
+                    continue;
+                }
+                const ConstArrayRef<rvec> x = sel[g].coordinates();
+                testX.insert(testX.end(), x.begin(), x.end());
+                offset.insert(offset.end(), x.size(), g * histogramSize);
+                if (bExclusions_)
                 {
-                    // TODO: Consider whether the histogramming could be done with
-                    // less overhead (after first measuring the overhead).
-                    dh.setPoint(0, std::sqrt(r2));
-                    dh.finishPointSet();
+                    const ConstArrayRef<int> atoms = sel[g].atomIndices();
+                    exclusionIds.insert(exclusionIds.end(), atoms.begin(), atoms.end());
                 }
             }
+            AnalysisNeighborhoodPositions testPositions(testX);
+            if (bExclusions_)
+            {
+                testPositions.exclusionIds(exclusionIds);
+            }
+            AnalysisNeighborhoodPairSearch pairSearch = nbsearch.startPairSearch(testPositions);
+            std::vector<AnalysisNeighborhoodPair> &pairs = frameData.pairs_;
+            real                                  *r2    = frameData.pairDist2_.data();
+            int                                   *bin   = frameData.pairBin_.data();
+            int                                    count;
+            while ((count = pairSearch.findNextPairs(pairs)) > 0)
+            {
+                for (int i = 0; i < count; ++i)
+                {
+                    r2[i] = pairs[i].distance2();
+                }
+                computePairBins(r2, count, cut2_, invBinWidth_, binCount_,
+                                binEdge2_.data(), bin);
+                for (int i = 0; i < count; ++i)
+                {
+                    ++pairCounts[offset[pairs[i].testIndex()] + bin[i]];
+                }
+            }
+        }
+    }
+
+    dh.startFrame(frnr, fr.time);
+    for (size_t g = 0; g < sel.size(); ++g)
+    {
+        dh.selectDataSet(g);
+        const int *counts = &pairCounts[g * histogramSize];
+        for (int bin = 0; bin < binCount_; ++bin)
+        {
+            if (counts[bin] > 0)
+            {
+                dh.setPoint(0, (bin + 0.5) / invBinWidth_);
+                dh.setPoint(1, counts[bin]);
+                dh.finishPointSet();
+            }
         }
         // Normalization factor for the number density (only used without
         // -surf, but does not hurt to populate otherwise).
-        nh.setPoint(g + 1, sel[g].posCount() * inverseVolume);
+        nh.setPoint(refSel.size() + g, sel[g].posCount() * inverseVolume);
     }
     dh.finishFrame();
     nh.finishFrame();
@@ -588,8 +807,11 @@ Rdf::finishAnalysis(int /*nframes*/)
 {
     // Normalize the averager with the number of reference positions,
     // from where the normalization propagates to all the output.
-    const real refPosCount = normAve_->average(0, 0);
-    pairCounts_->averager().scaleAll(1.0 / refPosCount);
+    for (size_t g = 0; g < sel_.size(); ++g)
+    {
+        const real refPosCount = normAve_->average(0, refIndex(g));
+        pairCounts_->averager().scaleSingle(g, 1.0 / refPosCount);
+    }
     pairCounts_->averager().done();
 
     // TODO: Consider how these could be exposed to the testing framework
@@ -628,7 +850,7 @@ Rdf::finishAnalysis(int /*nframes*/)
             // Normalize by particle density.
             for (size_t g = 0; g < sel_.size(); ++g)
             {
-                finalRdf->scaleSingle(g, 1.0 / normAve_->average(0, g + 1));
+                finalRdf->scaleSingle(g, 1.0 / normAve_->average(0, refSel_.size() + g));
             }
         }
     }
@@ -641,19 +863,37 @@ Rdf::finishAnalysis(int /*nframes*/)
     }
     finalRdf->done();
 
+    // With a single reference, it is given in the subtitle; otherwise, the
+    // legend identifies both selections of each pair.
+    auto setReferenceAndLegends = [this](AnalysisDataPlotModule *plotm)
+        {
+            if (refSel_.size() == 1)
+            {
+                plotm->setSubtitle(formatString("reference %s", refSel_[0].name()));
+            }
+            for (size_t i = 0; i < sel_.size(); ++i)
+            {
+                if (refSel_.size() == 1)
+                {
+                    plotm->appendLegend(sel_[i].name());
+                }
+                else
+                {
+                    plotm->appendLegend(formatString("%s around %s", sel_[i].name(),
+                                                     refSel_[i].name()));
+                }
+            }
+        };
+
     // TODO: Consider if some of this should be done in writeOutput().
     {
         AnalysisDataPlotModulePointer plotm(
                 new AnalysisDataPlotModule(plotSettings_));
         plotm->setFileName(fnRdf_);
         plotm->setTitle("Radial distribution");
-        plotm->setSubtitle(formatString("reference %s", refSel_.name()));
+        setReferenceAndLegends(plotm.get());
         plotm->setXLabel("r (nm)");
         plotm->setYLabel("g(r)");
-        for (size_t i = 0; i < sel_.size(); ++i)
-        {
-            plotm->appendLegend(sel_[i].name());
-        }
         finalRdf->addModule(plotm);
     }
 
@@ -668,13 +908,9 @@ Rdf::finishAnalysis(int /*nframes*/)
                 new AnalysisDataPlotModule(plotSettings_));
         plotm->setFileName(fnCumulative_);
         plotm->setTitle("Cumulative Number RDF");
-        plotm->setSubtitle(formatString("reference %s", refSel_.name()));
+        setReferenceAndLegends(plotm.get());
         plotm->setXLabel("r (nm)");
         plotm->setYLabel("number");
-        for (size_t i = 0; i < sel_.size(); ++i)
-        {
-            plotm->appendLegend(sel_[i].name());
-        }
         cumulativeRdf->addModule(plotm);
     }
 }
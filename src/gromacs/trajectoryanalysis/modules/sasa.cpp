@@ -289,6 +289,7 @@ class Sasa : public TrajectoryAnalysisModule
 
         virtual void initOptions(IOptionsContainer          *options,
                                  TrajectoryAnalysisSettings *settings);
+        virtual void optionsFinished(TrajectoryAnalysisSettings *settings);
         virtual void initAnalysis(const TrajectoryAnalysisSettings &settings,
                                   const TopologyInformation        &top);
 
@@ -492,6 +493,18 @@ Sasa::initOptions(IOptionsContainer *options, TrajectoryAnalysisSettings *settin
 
     // Atom names etc. are required for the VdW radii lookup.
     settings->setFlag(TrajectoryAnalysisSettings::efRequireTop);
+    settings->setFlag(TrajectoryAnalysisSettings::efParallelFrames);
+}
+
+void
+Sasa::optionsFinished(TrajectoryAnalysisSettings *settings)
+{
+    // The Connolly plot modifies the topology while analyzing the first
+    // frame, which cannot be done concurrently with other frames.
+    if (!fnConnolly_.empty())
+    {
+        settings->setFlag(TrajectoryAnalysisSettings::efParallelFrames, false);
+    }
 }
 
 void
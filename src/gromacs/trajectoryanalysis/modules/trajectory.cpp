@@ -152,6 +152,8 @@ Trajectory::initOptions(IOptionsContainer *options, TrajectoryAnalysisSettings *
     options->addOption(BooleanOption("len").store(&dimMask_[DIM])
                            .storeIsSet(&maskSet_[DIM])
                            .description("Plot vector length"));
+
+    settings->setFlag(TrajectoryAnalysisSettings::efParallelFrames);
 }
 
 
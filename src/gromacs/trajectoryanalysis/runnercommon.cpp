@@ -125,6 +125,8 @@ class TrajectoryAnalysisRunnerCommon::Impl : public ITopologyProvider
         bool                        bStartTimeSet_;
         bool                        bEndTimeSet_;
         bool                        bDeltaTimeSet_;
+        //! Number of threads for analyzing frames in parallel.
+        int                         threadCount_;
 
         bool                        bTrajOpen_;
         //! The current frame, or \p NULL if no frame loaded yet.
@@ -140,7 +142,7 @@ TrajectoryAnalysisRunnerCommon::Impl::Impl(TrajectoryAnalysisSettings *settings)
     : settings_(*settings),
       startTime_(0.0), endTime_(0.0), deltaTime_(0.0),
       bStartTimeSet_(false), bEndTimeSet_(false), bDeltaTimeSet_(false),
-      bTrajOpen_(false), fr(nullptr), gpbc_(nullptr), status_(nullptr), oenv_(nullptr)
+      threadCount_(1), bTrajOpen_(false), fr(nullptr), gpbc_(nullptr), status_(nullptr), oenv_(nullptr)
 {
 }
 
@@ -218,6 +220,8 @@ TrajectoryAnalysisRunnerCommon::Impl::initFirstFrame()
 
     int frflags = settings_.frflags();
     frflags |= TRX_NEED_X;
+    // Decode the next frames while the current one is analyzed.
+    frflags |= TRX_READ_AHEAD;
 
     snew(fr, 1);
 
@@ -389,6 +393,11 @@ TrajectoryAnalysisRunnerCommon::initOptions(IOptionsContainer *options,
         options->addOption(BooleanOption("pbc").store(&settings.impl_->bPBC)
                                .description("Use periodic boundary conditions for distance calculation"));
     }
+    if (settings.hasFlag(TrajectoryAnalysisSettings::efParallelFrames))
+    {
+        options->addOption(IntegerOption("nt").store(&impl_->threadCount_)
+                               .description("Number of threads for analyzing frames in parallel"));
+    }
 }
 
 
@@ -405,6 +414,11 @@ TrajectoryAnalysisRunnerCommon::optionsFinished()
         GMX_THROW(InconsistentInputError("-fgroup only makes sense together with a trajectory (-f)"));
     }
 
+    if (impl_->threadCount_ < 1)
+    {
+        GMX_THROW(InvalidInputError("-nt should be at least one"));
+    }
+
     impl_->settings_.impl_->plotSettings.setTimeUnit(impl_->settings_.timeUnit());
 
     if (impl_->bStartTimeSet_)
@@ -471,6 +485,13 @@ TrajectoryAnalysisRunnerCommon::initFrame()
 }
 
 
+int
+TrajectoryAnalysisRunnerCommon::threadCount() const
+{
+    return impl_->threadCount_;
+}
+
+
 bool
 TrajectoryAnalysisRunnerCommon::hasTrajectory() const
 {
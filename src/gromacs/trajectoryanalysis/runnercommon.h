@@ -118,6 +118,13 @@ class TrajectoryAnalysisRunnerCommon
          */
         void initFrame();
 
+        /*! \brief
+         * Returns the number of threads requested for analyzing frames.
+         *
+         * Always returns one if the module did not allow parallel analysis
+         * when the options were initialized.
+         */
+        int threadCount() const;
         //! Returns true if input data comes from a trajectory.
         bool hasTrajectory() const;
         //! Returns the topology information object.
@@ -43,8 +43,12 @@
 
 #include "gromacs/trajectoryanalysis/modules/distance.h"
 
+#include <string>
+
 #include <gtest/gtest.h>
 
+#include "gromacs/utility/stringutil.h"
+
 #include "testutils/cmdlinetest.h"
 
 #include "moduletest.h"
@@ -54,6 +58,33 @@ namespace
 
 using gmx::test::CommandLine;
 
+/*! \brief
+ * Returns a trajectory of \p frameCount frames in gro format, where the
+ * atoms of simple.gro move along different directions.
+ */
+std::string simpleTrajectory(int frameCount)
+{
+    const char *const names[3] = { "CB", "S1", "S2" };
+    const char *const resnames[5] = { "RA", "RB", "RA", "RC", "RD" };
+    const int         resnrs[5]   = { 2, 3, 4, 5, 1 };
+    std::string       contents;
+    for (int frame = 0; frame < frameCount; ++frame)
+    {
+        contents.append(gmx::formatString("Test system t= %d\n 15\n", frame));
+        for (int i = 0; i < 15; ++i)
+        {
+            const float x = 1 + i/4 + 0.1*frame*(i % 3 - 1);
+            const float y = 1 + i % 4 + 0.05*frame*(i % 4);
+            const float z = 0.02*frame*(i % 5);
+            contents.append(gmx::formatString("%5d%-5s%5s%5d%8.3f%8.3f%8.3f\n",
+                                              resnrs[i/3], resnames[i/3], names[i % 3],
+                                              i + 1, x, y, z));
+        }
+        contents.append("  10.00000  10.00000  10.00000\n");
+    }
+    return contents;
+}
+
 /********************************************************************
  * Tests for gmx::analysismodules::Distance.
  */
@@ -96,4 +127,32 @@ TEST_F(DistanceModuleTest, HandlesDynamicSelections)
     runTest(CommandLine(cmdline));
 }
 
+TEST_F(DistanceModuleTest, ComputesDistancesOverTrajectory)
+{
+    const char *const cmdline[] = {
+        "distance",
+        "-select", "atomname S1 S2", "atomname S1 S2 and res_cog x < 2.8",
+        "-len", "2", "-binw", "0.5"
+    };
+    setTopology("simple.gro");
+    setInputFileContents("-f", "gro", simpleTrajectory(8));
+    runTest(CommandLine(cmdline));
+}
+
+TEST_F(DistanceModuleTest, ComputesDistancesOverTrajectoryWithThreads)
+{
+    // The reference data is a copy of that for
+    // ComputesDistancesOverTrajectory: -nt is not added to cmdline, so
+    // that the command line in the reference data is also the same.
+    const char *const cmdline[] = {
+        "distance",
+        "-select", "atomname S1 S2", "atomname S1 S2 and res_cog x < 2.8",
+        "-len", "2", "-binw", "0.5"
+    };
+    setTopology("simple.gro");
+    setInputFileContents("-f", "gro", simpleTrajectory(8));
+    commandLine().addOption("-nt", 2);
+    runTest(CommandLine(cmdline));
+}
+
 } // namespace
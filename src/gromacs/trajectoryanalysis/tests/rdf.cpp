@@ -101,6 +101,20 @@ TEST_F(RdfModuleTest, CalculatesSurf)
     runTest(CommandLine(cmdline));
 }
 
+TEST_F(RdfModuleTest, CalculatesWithMultipleReferences)
+{
+    const char *const cmdline[] = {
+        "rdf",
+        "-bin", "0.05",
+        "-ref", "name OW", "name HW1",
+        "-sel", "name OW", "not name OW"
+    };
+    setTopology("spc216.gro");
+    setOutputFile("-o", ".xvg", NoTextMatch());
+    excludeDataset("pairdist");
+    runTest(CommandLine(cmdline));
+}
+
 TEST_F(RdfModuleTest, CalculatesXY)
 {
     const char *const cmdline[] = {
@@ -1723,9 +1723,11 @@ double gmx::do_md(FILE *fplog, t_commrec *cr, const gmx::MDLogger &mdlog,
         bExchanged = FALSE;
         if (bDoReplEx)
         {
+            wallcycle_start(wcycle, ewcREPLEX);
             bExchanged = replica_exchange(fplog, cr, repl_ex,
                                           state_global, enerd,
                                           state, step, t);
+            wallcycle_stop(wcycle, ewcREPLEX);
         }
 
         if ( (bExchanged || bNeedRepartition) && DOMAINDECOMP(cr) )
@@ -346,6 +346,8 @@ int Mdrunner::mainFunction(int argc, char *argv[])
           "Number of random exchanges to carry out each exchange interval (N^3 is one suggestion).  -nex zero or not specified gives neighbor replica exchange." },
         { "-reseed",  FALSE, etINT, {&replExParams.randomSeed},
           "Seed for replica exchange, -1 is generate a seed" },
+        { "-replexlambda", FALSE, etBOOL, {&replExParams.swapLambdaStates},
+          "With replica exchange in lambda, swap the lambda states instead of the coordinates" },
         { "-imdport",    FALSE, etINT, {&imdport},
           "HIDDENIMD listening port" },
         { "-imdwait",  FALSE, etBOOL, {&bIMDwait},
@@ -42,7 +42,9 @@
 #include "config.h"
 
 #include <math.h>
+#include <string.h>
 
+#include <algorithm>
 #include <random>
 
 #include "gromacs/domdec/domdec.h"
@@ -80,6 +82,8 @@ const char *erename[ereNR] = { "temperature", "lambda", "end_single_marker", "te
 typedef struct gmx_repl_ex
 {
     int       repl;        /* replica ID */
+    int       iparam;      /* replica ID whose parameters this simulation uses, equal to repl unless swapping lambda states */
+    gmx_bool  bSwapLambda; /* exchange lambda states instead of configurations */
     int       nrepl;       /* total number of replica */
     real      temp;        /* temperature */
     int       type;        /* replica exchange type from ere enum */
@@ -250,6 +254,59 @@ init_replica_exchange(FILE                            *fplog,
             gmx_fatal(FARGS, "delta_lambda is not zero");
         }
     }
+
+    re->iparam      = re->repl;
+    re->bSwapLambda = replExParams.swapLambdaStates;
+    if (re->bSwapLambda)
+    {
+        int *nuse;
+
+        if (re->type != ereLAMBDA)
+        {
+            gmx_fatal(FARGS, "Swapping lambda states is only supported with replica exchange in lambda only");
+        }
+        if (ir->bExpanded)
+        {
+            gmx_fatal(FARGS, "Swapping lambda states is not supported with expanded ensemble");
+        }
+        if (ir->fepvals->nstdhdl > 0)
+        {
+            /* The dH/dl and Delta H output is labeled with the initial
+             * lambda state only, so it can not follow a changing state.
+             */
+            gmx_fatal(FARGS, "Swapping lambda states requires nstdhdl = 0, since the free-energy output would mix lambda states");
+        }
+
+        /* After a restart init_fep_state has been set to the checkpointed
+         * lambda state, so the lambda states of the simulations are then
+         * a permutation of the increasing states of the run input files.
+         */
+        std::sort(re->q[ereLAMBDA], re->q[ereLAMBDA] + re->nrepl);
+        re->iparam = -1;
+        for (i = 0; i < re->nrepl; i++)
+        {
+            if (static_cast<int>(re->q[ereLAMBDA][i]) == state->fep_state)
+            {
+                re->iparam = i;
+            }
+        }
+        snew(nuse, re->nrepl);
+        if (re->iparam >= 0)
+        {
+            nuse[re->iparam] = 1;
+        }
+        gmx_sumi_sim(re->nrepl, nuse, ms);
+        for (i = 0; i < re->nrepl; i++)
+        {
+            if (nuse[i] != 1)
+            {
+                gmx_fatal(FARGS, "The lambda states of the simulations are not a permutation of the lambda states of the run input files");
+            }
+        }
+        sfree(nuse);
+        fprintf(fplog, "\nRepl  Swapping lambda states instead of coordinates, this simulation starts in lambda state %d\n", state->fep_state);
+    }
+
     if (re->bNPT)
     {
         snew(re->pres, re->nrepl);
@@ -434,125 +491,79 @@ init_replica_exchange(FILE                            *fplog,
     return re;
 }
 
-static void exchange_reals(const gmx_multisim_t gmx_unused *ms, int gmx_unused b, real *v, int n)
+static void exchange_state(const gmx_multisim_t gmx_unused *ms, int gmx_unused b, t_state *state)
 {
-    real *buf;
-    int   i;
+    /* When t_state changes, this code should be updated. */
+    int ngtc, nnhpres;
+    ngtc    = state->ngtc * state->nhchainlength;
+    nnhpres = state->nnhpres* state->nhchainlength;
 
-    if (v)
+    void        *field[] = {
+        state->box, state->box_rel, state->boxv,
+        &state->veta, &state->vol0,
+        state->svir_prev, state->fvir_prev, state->pres_prev,
+        state->nosehoover_xi.data(), state->nosehoover_vxi.data(),
+        state->nhpres_xi.data(), state->nhpres_vxi.data(),
+        state->therm_integral.data(), &state->baros_integral,
+        state->x.data(), state->v.data()
+    };
+    const size_t size[] = {
+        sizeof(matrix), sizeof(matrix), sizeof(matrix),
+        sizeof(real), sizeof(real),
+        sizeof(matrix), sizeof(matrix), sizeof(matrix),
+        ngtc*sizeof(double), ngtc*sizeof(double),
+        nnhpres*sizeof(double), nnhpres*sizeof(double),
+        state->ngtc*sizeof(double), sizeof(double),
+        state->natoms*sizeof(rvec), state->natoms*sizeof(rvec)
+    };
+    const int    nfield = sizeof(size)/sizeof(size[0]);
+    size_t       offset[nfield + 1];
+    char        *buf;
+    int          f;
+
+    offset[0] = 0;
+    for (f = 0; f < nfield; f++)
     {
-        snew(buf, n);
-#if GMX_MPI
-        /*
-           MPI_Sendrecv(v,  n*sizeof(real),MPI_BYTE,MSRANK(ms,b),0,
-           buf,n*sizeof(real),MPI_BYTE,MSRANK(ms,b),0,
-           ms->mpi_comm_masters,MPI_STATUS_IGNORE);
-         */
-        {
-            MPI_Request mpi_req;
-
-            MPI_Isend(v, n*sizeof(real), MPI_BYTE, MSRANK(ms, b), 0,
-                      ms->mpi_comm_masters, &mpi_req);
-            MPI_Recv(buf, n*sizeof(real), MPI_BYTE, MSRANK(ms, b), 0,
-                     ms->mpi_comm_masters, MPI_STATUS_IGNORE);
-            MPI_Wait(&mpi_req, MPI_STATUS_IGNORE);
-        }
-#endif
-        for (i = 0; i < n; i++)
-        {
-            v[i] = buf[i];
-        }
-        sfree(buf);
+        offset[f + 1] = offset[f] + (field[f] != nullptr ? size[f] : 0);
     }
-}
-
-
-static void exchange_doubles(const gmx_multisim_t gmx_unused *ms, int gmx_unused b, double *v, int n)
-{
-    double *buf;
-    int     i;
+    snew(buf, offset[nfield]);
 
-    if (v)
-    {
-        snew(buf, n);
 #if GMX_MPI
-        /*
-           MPI_Sendrecv(v,  n*sizeof(double),MPI_BYTE,MSRANK(ms,b),0,
-           buf,n*sizeof(double),MPI_BYTE,MSRANK(ms,b),0,
-           ms->mpi_comm_masters,MPI_STATUS_IGNORE);
+    {
+        /* Post all transfers at once, so the latencies of the different
+         * fields overlap, and wait for them only once.
          */
-        {
-            MPI_Request mpi_req;
+        MPI_Request mpi_req[2*nfield];
+        int         nreq = 0;
 
-            MPI_Isend(v, n*sizeof(double), MPI_BYTE, MSRANK(ms, b), 0,
-                      ms->mpi_comm_masters, &mpi_req);
-            MPI_Recv(buf, n*sizeof(double), MPI_BYTE, MSRANK(ms, b), 0,
-                     ms->mpi_comm_masters, MPI_STATUS_IGNORE);
-            MPI_Wait(&mpi_req, MPI_STATUS_IGNORE);
+        for (f = 0; f < nfield; f++)
+        {
+            if (offset[f + 1] > offset[f])
+            {
+                MPI_Irecv(buf + offset[f], size[f], MPI_BYTE, MSRANK(ms, b), f,
+                          ms->mpi_comm_masters, &mpi_req[nreq++]);
+            }
         }
-#endif
-        for (i = 0; i < n; i++)
+        for (f = 0; f < nfield; f++)
         {
-            v[i] = buf[i];
+            if (offset[f + 1] > offset[f])
+            {
+                MPI_Isend(field[f], size[f], MPI_BYTE, MSRANK(ms, b), f,
+                          ms->mpi_comm_masters, &mpi_req[nreq++]);
+            }
         }
-        sfree(buf);
+        MPI_Waitall(nreq, mpi_req, MPI_STATUSES_IGNORE);
     }
-}
-
-static void exchange_rvecs(const gmx_multisim_t gmx_unused *ms, int gmx_unused b, rvec *v, int n)
-{
-    rvec *buf;
-    int   i;
+#endif
 
-    if (v)
+    for (f = 0; f < nfield; f++)
     {
-        snew(buf, n);
-#if GMX_MPI
-        /*
-           MPI_Sendrecv(v[0],  n*sizeof(rvec),MPI_BYTE,MSRANK(ms,b),0,
-           buf[0],n*sizeof(rvec),MPI_BYTE,MSRANK(ms,b),0,
-           ms->mpi_comm_masters,MPI_STATUS_IGNORE);
-         */
-        {
-            MPI_Request mpi_req;
-
-            MPI_Isend(v[0], n*sizeof(rvec), MPI_BYTE, MSRANK(ms, b), 0,
-                      ms->mpi_comm_masters, &mpi_req);
-            MPI_Recv(buf[0], n*sizeof(rvec), MPI_BYTE, MSRANK(ms, b), 0,
-                     ms->mpi_comm_masters, MPI_STATUS_IGNORE);
-            MPI_Wait(&mpi_req, MPI_STATUS_IGNORE);
-        }
-#endif
-        for (i = 0; i < n; i++)
+        if (offset[f + 1] > offset[f])
         {
-            copy_rvec(buf[i], v[i]);
+            memcpy(field[f], buf + offset[f], size[f]);
         }
-        sfree(buf);
     }
-}
-
-static void exchange_state(const gmx_multisim_t *ms, int b, t_state *state)
-{
-    /* When t_state changes, this code should be updated. */
-    int ngtc, nnhpres;
-    ngtc    = state->ngtc * state->nhchainlength;
-    nnhpres = state->nnhpres* state->nhchainlength;
-    exchange_rvecs(ms, b, state->box, DIM);
-    exchange_rvecs(ms, b, state->box_rel, DIM);
-    exchange_rvecs(ms, b, state->boxv, DIM);
-    exchange_reals(ms, b, &(state->veta), 1);
-    exchange_reals(ms, b, &(state->vol0), 1);
-    exchange_rvecs(ms, b, state->svir_prev, DIM);
-    exchange_rvecs(ms, b, state->fvir_prev, DIM);
-    exchange_rvecs(ms, b, state->pres_prev, DIM);
-    exchange_doubles(ms, b, state->nosehoover_xi.data(), ngtc);
-    exchange_doubles(ms, b, state->nosehoover_vxi.data(), ngtc);
-    exchange_doubles(ms, b, state->nhpres_xi.data(), nnhpres);
-    exchange_doubles(ms, b, state->nhpres_vxi.data(), nnhpres);
-    exchange_doubles(ms, b, state->therm_integral.data(), state->ngtc);
-    exchange_doubles(ms, b, &state->baros_integral, 1);
-    exchange_rvecs(ms, b, as_rvec_array(state->x.data()), state->natoms);
-    exchange_rvecs(ms, b, as_rvec_array(state->v.data()), state->natoms);
+    sfree(buf);
 }
 
 static void copy_state_serial(const t_state *src, t_state *dest)
@@ -829,8 +840,8 @@ test_for_replica_exchange(FILE                 *fplog,
         {
             re->Vol[i] = 0;
         }
-        bVol               = TRUE;
-        re->Vol[re->repl]  = vol;
+        bVol                = TRUE;
+        re->Vol[re->iparam] = vol;
     }
     if ((re->type == ereTEMP || re->type == ereTL))
     {
@@ -838,8 +849,8 @@ test_for_replica_exchange(FILE                 *fplog,
         {
             re->Epot[i] = 0;
         }
-        bEpot              = TRUE;
-        re->Epot[re->repl] = enerd->term[F_EPOT];
+        bEpot                = TRUE;
+        re->Epot[re->iparam] = enerd->term[F_EPOT];
         /* temperatures of different states*/
         for (i = 0; i < re->nrepl; i++)
         {
@@ -868,7 +879,7 @@ test_for_replica_exchange(FILE                 *fplog,
         }
         for (i = 0; i < re->nrepl; i++)
         {
-            re->de[i][re->repl] = (enerd->enerpart_lambda[(int)re->q[ereLAMBDA][i]+1]-enerd->enerpart_lambda[0]);
+            re->de[i][re->iparam] = (enerd->enerpart_lambda[(int)re->q[ereLAMBDA][i]+1]-enerd->enerpart_lambda[0]);
         }
     }
 
@@ -982,7 +993,7 @@ test_for_replica_exchange(FILE                 *fplog,
             a = re->ind[i-1];
             b = re->ind[i];
 
-            bPrint = (re->repl == a || re->repl == b);
+            bPrint = (re->iparam == a || re->iparam == b);
             if (i % 2 == m)
             {
                 delta = calc_delta(fplog, bPrint, re, a, b, a, b);
@@ -1207,6 +1218,34 @@ prepare_to_do_exchange(struct gmx_repl_ex *re,
     }
 }
 
+/* Moves this simulation to the lambda state that the accepted exchanges
+ * assigned to its configuration and returns that lambda state.
+ * destinations[i] is the parameter index whose configuration ends up
+ * with the parameters of index i.
+ */
+static int swap_lambda_state(FILE *fplog, struct gmx_repl_ex *re)
+{
+    int i, iparam;
+
+    iparam = re->iparam;
+    for (i = 0; i < re->nrepl; i++)
+    {
+        if (re->destinations[i] == re->iparam)
+        {
+            iparam = i;
+        }
+    }
+    if (iparam != re->iparam)
+    {
+        fprintf(fplog, "Repl  lambda state %d -> %d\n",
+                static_cast<int>(re->q[ereLAMBDA][re->iparam]),
+                static_cast<int>(re->q[ereLAMBDA][iparam]));
+        re->iparam = iparam;
+    }
+
+    return static_cast<int>(re->q[ereLAMBDA][re->iparam]);
+}
+
 gmx_bool replica_exchange(FILE *fplog, const t_commrec *cr, struct gmx_repl_ex *re,
                           t_state *state, gmx_enerdata_t *enerd,
                           t_state *state_local, gmx_int64_t step, real time)
@@ -1220,12 +1259,21 @@ gmx_bool replica_exchange(FILE *fplog, const t_commrec *cr, struct gmx_repl_ex *
     /* Where each replica ends up after the exchange attempt(s). */
     /* The order in which multiple exchanges will occur. */
     gmx_bool bThisReplicaExchanged = FALSE;
+    /* The new lambda state when swapping lambda states, -1 otherwise */
+    int      fep_state = -1;
 
     if (MASTER(cr))
     {
         replica_id  = re->repl;
         test_for_replica_exchange(fplog, cr->ms, re, enerd, det(state_local->box), step, time);
-        prepare_to_do_exchange(re, replica_id, &maxswap, &bThisReplicaExchanged);
+        if (re->bSwapLambda)
+        {
+            fep_state = swap_lambda_state(fplog, re);
+        }
+        else
+        {
+            prepare_to_do_exchange(re, replica_id, &maxswap, &bThisReplicaExchanged);
+        }
     }
     /* Do intra-simulation broadcast so all processors belonging to
      * each simulation know whether they need to participate in
@@ -1236,9 +1284,23 @@ gmx_bool replica_exchange(FILE *fplog, const t_commrec *cr, struct gmx_repl_ex *
 #if GMX_MPI
         MPI_Bcast(&bThisReplicaExchanged, sizeof(gmx_bool), MPI_BYTE, MASTERRANK(cr),
                   cr->mpi_comm_mygroup);
+        MPI_Bcast(&fep_state, 1, MPI_INT, MASTERRANK(cr),
+                  cr->mpi_comm_mygroup);
 #endif
     }
 
+    if (fep_state >= 0)
+    {
+        /* Only the parameters moved, the configuration stays here.
+         * The lambdas are set from fep_state at the next step.
+         */
+        state_local->fep_state = fep_state;
+        if (MASTER(cr))
+        {
+            state->fep_state = fep_state;
+        }
+    }
+
     if (bThisReplicaExchanged)
     {
         /* Exchange the states */
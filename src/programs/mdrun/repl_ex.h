@@ -55,13 +55,15 @@ struct ReplicaExchangeParameters
     ReplicaExchangeParameters() :
         exchangeInterval(0),
         numExchanges(0),
-        randomSeed(-1)
+        randomSeed(-1),
+        swapLambdaStates(FALSE)
     {
     };
 
-    int exchangeInterval; /* Interval in steps at which to attempt exchanges, 0 means no replica exchange */
-    int numExchanges;     /* The number of exchanges to attempt at an exchange step */
-    int randomSeed;       /* The random seed, -1 means generate a seed */
+    int      exchangeInterval; /* Interval in steps at which to attempt exchanges, 0 means no replica exchange */
+    int      numExchanges;     /* The number of exchanges to attempt at an exchange step */
+    int      randomSeed;       /* The random seed, -1 means generate a seed */
+    gmx_bool swapLambdaStates; /* With lambda replica exchange, swap the lambda states instead of the coordinates */
 };
 
 /* Abstract type for replica exchange */
@@ -83,6 +85,8 @@ gmx_bool replica_exchange(FILE *fplog,
                           gmx_int64_t step, real time);
 /* Attempts replica exchange, should be called on all ranks.
  * Returns TRUE if this state has been exchanged.
+ * When swapping lambda states, only state->fep_state and
+ * state_local->fep_state are changed and FALSE is returned.
  * When running each replica in parallel,
  * this routine collects the state on the master rank before exchange.
  * With domain decomposition, the global state after exchange is stored
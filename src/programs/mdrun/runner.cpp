@@ -83,6 +83,7 @@
 #include "gromacs/mdlib/mdatoms.h"
 #include "gromacs/mdlib/mdrun.h"
 #include "gromacs/mdlib/minimize.h"
+#include "gromacs/mdlib/nb_verlet.h"
 #include "gromacs/mdlib/nbnxn_search.h"
 #include "gromacs/mdlib/qmmm.h"
 #include "gromacs/mdlib/sighandler.h"
@@ -234,6 +235,10 @@ static const int    nbnxnReferenceNstlist = 10;
 const int           nstlist_try[] = { 20, 25, 40 };
 //! Number of elements in the neighborsearch list trials.
 #define NNSTL  sizeof(nstlist_try)/sizeof(nstlist_try[0])
+//! The values to try when switching with dynamic pruning of the pair list
+const int           nstlist_try_prune[] = { 20, 25, 40, 50, 80, 100 };
+//! Number of elements in the neighborsearch list trials with dynamic pruning.
+#define NNSTL_PRUNE  sizeof(nstlist_try_prune)/sizeof(nstlist_try_prune[0])
 /* Increase nstlist until the non-bonded cost increases more than listfac_ok,
  * but never more than listfac_max.
  * A standard (protein+)water system at 300K with PME ewald_rtol=1e-5
@@ -258,6 +263,106 @@ static const float  nbnxn_knl_listfac_max   = 1.3;
 static const float  nbnxn_gpu_listfac_ok    = 1.20;
 //! Too high performance ratio beween force calc and neighbor searching
 static const float  nbnxn_gpu_listfac_max   = 1.30;
+/* CPU with dynamic pruning: the kernels use the pruned list, so the size
+ * of the outer list only affects the search and pruning cost.
+ */
+//! Max OK performance ratio beween force calc and neighbor searching
+static const float  nbnxn_prune_listfac_ok  = 1.25;
+//! Too high performance ratio beween force calc and neighbor searching
+static const float  nbnxn_prune_listfac_max = 1.35;
+/*! \brief The minimum number of steps between dynamic pruning of the pair list
+ *
+ * Pruning is cheap, but not free, so we do not want to prune every step.
+ */
+static const int    nbnxnDynamicPruningMinNstlist = 4;
+/*! \brief The maximum size of the pruned pair list relative to a list with zero buffer
+ *
+ * The default pruning interval is increased as long as the pruned list,
+ * which is used by the kernels, is at most this factor larger than
+ * a list without buffer.
+ */
+static const float  nbnxnDynamicPruningListfac = 1.10;
+
+/*! \brief Returns whether the setup allows dynamic pruning of CPU pair lists
+ *
+ * Dynamic pruning needs an estimate of the pair-list buffer, which is only
+ * available for dynamical integrators with a Verlet buffer tolerance,
+ * and it is not used for NVE, where we retain the user's list buffer.
+ * It can be disabled by setting the environment variable
+ * GMX_DISABLE_DYNAMICPRUNING.
+ */
+static bool supportsDynamicPairlistPruning(const t_inputrec *ir)
+{
+    return (EI_DYNAMICS(ir->eI) &&
+            ir->verletbuf_tol > 0 &&
+            !(EI_MD(ir->eI) && ir->etc == etcNO) &&
+            getenv("GMX_DISABLE_DYNAMICPRUNING") == nullptr);
+}
+
+/*! \brief Determines the dynamic pruning setup for an outer pair list
+ *
+ * Returns the pruning interval \p nstlistPrune and the inner list cut-off
+ * \p rlistInner for an outer list with lifetime \p nstlist and cut-off
+ * \p rlist. Returns false when pruning would not reduce the list used
+ * by the kernels. This is used both when choosing nstlist and when
+ * setting up the pruning, so the two always make the same decision.
+ */
+static bool getDynamicPairlistPruningSetup(t_inputrec       *ir,
+                                           const gmx_mtop_t *mtop,
+                                           matrix            box,
+                                           int               nstlist,
+                                           real              rlist,
+                                           int              *nstlistPrune,
+                                           real             *rlistInner)
+{
+    verletbuf_list_setup_t ls;
+    verletbuf_get_list_setup(true, false, &ls);
+
+    const real   rcut         = std::max(ir->rvdw, ir->rcoulomb);
+    const real   rlist_inc    = nbnxn_get_rlist_effective_inc(ls.cluster_size_j,
+                                                              mtop->natoms/det(box));
+    const int    nstlist_orig = ir->nstlist;
+
+    const char  *env = getenv("GMX_NSTLIST_DYNAMICPRUNING");
+    if (env != nullptr)
+    {
+        char *end;
+        *nstlistPrune = strtol(env, &end, 10);
+        if (!end || (*end != 0) || *nstlistPrune < 1)
+        {
+            gmx_fatal(FARGS, "Invalid value passed in GMX_NSTLIST_DYNAMICPRUNING=%s, a positive integer is required", env);
+        }
+        ir->nstlist = *nstlistPrune;
+        calc_verlet_buffer_size(mtop, det(box), ir, -1, &ls, nullptr, rlistInner);
+    }
+    else
+    {
+        /* Increase the pruning interval while the pruned list stays
+         * close in size to a list without buffer.
+         */
+        const real rlistInnerMax = (rcut + rlist_inc)*std::cbrt(nbnxnDynamicPruningListfac) - rlist_inc;
+
+        *nstlistPrune = nbnxnDynamicPruningMinNstlist;
+        ir->nstlist   = *nstlistPrune;
+        calc_verlet_buffer_size(mtop, det(box), ir, -1, &ls, nullptr, rlistInner);
+        while (*nstlistPrune + 1 < nstlist)
+        {
+            real rlistNext;
+
+            ir->nstlist = *nstlistPrune + 1;
+            calc_verlet_buffer_size(mtop, det(box), ir, -1, &ls, nullptr, &rlistNext);
+            if (rlistNext > rlistInnerMax)
+            {
+                break;
+            }
+            (*nstlistPrune)++;
+            *rlistInner = rlistNext;
+        }
+    }
+    ir->nstlist = nstlist_orig;
+
+    return (*nstlistPrune < nstlist && *rlistInner < rlist);
+}
 
 /*! \brief Try to increase nstlist when using the Verlet cut-off scheme */
 static void increase_nstlist(FILE *fp, t_commrec *cr,
@@ -266,12 +371,14 @@ static void increase_nstlist(FILE *fp, t_commrec *cr,
                              bool makeGpuPairList, const gmx::CpuInfo &cpuinfo)
 {
     float                  listfac_ok, listfac_max;
+    const int             *nstlist_try_set;
+    size_t                 nstlist_try_num;
     int                    nstlist_orig, nstlist_prev;
     verletbuf_list_setup_t ls;
     real                   rlistWithReferenceNstlist, rlist_inc, rlist_ok, rlist_max;
     real                   rlist_new, rlist_prev;
     size_t                 nstlist_ind = 0;
-    gmx_bool               bBox, bDD, bCont;
+    gmx_bool               bBox, bDD, bPrune, bCont;
     const char            *nstl_gpu = "\nFor optimal performance with a GPU nstlist (now %d) should be larger.\nThe optimum depends on your CPU and GPU resources.\nYou might want to try several nstlist values.\n";
     const char            *nve_err  = "Can not increase nstlist because an NVE ensemble is used";
     const char            *vbd_err  = "Can not increase nstlist because verlet-buffer-tolerance is not set or used";
@@ -279,6 +386,21 @@ static void increase_nstlist(FILE *fp, t_commrec *cr,
     const char            *dd_err   = "Can not increase nstlist because of domain decomposition limitations";
     char                   buf[STRLEN];
 
+    /* With dynamic pruning on the CPU the outer list can have a much
+     * longer lifetime, so we try larger nstlist values.
+     */
+    const bool useDynamicPruning = (!makeGpuPairList && supportsDynamicPairlistPruning(ir));
+    if (useDynamicPruning)
+    {
+        nstlist_try_set = nstlist_try_prune;
+        nstlist_try_num = NNSTL_PRUNE;
+    }
+    else
+    {
+        nstlist_try_set = nstlist_try;
+        nstlist_try_num = NNSTL;
+    }
+
     if (nstlist_cmdline <= 0)
     {
         if (ir->nstlist == 1)
@@ -289,16 +411,16 @@ static void increase_nstlist(FILE *fp, t_commrec *cr,
             return;
         }
 
-        if (fp != nullptr && makeGpuPairList && ir->nstlist < nstlist_try[0])
+        if (fp != nullptr && makeGpuPairList && ir->nstlist < nstlist_try_set[0])
         {
             fprintf(fp, nstl_gpu, ir->nstlist);
         }
         nstlist_ind = 0;
-        while (nstlist_ind < NNSTL && ir->nstlist >= nstlist_try[nstlist_ind])
+        while (nstlist_ind < nstlist_try_num && ir->nstlist >= nstlist_try_set[nstlist_ind])
         {
             nstlist_ind++;
         }
-        if (nstlist_ind == NNSTL)
+        if (nstlist_ind == nstlist_try_num)
         {
             /* There are no larger nstlist value to try */
             return;
@@ -343,6 +465,11 @@ static void increase_nstlist(FILE *fp, t_commrec *cr,
         listfac_ok  = nbnxn_gpu_listfac_ok;
         listfac_max = nbnxn_gpu_listfac_max;
     }
+    else if (useDynamicPruning)
+    {
+        listfac_ok  = nbnxn_prune_listfac_ok;
+        listfac_max = nbnxn_prune_listfac_max;
+    }
     else if (cpuinfo.feature(gmx::CpuInfo::Feature::X86_Avx512ER))
     {
         listfac_ok  = nbnxn_knl_listfac_ok;
@@ -393,7 +520,7 @@ static void increase_nstlist(FILE *fp, t_commrec *cr,
     {
         if (nstlist_cmdline <= 0)
         {
-            ir->nstlist = nstlist_try[nstlist_ind];
+            ir->nstlist = nstlist_try_set[nstlist_ind];
         }
 
         /* Set the pair-list buffer size in ir */
@@ -414,22 +541,35 @@ static void increase_nstlist(FILE *fp, t_commrec *cr,
             bDD = change_dd_cutoff(cr, &state_tmp, ir, rlist_new);
         }
 
+        /* The larger nstlist values and list size factors with pruning
+         * are only allowed when the pruning setup will use pruning.
+         */
+        bPrune = TRUE;
+        if (useDynamicPruning && nstlist_cmdline <= 0)
+        {
+            int  nstlistPrune;
+            real rlistInner;
+
+            bPrune = getDynamicPairlistPruningSetup(ir, mtop, box, ir->nstlist, rlist_new,
+                                                    &nstlistPrune, &rlistInner);
+        }
+
         if (debug)
         {
-            fprintf(debug, "nstlist %d rlist %.3f bBox %d bDD %d\n",
-                    ir->nstlist, rlist_new, bBox, bDD);
+            fprintf(debug, "nstlist %d rlist %.3f bBox %d bDD %d bPrune %d\n",
+                    ir->nstlist, rlist_new, bBox, bDD, bPrune);
         }
 
         bCont = FALSE;
 
         if (nstlist_cmdline <= 0)
         {
-            if (bBox && bDD && rlist_new <= rlist_max)
+            if (bBox && bDD && bPrune && rlist_new <= rlist_max)
             {
                 /* Increase nstlist */
                 nstlist_prev = ir->nstlist;
                 rlist_prev   = rlist_new;
-                bCont        = (nstlist_ind+1 < NNSTL && rlist_new < rlist_ok);
+                bCont        = (nstlist_ind+1 < nstlist_try_num && rlist_new < rlist_ok);
             }
             else
             {
@@ -523,6 +663,59 @@ static void prepare_verlet_scheme(FILE                           *fplog,
     }
 }
 
+/*! \brief Set up dynamic pruning of the CPU pair lists
+ *
+ * With dynamic pruning, the pair search produces an outer list with
+ * buffer rlist for a lifetime of nstlist steps, which is pruned every
+ * nstlistPrune steps to an inner list with a smaller buffer, which
+ * is used by the kernels. This is only used with CPU kernels.
+ */
+static void setup_dynamic_pairlist_pruning(FILE               *fplog,
+                                           t_inputrec         *ir,
+                                           const gmx_mtop_t   *mtop,
+                                           matrix              box,
+                                           nonbonded_verlet_t *nbv)
+{
+    if (!supportsDynamicPairlistPruning(ir) || nbv->bUseGPU || nbv->emulateGpu)
+    {
+        return;
+    }
+    for (int i = 0; i < nbv->ngrp; i++)
+    {
+        if (!nbnxn_kernel_pairlist_simple(nbv->grp[i].kernel_type))
+        {
+            return;
+        }
+    }
+
+    int  nstlistPrune;
+    real rlistInner;
+    if (!getDynamicPairlistPruningSetup(ir, mtop, box, ir->nstlist, ir->rlist,
+                                        &nstlistPrune, &rlistInner))
+    {
+        /* Pruning would not reduce the list used by the kernels */
+        return;
+    }
+
+    nbv->useDynamicPruning = true;
+    nbv->rlistInner        = rlistInner;
+    nbv->nstlistPrune      = nstlistPrune;
+
+    if (fplog != nullptr)
+    {
+        verletbuf_list_setup_t ls;
+        verletbuf_get_list_setup(true, false, &ls);
+        const real             rcut = std::max(ir->rvdw, ir->rcoulomb);
+
+        fprintf(fplog, "Using a dual %dx%d pair-list setup updated with dynamic pruning:\n",
+                ls.cluster_size_i, ls.cluster_size_j);
+        fprintf(fplog, "  outer list: updated every %3d steps, buffer %.3f nm, rlist %.3f nm\n",
+                ir->nstlist, ir->rlist - rcut, ir->rlist);
+        fprintf(fplog, "  inner list: updated every %3d steps, buffer %.3f nm, rlist %.3f nm\n\n",
+                nstlistPrune, rlistInner - rcut, rlistInner);
+    }
+}
+
 /*! \brief Override the nslist value in inputrec
  *
  * with value passed on the command line (if any)
@@ -1199,6 +1392,11 @@ int Mdrunner::mdrunner()
                       FALSE,
                       pforce);
 
+        if (fr->cutoff_scheme == ecutsVERLET)
+        {
+            setup_dynamic_pairlist_pruning(fplog, inputrec, mtop, box, fr->nbv);
+        }
+
         /* Initialize QM-MM */
         if (fr->bQMMM)
         {
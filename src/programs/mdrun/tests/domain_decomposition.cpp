@@ -42,10 +42,19 @@
  */
 #include "gmxpre.h"
 
+#include "config.h"
+
+#include <cstdlib>
+
 #include <string>
 
 #include <gtest/gtest.h>
 
+#include "gromacs/utility/gmxassert.h"
+#include "gromacs/utility/real.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textwriter.h"
+
 #include "testutils/cmdlinetest.h"
 
 #include "moduletest.h"
@@ -74,4 +83,152 @@ TEST_F(DomainDecompositionSpecialCasesTest, AnEmptyDomainWorks)
     ASSERT_EQ(0, runner_.callMdrun());
 }
 
+/*! \brief Runs with dynamic load balancing on the steps without search
+ *
+ * On these steps the first halo communication pulse overlaps with
+ * the local non-bonded work and the load balancing region is closed
+ * while waiting for the halo, which should pair up correctly with
+ * opening and closing the region elsewhere in the step.
+ */
+TEST_F(DomainDecompositionSpecialCasesTest, HaloOverlapWorksWithDynamicLoadBalancing)
+{
+    runner_.useStringAsMdpFile("cutoff-scheme = Verlet\n"
+                               "nsteps = 20\n"
+                               "nstlist = 10\n"
+                               "nstcalcenergy = 5\n");
+    runner_.useTopGroAndNdxFromDatabase("argon5832");
+    ASSERT_EQ(0, runner_.callGrompp());
+
+    gmx::test::CommandLine caller;
+    caller.addOption("-dlb", "yes");
+    ASSERT_EQ(0, runner_.callMdrun(caller));
+}
+
+//! Sets or unsets environment variable \p name.
+void setEnvironmentVariable(const char *name, bool set)
+{
+#if GMX_NATIVE_WINDOWS
+    _putenv_s(name, set ? "1" : "");
+#else
+    if (set)
+    {
+        GMX_RELEASE_ASSERT(setenv(name, "1", 1) == 0,
+                           "Could not set environment variable");
+    }
+    else
+    {
+        unsetenv(name);
+    }
+#endif
+}
+
+//! Topology with united-atom butanes, the number of molecules is set with formatString
+const char *g_butanesTopFileFormatString = "\
+[ defaults ]\n\
+  1  1  no  1.0  1.0\n\
+\n\
+[ atomtypes ]\n\
+  CH2    14.02700       0.000       A   0.90975E-02   0.35333E-04\n\
+  CH3    15.03500       0.000       A   0.88765E-02   0.26150E-04\n\
+\n\
+[ moleculetype ]\n\
+  butane   3\n\
+\n\
+[ atoms ]\n\
+     1     CH3       1     BUT      C1       1\n\
+     2     CH2       1     BUT      C2       2\n\
+     3     CH2       1     BUT      C3       3\n\
+     4     CH3       1     BUT      C4       4\n\
+\n\
+[ bonds ]\n\
+    1     2     1 1.530000e-01 3.347000e+05\n\
+    2     3     1 1.530000e-01 3.347000e+05\n\
+    3     4     1 1.530000e-01 3.347000e+05\n\
+\n\
+[ angles ]\n\
+    1     2     3     1 1.110000e+02 4.602000e+02\n\
+    2     3     4     1 1.110000e+02 4.602000e+02\n\
+\n\
+[ dihedrals ]\n\
+    1     2     3     4     3 9.2789 12.156 -13.120 -3.0597 26.240 -31.495\n\
+\n\
+[ system ]\n\
+Butanes\n\
+\n\
+[ molecules ]\n\
+butane   %d\n\
+";
+
+/*! \brief Checks incremental updates of the local topology against full assignments
+ *
+ * The cells are large enough for the bonded interactions to be assigned
+ * without distance checks, so the local topology is updated incrementally
+ * at repartitioning. With GMX_DD_CHECK_INCREMENTAL_TOP set, mdrun also
+ * assigns all bonded interactions from scratch and stops with a fatal
+ * error when the (order-insensitive) interaction lists differ.
+ */
+TEST_F(DomainDecompositionSpecialCasesTest, IncrementalLocalTopologyMatchesFullAssignment)
+{
+    /* A lattice of butanes, elongated along x so that x is decomposed */
+    const int    nx = 8, ny = 4, nz = 4;
+    const real   spacing = 0.6;
+    const real   butane[4][3] = {
+        { 0.000,  0.000, 0.000 }, { -0.101, -0.014, 0.114 },
+        { -0.090, -0.151, 0.181 }, { -0.193, -0.166, 0.293 }
+    };
+    const char  *names[4]  = { "C1", "C2", "C3", "C4" };
+    const int    nmol      = nx*ny*nz;
+    std::string  gro       = gmx::formatString("Butanes\n%5d\n", 4*nmol);
+    std::string  ndx       = "[ System ]\n";
+    int          atom      = 0;
+    for (int mol = 0; mol < nmol; mol++)
+    {
+        const real offset[3] = {
+            (mol % nx + 0.5f)*spacing,
+            (mol/nx % ny + 0.5f)*spacing,
+            (mol/(nx*ny) + 0.5f)*spacing
+        };
+        for (int a = 0; a < 4; a++)
+        {
+            atom++;
+            gro += gmx::formatString("%5d%-5s%5s%5d%8.3f%8.3f%8.3f\n",
+                                     mol + 1, "BUT", names[a], atom % 100000,
+                                     offset[0] + butane[a][0],
+                                     offset[1] + butane[a][1],
+                                     offset[2] + butane[a][2]);
+            ndx += gmx::formatString("%d\n", atom);
+        }
+    }
+    gro += gmx::formatString("%10.5f%10.5f%10.5f\n",
+                             nx*spacing, ny*spacing, nz*spacing);
+
+    runner_.topFileName_ = fileManager_.getTemporaryFilePath("butanes.top");
+    gmx::TextWriter::writeFileFromString(runner_.topFileName_,
+                                         gmx::formatString(g_butanesTopFileFormatString, nmol));
+    runner_.groFileName_ = fileManager_.getTemporaryFilePath("butanes.gro");
+    gmx::TextWriter::writeFileFromString(runner_.groFileName_, gro);
+    runner_.ndxFileName_ = fileManager_.getTemporaryFilePath("butanes.ndx");
+    runner_.useStringAsNdxFile(ndx.c_str());
+    /* Twice the cut-off fits in the 2.4 nm cells of two domains along x */
+    runner_.useStringAsMdpFile("cutoff-scheme = Verlet\n"
+                               "verlet-buffer-tolerance = -1\n"
+                               "rlist = 0.9\n"
+                               "rvdw = 0.9\n"
+                               "rcoulomb = 0.9\n"
+                               "nsteps = 500\n"
+                               "nstlist = 10\n"
+                               "dt = 0.002\n"
+                               "gen-vel = yes\n"
+                               "gen-temp = 1000\n"
+                               "gen-seed = 1234\n");
+    ASSERT_EQ(0, runner_.callGrompp());
+
+    setEnvironmentVariable("GMX_DD_INCREMENTAL_TOP", true);
+    setEnvironmentVariable("GMX_DD_CHECK_INCREMENTAL_TOP", true);
+    int result = runner_.callMdrun();
+    setEnvironmentVariable("GMX_DD_INCREMENTAL_TOP", false);
+    setEnvironmentVariable("GMX_DD_CHECK_INCREMENTAL_TOP", false);
+    ASSERT_EQ(0, result);
+}
+
 } // namespace
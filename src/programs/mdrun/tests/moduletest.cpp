@@ -233,7 +233,10 @@ SimulationRunner::callMdrun(const CommandLine &callerRef)
     }
 
 #if GMX_THREAD_MPI
-    caller.addOption("-ntmpi", getNumberOfTestMpiRanks());
+    if (!callerRef.contains("-ntmpi"))
+    {
+        caller.addOption("-ntmpi", getNumberOfTestMpiRanks());
+    }
 #endif
 
 #if GMX_OPENMP
@@ -110,7 +110,10 @@ class SimulationRunner
         int callGromppOnThisRank(const CommandLine &callerRef);
         //! Convenience wrapper for a default call to \c callGromppOnThisRank
         int callGromppOnThisRank();
-        //! Calls mdrun for testing with a customized command line
+        /*! \brief Calls mdrun for testing with a customized command line
+         *
+         * With thread-MPI, -ntmpi in \p callerRef overrides the number
+         * of ranks used for the tests. */
         int callMdrun(const CommandLine &callerRef);
         /*! \brief Convenience wrapper for calling mdrun for testing
          * with default command line */
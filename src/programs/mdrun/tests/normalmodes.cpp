@@ -0,0 +1,256 @@
+/*
+ * This file is part of the GROMACS molecular simulation package.
+ *
+ * Copyright (c) 2017, by the GROMACS development team, led by
+ * Mark Abraham, David van der Spoel, Berk Hess, and Erik Lindahl,
+ * and including many others, as listed in the AUTHORS file in the
+ * top-level source directory and at http://www.gromacs.org.
+ *
+ * GROMACS is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public License
+ * as published by the Free Software Foundation; either version 2.1
+ * of the License, or (at your option) any later version.
+ *
+ * GROMACS is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with GROMACS; if not, see
+ * http://www.gnu.org/licenses, or write to the Free Software Foundation,
+ * Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301  USA.
+ *
+ * If you want to redistribute modifications to GROMACS, please
+ * consider that scientific software is very special. Version
+ * control is crucial - bugs must be traceable. We will be happy to
+ * consider code for inclusion in the official distribution, but
+ * derived work must not be called official GROMACS. Details are found
+ * in the README & COPYING files - if they are missing, get the
+ * official version at http://www.gromacs.org.
+ *
+ * To help us fund GROMACS development, we humbly ask that you cite
+ * the research papers on the package. Check out http://www.gromacs.org.
+ */
+/*! \internal \file
+ * \brief
+ * Tests that normal-mode analysis distributed over ranks, also with
+ * frozen degrees of freedom, gives the same Hessian as a single rank.
+ *
+ * \ingroup module_mdrun_integration_tests
+ */
+#include "gmxpre.h"
+
+#include "config.h"
+
+#include <cmath>
+
+#include <algorithm>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "gromacs/fileio/mtxio.h"
+#include "gromacs/linearalgebra/sparsematrix.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/utility/smalloc.h"
+#include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textwriter.h"
+
+#include "testutils/cmdlinetest.h"
+#include "testutils/testasserts.h"
+
+#include "moduletest.h"
+
+namespace
+{
+
+//! Number of argon atoms along each dimension of the lattice
+const int c_latticeSize = 3;
+//! Number of argon atoms in the system
+const int c_atomCount   = c_latticeSize*c_latticeSize*c_latticeSize;
+
+//! Topology for c_atomCount argon atoms
+const char *g_argonTopFileString = "\
+[ defaults ]\n\
+  1  3\n\
+\n\
+[ atomtypes ]\n\
+  AR  AR  39.948  0.0  A  0.3345  1.045128\n\
+\n\
+[ moleculetype ]\n\
+  Argon  1\n\
+\n\
+[ atoms ]\n\
+  1  AR  1  AR  AR  1  0\n\
+\n\
+[ system ]\n\
+  Argon\n\
+\n\
+[ molecules ]\n\
+  Argon  27\n";
+
+/*! \brief
+ * Test fixture for normal-mode analysis of a slightly distorted
+ * lattice of argon atoms.
+ */
+class NormalModesTest : public gmx::test::MdrunTestFixture
+{
+    public:
+        NormalModesTest()
+        {
+            std::string gro = gmx::formatString("Argon lattice\n%5d\n", c_atomCount);
+            for (int i = 0; i < c_atomCount; i++)
+            {
+                const int index[3] = {
+                    i % c_latticeSize, i/c_latticeSize % c_latticeSize, i/(c_latticeSize*c_latticeSize)
+                };
+                real      x[3];
+                for (int d = 0; d < 3; d++)
+                {
+                    /* Distort the lattice to avoid symmetric forces */
+                    x[d] = 0.5 + 0.38*index[d] + 0.01*((i*(d + 2)) % 5 - 2);
+                }
+                gro += gmx::formatString("%5d%-5s%5s%5d%8.3f%8.3f%8.3f\n",
+                                         i + 1, "AR", "AR", i + 1, x[0], x[1], x[2]);
+            }
+            gro += "   3.00000   3.00000   3.00000\n";
+
+            runner_.topFileName_ = fileManager_.getTemporaryFilePath("argon.top");
+            gmx::TextWriter::writeFileFromString(runner_.topFileName_, g_argonTopFileString);
+            runner_.groFileName_ = fileManager_.getTemporaryFilePath("argon.gro");
+            gmx::TextWriter::writeFileFromString(runner_.groFileName_, gro);
+            runner_.ndxFileName_ = fileManager_.getTemporaryFilePath("argon.ndx");
+            runner_.useStringAsNdxFile("[ System ]\n"
+                                       "1 2 3 4 5 6 7 8 9 10 11 12 13 14 15 16 17 18 19 20 21 22 23 24 25 26 27\n"
+                                       "[ Frozen ]\n"
+                                       "1 5 9 14\n"
+                                       "[ FrozenZ ]\n"
+                                       "2 20 27\n");
+        }
+
+        //! Runs grompp with normal-mode analysis and \p mdpExtra in the mdp file.
+        void prepare(const char *mdpExtra)
+        {
+            runner_.useStringAsMdpFile(std::string("integrator = nm\n"
+                                                   "cutoff-scheme = Verlet\n"
+                                                   "verlet-buffer-tolerance = -1\n"
+                                                   "rlist = 0.9\n"
+                                                   "rvdw = 0.9\n"
+                                                   "rcoulomb = 0.9\n") + mdpExtra);
+            ASSERT_EQ(0, runner_.callGrompp());
+        }
+
+        /*! \brief
+         * Runs mdrun with \p rankCount ranks, or the number of test ranks
+         * when \p rankCount is zero, and returns the Hessian.
+         */
+        std::vector<real> runNormalModes(const char *name, int rankCount)
+        {
+            const std::string      mtxFile = fileManager_.getTemporaryFilePath(name);
+            gmx::test::CommandLine caller;
+            caller.addOption("-mtx", mtxFile);
+            if (rankCount > 0)
+            {
+                caller.addOption("-ntmpi", rankCount);
+            }
+            EXPECT_EQ(0, runner_.callMdrun(caller));
+
+            int                     nrow, ncol;
+            real                   *fullMatrix   = nullptr;
+            gmx_sparsematrix_t     *sparseMatrix = nullptr;
+            gmx_mtxio_read(mtxFile.c_str(), &nrow, &ncol, &fullMatrix, &sparseMatrix);
+            EXPECT_EQ(c_atomCount*DIM, nrow);
+            EXPECT_EQ(c_atomCount*DIM, ncol);
+            EXPECT_EQ(nullptr, sparseMatrix);
+            std::vector<real>       hessian;
+            if (fullMatrix != nullptr)
+            {
+                hessian.assign(fullMatrix, fullMatrix + nrow*ncol);
+                sfree(fullMatrix);
+            }
+
+            return hessian;
+        }
+};
+
+//! Checks that the Hessians \p reference and \p test are the same.
+void checkHessian(const std::vector<real> &reference, const std::vector<real> &test)
+{
+    ASSERT_EQ(reference.size(), test.size());
+    real scale = 0;
+    for (real h : reference)
+    {
+        scale = std::max(scale, std::abs(h));
+    }
+    for (size_t i = 0; i < reference.size(); i++)
+    {
+        EXPECT_REAL_EQ_TOL(reference[i], test[i],
+                           gmx::test::relativeToleranceAsFloatingPoint(scale, 1e-5))
+        << "element " << i;
+    }
+}
+
+/* The reference runs on a single rank need -ntmpi, so these tests only
+ * check something with thread-MPI.
+ */
+TEST_F(NormalModesTest, RanksGiveSameHessianAsSingleRank)
+{
+#if GMX_THREAD_MPI
+    ASSERT_NO_FATAL_FAILURE(prepare(""));
+
+    std::vector<real> hessian1 = runNormalModes("single.mtx", 1);
+    std::vector<real> hessian  = runNormalModes("ranks.mtx", 0);
+    checkHessian(hessian1, hessian);
+#endif
+}
+
+TEST_F(NormalModesTest, RanksGiveSameHessianAsSingleRankWithFrozenAtoms)
+{
+#if GMX_THREAD_MPI
+    const int frozenAtoms[]  = { 0, 4, 8, 13 };
+    const int frozenZAtoms[] = { 1, 19, 26 };
+
+    ASSERT_NO_FATAL_FAILURE(prepare(""));
+    std::vector<real> hessianFree = runNormalModes("free.mtx", 1);
+
+    ASSERT_NO_FATAL_FAILURE(prepare("freezegrps = Frozen FrozenZ\n"
+                                    "freezedim = Y Y Y N N Y\n"));
+    std::vector<real> hessian1 = runNormalModes("single.mtx", 1);
+    std::vector<real> hessian  = runNormalModes("ranks.mtx", 0);
+    checkHessian(hessian1, hessian);
+
+    /* The rows and columns of frozen degrees of freedom are zero, the
+     * other elements match the Hessian without frozen atoms.
+     */
+    std::vector<bool> frozen(c_atomCount*DIM, false);
+    for (int a : frozenAtoms)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            frozen[a*DIM + d] = true;
+        }
+    }
+    for (int a : frozenZAtoms)
+    {
+        frozen[a*DIM + ZZ] = true;
+    }
+    ASSERT_EQ(hessianFree.size(), hessian1.size());
+    std::vector<real> expected(hessianFree);
+    const int         n = c_atomCount*DIM;
+    for (int i = 0; i < n; i++)
+    {
+        for (int j = 0; j < n; j++)
+        {
+            if (frozen[i] || frozen[j])
+            {
+                expected[i*n + j] = 0;
+            }
+        }
+    }
+    checkHessian(expected, hessian1);
+#endif
+}
+
+} // namespace
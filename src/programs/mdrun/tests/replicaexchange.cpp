@@ -44,11 +44,22 @@
 
 #include "config.h"
 
+#include <cstdio>
+
+#include <string>
+#include <vector>
+
 #include <gtest/gtest.h>
 
+#include "gromacs/fileio/confio.h"
+#include "gromacs/math/vectypes.h"
+#include "gromacs/topology/topology.h"
 #include "gromacs/utility/path.h"
+#include "gromacs/utility/smalloc.h"
 #include "gromacs/utility/stringutil.h"
+#include "gromacs/utility/textreader.h"
 
+#include "testutils/testasserts.h"
 #include "testutils/testfilemanager.h"
 
 #include "multisimtest.h"
@@ -67,6 +78,154 @@ TEST_P(ReplicaExchangeEnsembleTest, ExitsNormally)
     runExitsNormallyTest();
 }
 
+//! Returns the lines of the log file \p logFileName that describe exchanges.
+std::vector<std::string> readExchangeLines(const std::string &logFileName)
+{
+    TextReader               reader(logFileName);
+    std::string              line;
+    std::vector<std::string> lines;
+    while (reader.readLine(&line))
+    {
+        if (startsWith(line, "Repl ex") || startsWith(line, "Repl pr"))
+        {
+            lines.push_back(line);
+        }
+    }
+    return lines;
+}
+
+/*! \brief Returns the lambda state that a simulation run with
+ * -replexlambda ends in, starting from \p lambdaState, according to
+ * its log file \p logFileName.
+ */
+int readFinalLambdaState(const std::string &logFileName, int lambdaState)
+{
+    TextReader  reader(logFileName);
+    std::string line;
+    while (reader.readLine(&line))
+    {
+        int from, to;
+        if (std::sscanf(line.c_str(), "Repl  lambda state %d -> %d", &from, &to) == 2)
+        {
+            EXPECT_EQ(lambdaState, from);
+            lambdaState = to;
+        }
+    }
+    return lambdaState;
+}
+
+//! Returns the coordinates in the configuration file \p confFileName.
+std::vector<RVec> readCoordinates(const std::string &confFileName)
+{
+    t_topology        top;
+    int               ePBC;
+    rvec             *x = nullptr;
+    matrix            box;
+    read_tps_conf(confFileName.c_str(), &top, &ePBC, &x, nullptr, box, FALSE);
+    std::vector<RVec> coordinates(x, x + top.atoms.nr);
+    sfree(x);
+    done_top(&top);
+    return coordinates;
+}
+
+/* Swapping the lambda states of the simulations instead of their
+ * coordinates should give the same exchanges, and the configuration
+ * of each simulation should end up at the lambda state of the
+ * simulation that ends with the same configuration when exchanging
+ * coordinates.
+ */
+TEST_P(ReplicaExchangeEnsembleTest, SwappingLambdaStatesMatchesExchangingCoordinates)
+{
+    if (size_ <= 1)
+    {
+        /* Can't test replica exchange without multiple ranks. */
+        return;
+    }
+
+    std::string lambdas;
+    for (int i = 0; i < size_; i++)
+    {
+        lambdas += formatString(" %g", 0.05*i);
+    }
+    runner_.useStringAsMdpFile(formatString("nsteps = 20\n"
+                                            "nstcalcenergy = 1\n"
+                                            "tcoupl = v-rescale\n"
+                                            "tc-grps = System\n"
+                                            "tau-t = 0.1\n"
+                                            "ref-t = 298\n"
+                                            "tau-p = 1\n"
+                                            "ref-p = 1\n"
+                                            "compressibility = 4.5e-5\n"
+                                            "%s\n"
+                                            "ld-seed = 1234\n"
+                                            "gen-vel = yes\n"
+                                            "gen-temp = 298\n"
+                                            "gen-seed = %d\n"
+                                            "free-energy = yes\n"
+                                            "couple-moltype = SOL\n"
+                                            "couple-lambda0 = vdw-q\n"
+                                            "couple-lambda1 = none\n"
+                                            "couple-intramol = no\n"
+                                            "sc-alpha = 0.5\n"
+                                            "fep-lambdas =%s\n"
+                                            "init-lambda-state = %d\n"
+                                            "calc-lambda-neighbors = -1\n"
+                                            "nstdhdl = 0\n",
+                                            GetParam(), 1000 + rank_, lambdas.c_str(), rank_));
+    EXPECT_EQ(0, runner_.callGromppOnThisRank());
+
+    // mdrun names the files without the rank suffix
+    runner_.tprFileName_ = mdrunTprFileName_;
+    const std::string rankSuffix = formatString("%d", rank_);
+    std::string       logFileName[2], confFileName[2];
+    for (int swapLambda = 0; swapLambda < 2; swapLambda++)
+    {
+        const char *name = (swapLambda ? "swaplambda" : "swapcoords");
+        runner_.logFileName_     = fileManager_.getTemporaryFilePath(formatString("%s.log", name));
+        logFileName[swapLambda]  = Path::concatenateBeforeExtension(runner_.logFileName_, rankSuffix);
+        const std::string conf   = fileManager_.getTemporaryFilePath(formatString("%s.gro", name));
+        confFileName[swapLambda] = conf;
+
+        CommandLine caller(*mdrunCaller_);
+        caller.addOption("-replex", 4);
+        caller.addOption("-reseed", 5678);
+        // Search every step, so both runs sum the forces in the same order
+        caller.addOption("-nstlist", 1);
+        caller.addOption("-c", conf);
+        if (swapLambda)
+        {
+            caller.append("-replexlambda");
+        }
+        ASSERT_EQ(0, runner_.callMdrun(caller));
+    }
+
+    /* The exchange probabilities and the accepted exchanges are the same */
+    std::vector<std::string> exchangeLines = readExchangeLines(logFileName[0]);
+    EXPECT_FALSE(exchangeLines.empty());
+    EXPECT_EQ(exchangeLines, readExchangeLines(logFileName[1]));
+
+    /* The configuration that this simulation holds at the end of the
+     * lambda swapping run is that of the simulation at its final lambda
+     * state in the coordinate exchange run. Each simulation in that run
+     * has finished writing its configuration, because all of them took
+     * part in the exchanges of the second run.
+     */
+    const int         lambdaState = readFinalLambdaState(logFileName[1], rank_);
+    std::vector<RVec> swapLambdaX = readCoordinates(
+                Path::concatenateBeforeExtension(confFileName[1], rankSuffix));
+    std::vector<RVec> swapCoordsX = readCoordinates(
+                Path::concatenateBeforeExtension(confFileName[0], formatString("%d", lambdaState)));
+    ASSERT_EQ(swapCoordsX.size(), swapLambdaX.size());
+    for (size_t i = 0; i < swapCoordsX.size(); i++)
+    {
+        for (int d = 0; d < DIM; d++)
+        {
+            EXPECT_REAL_EQ_TOL(swapCoordsX[i][d], swapLambdaX[i][d], absoluteTolerance(0.002))
+            << "atom " << i << " dimension " << d;
+        }
+    }
+}
+
 /* Note, not all preprocessor implementations nest macro expansions
    the same way / at all, if we would try to duplicate less code. */
 #if GMX_LIB_MPI